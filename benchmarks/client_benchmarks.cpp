@@ -0,0 +1,259 @@
+// Microbenchmarks for the per-turn CPU work of the client: building request
+// payloads, parsing replies, wrapping chat text, exporting Markdown and
+// saving/loading the config. Inputs are parameterized by message size and
+// history length. Write JSON for comparing commits with:
+//
+//   synthara-bench --benchmark_out=bench.json --benchmark_out_format=json
+//
+// With SYNTHARA_TRACK_ALLOCATIONS=1 each benchmark also reports allocations
+// per iteration, bytes allocated and peak heap growth.
+
+#include "alloc_tracker.h"
+#include "config_manager.h"
+#include "google_client.h"
+#include "markdown_exporter.h"
+#include "openai_client.h"
+#include "sse_parser.h"
+#include "terminal_ui.h"
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+using namespace libertymind;
+
+namespace {
+
+// Chat text with the characters JSON escaping and word wrapping care about
+std::string makeText(size_t length) {
+    static const std::string sample =
+        "The quick \"brown\" fox\tjumps over the lazy dog.\nCaf\xc3\xa9 na\xc3\xafve r\xc3\xa9sum\xc3\xa9 \\ path/to/file {x: 1} ";
+    std::string text;
+    text.reserve(length);
+    while (text.size() < length) {
+        text += sample;
+    }
+    // Cut at a character boundary so the text stays valid UTF-8
+    size_t end = length;
+    while (end > 0 && (static_cast<unsigned char>(text[end]) & 0xC0) == 0x80) {
+        --end;
+    }
+    text.resize(end);
+    return text;
+}
+
+// A system message followed by alternating user and assistant turns
+std::vector<Message> makeHistory(size_t messageSize, size_t turns) {
+    std::vector<Message> messages = {{"system", "You are a helpful assistant."}};
+    for (size_t i = 0; i < turns; ++i) {
+        messages.push_back({i % 2 == 0 ? "user" : "assistant", makeText(messageSize)});
+    }
+    return messages;
+}
+
+size_t historyBytes(const std::vector<Message>& messages) {
+    size_t bytes = 0;
+    for (const auto& message : messages) {
+        bytes += message.content.size();
+    }
+    return bytes;
+}
+
+// generateContent response carrying a reply of the given size
+std::string makeGoogleResponse(size_t replySize) {
+    nlohmann::json response = {
+        {"candidates", {{
+            {"content", {{"role", "model"}, {"parts", {{{"text", makeText(replySize)}}}}}},
+            {"finishReason", "STOP"},
+            {"index", 0}
+        }}},
+        {"usageMetadata", {{"promptTokenCount", 120}, {"candidatesTokenCount", replySize / 4}, {"totalTokenCount", 120 + replySize / 4}}},
+        {"modelVersion", "gemini-2.5-flash"}
+    };
+    return response.dump();
+}
+
+// Message size in bytes x number of messages in the history
+void historyArgs(benchmark::internal::Benchmark* benchmark) {
+    for (int size : {64, 1024, 16384}) {
+        for (int turns : {1, 16, 128}) {
+            benchmark->Args({size, turns});
+        }
+    }
+}
+
+void BM_GooglePayload(benchmark::State& state) {
+    auto messages = makeHistory(state.range(0), state.range(1));
+    for (auto _ : state) {
+        std::string payload = GoogleClient::buildRequestPayload(messages).dump();
+        benchmark::DoNotOptimize(payload);
+    }
+    state.SetBytesProcessed(state.iterations() * historyBytes(messages));
+}
+BENCHMARK(BM_GooglePayload)->Apply(historyArgs);
+
+void BM_OpenAIPayload(benchmark::State& state) {
+    auto messages = makeHistory(state.range(0), state.range(1));
+    for (auto _ : state) {
+        std::string payload = OpenAIClient::buildRequestPayload(messages, "local-model", kDefaultMaxOutputTokens).dump();
+        benchmark::DoNotOptimize(payload);
+    }
+    state.SetBytesProcessed(state.iterations() * historyBytes(messages));
+}
+BENCHMARK(BM_OpenAIPayload)->Apply(historyArgs);
+
+void BM_GoogleResponseParse(benchmark::State& state) {
+    HttpResult result;
+    result.status = 200;
+    result.body = makeGoogleResponse(state.range(0));
+
+    TokenUsage usage;
+    std::string reply;
+    for (auto _ : state) {
+        GoogleClient::handleResponse(
+            result,
+            [&usage](const TokenUsage& reported) { usage = reported; },
+            [&reply](const std::string& response, bool) { reply = response; });
+        benchmark::DoNotOptimize(reply);
+    }
+    state.SetBytesProcessed(state.iterations() * result.body.size());
+}
+BENCHMARK(BM_GoogleResponseParse)->Arg(256)->Arg(4096)->Arg(65536);
+
+// A streamed reply of range(0) bytes arriving as SSE events of range(1) bytes of text
+void BM_SseStreamParse(benchmark::State& state) {
+    std::string reply = makeText(state.range(0));
+    std::string stream;
+    for (size_t offset = 0; offset < reply.size();) {
+        // Events carry whole characters
+        size_t end = std::min<size_t>(reply.size(), offset + state.range(1));
+        while (end < reply.size() && (static_cast<unsigned char>(reply[end]) & 0xC0) == 0x80) {
+            ++end;
+        }
+        nlohmann::json chunk = {{"candidates", {{{"content", {{"parts", {{{"text", reply.substr(offset, end - offset)}}}}}}}}}};
+        stream += "data: " + chunk.dump() + "\r\n\r\n";
+        offset = end;
+    }
+
+    for (auto _ : state) {
+        std::string text;
+        SseParser parser([&text](const std::string& data) {
+            nlohmann::json event = nlohmann::json::parse(data);
+            text += event["candidates"][0]["content"]["parts"][0]["text"].get<std::string>();
+        });
+        // Network reads rarely line up with events
+        for (size_t offset = 0; offset < stream.size(); offset += 1400) {
+            parser.feed(stream.data() + offset, std::min<size_t>(1400, stream.size() - offset));
+        }
+        parser.finish();
+        benchmark::DoNotOptimize(text);
+    }
+    state.SetBytesProcessed(state.iterations() * stream.size());
+}
+BENCHMARK(BM_SseStreamParse)->Args({4096, 16})->Args({4096, 256})->Args({65536, 256});
+
+// Lay out the visible tail of a chat the way drawChat does on an 80x24 terminal
+void BM_ChatLayout(benchmark::State& state) {
+    auto messages = makeHistory(state.range(0), state.range(1));
+    const size_t rows = 20;
+    for (auto _ : state) {
+        size_t lines = 0;
+        for (size_t i = messages.size(); i-- > 1 && lines < rows;) {
+            lines += TerminalUI::wrapText(messages[i].content, 76).size() + 2;
+        }
+        benchmark::DoNotOptimize(lines);
+    }
+}
+BENCHMARK(BM_ChatLayout)->Apply(historyArgs);
+
+void BM_GenerateMarkdown(benchmark::State& state) {
+    auto messages = makeHistory(state.range(0), state.range(1));
+    for (auto _ : state) {
+        std::string markdown = MarkdownExporter::generateMarkdown(messages);
+        benchmark::DoNotOptimize(markdown);
+    }
+    state.SetBytesProcessed(state.iterations() * historyBytes(messages));
+}
+BENCHMARK(BM_GenerateMarkdown)->Apply(historyArgs);
+
+// Config with range(0) API keys and endpoints per provider
+void fillConfig(ConfigManager& config, int64_t entries) {
+    std::vector<std::string> endpoints;
+    for (int64_t i = 0; i < entries; ++i) {
+        config.addApiKey(Provider::GOOGLE, "AIza" + std::to_string(1000000 + i) + makeText(24));
+        endpoints.push_back("https://endpoint-" + std::to_string(i) + ".example.com");
+    }
+    config.setEndpoints(Provider::GOOGLE, endpoints);
+    config.flush();
+}
+
+void BM_ConfigSave(benchmark::State& state) {
+    ConfigManager config;
+    fillConfig(config, state.range(0));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(config.saveConfig());
+    }
+}
+BENCHMARK(BM_ConfigSave)->Arg(1)->Arg(32)->Unit(benchmark::kMicrosecond);
+
+void BM_ConfigLoad(benchmark::State& state) {
+    ConfigManager config;
+    fillConfig(config, state.range(0));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(config.loadConfig());
+    }
+}
+BENCHMARK(BM_ConfigLoad)->Arg(1)->Arg(32)->Unit(benchmark::kMicrosecond);
+
+// Feeds the allocation tracker's counters to Google Benchmark's memory report
+class AllocationCounter : public benchmark::MemoryManager {
+public:
+    void Start() override {
+        AllocTracker::resetPeaks();
+        start = AllocTracker::total();
+    }
+
+    void Stop(Result& result) override {
+        AllocStats end = AllocTracker::total();
+        result.num_allocs = static_cast<int64_t>(end.allocations - start.allocations);
+        result.max_bytes_used = end.peakBytes - start.liveBytes;
+        result.total_allocated_bytes = static_cast<int64_t>(end.bytesAllocated - start.bytesAllocated);
+        result.net_heap_growth = end.liveBytes - start.liveBytes;
+    }
+
+    // Older releases only call this form
+    void Stop(Result* result) { Stop(*result); }
+
+private:
+    AllocStats start;
+};
+
+} // namespace
+
+int main(int argc, char** argv) {
+    // Keep the config benchmarks away from the user's real config
+    char home[] = "/tmp/synthara-bench-XXXXXX";
+    if (!mkdtemp(home)) {
+        return 1;
+    }
+    setenv("HOME", home, 1);
+
+    AllocationCounter allocationCounter;
+    if (AllocTracker::isEnabled()) {
+        benchmark::RegisterMemoryManager(&allocationCounter);
+    }
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    benchmark::RegisterMemoryManager(nullptr);
+
+    std::error_code ignored;
+    std::filesystem::remove_all(home, ignored);
+    return 0;
+}
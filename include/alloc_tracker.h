@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+namespace libertymind {
+
+// Subsystems that allocations are charged to
+enum class AllocTag : uint8_t {
+    OTHER,
+    UI,
+    NETWORK,
+    PARSE,
+    SESSION,
+    EXPORT,
+    COUNT
+};
+
+// Counters for one tag (or all of them)
+struct AllocStats {
+    uint64_t allocations = 0;
+    uint64_t frees = 0;
+    uint64_t bytesAllocated = 0;  // Total ever requested
+    int64_t liveBytes = 0;        // Allocated and not yet freed
+    int64_t peakBytes = 0;        // Highest liveBytes seen
+};
+
+// Opt-in accounting of heap allocations made through operator new/delete,
+// charged to the subsystem tag active on the allocating thread. Enabled by
+// setting SYNTHARA_TRACK_ALLOCATIONS=1 in the environment; the choice is made
+// at the process's first allocation and can't change afterwards, since each
+// tracked block carries a small header recording its size and tag. When off,
+// operator new is a plain malloc.
+class AllocTracker {
+public:
+    // Charges allocations on this thread to a tag for the scope's lifetime
+    class Scope {
+    public:
+        explicit Scope(AllocTag tag);
+        ~Scope();
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        AllocTag previous;
+    };
+
+    static bool isEnabled();
+
+    static AllocStats stats(AllocTag tag);
+    static AllocStats total();
+    static const char* tagName(AllocTag tag);
+
+    // Start every peak over from the current live bytes
+    static void resetPeaks();
+
+    // Resident set size and its high-water mark from /proc, in kB (0 if unknown)
+    static void residentMemory(uint64_t& currentKb, uint64_t& peakKb);
+
+    // Write all counters as JSON
+    static bool writeReport(const std::filesystem::path& path, std::string& error);
+};
+
+} // namespace libertymind
@@ -1,9 +1,14 @@
 #pragma once
 
 #include "config_manager.h"
+#include "api_key_pool.h"
+#include "endpoint_selector.h"
+#include "task.h"
+#include <chrono>
 #include <string>
 #include <vector>
 #include <functional>
+#include <map>
 #include <memory>
 #include <nlohmann/json.hpp>
 
@@ -14,19 +19,116 @@ struct Message {
     std::string content;
 };
 
+// Token accounting reported by the provider for a completed request
+struct TokenUsage {
+    int promptTokens = 0;
+    int outputTokens = 0;
+    int totalTokens = 0;
+};
+
+// Outcome of a single HTTP exchange
+struct HttpResult {
+    long status = 0;
+    std::string body;
+    std::string error;
+    double ttfbSeconds = 0.0;   // Time until the first response byte
+    double totalSeconds = 0.0;  // Time for the whole exchange
+    std::map<std::string, std::string> headers;  // Response headers, names lowercased
+
+    // True when the transfer itself succeeded, whatever the HTTP status
+    bool ok() const { return error.empty(); }
+};
+
+// Outcome and timing of one completion request, for routing and diagnostics
+struct RequestStats {
+    std::string model;
+    long status = 0;         // HTTP status (0 if the transfer failed)
+    bool success = false;
+    double ttfbSeconds = 0.0;
+    double totalSeconds = 0.0;
+    int outputTokens = 0;
+};
+
+class ContextCache;
+struct ModelInfo;
+
+// Response length cap used unless a model's own limit is lower
+constexpr int kDefaultMaxOutputTokens = 2000;
+
+// One request of a provider-side batch job
+struct BatchRequest {
+    std::string key;  // Echoed back with the result
+    std::vector<Message> messages;
+    int maxOutputTokens = kDefaultMaxOutputTokens;
+};
+
+// Result of one request of a batch job
+struct BatchResult {
+    std::string key;
+    bool success = false;
+    std::string response;  // Reply text, or an error message
+    TokenUsage usage;
+};
+
+struct BatchJobOptions {
+    std::string displayName = "synthara-batch";
+    std::string jobName;  // Wait for this already-submitted job instead of submitting a new one
+    std::chrono::milliseconds pollInterval{5000};
+    std::chrono::milliseconds maxPollInterval{60000};
+
+    // Called with the job name once it exists and whenever its state changes
+    std::function<void(const std::string& jobName, const std::string& state)> onStatus;
+
+    // Polled while waiting; returning true abandons the wait (the job keeps running)
+    std::function<bool()> shouldStop;
+};
+
 using CompletionCallback = std::function<void(const std::string&, bool)>;
+using UsageCallback = std::function<void(const TokenUsage&)>;
+using RequestStatsCallback = std::function<void(const RequestStats&)>;
+using StreamCallback = std::function<void(const std::string&)>;
+using DataCallback = std::function<void(const char*, size_t)>;
+using BatchResultCallback = std::function<void(const BatchResult&)>;
+
+// One chat completion to run with ApiClient::complete
+struct CompletionRequest {
+    std::vector<Message> messages;
+    std::string model;
+    StreamCallback onChunk;  // Streams the reply when set (called on the network loop)
+};
+
+// Everything a completion produced, in place of the separate callbacks
+struct CompletionResult {
+    std::string response;  // Reply text, or an error message
+    bool success = false;
+    TokenUsage usage;
+    bool hasUsage = false;  // Whether the provider reported usage
+    RequestStats stats;
+};
 
 class ApiClient {
 public:
     ApiClient(const std::string& apiKey);
     virtual ~ApiClient() = default;
 
-    // Send a chat completion request
-    virtual void sendChatCompletion(
+    // Run a chat completion. Starts on the calling thread and continues on the
+    // network loop; the request may outlive the client.
+    virtual Task<CompletionResult> complete(CompletionRequest request) = 0;
+
+    // Run a chat completion, reading the reply as it streams:
+    //
+    //     while (std::optional<std::string> chunk = co_await stream.next()) { ... }
+    //
+    // result is filled in once the stream ends and must outlive it
+    AsyncGenerator<std::string> streamCompletion(CompletionRequest request, CompletionResult& result);
+
+    // Callback form of complete(), using the client's stream, usage and stats callbacks.
+    // They run one at a time, in order, on a network worker thread rather than the loop.
+    void sendChatCompletion(
         const std::vector<Message>& messages,
         const std::string& model,
         CompletionCallback callback
-    ) = 0;
+    );
 
     // Check if API key is valid
     virtual bool validateApiKey() = 0;
@@ -34,12 +136,115 @@ public:
     // Get the base URL for the API
     virtual std::string getBaseUrl() const = 0;
 
+    // Count the tokens a set of messages would use (-1 if unsupported or failed)
+    virtual int countTokens(const std::vector<Message>& messages, const std::string& model);
+
+    // List the models this key can generate with (false if unsupported or failed)
+    virtual bool listModels(std::vector<ModelInfo>& models);
+
+    // Run requests as one asynchronous job on the provider's side: submit them,
+    // wait for the job and hand each result to onResult as it is downloaded.
+    // Blocks until then; false with an error if unsupported, failed or stopped.
+    virtual bool runBatchJob(
+        const std::vector<BatchRequest>& requests,
+        const std::string& model,
+        const BatchJobOptions& options,
+        const BatchResultCallback& onResult,
+        std::string& error
+    );
+
+    // Cap the number of tokens generated per response
+    void setMaxOutputTokens(int tokens);
+
+    // Receive provider-reported token usage for completed requests
+    void setUsageCallback(UsageCallback callback);
+
+    // Receive reply text as it arrives (providers without streaming send nothing until the end)
+    void setStreamCallback(StreamCallback callback);
+
+    // Receive status and timing for each completed request, before the completion callback
+    void setRequestStatsCallback(RequestStatsCallback callback);
+
+    // Spread requests across a pool of keys instead of the client's own key
+    void setKeyPool(std::shared_ptr<ApiKeyPool> pool);
+
+    // Route requests between several endpoints, failing over on errors
+    void setEndpointSelector(std::shared_ptr<EndpointSelector> selector);
+
+    // Share a prompt-prefix cache across requests (ignored by providers without caching)
+    void setContextCache(std::shared_ptr<ContextCache> cache);
+
 protected:
+    // Client settings a request uses, copied so it can finish after the client is gone
+    struct RequestSettings {
+        std::string apiKey;
+        std::shared_ptr<ApiKeyPool> keyPool;
+        std::shared_ptr<EndpointSelector> endpointSelector;
+        std::shared_ptr<ContextCache> contextCache;
+        int maxOutputTokens = kDefaultMaxOutputTokens;
+    };
+
     std::string apiKey;
+    UsageCallback usageCallback;
+    RequestStatsCallback requestStatsCallback;
+    StreamCallback streamCallback;
+    std::shared_ptr<ContextCache> contextCache;
+    std::shared_ptr<ApiKeyPool> keyPool;
+    std::shared_ptr<EndpointSelector> endpointSelector;
+    int maxOutputTokens = kDefaultMaxOutputTokens;
+
+    // Endpoints to try in order (the provider's default if none are configured)
+    static std::vector<std::string> candidateEndpoints(
+        const std::shared_ptr<EndpointSelector>& selector,
+        const std::string& defaultEndpoint
+    );
+
+    RequestSettings getRequestSettings() const;
+
+    // Check out a key from the pool (an empty lease means use apiKey)
+    static ApiKeyPool::Lease acquireKey(const std::shared_ptr<ApiKeyPool>& pool);
 
     // Helper method for making HTTP requests
     static size_t writeCallback(char* ptr, size_t size, size_t nmemb, std::string* data);
 
+    // Perform an HTTP request with an optional JSON body (safe to call from worker threads)
+    static HttpResult performRequest(
+        const std::string& method,
+        const std::string& url,
+        const std::string& body,
+        const std::vector<std::string>& headers = {}
+    );
+
+    // Perform an HTTP request, handing the response body to onData as it arrives.
+    // timeoutSeconds caps the whole request; streams that may run long pass 0.
+    static HttpResult performStreamingRequest(
+        const std::string& method,
+        const std::string& url,
+        const std::string& body,
+        const std::vector<std::string>& headers,
+        const DataCallback& onData,
+        long timeoutSeconds = 0
+    );
+
+    // performStreamingRequest on the network loop, without a thread of its own.
+    // The arguments must outlive the task, so await it where it is created.
+    static Task<HttpResult> performStreamingRequestAsync(
+        const std::string& method,
+        const std::string& url,
+        const std::string& body,
+        const std::vector<std::string>& headers,
+        const DataCallback& onData,
+        long timeoutSeconds = 0
+    );
+
+    // performRequest on the network loop; the same lifetime rule applies
+    static Task<HttpResult> performRequestAsync(
+        const std::string& method,
+        const std::string& url,
+        const std::string& body,
+        const std::vector<std::string>& headers = {}
+    );
+
     // Make a POST request with JSON payload
     bool makePostRequest(
         const std::string& url,
@@ -49,7 +254,35 @@ protected:
     );
 };
 
+// Initialize libcurl once per process; safe to call from any thread
+void ensureCurlInitialized();
+
+// Limits that turn an unreachable or stalled endpoint into a transport error, so
+// requests fail over instead of hanging. Read once from the environment.
+struct TransferTimeouts {
+    long connectMilliseconds;  // SYNTHARA_CONNECT_TIMEOUT_MS (default 10000)
+    long stallSeconds;         // SYNTHARA_STALL_TIMEOUT_S: no data for this long (default 60)
+    long requestSeconds;       // SYNTHARA_REQUEST_TIMEOUT_S: whole non-streamed request (default 300, 0 = none)
+};
+const TransferTimeouts& getTransferTimeouts();
+
+// Split an "http+unix://<percent-encoded socket path>/path" URL into the socket
+// path and a plain http URL; false for ordinary URLs, or with an error if malformed
+bool splitUnixSocketUrl(const std::string& url, std::string& socketPath, std::string& httpUrl, std::string& error);
+
+// Keep at most this much of a response body for error messages
+constexpr size_t kMaxErrorBody = 64 * 1024;
+
+// Append streamed response bytes to an error body, stopping at kMaxErrorBody
+void appendErrorBody(std::string& body, const char* data, size_t size);
+
+// Short reason an API call failed, from the error payload when there is one
+std::string describeFailure(const HttpResult& result);
+
 // Factory function to create the appropriate API client
 std::unique_ptr<ApiClient> createApiClient(Provider provider, const std::string& apiKey);
 
+// Create a client that spreads its requests across a key pool
+std::unique_ptr<ApiClient> createApiClient(Provider provider, std::shared_ptr<ApiKeyPool> keyPool);
+
 } // namespace libertymind
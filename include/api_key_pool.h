@@ -0,0 +1,86 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace libertymind {
+
+// Spreads requests across several API keys for one provider. Each key
+// tracks its own in-flight count and rate-limit state; a key that gets a
+// 429 or 403 cools off for a while so the others carry the load.
+class ApiKeyPool : public std::enable_shared_from_this<ApiKeyPool> {
+public:
+    // A key checked out for one request; returned to the pool when destroyed
+    class Lease {
+    public:
+        Lease() = default;
+        Lease(std::shared_ptr<ApiKeyPool> pool, std::string key);
+        ~Lease();
+
+        Lease(Lease&& other) noexcept;
+        Lease& operator=(Lease&& other) noexcept;
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+
+        const std::string& key() const { return apiKey; }
+
+        // Record the HTTP status of the request made with this key
+        void setStatus(long status) { lastStatus = status; }
+
+        // Return the key to the pool now instead of on destruction
+        void release();
+
+    private:
+        std::shared_ptr<ApiKeyPool> pool;
+        std::string apiKey;
+        long lastStatus = 0;
+    };
+
+    struct KeyStatus {
+        std::string key;
+        int inFlight = 0;
+        uint64_t requests = 0;
+        uint64_t throttled = 0;
+        bool coolingDown = false;
+    };
+
+    explicit ApiKeyPool(const std::vector<std::string>& keys = {});
+
+    // Replace the key list, keeping the state of keys that remain
+    void setKeys(const std::vector<std::string>& keys);
+
+    // Check out the least-loaded key that isn't cooling down (round-robin among
+    // equals). If every key is cooling down, the one that recovers first is used.
+    Lease acquire();
+
+    size_t size() const;
+    std::vector<KeyStatus> getStatus() const;
+
+    // How long a key rests after a 429 (doubling while it keeps happening) or a 403
+    static constexpr std::chrono::seconds kThrottleCooldown{30};
+    static constexpr std::chrono::seconds kMaxThrottleCooldown{300};
+    static constexpr std::chrono::seconds kForbiddenCooldown{300};
+
+private:
+    struct KeyState {
+        std::string key;
+        int inFlight = 0;
+        uint64_t requests = 0;
+        uint64_t throttled = 0;
+        uint64_t lastUsed = 0;
+        int consecutiveThrottles = 0;
+        std::chrono::steady_clock::time_point cooldownUntil;
+    };
+
+    mutable std::mutex mutex;
+    std::vector<KeyState> keys;
+    uint64_t sequence = 0;
+
+    void release(const std::string& key, long status);
+};
+
+} // namespace libertymind
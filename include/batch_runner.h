@@ -0,0 +1,167 @@
+#pragma once
+
+#include "api_client.h"
+#include "config_manager.h"
+#include "model_router.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace libertymind {
+
+struct BatchOptions {
+    std::filesystem::path inputPath;
+    std::filesystem::path outputPath;      // Results as JSONL
+    std::filesystem::path checkpointPath;  // Progress for --resume
+    size_t concurrency = 8;                // Requests in flight at once
+    double requestsPerSecond = 0.0;        // Start rate limit (0 = unlimited)
+    bool ordered = true;                   // Write results in input order rather than as they complete
+    bool resume = false;                   // Continue from the checkpoint instead of starting over
+    int maxRetries = 3;                    // Retries for 429, 5xx and transport errors
+    std::string model;                     // Default model for items that don't name one
+    bool providerJobs = false;             // Submit provider-side batch jobs instead of live requests
+};
+
+// Snapshot of a running batch
+struct BatchProgress {
+    size_t total = 0;
+    size_t completed = 0;  // Results written or buffered, including failures and earlier runs
+    size_t failed = 0;
+    size_t inFlight = 0;
+    uint64_t outputTokens = 0;
+    double seconds = 0.0;
+    double requestsPerSecond = 0.0;
+    double tokensPerSecond = 0.0;
+    double p50Seconds = 0.0;
+    double p90Seconds = 0.0;
+    double p99Seconds = 0.0;
+    std::string status;    // State of provider-side batch jobs, if any
+};
+
+// Runs every request of a JSONL file against the configured provider with
+// bounded concurrency. Each input line is an object with "prompt" (or
+// "messages") and optional "id", "system", "model" and "max_output_tokens".
+// All requests share one key pool, endpoint selector and connection cache.
+// Results are checkpointed so an interrupted run can resume where it stopped.
+// With providerJobs the items are grouped by model and submitted as batch jobs
+// (ApiClient::runBatchJob); the checkpoint then remembers the job names so a
+// resumed run waits for the same jobs instead of submitting new ones.
+class BatchRunner {
+public:
+    BatchRunner(std::shared_ptr<ConfigManager> configManager, BatchOptions options);
+
+    // Run the batch, reporting progress about once a second. Returns false if
+    // the input, output or checkpoint couldn't be used (see getError()).
+    bool run(const std::function<void(const BatchProgress&)>& onProgress);
+
+    // Stop starting requests; run() returns once those in flight finish
+    void interrupt();
+
+    bool wasInterrupted() const;
+    BatchProgress getProgress() const;
+    std::string getError() const;
+
+private:
+    struct Item {
+        size_t index = 0;
+        nlohmann::json id;
+        std::vector<Message> messages;
+        std::string model;
+        int maxOutputTokens = kDefaultMaxOutputTokens;
+        std::string invalid;  // Why the input line couldn't be used
+    };
+
+    struct Retry {
+        size_t index;
+        int attempt;
+        std::chrono::steady_clock::time_point readyAt;
+    };
+
+    std::shared_ptr<ConfigManager> configManager;
+    BatchOptions options;
+    std::string error;
+
+    std::vector<Item> items;
+    std::vector<bool> done;  // Result is in the output file
+    uint64_t inputSize;
+
+    std::shared_ptr<ApiKeyPool> keyPool;
+    std::shared_ptr<EndpointSelector> endpointSelector;
+    std::shared_ptr<ModelRouter> modelRouter;
+
+    mutable std::mutex mutex;
+    std::condition_variable condition;
+    std::atomic<bool> interrupted;
+
+    // Dispatch state
+    size_t cursor;
+    size_t inFlight;
+    std::deque<Retry> retries;
+    std::chrono::steady_clock::time_point nextStart;
+    std::chrono::steady_clock::time_point pausedUntil;
+
+    // Output state
+    int outputFd;
+    uint64_t outputBytes;
+    size_t nextToWrite;
+    std::map<size_t, std::string> reorderBuffer;
+
+    // Statistics for this run
+    std::chrono::steady_clock::time_point startTime;
+    size_t completed;
+    size_t completedBefore;
+    size_t failed;
+    uint64_t outputTokens;
+    std::vector<double> latencies;
+
+    // Provider-side batch jobs by model, and their latest states
+    std::map<std::string, std::string> jobNames;
+    std::map<std::string, std::string> jobStates;
+
+    // Model "auto" items were submitted on, kept in the checkpoint so a resumed
+    // run finds their job again even if the tiers now rank differently
+    std::string jobAutoModel;
+
+    bool loadInput();
+    bool openOutput(uint64_t outputSize);
+    bool loadCheckpoint(uint64_t& outputSize);
+    bool saveCheckpoint();
+
+    // Dispatch live requests until every item is done or the run is interrupted
+    void runRequests(const std::function<void(const BatchProgress&)>& onProgress);
+
+    // Submit and wait for one batch job per model
+    void runJobs(const std::function<void(const BatchProgress&)>& onProgress);
+
+    // Model an item runs on ("auto" resolves to the best-ranked tier)
+    std::string resolveModel(const Item& item) const;
+
+    // Pick the next item to start, or false if none may start yet
+    bool takeNext(size_t& index, int& attempt, std::chrono::steady_clock::time_point& wakeAt);
+
+    void start(size_t index, int attempt);
+    void finish(size_t index, int attempt, const std::string& response, bool success,
+                const RequestStats& stats, const TokenUsage& usage, double latency);
+
+    // Store an item's final result (called with the mutex held)
+    void record(size_t index, int attempts, const std::string& model, const std::string& response, bool success,
+                long status, const TokenUsage& usage, double latency, double ttfb);
+
+    // Append result lines to the output file (called with the mutex held)
+    void writeResult(size_t index, const std::string& line);
+    bool writeAll(const std::string& data);
+
+    std::unique_ptr<ApiClient> createClient() const;
+    BatchProgress progressLocked() const;
+};
+
+} // namespace libertymind
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <string>
+#include <filesystem>
+#include <cstdint>
+
+namespace libertymind {
+
+enum class ExportFormat {
+    MARKDOWN,
+    JSONL
+};
+
+struct BulkExportOptions {
+    ExportFormat format = ExportFormat::MARKDOWN;
+    size_t jobs = 0; // 0 uses one worker per hardware thread
+    std::filesystem::path sessionDirectory;
+    std::filesystem::path outputDirectory;
+};
+
+struct BulkExportStats {
+    size_t sessions = 0;
+    size_t failed = 0;
+    uint64_t bytesRead = 0;
+    uint64_t bytesWritten = 0;
+    double seconds = 0.0;
+};
+
+// Exports every saved session in parallel, streaming each one from disk to disk
+class BulkExporter {
+public:
+    // Export all sessions found in the session directory
+    static BulkExportStats exportAll(const BulkExportOptions& options);
+
+    // Export a single saved session
+    static bool exportSession(
+        const std::filesystem::path& sessionPath,
+        const std::filesystem::path& outputPath,
+        ExportFormat format,
+        uint64_t& bytesWritten
+    );
+
+    // File extension for an export format
+    static std::string extensionFor(ExportFormat format);
+};
+
+} // namespace libertymind
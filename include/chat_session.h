@@ -2,28 +2,62 @@
 
 #include "api_client.h"
 #include "config_manager.h"
+#include "context_manager.h"
+#include "context_cache.h"
+#include "model_registry.h"
+#include "model_router.h"
+#include "session_store.h"
+#include <atomic>
+#include <chrono>
 #include <string>
 #include <vector>
 #include <memory>
 #include <functional>
+#include <mutex>
 
 namespace libertymind {
 
 using ChatCallback = std::function<void(const std::string&, bool)>;
 
+// Live request and history numbers for the performance HUD
+struct SessionPerf {
+    int requestsInFlight = 0;
+    double lastTtfbSeconds = 0.0;   // Of the last completed request
+    double lastTotalSeconds = 0.0;
+    double tokensPerSecond = 0.0;   // Of the reply streaming now, otherwise the last one
+    bool streaming = false;
+    uint64_t cacheHits = 0;
+    uint64_t cacheLookups = 0;
+    size_t historyMessages = 0;
+    size_t historyBytes = 0;
+};
+
 class ChatSession {
 public:
     ChatSession(std::shared_ptr<ConfigManager> configManager);
     ~ChatSession() = default;
     
-    // Send a message to the model
+    // Send a message to the model. Runs on the caller's thread up to the first
+    // request, so the message is in the history when this returns; the reply
+    // (or an error) comes back on the network loop.
+    Task<CompletionResult> send(std::string message);
+
+    // Callback form of send()
     void sendMessage(const std::string& message, ChatCallback callback);
     
     // Clear the conversation history
     void clearHistory();
     
-    // Get the conversation history
-    const std::vector<Message>& getHistory() const;
+    // Number of messages in the history; safe from any thread
+    size_t getHistorySize() const;
+
+    // Changes whenever existing messages change (cleared, system message edited);
+    // appending doesn't change it
+    uint64_t getHistoryRevision() const;
+
+    // Copy up to count messages starting at begin, for readers on other threads.
+    // False if the history was revised since revision was read.
+    bool copyHistory(size_t begin, size_t count, uint64_t revision, std::vector<Message>& messages) const;
     
     // Set system message
     void setSystemMessage(const std::string& message);
@@ -31,11 +65,74 @@ public:
     // Get system message
     std::string getSystemMessage() const;
 
+    // Get the context window manager
+    const ContextManager& getContextManager() const;
+
+    // Text of the reply streamed so far (empty when no reply is in progress)
+    std::string getPendingReply() const;
+
+    // Also hand each streamed chunk to a callback (called on the network loop)
+    void setStreamCallback(StreamCallback callback);
+
+    // Live per-model performance used by the "auto" model
+    const ModelRouter& getModelRouter() const;
+
+    // Snapshot of request timing, throughput and history size
+    SessionPerf getPerf() const;
+
+    // Size requests using the token limits of discovered models
+    void setModelRegistry(std::shared_ptr<ModelRegistry> registry);
+
+    // Tune token estimates with a countTokens call on the first request (on by default;
+    // one-shot runs end before it pays off)
+    void setCalibrationEnabled(bool enabled);
+
 private:
     std::shared_ptr<ConfigManager> configManager;
     std::vector<Message> history;
+    uint64_t historyRevision;
+    mutable std::mutex historyMutex;  // Held for every access; replies are appended on the network loop
     std::string systemMessage;
+    ContextManager contextManager;
+    std::shared_ptr<ContextCache> contextCache;
+    std::shared_ptr<ModelRouter> modelRouter;
+    std::shared_ptr<ApiKeyPool> keyPool;
+    std::shared_ptr<EndpointSelector> endpointSelector;
+    std::shared_ptr<ModelRegistry> modelRegistry;
+    // Saved session, appended to from the caller's thread and from offload workers.
+    // Taken before historyMutex when both are held.
+    mutable std::mutex sessionMutex;
+    SessionStore sessionStore;
+    bool sessionSaved;
+    bool calibrationEnabled;
+
+    // Reply text streamed on the network loop, drawn by the UI until it completes
+    mutable std::mutex pendingMutex;
+    std::string pendingReply;
+    std::chrono::steady_clock::time_point pendingStarted;  // First chunk of pendingReply
+    StreamCallback streamCallback;
+
+    // Timing of finished requests for getPerf
+    mutable std::mutex perfMutex;
+    RequestStats lastRequest;
+    std::atomic<int> requestsInFlight;
+
+    // Apply the configured context budget and caching thresholds, capped by the model's limits
+    void refreshContextSettings(const std::optional<ModelInfo>& modelInfo = std::nullopt);
+
+    // Registry entry for a model, if known
+    std::optional<ModelInfo> getModelInfo(const std::string& model) const;
     
+    // Point a client at a model's output limit and the session's cache
+    void configureClient(ApiClient& client, const std::string& model) const;
+
+    // Add streamed reply text for the UI and the stream callback
+    void appendPendingReply(const std::string& chunk);
+
+    // Append a message to the saved session, starting it with the system message.
+    // With onlyIfSaved, a session that hasn't been started yet is left alone.
+    void persistMessage(const Message& message, bool onlyIfSaved = false);
+
     // Create a new API client based on the current configuration
     std::unique_ptr<ApiClient> createClient() const;
 };
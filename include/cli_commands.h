@@ -0,0 +1,17 @@
+#pragma once
+
+namespace libertymind {
+
+// Headless subcommands dispatched from main() before any UI is created.
+// Each returns the process exit status.
+
+// synthara export --all [--format md|jsonl] [--jobs N] [--out DIR] [--sessions DIR]
+int runExportCommand(int argc, char** argv);
+
+// synthara batch [INPUT] [--out FILE] [--concurrency N] [--rps R] [--unordered] [--resume] ...
+int runBatchCommand(int argc, char** argv);
+
+// synthara -p PROMPT [--model ID] [--provider NAME] [--system TEXT] [--no-save], or a prompt on stdin
+int runPromptCommand(int argc, char** argv);
+
+} // namespace libertymind
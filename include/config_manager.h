@@ -2,25 +2,41 @@
 
 #include <string>
 #include <unordered_map>
+#include <vector>
 #include <filesystem>
 #include <fstream>
 #include <optional>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <nlohmann/json_fwd.hpp>
 
 namespace libertymind {
 
 enum class Provider {
-    GOOGLE
+    GOOGLE,
+    OPENAI_COMPATIBLE
 };
 
 class ConfigManager {
 public:
     ConfigManager();
-    ~ConfigManager() = default;
+    ~ConfigManager();
 
-    // API key management
+    ConfigManager(const ConfigManager&) = delete;
+    ConfigManager& operator=(const ConfigManager&) = delete;
+
+    // API key management (setApiKey replaces the provider's pool with one key).
+    // Surrounding whitespace is trimmed; false if what is left isn't a plausible key.
     bool setApiKey(Provider provider, const std::string& key);
     std::optional<std::string> getApiKey(Provider provider) const;
 
+    // Additional keys requests are spread across (false if invalid or already pooled)
+    bool addApiKey(Provider provider, const std::string& key);
+    std::vector<std::string> getApiKeys(Provider provider) const;
+
     // Provider and model selection
     void setSelectedProvider(Provider provider);
     Provider getSelectedProvider() const;
@@ -28,21 +44,114 @@ public:
     void setSelectedModel(const std::string& model);
     std::string getSelectedModel() const;
 
-    // Save and load configuration
+    // Context window management
+    void setContextTokenBudget(size_t tokens);
+    size_t getContextTokenBudget() const;
+
+    void setContextRecentTurns(size_t turns);
+    size_t getContextRecentTurns() const;
+
+    void setSummaryModel(const std::string& model);
+    std::string getSummaryModel() const;
+
+    // Server-side prompt prefix caching
+    void setContextCacheMinTokens(size_t tokens);
+    size_t getContextCacheMinTokens() const;
+
+    void setContextCacheTtlSeconds(int seconds);
+    int getContextCacheTtlSeconds() const;
+
+    // API endpoints (scheme and host, without the API version) to route between.
+    // SYNTHARA_GOOGLE_BASE_URL / SYNTHARA_OPENAI_BASE_URL replace the list when set.
+    void setEndpoints(Provider provider, const std::vector<std::string>& urls);
+    std::vector<std::string> getEndpoints(Provider provider) const;
+
+    // Models the "auto" option may route to, in order of preference
+    void setAutoModelTiers(const std::vector<std::string>& models);
+    std::vector<std::string> getAutoModelTiers() const;
+
+    // Session persistence
+    void setSaveSessions(bool enabled);
+    bool getSaveSessions() const;
+
+    // Save and load configuration (setters save in the background)
     bool saveConfig() const;
     bool loadConfig();
 
+    // Write pending changes now instead of waiting for the background flush
+    bool flush();
+
+    // Keep later changes in memory only (used for command-line overrides)
+    void setReadOnly(bool enabled);
+
+    // Watch config.json and apply edits made by other processes
+    void enableHotReload();
+
+    // Number of times the configuration was reloaded after an external edit
+    uint64_t getReloadCount() const;
+
     // Convert Provider enum to string and back
     static std::string providerToString(Provider provider);
     static Provider stringToProvider(const std::string& providerStr);
 
+    // Whether requests to a provider need an API key (local servers often don't)
+    static bool requiresApiKey(Provider provider);
+
+    // Non-empty printable text without spaces, as every provider's keys are
+    static bool isValidApiKey(const std::string& key);
+
 private:
-    std::unordered_map<Provider, std::string> apiKeys;
-    Provider selectedProvider;
-    std::string selectedModel;
+    // Everything stored in config.json. A file is parsed into a fresh copy, which
+    // replaces the current one only if the whole file is valid.
+    struct Settings {
+        std::unordered_map<Provider, std::vector<std::string>> apiKeys;
+        Provider selectedProvider;
+        std::string selectedModel;
+        size_t contextTokenBudget;
+        size_t contextRecentTurns;
+        std::string summaryModel;
+        size_t contextCacheMinTokens;
+        int contextCacheTtlSeconds;
+        std::unordered_map<Provider, std::vector<std::string>> endpoints;
+        std::vector<std::string> autoModelTiers;
+        bool saveSessions;
+
+        Settings();
+    };
+
+    Settings settings;
     std::filesystem::path configPath;
 
+    // Guards all settings; settings may change from the reload thread
+    mutable std::mutex mutex;
+
+    // Debounced background persistence
+    std::condition_variable flushCondition;
+    std::thread flushThread;
+    std::chrono::steady_clock::time_point lastChange;
+    bool dirty;
+    bool stopping;
+    bool readOnly;
+
+    // Serializes file writes and remembers what we last wrote, to ignore our own changes
+    mutable std::mutex writeMutex;
+    mutable std::string lastWrittenContent;
+
+    // Hot reload
+    std::thread watchThread;
+    int inotifyFd;
+    int wakePipe[2];
+    std::atomic<uint64_t> reloadCount;
+
     void initConfigPath();
+    void markDirty();
+    void flushLoop();
+    void watchLoop();
+    void reloadIfChanged();
+    nlohmann::json toJson() const;
+    // Throws if a setting has the wrong type or an out-of-range value
+    Settings parseJson(const nlohmann::json& config) const;
+    bool writeConfigFile(const std::string& content) const;
     void encryptApiKey(std::string& key) const;
     void decryptApiKey(std::string& key) const;
 };
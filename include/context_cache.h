@@ -0,0 +1,96 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <unordered_map>
+#include <chrono>
+#include <cstdint>
+
+namespace libertymind {
+
+// Tracks server-side cached prompt prefixes (Gemini cachedContents) for one session.
+// Entries belong to the API key that created them, so each key of a pool has its own.
+class ContextCache {
+public:
+    enum class Lookup {
+        SKIP,    // Prefix too small or previously rejected, send it inline
+        MISS,    // No live entry, create one
+        HIT,     // Live entry, reference it
+        REFRESH  // Live entry close to expiry, extend its TTL then reference it
+    };
+
+    ContextCache(size_t minTokens = 4096, int ttlSeconds = 3600);
+    ~ContextCache() = default;
+
+    // Thresholds and lifetime of cache entries
+    void setMinTokens(size_t tokens);
+    size_t getMinTokens() const;
+
+    void setTtlSeconds(int seconds);
+    int getTtlSeconds() const;
+
+    // Whether using the cache for this prefix would take requests to the server:
+    // an entry must be created or extended, or replaced entries await deletion.
+    // When false, lookup() answers from memory.
+    bool mayNeedRequests(const std::string& apiKey, const std::string& model, const std::string& prefix) const;
+
+    // Look up the key's entry for a model and prefix, returning its name on HIT/REFRESH
+    Lookup lookup(const std::string& apiKey, const std::string& model, const std::string& prefix, std::string& name);
+
+    // Record a newly created or refreshed entry
+    void store(const std::string& apiKey, const std::string& model, const std::string& prefix, const std::string& name);
+
+    // Remember that the server refused to cache this prefix
+    void markRejected(const std::string& model, const std::string& prefix);
+
+    // Creating an entry failed for a passing reason (throttling, server error);
+    // send prefixes inline for a while, backing off further on each failure
+    void deferCreation();
+
+    // Forget every entry; each is deleted on the next request made with its key
+    void invalidate();
+
+    // Forget one key's entry, e.g. after the server stopped accepting it
+    void invalidate(const std::string& apiKey);
+
+    // Take names of the key's entries that should be deleted server-side
+    std::vector<std::string> takePendingDeletions(const std::string& apiKey);
+
+    // Serializes entry creation so concurrent requests don't create duplicates
+    std::mutex& creationMutex();
+
+    // Lookups that found a live entry, out of all that could have (SKIPs aren't counted)
+    void getHitStats(uint64_t& hits, uint64_t& lookups) const;
+
+private:
+    mutable std::mutex mutex;
+    std::mutex createMutex;
+    size_t minTokens;
+    int ttlSeconds;
+
+    // The live entry of one API key and the replaced ones still to delete with it
+    struct Entry {
+        std::string name;
+        size_t key = 0;
+        std::chrono::steady_clock::time_point expiresAt;
+        std::vector<std::string> pendingDeletions;
+    };
+    std::unordered_map<std::string, Entry> entries;  // By API key
+
+    size_t rejectedKey;
+    int creationFailures;
+    std::chrono::steady_clock::time_point retryCreationAt;
+    uint64_t hitCount;
+    uint64_t lookupCount;
+
+    static size_t makeKey(const std::string& model, const std::string& prefix);
+
+    // What lookup() would answer for a cacheable prefix, without side effects (mutex held)
+    Lookup classify(const Entry* entry, size_t key, std::chrono::steady_clock::time_point now) const;
+
+    // Queue the entry's live name for deletion (mutex held)
+    static void retire(Entry& entry);
+};
+
+} // namespace libertymind
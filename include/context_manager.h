@@ -0,0 +1,86 @@
+#pragma once
+
+#include "api_client.h"
+#include <chrono>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <functional>
+
+namespace libertymind {
+
+struct ContextSettings {
+    size_t tokenBudget = 32000;
+    size_t recentTurns = 6;
+    std::string summaryModel = "gemini-2.0-flash-lite";
+};
+
+using ClientFactory = std::function<std::unique_ptr<ApiClient>()>;
+
+class ContextManager {
+public:
+    ContextManager();
+    ~ContextManager();
+
+    ContextManager(const ContextManager&) = delete;
+    ContextManager& operator=(const ContextManager&) = delete;
+
+    // Update the budget, recent-turn window and summary model
+    void setSettings(const ContextSettings& settings);
+    ContextSettings getSettings() const;
+
+    // Estimate the tokens used by text or a single message
+    size_t estimateTokens(const std::string& text) const;
+    size_t estimateTokens(const Message& message) const;
+
+    // Build the messages to send for the given history within the token budget
+    std::vector<Message> buildContext(const std::vector<Message>& history) const;
+
+    // Refine the estimator with the provider-reported prompt size of a context
+    void recordUsage(const std::vector<Message>& context, int promptTokens);
+
+    // Calibrate the estimator with countTokens on the background lane. Only one
+    // call runs at a time, failures back off, and after a few attempts usage
+    // reports are left to calibrate on their own. The factory is called on this thread.
+    void calibrate(const std::vector<Message>& context, const std::string& model, ClientFactory clientFactory);
+
+    // Fold turns older than the recent window into the rolling summary
+    void maybeCompact(const std::vector<Message>& history, ClientFactory clientFactory);
+
+    // Drop the summary, e.g. when the history is cleared
+    void reset();
+
+    // Get the current rolling summary
+    std::string getSummary() const;
+
+private:
+    // Shared with background summarization so late results stay safe
+    struct State {
+        mutable std::mutex mutex;
+        ContextSettings settings;
+        double charsPerToken = 4.0;
+        bool calibrated = false;
+        bool calibrating = false;  // A countTokens call is in flight
+        int calibrationAttempts = 0;
+        std::chrono::steady_clock::time_point nextCalibration;  // Backoff after a failed attempt
+        bool cancelled = false;    // The manager is gone; late results are dropped
+        std::string summary;
+        size_t foldedUpTo = 1;
+        size_t generation = 0;
+        bool compacting = false;
+    };
+
+    std::shared_ptr<State> state;
+
+    // Index of the first message in the recent-turn window
+    static size_t recentWindowStart(const std::vector<Message>& history, size_t recentTurns);
+
+    // Blend a measured prompt size into the chars-per-token ratio
+    static void applyUsage(State& state, const std::vector<Message>& context, int promptTokens);
+
+    // Clear the in-flight mark, scheduling the next attempt after a failure
+    static void finishCalibration(State& state, bool success);
+};
+
+} // namespace libertymind
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace libertymind {
+
+// Latency and health of one API endpoint
+struct EndpointStatus {
+    std::string url;
+    bool probed = false;
+    bool healthy = true;
+    double rttSeconds = 0.0;        // Smoothed time to first response byte of a probe
+    double connectSeconds = 0.0;    // TCP connect time of the last probe
+    double handshakeSeconds = 0.0;  // TLS handshake time of the last probe
+    int consecutiveFailures = 0;
+};
+
+// Picks the lowest-latency healthy endpoint from a configured list. A
+// background thread probes every endpoint periodically; request failures
+// mark an endpoint unhealthy until it answers a probe again.
+class EndpointSelector {
+public:
+    explicit EndpointSelector(const std::vector<std::string>& urls = {});
+    ~EndpointSelector();
+
+    EndpointSelector(const EndpointSelector&) = delete;
+    EndpointSelector& operator=(const EndpointSelector&) = delete;
+
+    // Replace the endpoint list, keeping measurements for endpoints that remain
+    void setEndpoints(const std::vector<std::string>& urls);
+
+    // Endpoints to try in order: healthy ones by latency, then the rest
+    std::vector<std::string> rank() const;
+
+    // Report the outcome of a real request
+    void reportSuccess(const std::string& url);
+    void reportFailure(const std::string& url);
+
+    // Probe all endpoints now (blocking; a no-op for a single endpoint)
+    void probeAll();
+
+    // Probe in the background every interval until destroyed
+    void startProbing(std::chrono::seconds interval = kProbeInterval);
+
+    std::vector<EndpointStatus> getStatus() const;
+
+    static constexpr std::chrono::seconds kProbeInterval{60};
+
+private:
+    mutable std::mutex mutex;
+    std::vector<EndpointStatus> endpoints;
+
+    std::thread probeThread;
+    std::condition_variable probeCondition;
+    bool stopping;
+
+    // Time a HEAD request to one endpoint; false if it couldn't be reached
+    static bool probe(const std::string& url, double& rtt, double& connect, double& handshake);
+};
+
+} // namespace libertymind
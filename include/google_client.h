@@ -9,15 +9,70 @@ public:
     GoogleClient(const std::string& apiKey);
     ~GoogleClient() override = default;
     
-    void sendChatCompletion(
-        const std::vector<Message>& messages,
-        const std::string& model,
-        CompletionCallback callback
-    ) override;
+    Task<CompletionResult> complete(CompletionRequest request) override;
     
     bool validateApiKey() override;
     
     std::string getBaseUrl() const override;
+
+    int countTokens(const std::vector<Message>& messages, const std::string& model) override;
+
+    bool listModels(std::vector<ModelInfo>& models) override;
+
+    // Gemini Batch API: upload the requests as a JSONL file, create a batch,
+    // poll it with backoff, then stream the results file back line by line
+    bool runBatchJob(
+        const std::vector<BatchRequest>& requests,
+        const std::string& model,
+        const BatchJobOptions& options,
+        const BatchResultCallback& onResult,
+        std::string& error
+    ) override;
+
+    // Build the "contents" and "systemInstruction" fields from chat messages
+    static nlohmann::json buildRequestPayload(const std::vector<Message>& messages, const std::string& cachedContent = "");
+
+    // Parse a generateContent response and invoke the callbacks
+    static void handleResponse(
+        const HttpResult& result,
+        const UsageCallback& usageCallback,
+        const CompletionCallback& callback
+    );
+
+private:
+    // Tries each endpoint in turn, using a cached prefix when there is one
+    static Task<CompletionResult> runCompletion(RequestSettings settings, CompletionRequest request);
+
+    // Find, refresh or create the cachedContents entry for a system prefix ("" to send inline)
+    static std::string resolveCachedContent(
+        ContextCache& cache,
+        const std::string& endpoint,
+        const std::string& apiKey,
+        const std::string& model,
+        const std::string& prefix
+    );
+
+    // POST a generateContent request. With a stream callback the reply is streamed from
+    // streamGenerateContent and the chunks are merged back into one generateContent body.
+    // Await it directly; the arguments must outlive the task.
+    static Task<HttpResult> generateContent(
+        const std::string& baseUrl,
+        const std::string& model,
+        const std::string& apiKey,
+        const std::string& payload,
+        const StreamCallback& streamCallback
+    );
+
+    // Upload a file with the Files API resumable protocol; returns its name ("files/...") or ""
+    static std::string uploadFile(
+        const std::string& endpoint,
+        const std::string& apiKey,
+        const std::string& displayName,
+        const std::string& mimeType,
+        const std::string& content,
+        std::string& error
+    );
+
 };
 
 } // namespace libertymind
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "api_client.h"
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace libertymind {
+
+// Record/replay of HTTP exchanges at the transport level. With
+// SYNTHARA_VCR=record every request made through ApiClient is appended to the
+// cassette file (SYNTHARA_VCR_CASSETTE, default synthara.cassette.jsonl) with
+// its response body split into the chunks that arrived and their timing.
+// With SYNTHARA_VCR=replay no network is used: each request is answered from
+// the cassette, paced like the recording (SYNTHARA_VCR_SPEED=original, a
+// factor such as 2, or max). Requests match on method, path, query and body;
+// API keys are never written, not even inside recorded response headers. Repeated requests replay their recordings in
+// order and start over once all have been used.
+class HttpCassette {
+public:
+    struct Chunk {
+        double milliseconds;  // Since the request started
+        std::string data;
+    };
+
+    // The cassette configured by the environment, or nullptr when off
+    static HttpCassette* active();
+
+    bool isReplaying() const;
+
+    // Append one exchange to the cassette file
+    void record(const std::string& method, const std::string& url, const std::string& body,
+                const HttpResult& result, const std::vector<Chunk>& chunks);
+
+    // Answer a request from the cassette, feeding the body to onData chunk by chunk
+    HttpResult replay(const std::string& method, const std::string& url, const std::string& body,
+                      const DataCallback& onData);
+
+private:
+    struct Exchange {
+        long status = 0;
+        std::string error;
+        std::map<std::string, std::string> headers;
+        std::vector<Chunk> chunks;
+        double totalMilliseconds = 0.0;
+    };
+
+    HttpCassette(bool replaying, std::filesystem::path path, double speed);
+
+    bool replaying;
+    std::filesystem::path path;
+    double speed;  // Replay pace relative to the recording (0 = as fast as possible)
+
+    std::mutex mutex;
+    std::map<std::string, std::vector<Exchange>> exchanges;  // By match key
+    std::map<std::string, size_t> nextExchange;
+    std::string loadError;
+    std::ofstream recording;  // Opened on the first recorded exchange
+
+    void load();
+
+    // Method, path and query (without the API key) and body
+    static std::string matchKey(const std::string& method, const std::string& url, const std::string& body);
+    static std::string redactedTarget(const std::string& url);
+
+    // A URL without its key= query parameter; normalize also fixes upload_id and
+    // upload_protocol, which differ between otherwise identical uploads
+    static std::string redactQuery(const std::string& url, bool normalize);
+};
+
+} // namespace libertymind
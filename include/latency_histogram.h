@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace libertymind {
+
+// Log-linear histogram with the layout of HdrHistogram: values from 1 to
+// highestTrackableValue are kept with a fixed number of significant decimal
+// digits, so percentiles are exact to that precision with constant memory and
+// O(1) recording. Not synchronized; guard it or keep one per thread and add().
+class LatencyHistogram {
+public:
+    explicit LatencyHistogram(int64_t highestTrackableValue = 3600LL * 1000 * 1000, int significantDigits = 3);
+
+    // Values above the trackable range are clamped to it
+    void record(int64_t value, int64_t count = 1);
+
+    void add(const LatencyHistogram& other);
+    void reset();
+
+    // Highest value equivalent to the one at the given percentile (0-100)
+    int64_t valueAtPercentile(double percentile) const;
+
+    int64_t totalCount() const;
+    int64_t min() const;
+    int64_t max() const;
+    double mean() const;
+
+private:
+    int64_t highestTrackableValue;
+    int subBucketHalfCountMagnitude;
+    int64_t subBucketHalfCount;
+    int64_t subBucketMask;
+    std::vector<int64_t> counts;
+
+    int64_t total;
+    int64_t minValue;
+    int64_t maxValue;
+
+    size_t indexOf(int64_t value) const;
+    int64_t valueAt(size_t index) const;
+    int64_t highestEquivalentValue(int64_t value) const;
+};
+
+} // namespace libertymind
@@ -2,20 +2,138 @@
 
 #include <string>
 #include <vector>
+#include <functional>
+#include <mutex>
+#include <sys/types.h>
+#include <ctime>
 #include "api_client.h"
 
 namespace libertymind {
 
+// Reports how many messages have been written out of the total
+using ExportProgressCallback = std::function<void(size_t, size_t)>;
+
+// Fills messages with up to count messages starting at begin (fewer past the end);
+// returning false aborts the export
+using MessageReader = std::function<bool(size_t begin, size_t count, std::vector<Message>& messages)>;
+
+// Writes a Markdown document straight to disk through a fixed-size buffer.
+// Output goes to a temporary file that replaces the target on commit().
+class MarkdownStreamWriter {
+public:
+    explicit MarkdownStreamWriter(size_t bufferSize = 1 << 20);
+    ~MarkdownStreamWriter();
+
+    MarkdownStreamWriter(const MarkdownStreamWriter&) = delete;
+    MarkdownStreamWriter& operator=(const MarkdownStreamWriter&) = delete;
+
+    // Create the temporary file next to the target path
+    bool open(const std::string& filePath);
+
+    // Write the title, timestamp and optional system instructions
+    bool writeHeader(const Message* systemMessage);
+
+    // Write one conversation message (system messages are skipped)
+    bool writeMessage(const Message& message);
+
+    // Write the closing footer
+    bool writeFooter();
+
+    // Write text verbatim, e.g. for non-Markdown renderings of a session
+    bool writeRaw(const std::string& text);
+
+    // Flush, sync and atomically rename the temporary file over the target
+    bool commit();
+
+    // Bytes handed to the writer so far
+    size_t bytesWritten() const;
+
+private:
+    std::vector<char> buffer;
+    size_t used;
+    size_t written;
+    int fd;
+    std::string targetPath;
+    std::string tempPath;
+
+    bool append(const char* data, size_t size);
+    bool append(const std::string& text);
+    bool flush();
+    bool writeAll(const char* data, size_t size);
+    void discard();
+};
+
+// Keeps a Markdown mirror of a session up to date by appending only the
+// messages added since the last update and rewriting the footer in place.
+class MarkdownAutoExporter {
+public:
+    MarkdownAutoExporter();
+    ~MarkdownAutoExporter() = default;
+
+    // Bind to a file path; the next update writes the whole document
+    void bind(const std::string& filePath);
+
+    // Stop mirroring
+    void unbind();
+
+    bool isBound() const;
+    std::string getPath() const;
+
+    // Bring the file up to date with the given history. revision must change
+    // whenever existing messages do (see ChatSession::getHistoryRevision);
+    // otherwise only messages past the last update are appended.
+    bool update(const std::vector<Message>& messages, uint64_t revision);
+
+private:
+    mutable std::mutex mutex;
+    std::string path;
+    size_t exportedCount;
+    uint64_t exportedRevision;
+    off_t footerOffset;
+
+    // The file as last written, to notice edits by anyone else
+    off_t fileSize;
+    struct timespec fileModified;
+
+    // Write the whole document and remember where its footer starts
+    bool rewrite(const std::vector<Message>& messages, const Message* system, uint64_t revision);
+
+    // Record the size and modification time of the file just written
+    bool recordFileState(int fd);
+};
+
 class MarkdownExporter {
 public:
     // Export chat history to a Markdown file
     static bool exportChatToMarkdown(const std::vector<Message>& messages, const std::string& filePath);
+
+    // Export chat history with bounded memory, reporting progress as messages are written
+    static bool exportChatToMarkdown(
+        const std::vector<Message>& messages,
+        const std::string& filePath,
+        const ExportProgressCallback& progress
+    );
+
+    // Export messageCount messages fetched a small batch at a time, so a history
+    // owned elsewhere is never copied whole. The header uses the first system
+    // message of the first batch.
+    static bool exportChatToMarkdown(
+        size_t messageCount,
+        const MessageReader& read,
+        const std::string& filePath,
+        const ExportProgressCallback& progress
+    );
     
     // Generate Markdown content from chat history
     static std::string generateMarkdown(const std::vector<Message>& messages);
     
     // Generate a sample Markdown file
     static bool generateSampleMarkdown(const std::string& filePath);
+
+    // Document pieces shared by the in-memory and streaming exporters
+    static std::string formatHeader(const Message* systemMessage);
+    static std::string formatMessageHeading(const std::string& role);
+    static std::string formatFooter();
 };
 
 } // namespace libertymind
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace libertymind {
+
+// Process-wide counters, gauges and histograms exposed in the OpenMetrics
+// text format. Metrics are fixed objects created at startup and linked into
+// an intrusive list, so updating one is a single relaxed atomic operation
+// and reading them never blocks the code that updates them.
+class Metric {
+public:
+    enum class Type {
+        COUNTER,
+        GAUGE,
+        HISTOGRAM
+    };
+
+    // labels is the text inside the braces, e.g. code="5xx" (empty for none)
+    Metric(Type type, const char* name, const char* help, const char* labels);
+    virtual ~Metric() = default;
+
+    Metric(const Metric&) = delete;
+    Metric& operator=(const Metric&) = delete;
+
+    Type getType() const { return type; }
+    const char* getName() const { return name; }
+    const char* getHelp() const { return help; }
+    const char* getLabels() const { return labels; }
+
+    // Append this metric's samples (no HELP/TYPE lines)
+    virtual void writeSamples(std::string& out) const = 0;
+
+    // Every metric created so far, newest first
+    static const Metric* first();
+    const Metric* getNext() const { return next; }
+
+private:
+    Type type;
+    const char* name;
+    const char* help;
+    const char* labels;
+    const Metric* next;
+};
+
+class Counter : public Metric {
+public:
+    Counter(const char* name, const char* help, const char* labels = "")
+        : Metric(Type::COUNTER, name, help, labels) {}
+
+    void add(uint64_t amount = 1) { value.fetch_add(amount, std::memory_order_relaxed); }
+    uint64_t get() const { return value.load(std::memory_order_relaxed); }
+
+    void writeSamples(std::string& out) const override;
+
+private:
+    std::atomic<uint64_t> value{0};
+};
+
+class Gauge : public Metric {
+public:
+    Gauge(const char* name, const char* help, const char* labels = "")
+        : Metric(Type::GAUGE, name, help, labels) {}
+
+    void add(int64_t amount = 1) { value.fetch_add(amount, std::memory_order_relaxed); }
+    void sub(int64_t amount = 1) { value.fetch_sub(amount, std::memory_order_relaxed); }
+    void set(int64_t amount) { value.store(amount, std::memory_order_relaxed); }
+    int64_t get() const { return value.load(std::memory_order_relaxed); }
+
+    void writeSamples(std::string& out) const override;
+
+private:
+    std::atomic<int64_t> value{0};
+};
+
+// Durations in seconds, counted into fixed buckets from 5 ms to 60 s
+class Histogram : public Metric {
+public:
+    static constexpr size_t kBucketCount = 13;
+
+    Histogram(const char* name, const char* help, const char* labels = "")
+        : Metric(Type::HISTOGRAM, name, help, labels) {}
+
+    void observe(double seconds);
+
+    void writeSamples(std::string& out) const override;
+
+private:
+    static const double kBounds[kBucketCount];
+
+    std::atomic<uint64_t> buckets[kBucketCount + 1] = {};  // Last one is +Inf
+    std::atomic<uint64_t> sumMicroseconds{0};
+};
+
+// The metrics the client updates
+namespace metrics {
+
+extern Counter httpRequests;
+extern Counter httpResponses2xx;
+extern Counter httpResponses4xx;
+extern Counter httpResponses5xx;
+extern Counter httpTransportErrors;
+extern Counter httpThrottled;
+extern Counter httpRequestBytes;
+extern Counter httpResponseBytes;
+extern Gauge httpInFlight;
+extern Histogram httpDuration;
+extern Histogram httpTtfb;
+
+extern Counter endpointRetries;
+extern Counter modelRetries;
+extern Counter batchRetries;
+
+extern Counter contextCacheLookups;
+extern Counter contextCacheHits;
+
+extern Gauge batchQueueDepth;
+extern Gauge exportQueueDepth;
+
+} // namespace metrics
+
+// Render every metric in the OpenMetrics text format, ending with # EOF
+std::string renderMetrics();
+
+// Serves renderMetrics() at GET /metrics from a background thread
+class MetricsServer {
+public:
+    // address is "unix:/path/to/socket", "HOST:PORT" or just "PORT" (on 127.0.0.1)
+    static bool start(const std::string& address, std::string& error);
+
+    // Start on SYNTHARA_METRICS_LISTEN when it is set; failures are reported on stderr
+    static void startFromEnvironment();
+
+    // Stop accepting scrapes and remove a Unix socket; safe to call when not running
+    static void shutdown();
+};
+
+} // namespace libertymind
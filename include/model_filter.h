@@ -0,0 +1,44 @@
+#pragma once
+
+#include "model_registry.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace libertymind {
+
+// Incremental fuzzy filter over a model catalog. Each typed character only
+// rescores the previous matches; backspace pops back to the earlier result.
+class ModelFilter {
+public:
+    struct Match {
+        size_t index;  // Position in the catalog
+        int score;
+    };
+
+    // Start filtering a (new) catalog, keeping the current query
+    void reset(std::shared_ptr<const ModelCatalog> catalog);
+
+    // Extend or shorten the query by one character
+    void push(char c);
+    void pop();
+
+    // Replace the query outright
+    void setQuery(const std::string& query);
+
+    const std::string& getQuery() const { return query; }
+    const std::shared_ptr<const ModelCatalog>& getCatalog() const { return catalog; }
+
+    // Matches ranked best first
+    const std::vector<Match>& matches() const { return levels.back(); }
+
+    // Score a query against a lowercased key (-1 if the query is not a subsequence)
+    static int score(const std::string& query, const std::string& key);
+
+private:
+    std::shared_ptr<const ModelCatalog> catalog;
+    std::string query;
+    std::vector<std::vector<Match>> levels;  // levels[i] holds the matches for query[0, i)
+};
+
+} // namespace libertymind
@@ -4,6 +4,12 @@
 #include <string>
 #include <vector>
 #include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <filesystem>
+#include <optional>
 
 namespace libertymind {
 
@@ -11,29 +17,92 @@ struct ModelInfo {
     std::string id;
     std::string name;
     std::string description;
+    int inputTokenLimit = 0;   // 0 when unknown
+    int outputTokenLimit = 0;  // 0 when unknown
+    std::vector<std::string> supportedMethods;
+};
+
+// Immutable, contiguous list of a provider's models with an id index.
+// Readers hold a shared_ptr snapshot, so a background refresh never
+// invalidates what the UI is iterating over.
+class ModelCatalog {
+public:
+    explicit ModelCatalog(std::vector<ModelInfo> models);
+
+    // All models, in provider order
+    const std::vector<ModelInfo>& models() const { return entries; }
+
+    // Lowercased "id name" strings used for searching, parallel to models()
+    const std::vector<std::string>& searchKeys() const { return keys; }
+
+    // Look up a model by ID (nullptr if unknown)
+    const ModelInfo* find(const std::string& modelId) const;
+
+    size_t size() const { return entries.size(); }
+
+private:
+    std::vector<ModelInfo> entries;
+    std::vector<std::string> keys;
+    std::unordered_map<std::string, size_t> byId;
 };
 
 class ModelRegistry {
 public:
     ModelRegistry();
-    ~ModelRegistry() = default;
-    
-    // Get all models for a specific provider
-    std::vector<ModelInfo> getModelsForProvider(Provider provider) const;
-    
+    ~ModelRegistry();
+
+    // Get the current model catalog for a provider (never null)
+    std::shared_ptr<const ModelCatalog> getCatalog(Provider provider) const;
+
     // Get all available providers
     std::vector<Provider> getAvailableProviders() const;
-    
+
     // Check if a model is valid for a provider
     bool isValidModel(Provider provider, const std::string& modelId) const;
-    
+
     // Get model info by ID
     std::optional<ModelInfo> getModelInfo(Provider provider, const std::string& modelId) const;
 
+    // Replace the models known for a provider
+    void setModels(Provider provider, std::vector<ModelInfo> providerModels);
+
+    // Fetch the provider's model list in the background if the cache is stale (or forced)
+    void refreshInBackground(
+        Provider provider,
+        const std::string& apiKey,
+        const std::vector<std::string>& endpoints,
+        bool force = false
+    );
+
+    // True while a background refresh is running
+    bool isRefreshing() const;
+
+    // How long a cached model list stays fresh
+    static const int kCacheTtlSeconds = 24 * 60 * 60;
+
 private:
-    std::unordered_map<Provider, std::vector<ModelInfo>> models;
-    
+    mutable std::mutex mutex;
+    std::unordered_map<Provider, std::shared_ptr<const ModelCatalog>> catalogs;
+    std::unordered_map<Provider, int64_t> fetchedAt;
+    std::filesystem::path cachePath;
+    std::thread refreshThread;
+    std::mutex refreshThreadMutex;  // Guards refreshThread itself
+    std::atomic<bool> refreshing;
+
+    // A model list fetch, kept whole so a forced one can be queued behind a running fetch
+    struct RefreshRequest {
+        Provider provider;
+        std::string apiKey;
+        std::vector<std::string> endpoints;
+    };
+    std::optional<RefreshRequest> pendingRefresh;  // Guarded by mutex
+
     void initializeModels();
+    void fetchModels(const RefreshRequest& request);
+
+    // On-disk cache of discovered models
+    bool loadCache();
+    bool saveCache() const;
 };
 
 } // namespace libertymind
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "api_client.h"
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace libertymind {
+
+// Model ID that asks the router to pick a model per request
+constexpr const char* kAutoModelId = "auto";
+
+// Live performance of one model, smoothed with an EWMA
+struct ModelStats {
+    size_t samples = 0;
+    size_t successes = 0;
+    size_t consecutiveErrors = 0;  // Non-429 failures since the last success
+    double ttfbSeconds = 0.0;
+    double tokensPerSecond = 0.0;
+    double errorRate = 0.0;      // Share of recent requests that failed
+    double throttleRate = 0.0;   // Share of recent requests rejected with 429
+    std::chrono::steady_clock::time_point cooldownUntil;
+};
+
+// Routes "auto" requests to the fastest healthy model in a tier list
+class ModelRouter {
+public:
+    // Record the outcome of a request
+    void record(const RequestStats& stats);
+
+    // Order the tier list by expected latency, healthy models first; models that
+    // have only ever failed go behind every model that has answered
+    std::vector<std::string> rank(const std::vector<std::string>& tiers) const;
+
+    // Current stats for a model (zero samples if never used)
+    ModelStats getStats(const std::string& model) const;
+
+    // Forget everything measured so far
+    void reset();
+
+    // Weight of the newest sample in the moving averages
+    static constexpr double kSmoothing = 0.3;
+
+private:
+    mutable std::mutex mutex;
+    std::unordered_map<std::string, ModelStats> models;
+
+    // Expected seconds until a typical reply is complete
+    static double expectedLatency(const ModelStats& stats);
+
+    // A model is skipped while it cools down after a failure
+    static bool isHealthy(const ModelStats& stats, std::chrono::steady_clock::time_point now);
+};
+
+} // namespace libertymind
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <curl/curl.h>
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace libertymind {
+
+// One thread driving every asynchronous transfer through a curl multi handle,
+// and the executor coroutines continue on after a network wait. The loop waits
+// in epoll on the sockets curl asks for and hands curl only the ones that are
+// ready, so a wakeup costs the same with one transfer or hundreds in flight.
+// Resumed coroutines run between curl calls, never inside curl's callbacks.
+// Code running on the loop must not block: blocking work goes through offload()
+// or execute(), which run it on a small, bounded pool of worker threads.
+class NetworkLoop {
+public:
+    // co_await loop.perform(curl) runs a configured easy handle and yields its
+    // result; the caller still owns the handle and cleans it up afterwards
+    class PerformAwaiter {
+    public:
+        PerformAwaiter(NetworkLoop& loop, CURL* curl) : loop(loop), curl(curl) {}
+
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> handle);
+        CURLcode await_resume() const noexcept { return result; }
+
+    private:
+        friend class NetworkLoop;
+
+        NetworkLoop& loop;
+        CURL* curl;
+        std::coroutine_handle<> waiting;
+        CURLcode result = CURLE_OK;
+        PerformAwaiter* next = nullptr;  // Queued for the loop thread
+    };
+
+    // co_await loop.offload(fn) runs fn on a worker thread, then continues on the loop
+    template <typename F>
+    class OffloadAwaiter {
+    public:
+        OffloadAwaiter(NetworkLoop& loop, F fn) : loop(loop), fn(std::move(fn)) {}
+
+        bool await_ready() const noexcept { return false; }
+
+        void await_suspend(std::coroutine_handle<> handle) {
+            loop.execute([this, handle]() {
+                fn();
+                loop.post(handle);
+            });
+        }
+
+        void await_resume() const noexcept {}
+
+    private:
+        NetworkLoop& loop;
+        F fn;
+    };
+
+    // The process-wide loop, started on first use
+    static NetworkLoop& shared();
+
+    // Stop the shared loop if it was started; transfers still running are abandoned.
+    // Call before curl_global_cleanup.
+    static void shutdown();
+
+    PerformAwaiter perform(CURL* curl) { return PerformAwaiter(*this, curl); }
+
+    template <typename F>
+    OffloadAwaiter<F> offload(F fn) { return OffloadAwaiter<F>(*this, std::move(fn)); }
+
+    // co_await loop.schedule() continues on the loop thread
+    auto schedule() {
+        struct ScheduleAwaiter {
+            NetworkLoop& loop;
+            bool await_ready() const noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> handle) { loop.post(handle); }
+            void await_resume() const noexcept {}
+        };
+        return ScheduleAwaiter{*this};
+    }
+
+    // Resume a coroutine on the loop thread; safe from any thread
+    void post(std::coroutine_handle<> handle);
+
+    // Run job on a worker thread without waiting for it; safe from any thread.
+    // Jobs queue up once every worker is busy, and are dropped once stopped.
+    void execute(std::function<void()> job);
+
+    // Whether the caller is running on the loop thread
+    bool isLoopThread() const;
+
+    // True once the loop has stopped and released its transfers
+    bool isStopped();
+
+private:
+    NetworkLoop();
+
+    NetworkLoop(const NetworkLoop&) = delete;
+    NetworkLoop& operator=(const NetworkLoop&) = delete;
+
+    void submit(PerformAwaiter* transfer);
+    // Interrupt epoll_wait; called with mutex held so it never races the close in stop()
+    void wake();
+    void run();
+    void stop();
+    void work();
+
+    // Let curl hand a socket event or an expired timer to the transfers, then collect finished ones
+    void socketAction(curl_socket_t socket, int events, std::vector<std::coroutine_handle<>>& ready);
+
+    // curl's requests to watch a socket and to be called back after a timeout
+    static int onSocket(CURL* curl, curl_socket_t socket, int what, void* loop, void* socketData);
+    static int onTimer(CURLM* multi, long timeoutMilliseconds, void* loop);
+
+    CURLM* multi;
+    int epollFd;
+    int wakeFd;  // eventfd other threads write to interrupt epoll_wait
+    std::thread thread;
+
+    // Only touched on the loop thread
+    bool timerArmed = false;
+    std::chrono::steady_clock::time_point timerDeadline;
+
+    // Handed over to the loop thread under the mutex
+    std::mutex mutex;
+    PerformAwaiter* submitted = nullptr;
+    std::vector<std::coroutine_handle<>> posted;
+    bool stopping = false;
+    bool stopped = false;
+
+    // Worker pool for execute() and offload(), grown on demand up to a fixed size
+    std::mutex workMutex;
+    std::condition_variable workReady;
+    std::deque<std::function<void()>> jobs;
+    size_t workers = 0;
+    size_t idleWorkers = 0;
+    bool workersStopping = false;
+};
+
+} // namespace libertymind
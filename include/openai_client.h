@@ -0,0 +1,38 @@
+#pragma once
+
+#include "api_client.h"
+
+namespace libertymind {
+
+// Client for OpenAI-compatible chat completion servers (llama.cpp, vLLM, gateways).
+// Replies are streamed with server-sent events. Endpoints may be TCP URLs or
+// http+unix:// URLs naming a Unix domain socket.
+class OpenAIClient : public ApiClient {
+public:
+    OpenAIClient(const std::string& apiKey);
+    ~OpenAIClient() override = default;
+
+    Task<CompletionResult> complete(CompletionRequest request) override;
+
+    bool validateApiKey() override;
+
+    std::string getBaseUrl() const override;
+
+    bool listModels(std::vector<ModelInfo>& models) override;
+
+    // Build a streaming chat.completions request body
+    static nlohmann::json buildRequestPayload(
+        const std::vector<Message>& messages,
+        const std::string& model,
+        int maxOutputTokens
+    );
+
+private:
+    // Streams from each endpoint in turn until one answers
+    static Task<CompletionResult> runCompletion(RequestSettings settings, CompletionRequest request);
+
+    // Authorization header for a key (none for servers without auth)
+    static std::vector<std::string> authHeaders(const std::string& apiKey);
+};
+
+} // namespace libertymind
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "api_client.h"
+#include <string>
+#include <vector>
+#include <filesystem>
+#include <functional>
+
+namespace libertymind {
+
+struct SessionInfo {
+    std::string id;
+    std::filesystem::path path;
+    uintmax_t sizeBytes;
+};
+
+// Persists chat sessions as JSONL files, one message per line
+class SessionStore {
+public:
+    explicit SessionStore(const std::filesystem::path& directory = defaultDirectory());
+    ~SessionStore() = default;
+
+    // Default location of saved sessions (~/.libertymind/sessions)
+    static std::filesystem::path defaultDirectory();
+
+    // Start a new session; its file is created on the first append
+    void beginSession();
+
+    // Append a message to the current session file
+    bool append(const Message& message);
+
+    // Path of the current session file
+    std::filesystem::path getCurrentPath() const;
+
+    // List saved sessions in a directory
+    static std::vector<SessionInfo> listSessions(const std::filesystem::path& directory = defaultDirectory());
+
+    // Read a session file one message at a time; the visitor returns false to stop
+    static bool readSession(const std::filesystem::path& path, const std::function<bool(const Message&)>& visitor);
+
+private:
+    std::filesystem::path directory;
+    std::filesystem::path currentPath;
+};
+
+} // namespace libertymind
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <functional>
+#include <string>
+
+namespace libertymind {
+
+// Splits a server-sent event stream into the data payload of each event.
+// Feed it bytes as they arrive; it buffers partial lines between calls.
+class SseParser {
+public:
+    explicit SseParser(std::function<void(const std::string&)> onEvent);
+
+    void feed(const char* data, size_t size);
+
+    // Dispatch an event left open when the stream ended without a blank line
+    void finish();
+
+private:
+    std::function<void(const std::string&)> onEvent;
+    std::string buffer;
+    std::string eventData;
+};
+
+} // namespace libertymind
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <chrono>
+#include <ostream>
+#include <string>
+
+namespace libertymind {
+
+// Records how long each startup phase takes (enabled with --trace-startup)
+class StartupTrace {
+public:
+    // Scoped phase that records its duration when it goes out of scope
+    class Phase {
+    public:
+        explicit Phase(const char* name);
+        ~Phase();
+
+        Phase(const Phase&) = delete;
+        Phase& operator=(const Phase&) = delete;
+
+    private:
+        const char* name;
+        std::chrono::steady_clock::time_point start;
+    };
+
+    static void enable();
+    static bool isEnabled();
+
+    // Record a point in time, e.g. the first frame being drawn
+    static void mark(const char* name);
+
+    // Record a completed phase
+    static void record(const char* name, std::chrono::steady_clock::time_point start,
+                       std::chrono::steady_clock::time_point end);
+
+    // Print all phases relative to process start
+    static void report(std::ostream& out);
+};
+
+} // namespace libertymind
@@ -0,0 +1,289 @@
+#pragma once
+
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+namespace libertymind {
+
+// Coroutine types for composing requests without a thread or a callback per
+// step. A Task doesn't start until it is awaited (or handed to startTask), and
+// finishing one resumes its awaiter directly, so a chain of awaits costs one
+// coroutine frame per call and no other allocation. Where a task continues
+// after a suspension depends on what it awaited: network waits resume on the
+// NetworkLoop thread.
+template <typename T = void>
+class Task;
+
+namespace detail {
+
+struct TaskPromiseBase {
+    std::coroutine_handle<> continuation = std::noop_coroutine();
+    std::exception_ptr exception;
+
+    // Hand control straight back to whoever awaited the task
+    struct FinalAwaiter {
+        bool await_ready() const noexcept { return false; }
+
+        template <typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) const noexcept {
+            return handle.promise().continuation;
+        }
+
+        void await_resume() const noexcept {}
+    };
+
+    std::suspend_always initial_suspend() const noexcept { return {}; }
+    FinalAwaiter final_suspend() const noexcept { return {}; }
+    void unhandled_exception() noexcept { exception = std::current_exception(); }
+};
+
+template <typename T>
+struct TaskPromise : TaskPromiseBase {
+    std::optional<T> value;
+
+    Task<T> get_return_object() noexcept;
+
+    template <typename U>
+    void return_value(U&& result) {
+        value.emplace(std::forward<U>(result));
+    }
+
+    T takeResult() {
+        if (exception) {
+            std::rethrow_exception(exception);
+        }
+        return std::move(*value);
+    }
+};
+
+template <>
+struct TaskPromise<void> : TaskPromiseBase {
+    Task<void> get_return_object() noexcept;
+
+    void return_void() const noexcept {}
+
+    void takeResult() {
+        if (exception) {
+            std::rethrow_exception(exception);
+        }
+    }
+};
+
+} // namespace detail
+
+template <typename T>
+class Task {
+public:
+    using promise_type = detail::TaskPromise<T>;
+
+    Task() = default;
+    explicit Task(std::coroutine_handle<promise_type> handle) : handle(handle) {}
+
+    Task(Task&& other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+
+    Task& operator=(Task&& other) noexcept {
+        if (this != &other) {
+            if (handle) {
+                handle.destroy();
+            }
+            handle = std::exchange(other.handle, nullptr);
+        }
+        return *this;
+    }
+
+    ~Task() {
+        if (handle) {
+            handle.destroy();
+        }
+    }
+
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    // Start the task and suspend the awaiter until it finishes; rethrows its exception
+    auto operator co_await() && noexcept {
+        struct Awaiter {
+            std::coroutine_handle<promise_type> handle;
+
+            bool await_ready() const noexcept { return !handle || handle.done(); }
+
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+                handle.promise().continuation = awaiting;
+                return handle;
+            }
+
+            T await_resume() { return handle.promise().takeResult(); }
+        };
+        return Awaiter{handle};
+    }
+
+private:
+    std::coroutine_handle<promise_type> handle;
+};
+
+namespace detail {
+
+template <typename T>
+Task<T> TaskPromise<T>::get_return_object() noexcept {
+    return Task<T>(std::coroutine_handle<TaskPromise<T>>::from_promise(*this));
+}
+
+inline Task<void> TaskPromise<void>::get_return_object() noexcept {
+    return Task<void>(std::coroutine_handle<TaskPromise<void>>::from_promise(*this));
+}
+
+// Runs eagerly and frees itself at the end; only startTask creates these
+struct DetachedTask {
+    struct promise_type {
+        DetachedTask get_return_object() const noexcept { return {}; }
+        std::suspend_never initial_suspend() const noexcept { return {}; }
+        std::suspend_never final_suspend() const noexcept { return {}; }
+        void return_void() const noexcept {}
+        void unhandled_exception() const noexcept { std::terminate(); }
+    };
+};
+
+template <typename T, typename OnDone, typename OnError>
+DetachedTask runDetached(Task<T> task, OnDone onDone, OnError onError) {
+    // Exceptions thrown by the callbacks themselves are not caught here
+    std::string error;
+    if constexpr (std::is_void_v<T>) {
+        try {
+            co_await std::move(task);
+        } catch (const std::exception& e) {
+            error = e.what();
+        } catch (...) {
+            error = "Unknown error";
+        }
+        if (error.empty()) {
+            onDone();
+        } else {
+            onError(error);
+        }
+    } else {
+        std::optional<T> result;
+        try {
+            result.emplace(co_await std::move(task));
+        } catch (const std::exception& e) {
+            error = e.what();
+        } catch (...) {
+            error = "Unknown error";
+        }
+        if (result) {
+            onDone(std::move(*result));
+        } else {
+            onError(error);
+        }
+    }
+}
+
+} // namespace detail
+
+// Run a task without waiting for it. It starts on the calling thread and runs
+// there until its first suspension; onDone gets the result (or onError the
+// exception's message) on whichever thread the task finishes.
+template <typename T, typename OnDone, typename OnError>
+void startTask(Task<T> task, OnDone onDone, OnError onError) {
+    detail::runDetached(std::move(task), std::move(onDone), std::move(onError));
+}
+
+// A coroutine producing a sequence of values on demand:
+//
+//     while (std::optional<std::string> chunk = co_await generator.next()) { ... }
+//
+// The body runs only while the consumer waits in next(), and each co_yield
+// resumes the consumer directly. Destroying the generator abandons the rest.
+template <typename T>
+class AsyncGenerator {
+public:
+    struct promise_type {
+        std::optional<T> current;
+        std::coroutine_handle<> consumer = std::noop_coroutine();
+        std::exception_ptr exception;
+
+        struct YieldAwaiter {
+            bool await_ready() const noexcept { return false; }
+
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> handle) const noexcept {
+                return handle.promise().consumer;
+            }
+
+            void await_resume() const noexcept {}
+        };
+
+        AsyncGenerator get_return_object() noexcept {
+            return AsyncGenerator(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+
+        std::suspend_always initial_suspend() const noexcept { return {}; }
+        YieldAwaiter final_suspend() const noexcept { return {}; }
+
+        template <typename U>
+        YieldAwaiter yield_value(U&& value) {
+            current.emplace(std::forward<U>(value));
+            return {};
+        }
+
+        void return_void() const noexcept {}
+        void unhandled_exception() noexcept { exception = std::current_exception(); }
+    };
+
+    AsyncGenerator() = default;
+    explicit AsyncGenerator(std::coroutine_handle<promise_type> handle) : handle(handle) {}
+
+    AsyncGenerator(AsyncGenerator&& other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+
+    AsyncGenerator& operator=(AsyncGenerator&& other) noexcept {
+        if (this != &other) {
+            if (handle) {
+                handle.destroy();
+            }
+            handle = std::exchange(other.handle, nullptr);
+        }
+        return *this;
+    }
+
+    ~AsyncGenerator() {
+        if (handle) {
+            handle.destroy();
+        }
+    }
+
+    AsyncGenerator(const AsyncGenerator&) = delete;
+    AsyncGenerator& operator=(const AsyncGenerator&) = delete;
+
+    // The next value, or nullopt once the body has returned; rethrows its exception
+    auto next() noexcept {
+        struct Awaiter {
+            std::coroutine_handle<promise_type> handle;
+
+            bool await_ready() const noexcept { return !handle || handle.done(); }
+
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+                handle.promise().current.reset();
+                handle.promise().consumer = awaiting;
+                return handle;
+            }
+
+            std::optional<T> await_resume() {
+                if (!handle || !handle.promise().current) {
+                    if (handle && handle.promise().exception) {
+                        std::rethrow_exception(std::exchange(handle.promise().exception, nullptr));
+                    }
+                    return std::nullopt;
+                }
+                return std::exchange(handle.promise().current, std::nullopt);
+            }
+        };
+        return Awaiter{handle};
+    }
+
+private:
+    std::coroutine_handle<promise_type> handle;
+};
+
+} // namespace libertymind
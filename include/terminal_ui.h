@@ -2,9 +2,17 @@
 
 #include "config_manager.h"
 #include "model_registry.h"
+#include "model_filter.h"
 #include "chat_session.h"
+#include "markdown_exporter.h"
+#include <atomic>
+#include <chrono>
+#include <future>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <string>
+#include <thread>
 #include <vector>
 #include <ncurses.h>
 
@@ -19,6 +27,7 @@ enum class Screen {
     SYSTEM_MESSAGE,
     THEME_CUSTOMIZATION,
     MARKDOWN_EXPORT,
+    DIAGNOSTICS,
     COMPANY_INFO
 };
 
@@ -30,6 +39,9 @@ public:
     // Run the UI
     void run();
 
+    // Split text into lines of at most width columns, breaking between words
+    static std::vector<std::string> wrapText(const std::string& text, size_t width);
+
 private:
     // Theme structure
     struct Theme {
@@ -58,11 +70,52 @@ private:
     bool running;
     Theme currentTheme;
 
-    // Components
+    // Components (the registry and chat session are created on first use)
     std::shared_ptr<ConfigManager> configManager;
-    std::unique_ptr<ModelRegistry> modelRegistry;
+    std::shared_ptr<ModelRegistry> modelRegistry;
     std::unique_ptr<ChatSession> chatSession;
 
+    // Typed filter over the model selection list
+    ModelFilter modelFilter;
+
+    // Theme file read in the background during startup
+    std::future<std::optional<Theme>> pendingTheme;
+    bool firstFrameDrawn;
+
+    // Background Markdown export
+    std::thread exportThread;
+    std::atomic<bool> exportRunning;
+    std::atomic<bool> exportSucceeded;
+    std::atomic<size_t> exportDone;
+    std::atomic<size_t> exportTotal;
+    std::string exportPath;
+    MarkdownAutoExporter autoExporter;
+
+    // Replies queued by the network loop for the UI thread
+    struct ChatReply {
+        std::string response;
+        bool success;
+    };
+    std::mutex chatRepliesMutex;
+    std::vector<ChatReply> chatReplies;
+
+    // Last config reload count shown to the user
+    uint64_t seenConfigReloads;
+
+    // Performance HUD on the chat screen (F2), redrawn with every frame
+    bool hudVisible;
+    double lastFrameMilliseconds;
+    uint64_t hudRssKb;
+    std::chrono::steady_clock::time_point hudRssSampled;
+
+    // The UI thread's copy of the chat history (see syncChatHistory)
+    std::vector<Message> chatHistory;
+    uint64_t chatHistoryRevision;
+
+    // Streamed reply length in the last chat frame, and whether the screen must be redrawn
+    size_t drawnPendingReplySize;
+    bool redrawNeeded;
+
     // Windows
     WINDOW* mainWindow;
     WINDOW* inputWindow;
@@ -77,6 +130,9 @@ private:
     // Draw the current screen
     void drawScreen();
 
+    // Whether the current screen shows anything that changed since the last frame
+    bool needsRedraw();
+
     // Handle input
     void handleInput();
 
@@ -89,7 +145,9 @@ private:
     void drawSystemMessage();
     void drawThemeCustomization();
     void drawMarkdownExport();
+    void drawDiagnostics();
     void drawCompanyInfo();
+    void drawHud(int y);
 
     // Screen-specific input handlers
     void handleMainMenuInput(int key);
@@ -100,8 +158,19 @@ private:
     void handleSystemMessageInput(int key);
     void handleThemeCustomizationInput(int key);
     void handleMarkdownExportInput(int key);
+    void handleDiagnosticsInput(int key);
     void handleCompanyInfoInput(int key);
 
+    // Lazily created components
+    ModelRegistry& registry();
+    ChatSession& session();
+
+    // Bring the UI's copy of the chat history up to date under the session's lock
+    const std::vector<Message>& syncChatHistory();
+
+    // Refresh the model list from the provider without blocking the UI
+    void refreshModels(bool force);
+
     // Helper functions
     void setStatusMessage(const std::string& message);
     void clearStatusMessage();
@@ -112,10 +181,19 @@ private:
     void appendToInputBuffer(int key);
     void backspaceInputBuffer();
 
+    // Background tasks
+    void startMarkdownExport(const std::string& filePath);
+    void pollBackgroundTasks();
+    void updateAutoExport();
+
+    // F12: start tracing, or save what has been traced so far
+    void toggleTrace();
+
     // Theme management
     void initializeColorPairs();
     bool saveTheme() const;
     bool loadTheme();
+    static std::optional<Theme> readThemeFile();
     void applyTheme();
 };
 
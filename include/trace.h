@@ -0,0 +1,70 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+namespace libertymind {
+
+// Scoped spans across UI, network and parsing, written as Chrome trace-event
+// JSON for chrome://tracing or ui.perfetto.dev. Each thread records into its
+// own fixed-size ring buffer, so tracing never allocates per span and keeps
+// the most recent events. When tracing is off a span costs one relaxed load.
+class Trace {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // Records its lifetime as one span when tracing is on
+    class Span {
+    public:
+        Span(const char* name, const char* category)
+            : name(name), category(category), start(isEnabled() ? Clock::now() : Clock::time_point()) {}
+
+        ~Span() {
+            if (start != Clock::time_point()) {
+                record(name, category, start, Clock::now(), argName, argValue);
+            }
+        }
+
+        // Attach a number shown with the span (e.g. bytes or a status code)
+        void setArg(const char* key, int64_t value) {
+            argName = key;
+            argValue = value;
+        }
+
+        Span(const Span&) = delete;
+        Span& operator=(const Span&) = delete;
+
+    private:
+        const char* name;
+        const char* category;
+        Clock::time_point start;
+        const char* argName = nullptr;
+        int64_t argValue = 0;
+    };
+
+    static void enable();
+    static bool isEnabled() { return enabled.load(std::memory_order_relaxed); }
+
+    // Where --trace asked for the trace to go ("" if it didn't)
+    static void setOutputPath(const std::filesystem::path& path);
+    static std::filesystem::path getOutputPath();
+
+    // Name the calling thread in the trace
+    static void setThreadName(const char* name);
+
+    // Record a span with explicit times, e.g. phases reported after the fact.
+    // Names and categories must be string literals (they are stored as pointers).
+    static void record(const char* name, const char* category, Clock::time_point start, Clock::time_point end,
+                       const char* argName = nullptr, int64_t argValue = 0);
+
+    // Write every thread's buffered spans as trace-event JSON
+    static bool write(const std::filesystem::path& path, std::string& error);
+
+private:
+    static std::atomic<bool> enabled;
+};
+
+} // namespace libertymind
@@ -1,16 +1,379 @@
 #include "api_client.h"
+#include "alloc_tracker.h"
+#include "http_cassette.h"
+#include "metrics.h"
+#include "network_loop.h"
+#include "startup_trace.h"
+#include "trace.h"
 #include <curl/curl.h>
+#include <algorithm>
+#include <cctype>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
 #include <iostream>
+#include <mutex>
+#include <strings.h>
 
 namespace libertymind {
 
-ApiClient::ApiClient(const std::string& apiKey) : apiKey(apiKey) {
-    // Initialize curl globally (should be called once in the application)
-    static bool curlInitialized = false;
-    if (!curlInitialized) {
+static std::once_flag curlInitFlag;
+
+void ensureCurlInitialized() {
+    // Concurrent callers block until the first one has finished initializing
+    std::call_once(curlInitFlag, []() {
+        StartupTrace::Phase phase("curl/TLS global init");
         curl_global_init(CURL_GLOBAL_ALL);
-        curlInitialized = true;
+    });
+}
+
+// A non-negative whole number from the environment, or fallback
+static long environmentLong(const char* name, long fallback) {
+    const char* value = getenv(name);
+    if (!value || !*value) {
+        return fallback;
     }
+    char* end = nullptr;
+    long number = strtol(value, &end, 10);
+    return *end || number < 0 ? fallback : number;
+}
+
+const TransferTimeouts& getTransferTimeouts() {
+    static const TransferTimeouts timeouts = {
+        environmentLong("SYNTHARA_CONNECT_TIMEOUT_MS", 10000),
+        environmentLong("SYNTHARA_STALL_TIMEOUT_S", 60),
+        environmentLong("SYNTHARA_REQUEST_TIMEOUT_S", 300)
+    };
+    return timeouts;
+}
+
+// One mutex per kind of data a share handle guards
+static std::mutex shareLocks[CURL_LOCK_DATA_LAST];
+
+static void lockShare(CURL*, curl_lock_data data, curl_lock_access, void*) {
+    shareLocks[data].lock();
+}
+
+static void unlockShare(CURL*, curl_lock_data data, void*) {
+    shareLocks[data].unlock();
+}
+
+// DNS results and TLS sessions shared by every request, so concurrent and
+// back-to-back requests skip the lookup and a full handshake. Connections are
+// reused through the network loop's multi handle instead. Lives until exit.
+static CURLSH* sharedTransport() {
+    static CURLSH* share = []() {
+        CURLSH* handle = curl_share_init();
+        if (handle) {
+            curl_share_setopt(handle, CURLSHOPT_LOCKFUNC, lockShare);
+            curl_share_setopt(handle, CURLSHOPT_UNLOCKFUNC, unlockShare);
+            curl_share_setopt(handle, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+            curl_share_setopt(handle, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+        }
+        return handle;
+    }();
+    return share;
+}
+
+bool splitUnixSocketUrl(const std::string& url, std::string& socketPath, std::string& httpUrl, std::string& error) {
+    static const std::string kScheme = "http+unix://";
+    error.clear();
+    if (url.compare(0, kScheme.size(), kScheme) != 0) {
+        return false;
+    }
+
+    size_t pathStart = url.find('/', kScheme.size());
+    std::string host = url.substr(kScheme.size(), pathStart == std::string::npos ? std::string::npos
+                                                                                 : pathStart - kScheme.size());
+
+    // The socket path travels percent-encoded in the host part
+    socketPath.clear();
+    for (size_t i = 0; i < host.size(); ++i) {
+        if (host[i] == '%') {
+            if (i + 2 >= host.size() || !std::isxdigit(static_cast<unsigned char>(host[i + 1])) ||
+                !std::isxdigit(static_cast<unsigned char>(host[i + 2]))) {
+                error = "Malformed percent-encoding in socket path: " + host;
+                return false;
+            }
+            socketPath += static_cast<char>(std::strtol(host.substr(i + 1, 2).c_str(), nullptr, 16));
+            i += 2;
+        } else {
+            socketPath += host[i];
+        }
+    }
+
+    httpUrl = "http://localhost" + (pathStart == std::string::npos ? std::string() : url.substr(pathStart));
+    return true;
+}
+
+void appendErrorBody(std::string& body, const char* data, size_t size) {
+    if (body.size() < kMaxErrorBody) {
+        body.append(data, std::min(size, kMaxErrorBody - body.size()));
+    }
+}
+
+std::string describeFailure(const HttpResult& result) {
+    if (!result.ok()) {
+        return result.error;
+    }
+
+    std::string reason = "HTTP " + std::to_string(result.status);
+    try {
+        nlohmann::json body = nlohmann::json::parse(result.body);
+        if (body.is_array() && !body.empty()) {
+            body = body[0];
+        }
+        if (body.contains("error") && body["error"].contains("message")) {
+            reason += ": " + body["error"]["message"].get<std::string>();
+        }
+    } catch (const std::exception& e) {
+        // Keep the status-only reason
+    }
+    return reason;
+}
+
+ApiClient::ApiClient(const std::string& apiKey) : apiKey(apiKey) {
+    ensureCurlInitialized();
+}
+
+int ApiClient::countTokens(const std::vector<Message>&, const std::string&) {
+    return -1;
+}
+
+bool ApiClient::listModels(std::vector<ModelInfo>&) {
+    return false;
+}
+
+bool ApiClient::runBatchJob(
+    const std::vector<BatchRequest>&,
+    const std::string&,
+    const BatchJobOptions&,
+    const BatchResultCallback&,
+    std::string& error
+) {
+    error = "Batch jobs are not supported by this provider";
+    return false;
+}
+
+void ApiClient::setMaxOutputTokens(int tokens) {
+    maxOutputTokens = tokens;
+}
+
+void ApiClient::setUsageCallback(UsageCallback callback) {
+    usageCallback = std::move(callback);
+}
+
+void ApiClient::setStreamCallback(StreamCallback callback) {
+    streamCallback = std::move(callback);
+}
+
+void ApiClient::setRequestStatsCallback(RequestStatsCallback callback) {
+    requestStatsCallback = std::move(callback);
+}
+
+void ApiClient::setKeyPool(std::shared_ptr<ApiKeyPool> pool) {
+    keyPool = std::move(pool);
+}
+
+void ApiClient::setEndpointSelector(std::shared_ptr<EndpointSelector> selector) {
+    endpointSelector = std::move(selector);
+}
+
+std::vector<std::string> ApiClient::candidateEndpoints(
+    const std::shared_ptr<EndpointSelector>& selector,
+    const std::string& defaultEndpoint
+) {
+    std::vector<std::string> endpoints;
+    if (selector) {
+        endpoints = selector->rank();
+    }
+    if (endpoints.empty()) {
+        endpoints.push_back(defaultEndpoint);
+    }
+    return endpoints;
+}
+
+ApiKeyPool::Lease ApiClient::acquireKey(const std::shared_ptr<ApiKeyPool>& pool) {
+    return pool ? pool->acquire() : ApiKeyPool::Lease();
+}
+
+void ApiClient::setContextCache(std::shared_ptr<ContextCache> cache) {
+    contextCache = std::move(cache);
+}
+
+ApiClient::RequestSettings ApiClient::getRequestSettings() const {
+    RequestSettings settings;
+    settings.apiKey = apiKey;
+    settings.keyPool = keyPool;
+    settings.endpointSelector = endpointSelector;
+    settings.contextCache = contextCache;
+    settings.maxOutputTokens = maxOutputTokens;
+    return settings;
+}
+
+namespace {
+
+// Runs callbacks on network workers one at a time, in the order they were pushed,
+// so user code never blocks the loop and chunks still arrive before the reply
+class CallbackQueue : public std::enable_shared_from_this<CallbackQueue> {
+public:
+    void push(std::function<void()> job) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            jobs.push_back(std::move(job));
+            if (draining) {
+                return;
+            }
+            draining = true;
+        }
+        NetworkLoop::shared().execute([self = shared_from_this()]() { self->drain(); });
+    }
+
+private:
+    void drain() {
+        while (true) {
+            std::function<void()> job;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (jobs.empty()) {
+                    draining = false;
+                    return;
+                }
+                job = std::move(jobs.front());
+                jobs.pop_front();
+            }
+            job();
+        }
+    }
+
+    std::mutex mutex;
+    std::deque<std::function<void()>> jobs;
+    bool draining = false;
+};
+
+} // namespace
+
+void ApiClient::sendChatCompletion(
+    const std::vector<Message>& messages,
+    const std::string& model,
+    CompletionCallback callback
+) {
+    auto callbacks = std::make_shared<CallbackQueue>();
+    StreamCallback onChunk;
+    if (streamCallback) {
+        onChunk = [callbacks, streamCallback = streamCallback](const std::string& chunk) {
+            callbacks->push([streamCallback, chunk]() { streamCallback(chunk); });
+        };
+    }
+
+    // Usage and stats are reported before the reply, as the callbacks promise
+    startTask(complete({messages, model, onChunk}),
+        [callbacks, usageCallback = usageCallback, statsCallback = requestStatsCallback, callback](
+            const CompletionResult& result) {
+            callbacks->push([usageCallback, statsCallback, callback, result]() {
+                if (result.hasUsage && usageCallback) {
+                    usageCallback(result.usage);
+                }
+                if (statsCallback) {
+                    statsCallback(result.stats);
+                }
+                callback(result.response, result.success);
+            });
+        },
+        [callbacks, callback](const std::string& error) {
+            callbacks->push([callback, error]() { callback("Error: " + error, false); });
+        });
+}
+
+namespace {
+
+// Chunks handed from a running completion to the coroutine reading them.
+// Shared with the completion, which keeps running if the reader gives up.
+class ChunkChannel {
+public:
+    void push(const std::string& chunk) {
+        std::lock_guard<std::mutex> lock(mutex);
+        chunks.push_back(chunk);
+        wakeReader();
+    }
+
+    void close(CompletionResult completion) {
+        std::lock_guard<std::mutex> lock(mutex);
+        result = std::move(completion);
+        closed = true;
+        wakeReader();
+    }
+
+    // co_await pop() yields the next chunk, or nullopt once closed and drained
+    auto pop() {
+        struct PopAwaiter {
+            ChunkChannel& channel;
+
+            bool await_ready() const noexcept { return false; }
+
+            bool await_suspend(std::coroutine_handle<> handle) {
+                std::lock_guard<std::mutex> lock(channel.mutex);
+                if (!channel.chunks.empty() || channel.closed) {
+                    return false;
+                }
+                channel.reader = handle;
+                return true;
+            }
+
+            std::optional<std::string> await_resume() {
+                std::lock_guard<std::mutex> lock(channel.mutex);
+                if (channel.chunks.empty()) {
+                    return std::nullopt;
+                }
+                std::string chunk = std::move(channel.chunks.front());
+                channel.chunks.pop_front();
+                return chunk;
+            }
+        };
+        return PopAwaiter{*this};
+    }
+
+    CompletionResult takeResult() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return std::move(result);
+    }
+
+private:
+    std::mutex mutex;
+    std::deque<std::string> chunks;
+    CompletionResult result;
+    bool closed = false;
+    std::coroutine_handle<> reader;
+
+    // Called under the mutex; the reader continues on the loop, not inside curl's callback
+    void wakeReader() {
+        if (reader) {
+            NetworkLoop::shared().post(std::exchange(reader, nullptr));
+        }
+    }
+};
+
+} // namespace
+
+AsyncGenerator<std::string> ApiClient::streamCompletion(CompletionRequest request, CompletionResult& result) {
+    auto channel = std::make_shared<ChunkChannel>();
+    request.onChunk = [channel](const std::string& chunk) {
+        channel->push(chunk);
+    };
+    startTask(complete(std::move(request)),
+        [channel](CompletionResult completion) {
+            channel->close(std::move(completion));
+        },
+        [channel](const std::string& error) {
+            CompletionResult completion;
+            completion.response = "Error: " + error;
+            channel->close(std::move(completion));
+        });
+
+    while (std::optional<std::string> chunk = co_await channel->pop()) {
+        co_yield std::move(*chunk);
+    }
+    result = channel->takeResult();
 }
 
 size_t ApiClient::writeCallback(char* ptr, size_t size, size_t nmemb, std::string* data) {
@@ -18,57 +381,407 @@ size_t ApiClient::writeCallback(char* ptr, size_t size, size_t nmemb, std::strin
     return size * nmemb;
 }
 
-bool ApiClient::makePostRequest(
+HttpResult ApiClient::performRequest(
+    const std::string& method,
     const std::string& url,
-    const nlohmann::json& payload,
-    std::string& response,
+    const std::string& body,
     const std::vector<std::string>& headers
 ) {
+    std::string responseBody;
+    HttpResult result = performStreamingRequest(method, url, body, headers, [&](const char* data, size_t size) {
+        responseBody.append(data, size);
+    }, getTransferTimeouts().requestSeconds);
+    result.body = std::move(responseBody);
+    return result;
+}
+
+// Forward each block of response data to the caller's sink
+static size_t dataCallback(char* ptr, size_t size, size_t nmemb, const DataCallback* onData) {
+    metrics::httpResponseBytes.add(size * nmemb);
+    (*onData)(ptr, size * nmemb);
+    return size * nmemb;
+}
+
+// Collect "Name: value" response headers, starting over for each response (e.g. after a 100 Continue)
+static size_t headerCallback(char* ptr, size_t size, size_t nmemb, std::map<std::string, std::string>* headers) {
+    std::string line(ptr, size * nmemb);
+    if (line.compare(0, 5, "HTTP/") == 0) {
+        headers->clear();
+        return line.size();
+    }
+
+    size_t colon = line.find(':');
+    if (colon != std::string::npos) {
+        std::string name = line.substr(0, colon);
+        std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return std::tolower(c); });
+        size_t valueStart = line.find_first_not_of(" \t", colon + 1);
+        size_t valueEnd = line.find_last_not_of(" \t\r\n");
+        (*headers)[name] = valueStart == std::string::npos || valueEnd < valueStart
+                               ? std::string()
+                               : line.substr(valueStart, valueEnd - valueStart + 1);
+    }
+    return line.size();
+}
+
+// Count a finished exchange by outcome and timing
+static void recordRequestMetrics(const HttpResult& result) {
+    metrics::httpInFlight.sub();
+    if (!result.ok()) {
+        metrics::httpTransportErrors.add();
+        return;
+    }
+
+    if (result.status >= 500) {
+        metrics::httpResponses5xx.add();
+    } else if (result.status >= 400) {
+        metrics::httpResponses4xx.add();
+    } else {
+        metrics::httpResponses2xx.add();
+    }
+    if (result.status == 429) {
+        metrics::httpThrottled.add();
+    }
+    metrics::httpDuration.observe(result.totalSeconds);
+    metrics::httpTtfb.observe(result.ttfbSeconds);
+}
+
+// Turn curl's cumulative phase timers into spans starting at the transfer's start
+static void traceTransferPhases(CURL* curl, Trace::Clock::time_point start) {
+    struct Phase {
+        const char* name;
+        CURLINFO end;
+    };
+    static const Phase phases[] = {
+        {"dns", CURLINFO_NAMELOOKUP_TIME},
+        {"connect", CURLINFO_CONNECT_TIME},
+        {"tls", CURLINFO_APPCONNECT_TIME},
+        {"send", CURLINFO_PRETRANSFER_TIME},
+        {"wait", CURLINFO_STARTTRANSFER_TIME},
+        {"receive", CURLINFO_TOTAL_TIME}
+    };
+
+    double previous = 0.0;
+    for (const auto& phase : phases) {
+        double seconds = 0.0;
+        curl_easy_getinfo(curl, phase.end, &seconds);
+
+        // Phases that didn't happen (a reused connection, plain HTTP) report 0
+        if (seconds <= previous) {
+            continue;
+        }
+        auto at = [&](double offset) {
+            return start + std::chrono::duration_cast<Trace::Clock::duration>(std::chrono::duration<double>(offset));
+        };
+        Trace::record(phase.name, "net", at(previous), at(seconds));
+        previous = seconds;
+    }
+}
+
+// An easy handle set up for one request, with the header list its options point at
+struct Transfer {
+    CURL* curl = nullptr;
+    struct curl_slist* headerList = nullptr;
+
+    ~Transfer() {
+        curl_slist_free_all(headerList);
+        if (curl) {
+            curl_easy_cleanup(curl);
+        }
+    }
+};
+
+// Configure a transfer; sink and result->headers must outlive it. URL, method and
+// body are copied by curl except the body, which must stay put until it is done.
+static bool openTransfer(
+    Transfer& transfer,
+    const std::string& method,
+    const std::string& url,
+    const std::string& body,
+    const std::vector<std::string>& headers,
+    const DataCallback* sink,
+    long timeoutSeconds,
+    HttpResult& result
+) {
+    ensureCurlInitialized();
     CURL* curl = curl_easy_init();
     if (!curl) {
-        std::cerr << "Failed to initialize curl" << std::endl;
+        result.error = "Failed to initialize curl";
         return false;
     }
+    transfer.curl = curl;
+
+    // Set URL, connecting through a Unix domain socket for http+unix:// URLs
+    std::string socketPath;
+    std::string httpUrl;
+    std::string urlError;
+    if (splitUnixSocketUrl(url, socketPath, httpUrl, urlError)) {
+        curl_easy_setopt(curl, CURLOPT_UNIX_SOCKET_PATH, socketPath.c_str());
+        curl_easy_setopt(curl, CURLOPT_URL, httpUrl.c_str());
+    } else if (!urlError.empty()) {
+        result.error = urlError;
+        return false;
+    } else {
+        curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+    }
     
-    // Set URL
-    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-    
-    // Set POST method
-    curl_easy_setopt(curl, CURLOPT_POST, 1L);
-    
-    // Set request body
-    std::string payloadStr = payload.dump();
-    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, payloadStr.c_str());
-    curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, payloadStr.size());
+    // Set method and request body
+    if (method == "POST") {
+        curl_easy_setopt(curl, CURLOPT_POST, 1L);
+    } else if (method != "GET") {
+        curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, method.c_str());
+    }
+
+    if (method != "GET") {
+        curl_easy_setopt(curl, CURLOPT_POSTFIELDS, body.c_str());
+        curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, static_cast<long>(body.size()));
+    }
     
-    // Set headers
-    struct curl_slist* headerList = nullptr;
-    headerList = curl_slist_append(headerList, "Content-Type: application/json");
+    // Set headers, defaulting to a JSON body
+    bool hasContentType = std::any_of(headers.begin(), headers.end(), [](const std::string& header) {
+        return strncasecmp(header.c_str(), "Content-Type:", 13) == 0;
+    });
+    if (!hasContentType) {
+        transfer.headerList = curl_slist_append(transfer.headerList, "Content-Type: application/json");
+    }
     
     for (const auto& header : headers) {
-        headerList = curl_slist_append(headerList, header.c_str());
+        transfer.headerList = curl_slist_append(transfer.headerList, header.c_str());
     }
     
-    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headerList);
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, transfer.headerList);
+
+    // Reuse lookups and TLS sessions across requests and threads
+    curl_easy_setopt(curl, CURLOPT_SHARE, sharedTransport());
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+
+    // Give up on endpoints that don't answer or stop sending, so the next one gets a turn.
+    // A stream is only cut off when it stalls, never for running long.
+    const TransferTimeouts& timeouts = getTransferTimeouts();
+    curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT_MS, timeouts.connectMilliseconds);
+    if (timeouts.stallSeconds > 0) {
+        curl_easy_setopt(curl, CURLOPT_LOW_SPEED_LIMIT, 1L);
+        curl_easy_setopt(curl, CURLOPT_LOW_SPEED_TIME, timeouts.stallSeconds);
+    }
+    if (timeoutSeconds > 0) {
+        curl_easy_setopt(curl, CURLOPT_TIMEOUT, timeoutSeconds);
+    }
     
-    // Set write callback
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, writeCallback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, dataCallback);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, sink);
+    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, headerCallback);
+    curl_easy_setopt(curl, CURLOPT_HEADERDATA, &result.headers);
+    return true;
+}
+
+// Fill in the outcome and timing of a finished transfer and count it
+static void finishTransfer(Transfer& transfer, CURLcode code, Trace::Clock::time_point start, HttpResult& result) {
+    if (code != CURLE_OK) {
+        result.error = curl_easy_strerror(code);
+    } else {
+        curl_easy_getinfo(transfer.curl, CURLINFO_RESPONSE_CODE, &result.status);
+        curl_easy_getinfo(transfer.curl, CURLINFO_STARTTRANSFER_TIME, &result.ttfbSeconds);
+        curl_easy_getinfo(transfer.curl, CURLINFO_TOTAL_TIME, &result.totalSeconds);
+    }
+    if (Trace::isEnabled()) {
+        traceTransferPhases(transfer.curl, start);
+    }
+    recordRequestMetrics(result);
+}
+
+// How often a thread blocked on a transfer checks whether the loop has stopped
+static const std::chrono::milliseconds kStopCheckInterval(100);
+
+// Response data handed from a transfer on the network loop to the thread waiting for it
+struct BlockingTransfer {
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<std::string> chunks;
+    bool done = false;
+    CURLcode code = CURLE_OK;
+};
+
+static Task<void> awaitTransfer(NetworkLoop& loop, CURL* curl, std::shared_ptr<BlockingTransfer> state) {
+    CURLcode code = co_await loop.perform(curl);
+    std::lock_guard<std::mutex> lock(state->mutex);
+    state->code = code;
+    state->done = true;
+    state->changed.notify_one();
+}
+
+// Run a configured transfer on the network loop and wait for it, so blocking
+// requests reuse the loop's open connections. Response data is queued back and
+// handed to sink on this thread, keeping callers' work off the loop.
+static CURLcode performOnLoop(CURL* curl, const DataCallback& sink) {
+    NetworkLoop& loop = NetworkLoop::shared();
+    if (loop.isLoopThread()) {
+        // Waiting here would stall the loop the transfer needs
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &sink);
+        return curl_easy_perform(curl);
+    }
+
+    auto state = std::make_shared<BlockingTransfer>();
+    DataCallback enqueue = [state](const char* data, size_t size) {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->chunks.emplace_back(data, size);
+        state->changed.notify_one();
+    };
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &enqueue);
+    startTask(awaitTransfer(loop, curl, state), []() {}, [](const std::string&) {});
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    while (true) {
+        while (!state->chunks.empty()) {
+            std::string chunk = std::move(state->chunks.front());
+            state->chunks.pop_front();
+            lock.unlock();
+            sink(chunk.data(), chunk.size());
+            lock.lock();
+        }
+        if (state->done) {
+            return state->code;
+        }
+
+        // A stopped loop abandons its transfers; it has let go of the handle by then
+        if (loop.isStopped()) {
+            return CURLE_ABORTED_BY_CALLBACK;
+        }
+        state->changed.wait_for(lock, kStopCheckInterval);
+    }
+}
+
+HttpResult ApiClient::performStreamingRequest(
+    const std::string& method,
+    const std::string& url,
+    const std::string& body,
+    const std::vector<std::string>& headers,
+    const DataCallback& onData,
+    long timeoutSeconds
+) {
+    // Answer from the cassette instead of the network when replaying
+    metrics::httpRequests.add();
+    metrics::httpRequestBytes.add(method == "GET" ? 0 : body.size());
+    metrics::httpInFlight.add();
+
+    HttpCassette* cassette = HttpCassette::active();
+    if (cassette && cassette->isReplaying()) {
+        Trace::Span span("replay", "net");
+        AllocTracker::Scope allocations(AllocTag::NETWORK);
+        HttpResult result = cassette->replay(method, url, body, [&onData](const char* data, size_t size) {
+            metrics::httpResponseBytes.add(size);
+            onData(data, size);
+        });
+        recordRequestMetrics(result);
+        span.setArg("status", result.status);
+        return result;
+    }
+
+    Trace::Span span("http", "net");
+    AllocTracker::Scope allocations(AllocTag::NETWORK);
+    HttpResult result;
+
+    // Keep each block and its arrival time when recording
+    std::vector<HttpCassette::Chunk> chunks;
+    auto started = std::chrono::steady_clock::now();
+    DataCallback sink = onData;
+    if (cassette) {
+        sink = [&](const char* data, size_t size) {
+            double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+            chunks.push_back({elapsed, std::string(data, size)});
+            onData(data, size);
+        };
+    }
+
+    Transfer transfer;
+    if (!openTransfer(transfer, method, url, body, headers, &sink, timeoutSeconds, result)) {
+        recordRequestMetrics(result);
+        return result;
+    }
     
     // Perform request
-    CURLcode res = curl_easy_perform(curl);
-    
-    // Check for errors
-    bool success = (res == CURLE_OK);
-    if (!success) {
-        std::cerr << "curl_easy_perform() failed: " << curl_easy_strerror(res) << std::endl;
+    auto transferStart = Trace::Clock::now();
+    finishTransfer(transfer, performOnLoop(transfer.curl, sink), transferStart, result);
+    span.setArg("status", result.status);
+
+    if (cassette) {
+        cassette->record(method, url, body, result, chunks);
     }
     
-    // Cleanup
-    curl_slist_free_all(headerList);
-    curl_easy_cleanup(curl);
-    
-    return success;
+    return result;
+}
+
+Task<HttpResult> ApiClient::performStreamingRequestAsync(
+    const std::string& method,
+    const std::string& url,
+    const std::string& body,
+    const std::vector<std::string>& headers,
+    const DataCallback& onData,
+    long timeoutSeconds
+) {
+    // Recording and paced replay block, so cassette runs keep to a thread beside the loop
+    NetworkLoop& loop = NetworkLoop::shared();
+    if (HttpCassette::active()) {
+        HttpResult result;
+        co_await loop.offload([&]() {
+            result = performStreamingRequest(method, url, body, headers, onData, timeoutSeconds);
+        });
+        co_return result;
+    }
+
+    metrics::httpRequests.add();
+    metrics::httpRequestBytes.add(method == "GET" ? 0 : body.size());
+    metrics::httpInFlight.add();
+
+    HttpResult result;
+    Transfer transfer;
+    bool opened;
+    {
+        AllocTracker::Scope allocations(AllocTag::NETWORK);
+        opened = openTransfer(transfer, method, url, body, headers, &onData, timeoutSeconds, result);
+    }
+    if (!opened) {
+        recordRequestMetrics(result);
+        co_return result;
+    }
+
+    // Spans can't stay open across the wait, so the exchange is recorded afterwards
+    auto transferStart = Trace::Clock::now();
+    CURLcode code = co_await loop.perform(transfer.curl);
+    finishTransfer(transfer, code, transferStart, result);
+    if (Trace::isEnabled()) {
+        Trace::record("http", "net", transferStart, Trace::Clock::now(), "status", result.status);
+    }
+    co_return result;
+}
+
+Task<HttpResult> ApiClient::performRequestAsync(
+    const std::string& method,
+    const std::string& url,
+    const std::string& body,
+    const std::vector<std::string>& headers
+) {
+    std::string responseBody;
+    HttpResult result = co_await performStreamingRequestAsync(method, url, body, headers,
+                                                              [&](const char* data, size_t size) {
+        responseBody.append(data, size);
+    }, getTransferTimeouts().requestSeconds);
+    result.body = std::move(responseBody);
+    co_return result;
+}
+
+bool ApiClient::makePostRequest(
+    const std::string& url,
+    const nlohmann::json& payload,
+    std::string& response,
+    const std::vector<std::string>& headers
+) {
+    HttpResult result = performRequest("POST", url, payload.dump(), headers);
+    if (!result.ok()) {
+        std::cerr << "curl_easy_perform() failed: " << result.error << std::endl;
+        return false;
+    }
+
+    response += result.body;
+    return true;
 }
 
 } // namespace libertymind
@@ -1,10 +1,28 @@
 #include "api_client.h"
 #include "google_client.h"
+#include "openai_client.h"
 
 namespace libertymind {
 
 std::unique_ptr<ApiClient> createApiClient(Provider provider, const std::string& apiKey) {
-    return std::make_unique<GoogleClient>(apiKey);
+    switch (provider) {
+        case Provider::OPENAI_COMPATIBLE:
+            return std::make_unique<OpenAIClient>(apiKey);
+        case Provider::GOOGLE:
+        default:
+            return std::make_unique<GoogleClient>(apiKey);
+    }
+}
+
+std::unique_ptr<ApiClient> createApiClient(Provider provider, std::shared_ptr<ApiKeyPool> keyPool) {
+    if (!keyPool || keyPool->size() == 0) {
+        return nullptr;
+    }
+
+    // The first key serves callers that don't go through the pool
+    std::unique_ptr<ApiClient> client = createApiClient(provider, keyPool->getStatus().front().key);
+    client->setKeyPool(std::move(keyPool));
+    return client;
 }
 
 } // namespace libertymind
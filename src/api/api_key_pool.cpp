@@ -0,0 +1,131 @@
+#include "api_key_pool.h"
+#include <algorithm>
+
+namespace libertymind {
+
+ApiKeyPool::Lease::Lease(std::shared_ptr<ApiKeyPool> pool, std::string key)
+    : pool(std::move(pool)), apiKey(std::move(key)) {}
+
+ApiKeyPool::Lease::~Lease() {
+    release();
+}
+
+ApiKeyPool::Lease::Lease(Lease&& other) noexcept
+    : pool(std::move(other.pool)), apiKey(std::move(other.apiKey)), lastStatus(other.lastStatus) {
+    other.pool.reset();
+}
+
+ApiKeyPool::Lease& ApiKeyPool::Lease::operator=(Lease&& other) noexcept {
+    if (this != &other) {
+        release();
+        pool = std::move(other.pool);
+        apiKey = std::move(other.apiKey);
+        lastStatus = other.lastStatus;
+        other.pool.reset();
+    }
+    return *this;
+}
+
+void ApiKeyPool::Lease::release() {
+    if (pool) {
+        pool->release(apiKey, lastStatus);
+        pool.reset();
+    }
+}
+
+ApiKeyPool::ApiKeyPool(const std::vector<std::string>& keys) {
+    setKeys(keys);
+}
+
+void ApiKeyPool::setKeys(const std::vector<std::string>& newKeys) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    std::vector<KeyState> updated;
+    for (const auto& key : newKeys) {
+        auto it = std::find_if(keys.begin(), keys.end(), [&](const KeyState& state) {
+            return state.key == key;
+        });
+        if (it != keys.end()) {
+            updated.push_back(*it);
+        } else {
+            KeyState state;
+            state.key = key;
+            updated.push_back(state);
+        }
+    }
+    keys = std::move(updated);
+}
+
+ApiKeyPool::Lease ApiKeyPool::acquire() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (keys.empty()) {
+        return Lease();
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    KeyState* best = nullptr;
+    for (auto& state : keys) {
+        if (state.cooldownUntil > now) {
+            continue;
+        }
+        // Fewest requests in flight wins; the least recently used breaks ties
+        if (!best || state.inFlight < best->inFlight ||
+            (state.inFlight == best->inFlight && state.lastUsed < best->lastUsed)) {
+            best = &state;
+        }
+    }
+
+    // Everything is cooling down; use whichever key recovers first rather than stall
+    if (!best) {
+        best = &*std::min_element(keys.begin(), keys.end(), [](const KeyState& a, const KeyState& b) {
+            return a.cooldownUntil < b.cooldownUntil;
+        });
+    }
+
+    ++best->inFlight;
+    ++best->requests;
+    best->lastUsed = ++sequence;
+    return Lease(shared_from_this(), best->key);
+}
+
+void ApiKeyPool::release(const std::string& key, long status) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = std::find_if(keys.begin(), keys.end(), [&](const KeyState& state) {
+        return state.key == key;
+    });
+    if (it == keys.end()) {
+        return; // Removed from the pool while in use
+    }
+
+    it->inFlight = std::max(0, it->inFlight - 1);
+
+    auto now = std::chrono::steady_clock::now();
+    if (status == 429) {
+        ++it->throttled;
+        std::chrono::seconds cooldown = kThrottleCooldown * (1 << std::min(it->consecutiveThrottles, 4));
+        it->cooldownUntil = now + std::min(cooldown, kMaxThrottleCooldown);
+        ++it->consecutiveThrottles;
+    } else if (status == 403) {
+        it->cooldownUntil = now + kForbiddenCooldown;
+    } else if (status != 0) {
+        it->consecutiveThrottles = 0;
+    }
+}
+
+size_t ApiKeyPool::size() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return keys.size();
+}
+
+std::vector<ApiKeyPool::KeyStatus> ApiKeyPool::getStatus() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto now = std::chrono::steady_clock::now();
+
+    std::vector<KeyStatus> status;
+    for (const auto& state : keys) {
+        status.push_back({state.key, state.inFlight, state.requests, state.throttled, state.cooldownUntil > now});
+    }
+    return status;
+}
+
+} // namespace libertymind
@@ -0,0 +1,180 @@
+#include "context_cache.h"
+#include "metrics.h"
+#include <algorithm>
+#include <functional>
+
+namespace libertymind {
+
+// Extend entries once less than this much of their lifetime remains
+static const std::chrono::seconds kRefreshMargin(300);
+
+// Rough chars-per-token ratio used to size prefixes before sending them
+static const size_t kCharsPerToken = 4;
+
+// First wait after a failed entry creation, doubled per failure up to kMaxCreationBackoff
+static const std::chrono::seconds kCreationBackoff(30);
+static const std::chrono::seconds kMaxCreationBackoff(1800);
+
+ContextCache::ContextCache(size_t minTokens, int ttlSeconds)
+    : minTokens(minTokens), ttlSeconds(ttlSeconds), rejectedKey(0),
+      creationFailures(0), hitCount(0), lookupCount(0) {}
+
+void ContextCache::setMinTokens(size_t tokens) {
+    std::lock_guard<std::mutex> lock(mutex);
+    minTokens = tokens;
+}
+
+size_t ContextCache::getMinTokens() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return minTokens;
+}
+
+void ContextCache::setTtlSeconds(int seconds) {
+    std::lock_guard<std::mutex> lock(mutex);
+    ttlSeconds = seconds;
+}
+
+int ContextCache::getTtlSeconds() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return ttlSeconds;
+}
+
+size_t ContextCache::makeKey(const std::string& model, const std::string& prefix) {
+    size_t key = std::hash<std::string>{}(prefix);
+    key ^= std::hash<std::string>{}(model) + 0x9e3779b97f4a7c15ULL + (key << 6) + (key >> 2);
+    return key;
+}
+
+ContextCache::Lookup ContextCache::classify(const Entry* entry, size_t key, std::chrono::steady_clock::time_point now) const {
+    if (key == rejectedKey) {
+        return Lookup::SKIP;
+    }
+    if (!entry || entry->name.empty() || key != entry->key || now >= entry->expiresAt) {
+        return now < retryCreationAt ? Lookup::SKIP : Lookup::MISS;
+    }
+    return now + kRefreshMargin >= entry->expiresAt ? Lookup::REFRESH : Lookup::HIT;
+}
+
+void ContextCache::retire(Entry& entry) {
+    if (!entry.name.empty()) {
+        entry.pendingDeletions.push_back(entry.name);
+        entry.name.clear();
+    }
+}
+
+bool ContextCache::mayNeedRequests(const std::string& apiKey, const std::string& model, const std::string& prefix) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(apiKey);
+    const Entry* entry = it != entries.end() ? &it->second : nullptr;
+    if (entry && !entry->pendingDeletions.empty()) {
+        return true;
+    }
+    if (prefix.size() < minTokens * kCharsPerToken) {
+        return false;
+    }
+
+    size_t key = makeKey(model, prefix);
+    if (entry && !entry->name.empty() && key != entry->key) {
+        return true;
+    }
+    Lookup result = classify(entry, key, std::chrono::steady_clock::now());
+    return result == Lookup::MISS || result == Lookup::REFRESH;
+}
+
+ContextCache::Lookup ContextCache::lookup(
+    const std::string& apiKey,
+    const std::string& model,
+    const std::string& prefix,
+    std::string& name
+) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (prefix.size() < minTokens * kCharsPerToken) {
+        return Lookup::SKIP;
+    }
+
+    // A different prefix replaces the key's old entry
+    size_t key = makeKey(model, prefix);
+    auto it = entries.find(apiKey);
+    Entry* entry = it != entries.end() ? &it->second : nullptr;
+    if (entry && key != entry->key) {
+        retire(*entry);
+    }
+
+    Lookup result = classify(entry, key, std::chrono::steady_clock::now());
+    if (result == Lookup::SKIP) {
+        return result;
+    }
+
+    ++lookupCount;
+    metrics::contextCacheLookups.add();
+    if (result == Lookup::MISS) {
+        return result;
+    }
+
+    ++hitCount;
+    metrics::contextCacheHits.add();
+    name = entry->name;
+    return result;
+}
+
+void ContextCache::store(const std::string& apiKey, const std::string& model, const std::string& prefix, const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutex);
+    Entry& entry = entries[apiKey];
+    entry.name = name;
+    entry.key = makeKey(model, prefix);
+    entry.expiresAt = std::chrono::steady_clock::now() + std::chrono::seconds(ttlSeconds);
+    creationFailures = 0;
+}
+
+void ContextCache::markRejected(const std::string& model, const std::string& prefix) {
+    std::lock_guard<std::mutex> lock(mutex);
+    rejectedKey = makeKey(model, prefix);
+}
+
+void ContextCache::deferCreation() {
+    std::lock_guard<std::mutex> lock(mutex);
+    ++creationFailures;
+    std::chrono::seconds backoff = kCreationBackoff * (1 << std::min(creationFailures - 1, 6));
+    retryCreationAt = std::chrono::steady_clock::now() + std::min(backoff, kMaxCreationBackoff);
+}
+
+void ContextCache::invalidate() {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto& [apiKey, entry] : entries) {
+        retire(entry);
+        entry.key = 0;
+    }
+    rejectedKey = 0;
+}
+
+void ContextCache::invalidate(const std::string& apiKey) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(apiKey);
+    if (it != entries.end()) {
+        retire(it->second);
+        it->second.key = 0;
+    }
+}
+
+std::vector<std::string> ContextCache::takePendingDeletions(const std::string& apiKey) {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<std::string> names;
+    auto it = entries.find(apiKey);
+    if (it != entries.end()) {
+        names.swap(it->second.pendingDeletions);
+    }
+    return names;
+}
+
+std::mutex& ContextCache::creationMutex() {
+    return createMutex;
+}
+
+void ContextCache::getHitStats(uint64_t& hits, uint64_t& lookups) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    hits = hitCount;
+    lookups = lookupCount;
+}
+
+} // namespace libertymind
@@ -0,0 +1,211 @@
+#include "endpoint_selector.h"
+#include "api_client.h"
+#include "http_cassette.h"
+#include <curl/curl.h>
+#include <algorithm>
+
+namespace libertymind {
+
+// Weight of the newest probe in the smoothed RTT
+static const double kRttSmoothing = 0.3;
+
+// Give up on a probe after this long
+static const long kProbeTimeoutMs = 3000;
+
+EndpointSelector::EndpointSelector(const std::vector<std::string>& urls) : stopping(false) {
+    setEndpoints(urls);
+}
+
+EndpointSelector::~EndpointSelector() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    probeCondition.notify_all();
+    if (probeThread.joinable()) {
+        probeThread.join();
+    }
+}
+
+void EndpointSelector::setEndpoints(const std::vector<std::string>& urls) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    std::vector<EndpointStatus> updated;
+    for (const auto& url : urls) {
+        auto it = std::find_if(endpoints.begin(), endpoints.end(), [&](const EndpointStatus& status) {
+            return status.url == url;
+        });
+        if (it != endpoints.end()) {
+            updated.push_back(*it);
+        } else {
+            EndpointStatus status;
+            status.url = url;
+            updated.push_back(status);
+        }
+    }
+    endpoints = std::move(updated);
+}
+
+std::vector<std::string> EndpointSelector::rank() const {
+    std::vector<EndpointStatus> sorted;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        sorted = endpoints;
+    }
+
+    // Unprobed endpoints keep their configured order behind the measured healthy ones
+    std::stable_sort(sorted.begin(), sorted.end(), [](const EndpointStatus& a, const EndpointStatus& b) {
+        if (a.healthy != b.healthy) {
+            return a.healthy;
+        }
+        if (a.healthy && a.probed != b.probed) {
+            return a.probed;
+        }
+        if (a.healthy && a.probed) {
+            return a.rttSeconds < b.rttSeconds;
+        }
+        return false;
+    });
+
+    std::vector<std::string> urls;
+    for (const auto& status : sorted) {
+        urls.push_back(status.url);
+    }
+    return urls;
+}
+
+void EndpointSelector::reportSuccess(const std::string& url) {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto& status : endpoints) {
+        if (status.url == url) {
+            status.healthy = true;
+            status.consecutiveFailures = 0;
+        }
+    }
+}
+
+void EndpointSelector::reportFailure(const std::string& url) {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto& status : endpoints) {
+        if (status.url == url) {
+            status.healthy = false;
+            ++status.consecutiveFailures;
+        }
+    }
+}
+
+bool EndpointSelector::probe(const std::string& url, double& rtt, double& connect, double& handshake) {
+    // Replayed requests never touch the network, so every endpoint is equally close
+    HttpCassette* cassette = HttpCassette::active();
+    if (cassette && cassette->isReplaying()) {
+        rtt = connect = handshake = 0.0;
+        return true;
+    }
+
+    ensureCurlInitialized();
+    CURL* curl = curl_easy_init();
+    if (!curl) {
+        return false;
+    }
+
+    // Any HTTP response means the endpoint is reachable; the status doesn't matter
+    std::string socketPath;
+    std::string httpUrl;
+    std::string urlError;
+    if (splitUnixSocketUrl(url, socketPath, httpUrl, urlError)) {
+        curl_easy_setopt(curl, CURLOPT_UNIX_SOCKET_PATH, socketPath.c_str());
+        curl_easy_setopt(curl, CURLOPT_URL, httpUrl.c_str());
+    } else if (!urlError.empty()) {
+        curl_easy_cleanup(curl);
+        return false;
+    } else {
+        curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+    }
+    curl_easy_setopt(curl, CURLOPT_NOBODY, 1L);
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, kProbeTimeoutMs);
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+
+    CURLcode res = curl_easy_perform(curl);
+    if (res == CURLE_OK) {
+        double lookup = 0.0;
+        double tcp = 0.0;
+        double tls = 0.0;
+        double firstByte = 0.0;
+        curl_easy_getinfo(curl, CURLINFO_NAMELOOKUP_TIME, &lookup);
+        curl_easy_getinfo(curl, CURLINFO_CONNECT_TIME, &tcp);
+        curl_easy_getinfo(curl, CURLINFO_APPCONNECT_TIME, &tls);
+        curl_easy_getinfo(curl, CURLINFO_STARTTRANSFER_TIME, &firstByte);
+
+        // curl reports cumulative times from the start of the transfer
+        connect = tcp - lookup;
+        handshake = tls > 0.0 ? tls - tcp : 0.0;
+        rtt = firstByte;
+    }
+
+    curl_easy_cleanup(curl);
+    return res == CURLE_OK;
+}
+
+void EndpointSelector::probeAll() {
+    std::vector<std::string> urls;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const auto& status : endpoints) {
+            urls.push_back(status.url);
+        }
+    }
+
+    // With a single endpoint there is nothing to choose between
+    if (urls.size() < 2) {
+        return;
+    }
+
+    // Probe without holding the lock; requests keep routing meanwhile
+    for (const auto& url : urls) {
+        double rtt = 0.0;
+        double connect = 0.0;
+        double handshake = 0.0;
+        bool reachable = probe(url, rtt, connect, handshake);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto& status : endpoints) {
+            if (status.url != url) {
+                continue;
+            }
+            if (reachable) {
+                status.rttSeconds = status.probed ? status.rttSeconds + kRttSmoothing * (rtt - status.rttSeconds) : rtt;
+                status.connectSeconds = connect;
+                status.handshakeSeconds = handshake;
+                status.probed = true;
+                status.healthy = true;
+                status.consecutiveFailures = 0;
+            } else {
+                status.healthy = false;
+                ++status.consecutiveFailures;
+            }
+        }
+    }
+}
+
+void EndpointSelector::startProbing(std::chrono::seconds interval) {
+    if (probeThread.joinable()) {
+        return;
+    }
+
+    probeThread = std::thread([this, interval]() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!stopping) {
+            lock.unlock();
+            probeAll();
+            lock.lock();
+            probeCondition.wait_for(lock, interval, [this]() { return stopping; });
+        }
+    });
+}
+
+std::vector<EndpointStatus> EndpointSelector::getStatus() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return endpoints;
+}
+
+} // namespace libertymind
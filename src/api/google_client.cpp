@@ -1,157 +1,798 @@
 #include "google_client.h"
+#include "alloc_tracker.h"
+#include "context_cache.h"
+#include "metrics.h"
+#include "network_loop.h"
+#include "model_registry.h"
+#include "sse_parser.h"
+#include "trace.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
 #include <iostream>
 #include <thread>
-#include <curl/curl.h>
 #include <nlohmann/json.hpp>
 
 namespace libertymind {
 
+static const char* kDefaultEndpoint = "https://generativelanguage.googleapis.com";
+static const char* kApiVersion = "/v1";
+
+// Context caching and model listing are only available on the beta surface
+static const char* kBetaApiVersion = "/v1beta";
+
+// Give up on a batch job after this many polls in a row fail
+static const int kMaxPollFailures = 10;
+
+// How often a waiting batch job checks whether it should stop
+static const std::chrono::milliseconds kStopCheckInterval(100);
+
+// Throttling and server errors pass; other refusals hold for the same request
+static bool isTransientFailure(const HttpResult& result) {
+    return !result.ok() || result.status == 408 || result.status == 429 || result.status >= 500;
+}
+
+// Whether a request failed because its cachedContents entry is gone or can't be used
+// with this key, as opposed to any other error
+static bool isCacheRejection(const HttpResult& result) {
+    if (!result.ok()) {
+        return false;
+    }
+    if (result.status == 403 || result.status == 404) {
+        return true;
+    }
+    if (result.status != 400) {
+        return false;
+    }
+
+    std::string message;
+    try {
+        nlohmann::json body = nlohmann::json::parse(result.body);
+        if (body.is_array() && !body.empty()) {
+            body = body[0];
+        }
+        message = body.at("error").value("message", "");
+    } catch (const std::exception& e) {
+        return false;
+    }
+    std::transform(message.begin(), message.end(), message.begin(), [](unsigned char c) { return std::tolower(c); });
+    return message.find("cachedcontent") != std::string::npos || message.find("cached content") != std::string::npos;
+}
+
+// Reply text and usage of a generateContent response, or why there is none
+static bool extractReply(const nlohmann::json& response, std::string& text, TokenUsage& usage, std::string& error) {
+    if (response.contains("usageMetadata")) {
+        const auto& metadata = response["usageMetadata"];
+        usage.promptTokens = metadata.value("promptTokenCount", 0);
+        usage.outputTokens = metadata.value("candidatesTokenCount", 0);
+        usage.totalTokens = metadata.value("totalTokenCount", 0);
+    }
+
+    if (!response.contains("candidates") || !response["candidates"].is_array() || response["candidates"].empty()) {
+        std::string blockReason = response.value("promptFeedback", nlohmann::json::object()).value("blockReason", "");
+        error = blockReason.empty() ? "No candidates in response" : "Prompt blocked: " + blockReason;
+        return false;
+    }
+
+    const auto& content = response["candidates"][0].value("content", nlohmann::json::object());
+    for (const auto& part : content.value("parts", nlohmann::json::array())) {
+        if (part.contains("text") && part["text"].is_string()) {
+            text += part["text"].get<std::string>();
+        }
+    }
+    if (text.empty()) {
+        error = "No text found in response";
+        return false;
+    }
+    return true;
+}
+
+// Whether a batch job state name is final
+static bool isFinalBatchState(const std::string& state) {
+    for (const char* suffix : {"_SUCCEEDED", "_FAILED", "_CANCELLED", "_EXPIRED"}) {
+        size_t length = std::strlen(suffix);
+        if (state.size() >= length && state.compare(state.size() - length, length, suffix) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
 GoogleClient::GoogleClient(const std::string& apiKey) : ApiClient(apiKey) {}
 
 std::string GoogleClient::getBaseUrl() const {
-    return "https://generativelanguage.googleapis.com/v1";
+    return candidateEndpoints(endpointSelector, kDefaultEndpoint).front() + kApiVersion;
 }
 
-// Simple callback function for curl
-static size_t WriteCallback(void* contents, size_t size, size_t nmemb, std::string* s) {
-    size_t newLength = size * nmemb;
-    try {
-        s->append((char*)contents, newLength);
-        return newLength;
-    } catch(std::bad_alloc& e) {
-        return 0;
+
+nlohmann::json GoogleClient::buildRequestPayload(const std::vector<Message>& messages, const std::string& cachedContent) {
+    nlohmann::json payload;
+    nlohmann::json contents = nlohmann::json::array();
+    std::string systemText;
+
+    for (size_t i = 0; i < messages.size(); ++i) {
+        const auto& message = messages[i];
+
+        // The cached entry already holds the leading system message
+        if (!cachedContent.empty() && i == 0 && message.role == "system") {
+            continue;
+        }
+
+        // A cached request can't carry a system instruction, so send other system text inline
+        if (!cachedContent.empty() && message.role == "system") {
+            contents.push_back({
+                {"role", "user"},
+                {"parts", nlohmann::json::array({{{"text", message.content}}})}
+            });
+            continue;
+        }
+
+        // Gemini takes system messages separately as a system instruction
+        if (message.role == "system") {
+            if (!systemText.empty()) {
+                systemText += "\n\n";
+            }
+            systemText += message.content;
+            continue;
+        }
+
+        // Gemini calls the assistant role "model"
+        std::string role = message.role == "assistant" ? "model" : "user";
+        contents.push_back({
+            {"role", role},
+            {"parts", nlohmann::json::array({{{"text", message.content}}})}
+        });
+    }
+
+    if (contents.empty()) {
+        contents.push_back({
+            {"role", "user"},
+            {"parts", nlohmann::json::array({{{"text", "Hello"}}})}
+        });
+    }
+
+    payload["contents"] = std::move(contents);
+    if (!systemText.empty()) {
+        payload["systemInstruction"] = {
+            {"parts", nlohmann::json::array({{{"text", systemText}}})}
+        };
+    }
+    if (!cachedContent.empty()) {
+        payload["cachedContent"] = cachedContent;
     }
+
+    return payload;
 }
 
-void GoogleClient::sendChatCompletion(
-    const std::vector<Message>& messages,
+std::string GoogleClient::resolveCachedContent(
+    ContextCache& cache,
+    const std::string& endpoint,
+    const std::string& apiKey,
     const std::string& model,
-    CompletionCallback callback
+    const std::string& prefix
 ) {
-    // Uncommented and fixed implementation to use the actual Google API
+    std::string betaBaseUrl = endpoint + kBetaApiVersion;
+
+    // Best-effort cleanup of entries replaced or invalidated since the last request
+    for (const auto& name : cache.takePendingDeletions(apiKey)) {
+        performRequest("DELETE", betaBaseUrl + "/" + name + "?key=" + apiKey, "");
+    }
+
+    std::lock_guard<std::mutex> createLock(cache.creationMutex());
 
-    // Extract the last user message for simplicity
-    std::string userMessage = "Hello";
-    for (auto it = messages.rbegin(); it != messages.rend(); ++it) {
-        if (it->role == "user") {
-            userMessage = it->content;
+    std::string name;
+    std::string ttl = std::to_string(cache.getTtlSeconds()) + "s";
+    switch (cache.lookup(apiKey, model, prefix, name)) {
+        case ContextCache::Lookup::SKIP:
+            return "";
+        case ContextCache::Lookup::HIT:
+            return name;
+        case ContextCache::Lookup::REFRESH: {
+            // Extend the entry's lifetime so it outlives the session
+            HttpResult result = performRequest(
+                "PATCH", betaBaseUrl + "/" + name + "?updateMask=ttl&key=" + apiKey,
+                nlohmann::json({{"ttl", ttl}}).dump());
+            if (result.ok() && result.status == 200) {
+                cache.store(apiKey, model, prefix, name);
+                return name;
+            }
+
+            // The entry lives on until it expires, so a passing failure can wait for the next request
+            if (isTransientFailure(result)) {
+                return name;
+            }
+            cache.invalidate(apiKey);
+            return "";
+        }
+        case ContextCache::Lookup::MISS:
             break;
+    }
+
+    // Upload the prefix once as a cache entry
+    nlohmann::json request = {
+        {"model", "models/" + model},
+        {"systemInstruction", {{"parts", nlohmann::json::array({{{"text", prefix}}})}}},
+        {"ttl", ttl}
+    };
+
+    HttpResult result = performRequest("POST", betaBaseUrl + "/cachedContents?key=" + apiKey, request.dump());
+    if (result.ok() && result.status == 200) {
+        try {
+            nlohmann::json responseJson = nlohmann::json::parse(result.body);
+            if (responseJson.contains("name")) {
+                name = responseJson["name"];
+                cache.store(apiKey, model, prefix, name);
+                return name;
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "Error parsing cachedContents response: " << e.what() << std::endl;
+        }
+    }
+
+    if (result.ok() && result.status >= 400 && !isTransientFailure(result)) {
+        // Too small, unsupported model, etc. - stop trying for this prefix
+        cache.markRejected(model, prefix);
+    } else {
+        // Throttled, server trouble or an odd reply - try again later
+        cache.deferCreation();
+    }
+    return "";
+}
+
+Task<HttpResult> GoogleClient::generateContent(
+    const std::string& baseUrl,
+    const std::string& model,
+    const std::string& apiKey,
+    const std::string& payload,
+    const StreamCallback& streamCallback
+) {
+    if (!streamCallback) {
+        co_return co_await performRequestAsync("POST", baseUrl + "/models/" + model + ":generateContent?key=" + apiKey,
+                                               payload);
+    }
+
+    // Each event is a partial generateContent response; the last one carries usage and finish reason
+    std::string text;
+    std::string rawBody;
+    nlohmann::json lastChunk;
+    SseParser parser([&](const std::string& data) {
+        Trace::Span span("parse chunk", "parse");
+        span.setArg("bytes", static_cast<int64_t>(data.size()));
+        AllocTracker::Scope allocations(AllocTag::PARSE);
+        try {
+            nlohmann::json chunk = nlohmann::json::parse(data);
+            if (chunk.contains("candidates") && chunk["candidates"].is_array() && !chunk["candidates"].empty()) {
+                const auto& content = chunk["candidates"][0].value("content", nlohmann::json::object());
+                for (const auto& part : content.value("parts", nlohmann::json::array())) {
+                    if (part.contains("text") && part["text"].is_string()) {
+                        std::string piece = part["text"];
+                        text += piece;
+                        if (!piece.empty()) {
+                            streamCallback(piece);
+                        }
+                    }
+                }
+            }
+            lastChunk = std::move(chunk);
+        } catch (const std::exception& e) {
+            // Ignore malformed chunks
+        }
+    });
+
+    HttpResult result = co_await performStreamingRequestAsync(
+        "POST", baseUrl + "/models/" + model + ":streamGenerateContent?alt=sse&key=" + apiKey, payload, {},
+        [&](const char* data, size_t size) {
+            appendErrorBody(rawBody, data, size);
+            parser.feed(data, size);
+        });
+    parser.finish();
+
+    if (lastChunk.is_null()) {
+        // Errors come back as a plain JSON body
+        result.body = std::move(rawBody);
+    } else if (!text.empty()) {
+        if (!lastChunk.contains("candidates") || !lastChunk["candidates"].is_array() || lastChunk["candidates"].empty()) {
+            lastChunk["candidates"] = nlohmann::json::array({nlohmann::json::object()});
         }
+        lastChunk["candidates"][0]["content"] = {
+            {"role", "model"},
+            {"parts", nlohmann::json::array({{{"text", text}}})}
+        };
+        result.body = lastChunk.dump();
+    } else {
+        // Blocked prompts and the like: let the caller report the last chunk
+        result.body = lastChunk.dump();
+    }
+    co_return result;
+}
+
+void GoogleClient::handleResponse(
+    const HttpResult& result,
+    const UsageCallback& usageCallback,
+    const CompletionCallback& callback
+) {
+    // Check for errors
+    if (!result.ok()) {
+        callback(std::string("Error: ") + result.error, false);
+        return;
     }
 
-    // Create a thread to handle the API request
-    std::thread([userMessage, model, apiKey=this->apiKey, callback]() {
-        // Initialize curl
-        CURL* curl = curl_easy_init();
-        if (!curl) {
-            callback("Error: Failed to initialize curl", false);
+    const std::string& responseText = result.body;
+
+    // Parse the JSON response
+    try {
+        // Use nlohmann/json to parse the response
+        nlohmann::json responseJson;
+        {
+            Trace::Span span("parse response", "parse");
+            span.setArg("bytes", static_cast<int64_t>(responseText.size()));
+            AllocTracker::Scope allocations(AllocTag::PARSE);
+            responseJson = nlohmann::json::parse(responseText);
+        }
+
+        // Handle API error
+        if (responseJson.contains("error")) {
+            std::string errorMessage = "API Error";
+            if (responseJson["error"].contains("message")) {
+                errorMessage = responseJson["error"]["message"];
+            }
+            callback("Error: " + errorMessage, false);
             return;
         }
 
-        // Prepare URL
-        std::string url = "https://generativelanguage.googleapis.com/v1/models/" +
-                          model + ":generateContent?key=" + apiKey;
+        // Same extraction as batch results, so every part of a multi-part reply is kept
+        std::string text;
+        std::string error;
+        TokenUsage tokenUsage;
+        bool success = extractReply(responseJson, text, tokenUsage, error);
+
+        // Report token usage if the provider included it
+        if (usageCallback && responseJson.contains("usageMetadata")) {
+            usageCallback(tokenUsage);
+        }
+
+        if (success) {
+            callback(text, true);
+        } else {
+            callback("Error: " + error, false);
+        }
+    } catch (const std::exception& e) {
+        // JSON parsing error
+        callback("Error parsing response: " + std::string(e.what()) +
+                 "\nResponse: " + responseText.substr(0, 100) + "...", false);
+    }
+}
+
+Task<CompletionResult> GoogleClient::complete(CompletionRequest request) {
+    return runCompletion(getRequestSettings(), std::move(request));
+}
+
+Task<CompletionResult> GoogleClient::runCompletion(RequestSettings settings, CompletionRequest request) {
+    const std::vector<Message>& messages = request.messages;
+    const std::string& model = request.model;
+    const std::shared_ptr<EndpointSelector>& selector = settings.endpointSelector;
+    const std::shared_ptr<ContextCache>& cache = settings.contextCache;
+
+    // Use one key from the pool for the whole exchange
+    ApiKeyPool::Lease lease = acquireKey(settings.keyPool);
+    const std::string& apiKey = lease.key().empty() ? settings.apiKey : lease.key();
+    std::vector<std::string> endpoints = candidateEndpoints(selector, kDefaultEndpoint);
+
+    // Reference a cached copy of a long system prefix instead of resending it. Creating or
+    // extending the entry takes blocking round trips, so that runs beside the loop.
+    std::string cachedContent;
+    if (cache && !messages.empty() && messages[0].role == "system") {
+        const std::string& prefix = messages[0].content;
+        if (cache->mayNeedRequests(apiKey, model, prefix)) {
+            co_await NetworkLoop::shared().offload([&]() {
+                cachedContent = resolveCachedContent(*cache, endpoints.front(), apiKey, model, prefix);
+            });
+        } else if (cache->lookup(apiKey, model, prefix, cachedContent) != ContextCache::Lookup::HIT) {
+            // The entry changed since the check; send the prefix inline this time
+            cachedContent.clear();
+        }
+    }
+
+    // Build the request payload from the full conversation context
+    std::string body;
+    {
+        Trace::Span span("build request", "request");
+        AllocTracker::Scope allocations(AllocTag::NETWORK);
+        nlohmann::json payload = buildRequestPayload(messages, cachedContent);
+        payload["generationConfig"] = {{"temperature", 0.7}, {"maxOutputTokens", settings.maxOutputTokens}};
+        body = payload.dump();
+        span.setArg("bytes", static_cast<int64_t>(body.size()));
+    }
+
+    // Note when text reaches the caller; after that a failed stream can't be retried
+    bool streamed = false;
+    StreamCallback onChunk;
+    if (request.onChunk) {
+        onChunk = [&](const std::string& chunk) {
+            streamed = true;
+            request.onChunk(chunk);
+        };
+    }
+
+    // Try endpoints fastest first, moving on when one is unreachable or failing
+    HttpResult result;
+    for (const auto& endpoint : endpoints) {
+        if (&endpoint != &endpoints.front()) {
+            metrics::endpointRetries.add();
+        }
+        std::string baseUrl = endpoint + (cachedContent.empty() ? kApiVersion : kBetaApiVersion);
+        result = co_await generateContent(baseUrl, model, apiKey, body, onChunk);
+
+        // A cache entry can vanish server-side; drop it and resend the prefix inline.
+        // Other errors go down the normal failure path and leave the entry alone.
+        if (!cachedContent.empty() && isCacheRejection(result)) {
+            cache->invalidate(apiKey);
+            cachedContent.clear();
+            {
+                Trace::Span span("build request", "request");
+                AllocTracker::Scope allocations(AllocTag::NETWORK);
+                nlohmann::json payload = buildRequestPayload(messages);
+                payload["generationConfig"] = {{"temperature", 0.7}, {"maxOutputTokens", settings.maxOutputTokens}};
+                body = payload.dump();
+            }
+            baseUrl = endpoint + kApiVersion;
+            result = co_await generateContent(baseUrl, model, apiKey, body, onChunk);
+        }
 
-        // Prepare JSON payload with proper escaping
-        std::string escapedMessage = userMessage;
-        // Replace backslashes with double backslashes
-        size_t pos = 0;
-        while ((pos = escapedMessage.find("\\", pos)) != std::string::npos) {
-            escapedMessage.replace(pos, 1, "\\\\");
-            pos += 2;
+        if (result.ok() && result.status < 500) {
+            if (selector) {
+                selector->reportSuccess(endpoint);
+            }
+            break;
         }
-        // Replace double quotes with escaped quotes
-        pos = 0;
-        while ((pos = escapedMessage.find("\"", pos)) != std::string::npos) {
-            escapedMessage.replace(pos, 1, "\\\"");
-            pos += 2;
+        if (selector) {
+            selector->reportFailure(endpoint);
         }
-        // Replace newlines with \n
-        pos = 0;
-        while ((pos = escapedMessage.find("\n", pos)) != std::string::npos) {
-            escapedMessage.replace(pos, 1, "\\n");
-            pos += 2;
+        if (streamed) {
+            break;
         }
+    }
 
-        // Create the JSON payload
-        std::string jsonPayload = "{\"contents\":[{\"role\":\"user\",\"parts\":[{\"text\":\"" +
-                                 escapedMessage + "\"}]}],\"generationConfig\":{\"temperature\":0.7,\"maxOutputTokens\":2000}}";
+    // Hand the key back, cooling it off if it was throttled, before anyone reacts to the reply
+    lease.setStatus(result.status);
+    lease.release();
 
-        // Response buffer
-        std::string responseText;
+    CompletionResult completion;
+    completion.stats.model = model;
+    completion.stats.status = result.status;
+    completion.stats.ttfbSeconds = result.ttfbSeconds;
+    completion.stats.totalSeconds = result.totalSeconds;
+    handleResponse(result,
+        [&](const TokenUsage& usage) {
+            completion.usage = usage;
+            completion.hasUsage = true;
+            completion.stats.outputTokens = usage.outputTokens;
+        },
+        [&](const std::string& response, bool success) {
+            completion.response = response;
+            completion.success = success;
+            completion.stats.success = success;
+        });
+    co_return completion;
+}
 
-        // Set curl options
-        curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-        curl_easy_setopt(curl, CURLOPT_POSTFIELDS, jsonPayload.c_str());
-        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
-        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &responseText);
+int GoogleClient::countTokens(const std::vector<Message>& messages, const std::string& model) {
+    try {
+        nlohmann::json payload = buildRequestPayload(messages);
 
-        // Set headers
-        struct curl_slist* headers = NULL;
-        headers = curl_slist_append(headers, "Content-Type: application/json");
-        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+        // countTokens does not accept a system instruction alongside plain contents
+        if (payload.contains("systemInstruction")) {
+            nlohmann::json systemTurn = {
+                {"role", "user"},
+                {"parts", payload["systemInstruction"]["parts"]}
+            };
+            payload["contents"].insert(payload["contents"].begin(), systemTurn);
+            payload.erase("systemInstruction");
+        }
 
-        // Perform request
-        CURLcode res = curl_easy_perform(curl);
+        ApiKeyPool::Lease lease = acquireKey(keyPool);
+        std::string url = getBaseUrl() + "/models/" + model + ":countTokens?key=" +
+                          (lease.key().empty() ? apiKey : lease.key());
+        HttpResult result = performRequest("POST", url, payload.dump());
+        lease.setStatus(result.status);
+        if (!result.ok()) {
+            std::cerr << "curl_easy_perform() failed: " << result.error << std::endl;
+            return -1;
+        }
 
-        // Check for errors
-        if (res != CURLE_OK) {
-            callback(std::string("Error: ") + curl_easy_strerror(res), false);
-        } else {
-            // Parse the JSON response
-            try {
-                // Use nlohmann/json to parse the response
-                nlohmann::json responseJson = nlohmann::json::parse(responseText);
-
-                // Check if we have candidates
-                if (responseJson.contains("candidates") &&
-                    responseJson["candidates"].is_array() &&
-                    !responseJson["candidates"].empty()) {
-
-                    // Get the first candidate
-                    const auto& candidate = responseJson["candidates"][0];
-
-                    // Check if it has content and parts
-                    if (candidate.contains("content") &&
-                        candidate["content"].contains("parts") &&
-                        candidate["content"]["parts"].is_array() &&
-                        !candidate["content"]["parts"].empty()) {
-
-                        // Get the text from the first part
-                        const auto& part = candidate["content"]["parts"][0];
-                        if (part.contains("text")) {
-                            std::string text = part["text"];
-                            callback(text, true);
-                        } else {
-                            callback("Error: No text found in response", false);
-                        }
-                    } else {
-                        callback("Error: Invalid content format in response", false);
-                    }
-                } else if (responseJson.contains("error")) {
-                    // Handle API error
-                    std::string errorMessage = "API Error";
-                    if (responseJson["error"].contains("message")) {
-                        errorMessage = responseJson["error"]["message"];
+        nlohmann::json responseJson = nlohmann::json::parse(result.body);
+        return responseJson.value("totalTokens", -1);
+    } catch (const std::exception& e) {
+        std::cerr << "Error counting tokens: " << e.what() << std::endl;
+        return -1;
+    }
+}
+
+bool GoogleClient::listModels(std::vector<ModelInfo>& models) {
+    try {
+        std::string pageToken;
+        do {
+            std::string url = candidateEndpoints(endpointSelector, kDefaultEndpoint).front() + kBetaApiVersion +
+                              "/models?pageSize=1000&key=" + apiKey;
+            if (!pageToken.empty()) {
+                url += "&pageToken=" + pageToken;
+            }
+
+            HttpResult result = performRequest("GET", url, "");
+            if (!result.ok() || result.status != 200) {
+                return false;
+            }
+
+            nlohmann::json responseJson = nlohmann::json::parse(result.body);
+            for (const auto& model : responseJson.value("models", nlohmann::json::array())) {
+                std::vector<std::string> methods =
+                    model.value("supportedGenerationMethods", std::vector<std::string>());
+
+                // Only chat-capable models belong in the selection menu
+                if (std::find(methods.begin(), methods.end(), "generateContent") == methods.end()) {
+                    continue;
+                }
+
+                ModelInfo info;
+                info.id = model.value("name", "");
+                if (info.id.rfind("models/", 0) == 0) {
+                    info.id = info.id.substr(7);
+                }
+                info.name = model.value("displayName", info.id);
+                info.description = model.value("description", "");
+                info.inputTokenLimit = model.value("inputTokenLimit", 0);
+                info.outputTokenLimit = model.value("outputTokenLimit", 0);
+                info.supportedMethods = std::move(methods);
+                models.push_back(std::move(info));
+            }
+
+            pageToken = responseJson.value("nextPageToken", "");
+        } while (!pageToken.empty());
+
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << "Error listing models: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+std::string GoogleClient::uploadFile(
+    const std::string& endpoint,
+    const std::string& apiKey,
+    const std::string& displayName,
+    const std::string& mimeType,
+    const std::string& content,
+    std::string& error
+) {
+    // Start a resumable upload; the server answers with the URL to send the bytes to
+    HttpResult started = performRequest(
+        "POST", endpoint + "/upload" + kBetaApiVersion + "/files?key=" + apiKey,
+        nlohmann::json({{"file", {{"display_name", displayName}}}}).dump(),
+        {"X-Goog-Upload-Protocol: resumable",
+         "X-Goog-Upload-Command: start",
+         "X-Goog-Upload-Header-Content-Length: " + std::to_string(content.size()),
+         "X-Goog-Upload-Header-Content-Type: " + mimeType});
+    auto uploadUrl = started.headers.find("x-goog-upload-url");
+    if (!started.ok() || started.status != 200 || uploadUrl == started.headers.end()) {
+        error = "Starting upload failed: " + describeFailure(started);
+        return "";
+    }
+
+    // Send everything in one piece and finish the upload
+    HttpResult uploaded = performRequest(
+        "POST", uploadUrl->second, content,
+        {"Content-Type: " + mimeType,
+         "X-Goog-Upload-Offset: 0",
+         "X-Goog-Upload-Command: upload, finalize"});
+    if (!uploaded.ok() || uploaded.status != 200) {
+        error = "Upload failed: " + describeFailure(uploaded);
+        return "";
+    }
+
+    std::string name = nlohmann::json::parse(uploaded.body).value("file", nlohmann::json::object()).value("name", "");
+    if (name.empty()) {
+        error = "Upload returned no file name";
+    }
+    return name;
+}
+
+bool GoogleClient::runBatchJob(
+    const std::vector<BatchRequest>& requests,
+    const std::string& model,
+    const BatchJobOptions& options,
+    const BatchResultCallback& onResult,
+    std::string& error
+) {
+    try {
+        std::string endpoint = candidateEndpoints(endpointSelector, kDefaultEndpoint).front();
+        std::string betaBaseUrl = endpoint + kBetaApiVersion;
+
+        // One key for the whole job; it only needs a slot in the pool while submitting
+        ApiKeyPool::Lease lease = acquireKey(keyPool);
+        std::string key = lease.key().empty() ? apiKey : lease.key();
+
+        // The uploaded requests are deleted however this returns, unless the job is
+        // left running for a resume: it still reads them, and that run deletes them
+        struct UploadedFile {
+            std::string url;
+            ~UploadedFile() {
+                if (!url.empty()) {
+                    performRequest("DELETE", url, "");
+                }
+            }
+        } upload;
+
+        std::string jobName = options.jobName;
+        if (jobName.empty()) {
+            // One line per request: {"key": ..., "request": GenerateContentRequest}
+            std::string content;
+            for (const auto& request : requests) {
+                nlohmann::json payload = buildRequestPayload(request.messages);
+                payload["generationConfig"] = {{"temperature", 0.7}, {"maxOutputTokens", request.maxOutputTokens}};
+                content += nlohmann::json({{"key", request.key}, {"request", payload}})
+                               .dump(-1, ' ', false, nlohmann::json::error_handler_t::replace);
+                content += '\n';
+            }
+
+            std::string inputFile = uploadFile(endpoint, key, options.displayName, "application/jsonl", content, error);
+            if (inputFile.empty()) {
+                return false;
+            }
+            upload.url = betaBaseUrl + "/" + inputFile + "?key=" + key;
+
+            nlohmann::json batch = {
+                {"batch", {
+                    {"display_name", options.displayName},
+                    {"input_config", {{"file_name", inputFile}}}
+                }}
+            };
+            HttpResult created = performRequest(
+                "POST", betaBaseUrl + "/models/" + model + ":batchGenerateContent?key=" + key, batch.dump());
+            lease.setStatus(created.status);
+            if (!created.ok() || created.status != 200) {
+                error = "Creating batch failed: " + describeFailure(created);
+                return false;
+            }
+
+            jobName = nlohmann::json::parse(created.body).value("name", "");
+            if (jobName.empty()) {
+                error = "Creating batch returned no job name";
+                return false;
+            }
+        }
+        lease.release();
+
+        // Poll with growing intervals until the job reaches a final state
+        std::string state;
+        nlohmann::json job;
+        auto interval = options.pollInterval;
+        int failures = 0;
+        if (options.onStatus) {
+            options.onStatus(jobName, state);
+        }
+        while (true) {
+            HttpResult polled = performRequest("GET", betaBaseUrl + "/" + jobName + "?key=" + key, "");
+            if (polled.ok() && polled.status == 200) {
+                failures = 0;
+                job = nlohmann::json::parse(polled.body);
+                const auto& metadata = job.value("metadata", nlohmann::json::object());
+                std::string current = metadata.value("state", "");
+
+                // A resumed job's input was uploaded by an earlier run
+                std::string uploaded = metadata.value("inputConfig", nlohmann::json::object()).value("fileName", "");
+                if (options.jobName == jobName && upload.url.empty() && !uploaded.empty()) {
+                    upload.url = betaBaseUrl + "/" + uploaded + "?key=" + key;
+                }
+                if (current != state) {
+                    state = current;
+                    if (options.onStatus) {
+                        options.onStatus(jobName, state);
                     }
-                    callback("Error: " + errorMessage, false);
-                } else {
-                    // Fallback error message with partial response
-                    callback("Error: Unexpected response format. Response: " +
-                             responseText.substr(0, 100) + "...", false);
                 }
-            } catch (const std::exception& e) {
-                // JSON parsing error
-                callback("Error parsing response: " + std::string(e.what()) +
-                         "\nResponse: " + responseText.substr(0, 100) + "...", false);
+                if (job.value("done", false) || isFinalBatchState(state)) {
+                    break;
+                }
+            } else if (polled.ok() && polled.status < 500 && polled.status != 429) {
+                error = "Polling " + jobName + " failed: " + describeFailure(polled);
+                return false;
+            } else if (++failures >= kMaxPollFailures) {
+                error = "Polling " + jobName + " keeps failing: " + describeFailure(polled);
+                return false;
+            }
+
+            // Sleep in short slices so a stop request is noticed promptly
+            auto wakeAt = std::chrono::steady_clock::now() + interval;
+            while (std::chrono::steady_clock::now() < wakeAt) {
+                if (options.shouldStop && options.shouldStop()) {
+                    error = "Stopped waiting for " + jobName;
+                    upload.url.clear();
+                    return false;
+                }
+                std::this_thread::sleep_for(kStopCheckInterval);
+            }
+            interval = std::min(options.maxPollInterval, interval * 3 / 2);
+        }
+
+        if (job.contains("error") || (!state.empty() && state.find("_SUCCEEDED") == std::string::npos)) {
+            error = "Batch " + jobName + " ended in " + (state.empty() ? "error" : state);
+            if (job.contains("error") && job["error"].contains("message")) {
+                error += ": " + job["error"]["message"].get<std::string>();
             }
+            return false;
         }
 
-        // Clean up
-        curl_slist_free_all(headers);
-        curl_easy_cleanup(curl);
-    }).detach();
+        // Each result line carries the key of its request
+        auto deliver = [&](const nlohmann::json& line) {
+            BatchResult result;
+            result.key = line.value("key", "");
+            if (result.key.empty() && line.contains("metadata")) {
+                result.key = line["metadata"].value("key", "");
+            }
+            if (line.contains("response")) {
+                std::string reason;
+                result.success = extractReply(line["response"], result.response, result.usage, reason);
+                if (!result.success) {
+                    result.response = "Error: " + reason;
+                }
+            } else {
+                std::string message = line.value("error", nlohmann::json::object()).value("message", "Unknown error");
+                result.response = "Error: " + message;
+            }
+            onResult(result);
+        };
+
+        const auto& metadata = job.value("metadata", nlohmann::json::object());
+        nlohmann::json output = job.value("response", metadata.value("output", nlohmann::json::object()));
+        std::string responsesFile = output.value("responsesFile", "");
 
+        // Small jobs may come back inline instead of as a file
+        if (responsesFile.empty()) {
+            const auto& inlined = output.value("inlinedResponses", nlohmann::json::object());
+            for (const auto& line : inlined.value("inlinedResponses", nlohmann::json::array())) {
+                deliver(line);
+            }
+        } else {
+            // Stream the results file, handing over each line as soon as it is complete
+            std::string pending;
+            auto drainLines = [&](bool final) {
+                size_t start = 0;
+                size_t end;
+                while ((end = pending.find('\n', start)) != std::string::npos || (final && start < pending.size())) {
+                    if (end == std::string::npos) {
+                        end = pending.size();
+                    }
+                    try {
+                        nlohmann::json line = nlohmann::json::parse(pending.begin() + start, pending.begin() + end);
+                        if (line.is_object() && (line.contains("key") || line.contains("metadata"))) {
+                            deliver(line);
+                        }
+                    } catch (const std::exception& e) {
+                        // Not a result line (e.g. part of an error payload)
+                    }
+                    start = end + 1;
+                }
+                pending.erase(0, std::min(start, pending.size()));
+            };
+
+            HttpResult downloaded = performStreamingRequest(
+                "GET", endpoint + "/download" + kBetaApiVersion + "/" + responsesFile + ":download?alt=media&key=" + key,
+                "", {}, [&](const char* data, size_t size) {
+                    pending.append(data, size);
+                    drainLines(false);
+                });
+            if (downloaded.ok() && downloaded.status == 200) {
+                drainLines(true);
+            }
+            if (!downloaded.ok() || downloaded.status != 200) {
+                error = "Downloading " + responsesFile + " failed: " + describeFailure(downloaded);
+                return false;
+            }
+        }
+        return true;
+    } catch (const std::exception& e) {
+        error = std::string("Batch job failed: ") + e.what();
+        return false;
+    }
 }
 
 bool GoogleClient::validateApiKey() {
@@ -165,10 +806,7 @@ bool GoogleClient::validateApiKey() {
     std::cout << "\nNote: For Google Gemini API, you need an API key from Google AI Studio." << std::endl;
     std::cout << "Visit: https://aistudio.google.com/ to get your API key." << std::endl;
 
-    std::cout << "\nSynthara supports these Gemini models:" << std::endl;
-    std::cout << "- Gemini 2.0 Flash-Lite: Cost-effective model for simple tasks" << std::endl;
-    std::cout << "- Gemini 1.5 Pro: Google's versatile model with long context" << std::endl;
-    std::cout << "- Gemini 1.5 Flash: Faster, more efficient Google model" << std::endl;
+    std::cout << "\nSynthara discovers the Gemini models available to your key automatically." << std::endl;
 
     return true;
 }
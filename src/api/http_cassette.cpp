@@ -0,0 +1,211 @@
+#include "http_cassette.h"
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <thread>
+
+namespace libertymind {
+
+HttpCassette* HttpCassette::active() {
+    static HttpCassette* cassette = []() -> HttpCassette* {
+        const char* mode = getenv("SYNTHARA_VCR");
+        if (!mode || (std::string(mode) != "record" && std::string(mode) != "replay")) {
+            return nullptr;
+        }
+
+        const char* file = getenv("SYNTHARA_VCR_CASSETTE");
+        std::filesystem::path path = file && *file ? file : "synthara.cassette.jsonl";
+
+        // "original" or unset keeps the recorded timing, "max" drops it, a number scales it
+        double speed = 1.0;
+        const char* pace = getenv("SYNTHARA_VCR_SPEED");
+        if (pace && std::string(pace) == "max") {
+            speed = 0.0;
+        } else if (pace && *pace && std::string(pace) != "original") {
+            speed = std::max(0.0, std::strtod(pace, nullptr));
+        }
+
+        // Lives for the whole process; requests may still be running at exit
+        auto* configured = new HttpCassette(std::string(mode) == "replay", path, speed);
+        if (configured->replaying) {
+            configured->load();
+        }
+        return configured;
+    }();
+    return cassette;
+}
+
+HttpCassette::HttpCassette(bool replaying, std::filesystem::path path, double speed)
+    : replaying(replaying), path(std::move(path)), speed(speed) {
+}
+
+bool HttpCassette::isReplaying() const {
+    return replaying;
+}
+
+std::string HttpCassette::redactQuery(const std::string& url, bool normalize) {
+    size_t query = url.find('?');
+    if (query == std::string::npos) {
+        return url;
+    }
+
+    // Drop the API key, and with normalize give per-upload parameters a fixed value
+    std::string kept;
+    size_t position = query + 1;
+    while (position <= url.size()) {
+        size_t end = url.find('&', position);
+        if (end == std::string::npos) {
+            end = url.size();
+        }
+        std::string parameter = url.substr(position, end - position);
+        std::string name = parameter.substr(0, parameter.find('='));
+        if (normalize && (name == "upload_id" || name == "upload_protocol")) {
+            parameter = name + "=*";
+        }
+        if (!parameter.empty() && name != "key") {
+            kept += (kept.empty() ? "" : "&") + parameter;
+        }
+        position = end + 1;
+    }
+    return url.substr(0, query) + (kept.empty() ? "" : "?" + kept);
+}
+
+std::string HttpCassette::redactedTarget(const std::string& url) {
+    // Drop the scheme and host so recordings replay against any endpoint
+    size_t start = url.find("://");
+    start = start == std::string::npos ? 0 : url.find('/', start + 3);
+    std::string target = start == std::string::npos ? "/" : url.substr(start);
+    return redactQuery(target, true);
+}
+
+std::string HttpCassette::matchKey(const std::string& method, const std::string& url, const std::string& body) {
+    return method + " " + redactedTarget(url) + "\n" + body;
+}
+
+void HttpCassette::load() {
+    std::ifstream file(path);
+    if (!file) {
+        loadError = "Cannot read cassette " + path.string();
+        std::cerr << "Error: " << loadError << std::endl;
+        return;
+    }
+
+    std::string line;
+    size_t lineNumber = 0;
+    while (std::getline(file, line)) {
+        ++lineNumber;
+        if (line.empty()) {
+            continue;
+        }
+        try {
+            nlohmann::json entry = nlohmann::json::parse(line);
+            Exchange exchange;
+            exchange.status = entry.value("status", 0L);
+            exchange.error = entry.value("error", "");
+            exchange.headers = entry.value("headers", std::map<std::string, std::string>());
+            exchange.totalMilliseconds = entry.value("total_ms", 0.0);
+            for (const auto& chunk : entry.value("chunks", nlohmann::json::array())) {
+                exchange.chunks.push_back({chunk.at(0).get<double>(), chunk.at(1).get<std::string>()});
+            }
+            std::string key = entry.value("method", "GET") + " " + entry.value("target", "/") + "\n" +
+                              entry.value("request", "");
+            exchanges[key].push_back(std::move(exchange));
+        } catch (const std::exception& e) {
+            std::cerr << "Warning: Skipping line " << lineNumber << " of " << path.string() << ": " << e.what() << std::endl;
+        }
+    }
+}
+
+void HttpCassette::record(const std::string& method, const std::string& url, const std::string& body,
+                          const HttpResult& result, const std::vector<Chunk>& chunks) {
+    nlohmann::json recordedChunks = nlohmann::json::array();
+    for (const auto& chunk : chunks) {
+        recordedChunks.push_back({chunk.milliseconds, chunk.data});
+    }
+
+    // Response headers can carry URLs with the key in them (x-goog-upload-url)
+    std::map<std::string, std::string> headers;
+    for (const auto& [name, value] : result.headers) {
+        headers[name] = redactQuery(value, false);
+    }
+
+    nlohmann::json entry = {
+        {"method", method},
+        {"target", redactedTarget(url)},
+        {"request", body},
+        {"status", result.status},
+        {"error", result.error},
+        {"headers", headers},
+        {"chunks", recordedChunks},
+        {"ttfb_ms", result.ttfbSeconds * 1000.0},
+        {"total_ms", result.totalSeconds * 1000.0}
+    };
+
+    // Bodies that aren't valid UTF-8 are stored with replacement characters rather than dropped
+    std::string line = entry.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace);
+
+    // The file stays open for the whole recording; each exchange is flushed so a
+    // run that is killed still leaves a usable cassette
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!recording.is_open()) {
+        recording.open(path, std::ios::app);
+    }
+    recording << line << '\n';
+    recording.flush();
+    if (!recording) {
+        std::cerr << "Warning: Cannot write cassette " << path.string() << std::endl;
+        recording.clear();
+    }
+}
+
+HttpResult HttpCassette::replay(const std::string& method, const std::string& url, const std::string& body,
+                                const DataCallback& onData) {
+    HttpResult result;
+    auto started = std::chrono::steady_clock::now();
+
+    Exchange exchange;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto recorded = exchanges.find(matchKey(method, url, body));
+        if (recorded == exchanges.end()) {
+            result.error = loadError.empty() ? "No recording for " + method + " " + redactedTarget(url) + " in " + path.string()
+                                             : loadError;
+            return result;
+        }
+        size_t& next = nextExchange[recorded->first];
+        exchange = recorded->second[next];
+        next = (next + 1) % recorded->second.size();
+    }
+
+    auto waitUntil = [&](double milliseconds) {
+        if (speed > 0.0) {
+            std::this_thread::sleep_until(started + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::duration<double, std::milli>(milliseconds / speed)));
+        }
+    };
+
+    bool first = true;
+    for (const auto& chunk : exchange.chunks) {
+        waitUntil(chunk.milliseconds);
+        if (first) {
+            result.ttfbSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+            first = false;
+        }
+        onData(chunk.data.data(), chunk.data.size());
+    }
+    waitUntil(exchange.totalMilliseconds);
+
+    result.error = exchange.error;
+    if (result.ok()) {
+        result.status = exchange.status;
+        result.headers = exchange.headers;
+        result.totalSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+        if (first) {
+            result.ttfbSeconds = result.totalSeconds;
+        }
+    }
+    return result;
+}
+
+} // namespace libertymind
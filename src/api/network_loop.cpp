@@ -0,0 +1,289 @@
+#include "network_loop.h"
+#include "alloc_tracker.h"
+#include "api_client.h"
+#include "trace.h"
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+
+namespace libertymind {
+
+static std::mutex sharedMutex;
+static NetworkLoop* sharedLoop = nullptr;
+
+// Socket events handled per epoll_wait call
+static const int kMaxEvents = 64;
+
+// Idle connections kept open for reuse; enough for a full batch worth of concurrency
+static const long kMaxIdleConnections = 64;
+
+// Worker threads for blocking work; enough for paced cassette replays at batch concurrency
+static const size_t kMaxWorkers = 32;
+
+NetworkLoop& NetworkLoop::shared() {
+    std::lock_guard<std::mutex> lock(sharedMutex);
+    if (!sharedLoop) {
+        // Never freed: coroutines abandoned at exit may still point at it
+        sharedLoop = new NetworkLoop();
+    }
+    return *sharedLoop;
+}
+
+void NetworkLoop::shutdown() {
+    std::lock_guard<std::mutex> lock(sharedMutex);
+    if (sharedLoop) {
+        sharedLoop->stop();
+    }
+}
+
+NetworkLoop::NetworkLoop() {
+    ensureCurlInitialized();
+    multi = curl_multi_init();
+    curl_multi_setopt(multi, CURLMOPT_SOCKETFUNCTION, onSocket);
+    curl_multi_setopt(multi, CURLMOPT_SOCKETDATA, this);
+    curl_multi_setopt(multi, CURLMOPT_TIMERFUNCTION, onTimer);
+    curl_multi_setopt(multi, CURLMOPT_TIMERDATA, this);
+    curl_multi_setopt(multi, CURLMOPT_MAXCONNECTS, kMaxIdleConnections);
+
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    wakeFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.fd = wakeFd;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &event);
+
+    thread = std::thread(&NetworkLoop::run, this);
+}
+
+void NetworkLoop::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (stopping) {
+            return;
+        }
+        stopping = true;
+        wake();
+    }
+    thread.join();
+
+    // Idle workers exit; busy ones finish their job first and nothing is posted from it
+    {
+        std::lock_guard<std::mutex> lock(workMutex);
+        workersStopping = true;
+        jobs.clear();
+    }
+    workReady.notify_all();
+    curl_multi_cleanup(multi);
+    close(epollFd);
+
+    // Wakes happen under the mutex, so none can reach a closed (or reused) descriptor
+    std::lock_guard<std::mutex> lock(mutex);
+    stopped = true;
+    close(wakeFd);
+}
+
+bool NetworkLoop::isLoopThread() const {
+    return std::this_thread::get_id() == thread.get_id();
+}
+
+bool NetworkLoop::isStopped() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return stopped;
+}
+
+void NetworkLoop::PerformAwaiter::await_suspend(std::coroutine_handle<> handle) {
+    waiting = handle;
+    loop.submit(this);
+}
+
+void NetworkLoop::submit(PerformAwaiter* transfer) {
+    // Once stopped nothing runs again; the coroutine stays suspended
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (stopping) {
+            return;
+        }
+        transfer->next = submitted;
+        submitted = transfer;
+        wake();
+    }
+}
+
+void NetworkLoop::post(std::coroutine_handle<> handle) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (stopping) {
+            return;
+        }
+        posted.push_back(handle);
+        wake();
+    }
+}
+
+void NetworkLoop::execute(std::function<void()> job) {
+    {
+        std::lock_guard<std::mutex> lock(workMutex);
+        if (workersStopping) {
+            return;
+        }
+        jobs.push_back(std::move(job));
+
+        // Start another worker when the queue outgrows the idle ones, up to the limit.
+        // Workers are detached: one still busy at exit must not hold up shutdown.
+        if (jobs.size() > idleWorkers && workers < kMaxWorkers) {
+            ++workers;
+            std::thread(&NetworkLoop::work, this).detach();
+        }
+    }
+    workReady.notify_one();
+}
+
+void NetworkLoop::work() {
+    Trace::setThreadName("network worker");
+
+    std::unique_lock<std::mutex> lock(workMutex);
+    while (true) {
+        ++idleWorkers;
+        workReady.wait(lock, [this]() { return !jobs.empty() || workersStopping; });
+        --idleWorkers;
+        if (workersStopping) {
+            --workers;
+            return;
+        }
+
+        std::function<void()> job = std::move(jobs.front());
+        jobs.pop_front();
+        lock.unlock();
+        job();
+        lock.lock();
+    }
+}
+
+void NetworkLoop::wake() {
+    uint64_t one = 1;
+    ssize_t written = write(wakeFd, &one, sizeof(one));
+    (void)written;  // Only fails when the counter is already non-zero
+}
+
+int NetworkLoop::onSocket(CURL*, curl_socket_t socket, int what, void* loop, void*) {
+    int epollFd = static_cast<NetworkLoop*>(loop)->epollFd;
+    if (what == CURL_POLL_REMOVE) {
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, socket, nullptr);
+        return 0;
+    }
+
+    epoll_event event = {};
+    event.events = ((what & CURL_POLL_IN) ? static_cast<int>(EPOLLIN) : 0) |
+                   ((what & CURL_POLL_OUT) ? static_cast<int>(EPOLLOUT) : 0);
+    event.data.fd = socket;
+
+    // curl reports a socket when it first needs one and again whenever the wanted events change
+    if (epoll_ctl(epollFd, EPOLL_CTL_MOD, socket, &event) != 0 && errno == ENOENT) {
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, socket, &event);
+    }
+    return 0;
+}
+
+int NetworkLoop::onTimer(CURLM*, long timeoutMilliseconds, void* loop) {
+    NetworkLoop* self = static_cast<NetworkLoop*>(loop);
+    self->timerArmed = timeoutMilliseconds >= 0;
+    self->timerDeadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMilliseconds);
+    return 0;
+}
+
+void NetworkLoop::socketAction(curl_socket_t socket, int events, std::vector<std::coroutine_handle<>>& ready) {
+    int running = 0;
+    {
+        AllocTracker::Scope allocations(AllocTag::NETWORK);
+        curl_multi_socket_action(multi, socket, events, &running);
+    }
+
+    // Finished transfers leave the multi handle before their coroutines see them
+    int remaining = 0;
+    while (CURLMsg* message = curl_multi_info_read(multi, &remaining)) {
+        if (message->msg != CURLMSG_DONE) {
+            continue;
+        }
+        PerformAwaiter* transfer = nullptr;
+        curl_easy_getinfo(message->easy_handle, CURLINFO_PRIVATE, &transfer);
+        transfer->result = message->data.result;
+        curl_multi_remove_handle(multi, message->easy_handle);
+        ready.push_back(transfer->waiting);
+    }
+}
+
+void NetworkLoop::run() {
+    Trace::setThreadName("network loop");
+
+    std::vector<std::coroutine_handle<>> ready;
+    std::vector<std::coroutine_handle<>> resuming;
+    epoll_event events[kMaxEvents];
+    while (true) {
+        PerformAwaiter* added;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (stopping) {
+                break;
+            }
+            added = std::exchange(submitted, nullptr);
+            ready.insert(ready.end(), posted.begin(), posted.end());
+            posted.clear();
+        }
+
+        // New transfers join the multi handle, which arms curl's timer to start
+        // them; one that can't join is failed straight away
+        while (added) {
+            PerformAwaiter* transfer = std::exchange(added, added->next);
+            curl_easy_setopt(transfer->curl, CURLOPT_PRIVATE, transfer);
+            if (curl_multi_add_handle(multi, transfer->curl) != CURLM_OK) {
+                transfer->result = CURLE_FAILED_INIT;
+                ready.push_back(transfer->waiting);
+            }
+        }
+
+        // Continue waiting coroutines; they may start transfers or post more work
+        resuming.swap(ready);
+        for (std::coroutine_handle<> handle : resuming) {
+            handle.resume();
+        }
+        resuming.clear();
+
+        // Sleep until a socket is ready, curl's timer is due, or another thread wakes us
+        int timeout = -1;
+        if (timerArmed) {
+            auto due = std::chrono::ceil<std::chrono::milliseconds>(timerDeadline - std::chrono::steady_clock::now());
+            timeout = static_cast<int>(std::max<int64_t>(0, due.count()));
+        }
+        int count = epoll_wait(epollFd, events, kMaxEvents, timeout);
+        for (int i = 0; i < count; ++i) {
+            if (events[i].data.fd == wakeFd) {
+                uint64_t value;
+                ssize_t drained = read(wakeFd, &value, sizeof(value));
+                (void)drained;
+                continue;
+            }
+
+            int flags = 0;
+            if (events[i].events & EPOLLIN) {
+                flags |= CURL_CSELECT_IN;
+            }
+            if (events[i].events & EPOLLOUT) {
+                flags |= CURL_CSELECT_OUT;
+            }
+            if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+                flags |= CURL_CSELECT_ERR;
+            }
+            socketAction(events[i].data.fd, flags, ready);
+        }
+
+        if (timerArmed && std::chrono::steady_clock::now() >= timerDeadline) {
+            timerArmed = false;
+            socketAction(CURL_SOCKET_TIMEOUT, 0, ready);
+        }
+    }
+}
+
+} // namespace libertymind
@@ -0,0 +1,232 @@
+#include "openai_client.h"
+#include "alloc_tracker.h"
+#include "metrics.h"
+#include "model_registry.h"
+#include "sse_parser.h"
+#include "trace.h"
+#include <algorithm>
+#include <iostream>
+#include <nlohmann/json.hpp>
+
+namespace libertymind {
+
+// Local inference servers usually listen here
+static const char* kDefaultEndpoint = "http://127.0.0.1:8080";
+static const char* kApiVersion = "/v1";
+
+OpenAIClient::OpenAIClient(const std::string& apiKey) : ApiClient(apiKey) {}
+
+std::string OpenAIClient::getBaseUrl() const {
+    return candidateEndpoints(endpointSelector, kDefaultEndpoint).front() + kApiVersion;
+}
+
+std::vector<std::string> OpenAIClient::authHeaders(const std::string& apiKey) {
+    if (apiKey.empty()) {
+        return {};
+    }
+    return {"Authorization: Bearer " + apiKey};
+}
+
+nlohmann::json OpenAIClient::buildRequestPayload(
+    const std::vector<Message>& messages,
+    const std::string& model,
+    int maxOutputTokens
+) {
+    nlohmann::json chatMessages = nlohmann::json::array();
+    for (const auto& message : messages) {
+        chatMessages.push_back({{"role", message.role}, {"content", message.content}});
+    }
+
+    return {
+        {"model", model},
+        {"messages", chatMessages},
+        {"temperature", 0.7},
+        {"max_tokens", maxOutputTokens},
+        {"stream", true},
+        {"stream_options", {{"include_usage", true}}}
+    };
+}
+
+Task<CompletionResult> OpenAIClient::complete(CompletionRequest request) {
+    return runCompletion(getRequestSettings(), std::move(request));
+}
+
+Task<CompletionResult> OpenAIClient::runCompletion(RequestSettings settings, CompletionRequest request) {
+    ApiKeyPool::Lease lease = acquireKey(settings.keyPool);
+    const std::string& apiKey = lease.key().empty() ? settings.apiKey : lease.key();
+    std::string payload;
+    {
+        Trace::Span span("build request", "request");
+        AllocTracker::Scope allocations(AllocTag::NETWORK);
+        payload = buildRequestPayload(request.messages, request.model, settings.maxOutputTokens).dump();
+        span.setArg("bytes", static_cast<int64_t>(payload.size()));
+    }
+
+    std::string reply;
+    std::string rawBody;
+    TokenUsage usage;
+    bool haveUsage = false;
+    bool sawEvents = false;
+    HttpResult result;
+
+    // Try endpoints fastest first; once text has streamed to the caller we can't start over
+    const std::shared_ptr<EndpointSelector>& selector = settings.endpointSelector;
+    std::vector<std::string> endpoints = candidateEndpoints(selector, kDefaultEndpoint);
+    for (const auto& endpoint : endpoints) {
+        if (&endpoint != &endpoints.front()) {
+            metrics::endpointRetries.add();
+        }
+
+        // Each attempt starts clean; a failed one's events must not pass for this one's
+        reply.clear();
+        usage = TokenUsage();
+        haveUsage = false;
+        sawEvents = false;
+        SseParser parser([&](const std::string& data) {
+            Trace::Span span("parse chunk", "parse");
+            span.setArg("bytes", static_cast<int64_t>(data.size()));
+            AllocTracker::Scope allocations(AllocTag::PARSE);
+            sawEvents = true;
+            if (data == "[DONE]") {
+                return;
+            }
+
+            try {
+                nlohmann::json chunk = nlohmann::json::parse(data);
+                if (chunk.contains("choices") && chunk["choices"].is_array() && !chunk["choices"].empty()) {
+                    const auto& delta = chunk["choices"][0].value("delta", nlohmann::json::object());
+                    if (delta.contains("content") && delta["content"].is_string()) {
+                        std::string text = delta["content"];
+                        reply += text;
+                        if (request.onChunk && !text.empty()) {
+                            request.onChunk(text);
+                        }
+                    }
+                }
+                if (chunk.contains("usage") && chunk["usage"].is_object()) {
+                    usage.promptTokens = chunk["usage"].value("prompt_tokens", 0);
+                    usage.outputTokens = chunk["usage"].value("completion_tokens", 0);
+                    usage.totalTokens = chunk["usage"].value("total_tokens", 0);
+                    haveUsage = true;
+                }
+            } catch (const std::exception& e) {
+                // Ignore keep-alive comments and malformed chunks
+            }
+        });
+
+        rawBody.clear();
+        result = co_await performStreamingRequestAsync("POST", endpoint + kApiVersion + "/chat/completions", payload,
+                                                       authHeaders(apiKey), [&](const char* data, size_t size) {
+            parser.feed(data, size);
+
+            // Until an event arrives this may be a whole non-streamed reply, so none of it is dropped
+            if (!sawEvents) {
+                rawBody.append(data, size);
+            }
+        });
+        parser.finish();
+
+        bool failed = !result.ok() || result.status >= 500;
+        if (selector) {
+            failed ? selector->reportFailure(endpoint) : selector->reportSuccess(endpoint);
+        }
+        if (!failed || !reply.empty()) {
+            break;
+        }
+    }
+
+    lease.setStatus(result.status);
+    lease.release();
+
+    // Servers that ignore "stream" answer with a single JSON body
+    if (result.ok() && result.status == 200 && !sawEvents) {
+        try {
+            Trace::Span span("parse response", "parse");
+            span.setArg("bytes", static_cast<int64_t>(rawBody.size()));
+            AllocTracker::Scope allocations(AllocTag::PARSE);
+            nlohmann::json responseJson = nlohmann::json::parse(rawBody);
+            reply = responseJson["choices"][0]["message"]["content"].get<std::string>();
+            if (responseJson.contains("usage")) {
+                usage.promptTokens = responseJson["usage"].value("prompt_tokens", 0);
+                usage.outputTokens = responseJson["usage"].value("completion_tokens", 0);
+                usage.totalTokens = responseJson["usage"].value("total_tokens", 0);
+                haveUsage = true;
+            }
+        } catch (const std::exception& e) {
+            // Reported as an empty response below
+        }
+    }
+
+    // Work out the outcome
+    CompletionResult completion;
+    if (!result.ok()) {
+        completion.response = "Error: " + result.error;
+    } else if (result.status != 200) {
+        completion.response = "Error: HTTP " + std::to_string(result.status);
+        try {
+            rawBody.resize(std::min(rawBody.size(), kMaxErrorBody));
+            nlohmann::json errorJson = nlohmann::json::parse(rawBody);
+            if (errorJson.contains("error")) {
+                const auto& error = errorJson["error"];
+                completion.response = "Error: " + (error.is_object() ? error.value("message", completion.response)
+                                                                     : error.dump());
+            }
+        } catch (const std::exception& e) {
+            // Keep the status-only message
+        }
+    } else if (reply.empty()) {
+        completion.response = "Error: Empty response from server";
+    } else {
+        completion.response = std::move(reply);
+        completion.success = true;
+    }
+
+    completion.usage = usage;
+    completion.hasUsage = haveUsage;
+    completion.stats.model = request.model;
+    completion.stats.status = result.status;
+    completion.stats.success = completion.success;
+    completion.stats.ttfbSeconds = result.ttfbSeconds;
+    completion.stats.totalSeconds = result.totalSeconds;
+    completion.stats.outputTokens = usage.outputTokens;
+    co_return completion;
+}
+
+bool OpenAIClient::listModels(std::vector<ModelInfo>& models) {
+    try {
+        ApiKeyPool::Lease lease = acquireKey(keyPool);
+        HttpResult result = performRequest("GET", getBaseUrl() + "/models", "",
+                                           authHeaders(lease.key().empty() ? apiKey : lease.key()));
+        lease.setStatus(result.status);
+        if (!result.ok() || result.status != 200) {
+            return false;
+        }
+
+        nlohmann::json responseJson = nlohmann::json::parse(result.body);
+        for (const auto& model : responseJson.value("data", nlohmann::json::array())) {
+            ModelInfo info;
+            info.id = model.value("id", "");
+            if (info.id.empty()) {
+                continue;
+            }
+            info.name = info.id;
+            info.description = model.value("owned_by", "");
+
+            // vLLM reports the context window; others leave the limit unknown
+            info.inputTokenLimit = model.value("max_model_len", 0);
+            info.supportedMethods = {"chat.completions"};
+            models.push_back(std::move(info));
+        }
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << "Error listing models: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool OpenAIClient::validateApiKey() {
+    // Local servers commonly run without authentication
+    return true;
+}
+
+} // namespace libertymind
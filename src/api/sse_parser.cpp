@@ -0,0 +1,46 @@
+#include "sse_parser.h"
+
+namespace libertymind {
+
+SseParser::SseParser(std::function<void(const std::string&)> onEvent) : onEvent(std::move(onEvent)) {}
+
+void SseParser::feed(const char* data, size_t size) {
+    buffer.append(data, size);
+
+    size_t start = 0;
+    size_t end;
+    while ((end = buffer.find('\n', start)) != std::string::npos) {
+        std::string line = buffer.substr(start, end - start);
+        start = end + 1;
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+
+        // A blank line ends the event
+        if (line.empty()) {
+            if (!eventData.empty()) {
+                onEvent(eventData);
+                eventData.clear();
+            }
+            continue;
+        }
+
+        if (line.compare(0, 5, "data:") == 0) {
+            size_t valueStart = line.size() > 5 && line[5] == ' ' ? 6 : 5;
+            if (!eventData.empty()) {
+                eventData += '\n';
+            }
+            eventData += line.substr(valueStart);
+        }
+    }
+    buffer.erase(0, start);
+}
+
+void SseParser::finish() {
+    if (!eventData.empty()) {
+        onEvent(eventData);
+        eventData.clear();
+    }
+}
+
+} // namespace libertymind
@@ -0,0 +1,748 @@
+#include "batch_runner.h"
+#include "metrics.h"
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include <fcntl.h>
+#include <unistd.h>
+
+using json = nlohmann::json;
+namespace fs = std::filesystem;
+
+namespace libertymind {
+
+// How often progress is reported and the checkpoint rewritten
+static const std::chrono::seconds kProgressInterval(1);
+
+// Longest the dispatcher sleeps without re-checking for interruption
+static const std::chrono::milliseconds kMaxIdleWait(200);
+
+// Backoff before retrying a failed request: doubles per attempt up to the cap
+static const std::chrono::milliseconds kRetryBackoff(1000);
+static const std::chrono::milliseconds kMaxRetryBackoff(60000);
+
+BatchRunner::BatchRunner(std::shared_ptr<ConfigManager> configManager, BatchOptions options)
+    : configManager(configManager),
+      options(std::move(options)),
+      inputSize(0),
+      keyPool(std::make_shared<ApiKeyPool>(configManager->getApiKeys(configManager->getSelectedProvider()))),
+      endpointSelector(std::make_shared<EndpointSelector>(
+          configManager->getEndpoints(configManager->getSelectedProvider()))),
+      modelRouter(std::make_shared<ModelRouter>()),
+      interrupted(false),
+      cursor(0),
+      inFlight(0),
+      outputFd(-1),
+      outputBytes(0),
+      nextToWrite(0),
+      completed(0),
+      completedBefore(0),
+      failed(0),
+      outputTokens(0) {
+    if (this->options.concurrency == 0) {
+        this->options.concurrency = 1;
+    }
+    if (this->options.model.empty()) {
+        this->options.model = configManager->getSelectedModel();
+    }
+}
+
+bool BatchRunner::run(const std::function<void(const BatchProgress&)>& onProgress) {
+    uint64_t outputSize = 0;
+    if (!loadInput() || !loadCheckpoint(outputSize) || !openOutput(outputSize)) {
+        return false;
+    }
+
+    // Keep ranking endpoints for the length of the batch
+    endpointSelector->startProbing();
+
+    startTime = std::chrono::steady_clock::now();
+    if (options.providerJobs) {
+        runJobs(onProgress);
+    } else {
+        runRequests(onProgress);
+    }
+
+    // A finished batch needs no checkpoint; an interrupted one keeps it for --resume
+    bool finished = std::all_of(done.begin(), done.end(), [](bool isDone) { return isDone; });
+    if (finished) {
+        fsync(outputFd);
+        std::error_code ec;
+        fs::remove(options.checkpointPath, ec);
+    } else {
+        saveCheckpoint();
+    }
+    close(outputFd);
+    outputFd = -1;
+
+    onProgress(getProgress());
+    return true;
+}
+
+void BatchRunner::runRequests(const std::function<void(const BatchProgress&)>& onProgress) {
+    auto nextReport = startTime + kProgressInterval;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    metrics::batchQueueDepth.set(static_cast<int64_t>(items.size() - cursor + retries.size()));
+    while (true) {
+        bool stopping = interrupted.load();
+        if (inFlight == 0 && (stopping || (cursor >= items.size() && retries.empty()))) {
+            break;
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        if (now >= nextReport) {
+            BatchProgress progress = progressLocked();
+            lock.unlock();
+            saveCheckpoint();
+            onProgress(progress);
+            lock.lock();
+            nextReport = now + kProgressInterval;
+            continue;
+        }
+
+        size_t index;
+        int attempt;
+        auto wakeAt = std::min(now + kMaxIdleWait, nextReport);
+        if (!stopping && takeNext(index, attempt, wakeAt)) {
+            ++inFlight;
+            lock.unlock();
+            start(index, attempt);
+            lock.lock();
+            continue;
+        }
+
+        condition.wait_until(lock, std::min(wakeAt, nextReport));
+    }
+    metrics::batchQueueDepth.set(0);
+    lock.unlock();
+}
+
+void BatchRunner::runJobs(const std::function<void(const BatchProgress&)>& onProgress) {
+    // Failed input lines are recorded straight away; the rest go into one job per model
+    std::map<std::string, std::vector<size_t>> groups;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const auto& item : items) {
+            if (done[item.index]) {
+                continue;
+            }
+            if (!item.invalid.empty()) {
+                record(item.index, 1, item.model, "Error: Invalid request: " + item.invalid, false, 0, TokenUsage(), 0.0, 0.0);
+                continue;
+            }
+            if (item.model != kAutoModelId) {
+                groups[item.model].push_back(item.index);
+                continue;
+            }
+            if (jobAutoModel.empty()) {
+                jobAutoModel = resolveModel(item);
+            }
+            groups[jobAutoModel].push_back(item.index);
+        }
+        cursor = items.size();
+    }
+
+    size_t running = groups.size();
+    std::vector<std::thread> workers;
+    for (const auto& [model, indices] : groups) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            inFlight += indices.size();
+        }
+
+        workers.emplace_back([this, &running, model = model, indices = indices]() {
+            std::vector<BatchRequest> requests;
+            for (size_t index : indices) {
+                requests.push_back({std::to_string(index), items[index].messages, items[index].maxOutputTokens});
+            }
+
+            BatchJobOptions jobOptions;
+            jobOptions.displayName = "synthara-" + options.inputPath.stem().string();
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                auto existing = jobNames.find(model);
+                if (existing != jobNames.end()) {
+                    jobOptions.jobName = existing->second;
+                }
+            }
+            jobOptions.onStatus = [this, &model](const std::string& name, const std::string& state) {
+                bool submitted;
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    submitted = jobNames[model] != name;
+                    jobNames[model] = name;
+                    jobStates[model] = name + " " + (state.empty() ? "SUBMITTED" : state);
+                }
+
+                // Remember a new job right away so a crash can't orphan it
+                if (submitted) {
+                    saveCheckpoint();
+                }
+            };
+            jobOptions.shouldStop = [this]() { return interrupted.load(); };
+
+            auto started = std::chrono::steady_clock::now();
+            auto elapsed = [&started]() {
+                return std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+            };
+
+            std::string jobError;
+            std::unique_ptr<ApiClient> client = createClient();
+            bool ok = client != nullptr && client->runBatchJob(requests, model, jobOptions,
+                [&](const BatchResult& result) {
+                    // Results come back keyed by item index; ignore anything that isn't ours
+                    char* end = nullptr;
+                    size_t index = std::strtoul(result.key.c_str(), &end, 10);
+                    if (result.key.empty() || *end != '\0' || index >= items.size() ||
+                        std::find(indices.begin(), indices.end(), index) == indices.end()) {
+                        return;
+                    }
+
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (done[index] || reorderBuffer.count(index)) {
+                        return;
+                    }
+                    record(index, 1, model, result.response, result.success, result.success ? 200 : 0,
+                           result.usage, elapsed(), 0.0);
+                    --inFlight;
+                    condition.notify_all();
+                }, jobError);
+            if (!client) {
+                jobError = "Failed to create API client. Please check your API key.";
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            if (ok || !interrupted) {
+                // The job is over; anything it didn't answer failed
+                jobNames.erase(model);
+                std::string reason = ok ? "Missing from batch results" : jobError;
+                for (size_t index : indices) {
+                    if (!done[index] && !reorderBuffer.count(index)) {
+                        record(index, 1, model, "Error: " + reason, false, 0, TokenUsage(), elapsed(), 0.0);
+                        --inFlight;
+                    }
+                }
+            } else {
+                // Interrupted: the job keeps running and --resume picks it up
+                for (size_t index : indices) {
+                    if (!done[index] && !reorderBuffer.count(index)) {
+                        --inFlight;
+                    }
+                }
+            }
+            jobStates.erase(model);
+            --running;
+            condition.notify_all();
+        });
+    }
+
+    auto nextReport = startTime + kProgressInterval;
+    std::unique_lock<std::mutex> lock(mutex);
+    while (running > 0) {
+        condition.wait_until(lock, nextReport);
+        auto now = std::chrono::steady_clock::now();
+        if (now >= nextReport) {
+            BatchProgress progress = progressLocked();
+            lock.unlock();
+            saveCheckpoint();
+            onProgress(progress);
+            lock.lock();
+            nextReport = now + kProgressInterval;
+        }
+    }
+    lock.unlock();
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+void BatchRunner::interrupt() {
+    std::lock_guard<std::mutex> lock(mutex);
+    interrupted = true;
+    condition.notify_all();
+}
+
+bool BatchRunner::wasInterrupted() const {
+    return interrupted.load();
+}
+
+BatchProgress BatchRunner::getProgress() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return progressLocked();
+}
+
+std::string BatchRunner::getError() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return error;
+}
+
+bool BatchRunner::loadInput() {
+    std::ifstream file(options.inputPath);
+    if (!file) {
+        error = "Cannot open " + options.inputPath.string();
+        return false;
+    }
+
+    std::error_code ec;
+    inputSize = fs::file_size(options.inputPath, ec);
+
+    std::string line;
+    size_t lineNumber = 0;
+    while (std::getline(file, line)) {
+        ++lineNumber;
+        if (line.find_first_not_of(" \t\r") == std::string::npos) {
+            continue;
+        }
+
+        Item item;
+        item.index = items.size();
+        item.id = item.index;
+        item.model = options.model;
+
+        // A bad line becomes a failed result rather than stopping the batch
+        try {
+            json request = json::parse(line);
+            if (request.contains("id")) {
+                item.id = request["id"];
+            }
+            item.model = request.value("model", item.model);
+            item.maxOutputTokens = request.value("max_output_tokens", item.maxOutputTokens);
+
+            std::string system = request.value("system", "");
+            if (!system.empty()) {
+                item.messages.push_back({"system", system});
+            }
+            if (request.contains("messages") && request["messages"].is_array()) {
+                for (const auto& message : request["messages"]) {
+                    item.messages.push_back({message.value("role", "user"), message.value("content", "")});
+                }
+            } else if (request.contains("prompt") && request["prompt"].is_string()) {
+                item.messages.push_back({"user", request["prompt"].get<std::string>()});
+            } else {
+                item.invalid = "line " + std::to_string(lineNumber) + " has no \"prompt\" or \"messages\"";
+            }
+        } catch (const std::exception& e) {
+            item.invalid = "line " + std::to_string(lineNumber) + " is not valid JSON: " + e.what();
+        }
+
+        items.push_back(std::move(item));
+    }
+
+    done.assign(items.size(), false);
+    return true;
+}
+
+bool BatchRunner::loadCheckpoint(uint64_t& outputSize) {
+    outputSize = 0;
+
+    std::error_code ec;
+    bool exists = fs::exists(options.checkpointPath, ec);
+    if (!options.resume) {
+        if (exists) {
+            error = "An unfinished run left " + options.checkpointPath.string() +
+                    "; pass --resume to continue it or delete it to start over";
+            return false;
+        }
+        return true;
+    }
+
+    // Nothing to resume: start from the beginning
+    if (!exists) {
+        return true;
+    }
+
+    try {
+        std::ifstream file(options.checkpointPath);
+        json checkpoint = json::parse(file);
+
+        if (checkpoint.value("input_size", uint64_t(0)) != inputSize ||
+            checkpoint.value("total", size_t(0)) != items.size()) {
+            error = "Checkpoint " + options.checkpointPath.string() + " was written for a different input file";
+            return false;
+        }
+
+        // Finished results came from one provider; the rest must not quietly come from another
+        std::string provider = ConfigManager::providerToString(configManager->getSelectedProvider());
+        std::string checkpointProvider = checkpoint.value("provider", provider);
+        if (checkpointProvider != provider) {
+            error = "Checkpoint " + options.checkpointPath.string() + " was written for provider " +
+                    checkpointProvider + "; resume with --provider " + checkpointProvider;
+            return false;
+        }
+
+        outputSize = checkpoint.value("output_bytes", uint64_t(0));
+        uintmax_t existing = fs::file_size(options.outputPath, ec);
+        if (outputSize > 0 && (ec || existing < outputSize)) {
+            error = "Results file " + options.outputPath.string() + " is shorter than the checkpoint records";
+            return false;
+        }
+
+        jobNames = checkpoint.value("jobs", std::map<std::string, std::string>());
+        jobAutoModel = checkpoint.value("auto_model", "");
+
+        for (const auto& range : checkpoint.value("done", json::array())) {
+            size_t first = range.at(0).get<size_t>();
+            size_t last = std::min(range.at(1).get<size_t>(), items.size());
+            for (size_t i = first; i < last; ++i) {
+                done[i] = true;
+                ++completedBefore;
+            }
+        }
+    } catch (const std::exception& e) {
+        error = "Cannot read checkpoint " + options.checkpointPath.string() + ": " + e.what();
+        return false;
+    }
+
+    return true;
+}
+
+bool BatchRunner::openOutput(uint64_t outputSize) {
+    outputFd = open(options.outputPath.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+    if (outputFd < 0) {
+        error = "Cannot open " + options.outputPath.string() + ": " + strerror(errno);
+        return false;
+    }
+
+    // Drop anything written after the last checkpoint; those requests run again
+    if (ftruncate(outputFd, static_cast<off_t>(outputSize)) != 0 ||
+        lseek(outputFd, 0, SEEK_END) < 0) {
+        error = "Cannot prepare " + options.outputPath.string() + ": " + strerror(errno);
+        close(outputFd);
+        outputFd = -1;
+        return false;
+    }
+
+    outputBytes = outputSize;
+    while (nextToWrite < done.size() && done[nextToWrite]) {
+        ++nextToWrite;
+    }
+    return true;
+}
+
+bool BatchRunner::saveCheckpoint() {
+    // Record finished items as [first, last) ranges
+    json ranges = json::array();
+    json jobs = json::object();
+    uint64_t bytes;
+    std::string autoModel;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        bytes = outputBytes;
+        autoModel = jobAutoModel;
+        for (const auto& [model, name] : jobNames) {
+            jobs[model] = name;
+        }
+        for (size_t i = 0; i < done.size();) {
+            if (!done[i]) {
+                ++i;
+                continue;
+            }
+            size_t first = i;
+            while (i < done.size() && done[i]) {
+                ++i;
+            }
+            ranges.push_back({first, i});
+        }
+    }
+
+    // The results must be on disk before the checkpoint claims them
+    if (fsync(outputFd) != 0) {
+        return false;
+    }
+
+    json checkpoint = {
+        {"input", fs::absolute(options.inputPath).string()},
+        {"input_size", inputSize},
+        {"total", items.size()},
+        {"provider", ConfigManager::providerToString(configManager->getSelectedProvider())},
+        {"output_bytes", bytes},
+        {"done", ranges},
+        {"jobs", jobs},
+        {"auto_model", autoModel}
+    };
+    std::string content = checkpoint.dump();
+
+    // Replace the old checkpoint atomically
+    std::string tempPath = options.checkpointPath.string() + ".tmp";
+    int fd = open(tempPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    bool ok = write(fd, content.data(), content.size()) == static_cast<ssize_t>(content.size());
+    ok = ok && fsync(fd) == 0;
+    ok = close(fd) == 0 && ok;
+    if (!ok || rename(tempPath.c_str(), options.checkpointPath.c_str()) != 0) {
+        std::cerr << "Error saving checkpoint: " << strerror(errno) << std::endl;
+        unlink(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool BatchRunner::takeNext(size_t& index, int& attempt, std::chrono::steady_clock::time_point& wakeAt) {
+    auto now = std::chrono::steady_clock::now();
+    if (inFlight >= options.concurrency) {
+        return false;
+    }
+
+    // Everyone waits out a rate limit response
+    if (now < pausedUntil) {
+        wakeAt = std::min(wakeAt, pausedUntil);
+        return false;
+    }
+    if (options.requestsPerSecond > 0.0 && now < nextStart) {
+        wakeAt = std::min(wakeAt, nextStart);
+        return false;
+    }
+
+    // Retries that are due go first, then new items
+    auto due = std::find_if(retries.begin(), retries.end(), [&](const Retry& retry) {
+        return retry.readyAt <= now;
+    });
+    if (due != retries.end()) {
+        index = due->index;
+        attempt = due->attempt;
+        retries.erase(due);
+    } else {
+        while (cursor < items.size() && done[cursor]) {
+            ++cursor;
+        }
+        if (cursor >= items.size()) {
+            for (const auto& retry : retries) {
+                wakeAt = std::min(wakeAt, retry.readyAt);
+            }
+            return false;
+        }
+        index = cursor++;
+        attempt = 0;
+    }
+
+    if (options.requestsPerSecond > 0.0) {
+        auto interval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(1.0 / options.requestsPerSecond));
+        nextStart = std::max(nextStart, now) + interval;
+    }
+    metrics::batchQueueDepth.set(static_cast<int64_t>(items.size() - cursor + retries.size()));
+    return true;
+}
+
+void BatchRunner::start(size_t index, int attempt) {
+    const Item& item = items[index];
+    if (!item.invalid.empty()) {
+        finish(index, attempt, "Error: Invalid request: " + item.invalid, false, RequestStats(), TokenUsage(), 0.0);
+        return;
+    }
+
+    std::unique_ptr<ApiClient> client = createClient();
+    if (!client) {
+        finish(index, attempt, "Error: Failed to create API client. Please check your API key.", false,
+               RequestStats(), TokenUsage(), 0.0);
+        return;
+    }
+
+    std::string model = resolveModel(item);
+
+    // The client reports stats and usage before the reply
+    auto stats = std::make_shared<RequestStats>();
+    auto usage = std::make_shared<TokenUsage>();
+    client->setMaxOutputTokens(item.maxOutputTokens);
+    client->setUsageCallback([usage](const TokenUsage& tokenUsage) {
+        *usage = tokenUsage;
+    });
+    client->setRequestStatsCallback([stats, router = modelRouter](const RequestStats& requestStats) {
+        *stats = requestStats;
+        router->record(requestStats);
+    });
+
+    auto started = std::chrono::steady_clock::now();
+    client->sendChatCompletion(item.messages, model,
+        [this, index, attempt, stats, usage, started](const std::string& response, bool success) {
+            std::chrono::duration<double> latency = std::chrono::steady_clock::now() - started;
+            finish(index, attempt, response, success, *stats, *usage, latency.count());
+        });
+}
+
+void BatchRunner::finish(
+    size_t index,
+    int attempt,
+    const std::string& response,
+    bool success,
+    const RequestStats& stats,
+    const TokenUsage& usage,
+    double latency
+) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // Throttling, server errors and dropped connections are worth another try
+    // (stats.model is only filled in once a request was actually made)
+    bool transient = !success && !stats.model.empty() &&
+                     (stats.status == 429 || stats.status >= 500 || stats.status == 0);
+    if (transient && (attempt < options.maxRetries || interrupted)) {
+        // Left unrecorded when interrupted, so a resumed run tries again
+        if (!interrupted) {
+            auto backoff = std::min(kMaxRetryBackoff, kRetryBackoff * (1 << std::min(attempt, 16)));
+            auto readyAt = std::chrono::steady_clock::now() + backoff;
+            retries.push_back({index, attempt + 1, readyAt});
+            metrics::batchRetries.add();
+            metrics::batchQueueDepth.set(static_cast<int64_t>(items.size() - cursor + retries.size()));
+            if (stats.status == 429) {
+                pausedUntil = std::max(pausedUntil, readyAt);
+            }
+        }
+        --inFlight;
+        condition.notify_all();
+        return;
+    }
+
+    record(index, attempt + 1, stats.model.empty() ? items[index].model : stats.model, response, success,
+           stats.status, usage, latency, stats.ttfbSeconds);
+    --inFlight;
+    condition.notify_all();
+}
+
+void BatchRunner::record(
+    size_t index,
+    int attempts,
+    const std::string& model,
+    const std::string& response,
+    bool success,
+    long status,
+    const TokenUsage& usage,
+    double latency,
+    double ttfb
+) {
+    json result = {
+        {"index", index},
+        {"id", items[index].id},
+        {"model", model},
+        {"success", success},
+        {success ? "response" : "error", response},
+        {"status", status},
+        {"attempts", attempts},
+        {"latency_ms", std::lround(latency * 1000.0)},
+        {"ttfb_ms", std::lround(ttfb * 1000.0)},
+        {"usage", {{"prompt_tokens", usage.promptTokens}, {"output_tokens", usage.outputTokens}}}
+    };
+
+    ++completed;
+    outputTokens += usage.outputTokens;
+    if (success) {
+        latencies.push_back(latency);
+    } else {
+        ++failed;
+    }
+
+    std::string line = result.dump(-1, ' ', false, json::error_handler_t::replace) + "\n";
+    if (!options.ordered) {
+        writeResult(index, line);
+    } else {
+        // Hold results back until every earlier item has been written
+        reorderBuffer.emplace(index, std::move(line));
+        while (nextToWrite < items.size()) {
+            if (done[nextToWrite]) {
+                ++nextToWrite;
+                continue;
+            }
+            auto next = reorderBuffer.find(nextToWrite);
+            if (next == reorderBuffer.end()) {
+                break;
+            }
+            writeResult(next->first, next->second);
+            reorderBuffer.erase(next);
+            ++nextToWrite;
+        }
+    }
+}
+
+void BatchRunner::writeResult(size_t index, const std::string& line) {
+    if (!writeAll(line)) {
+        // Stop rather than keep spending requests whose results can't be saved
+        if (error.empty()) {
+            error = "Error writing " + options.outputPath.string() + ": " + strerror(errno);
+        }
+        interrupted = true;
+        return;
+    }
+    outputBytes += line.size();
+    done[index] = true;
+}
+
+bool BatchRunner::writeAll(const std::string& data) {
+    const char* pos = data.data();
+    size_t remaining = data.size();
+    while (remaining > 0) {
+        ssize_t n = write(outputFd, pos, remaining);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        pos += n;
+        remaining -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+std::string BatchRunner::resolveModel(const Item& item) const {
+    if (item.model != kAutoModelId) {
+        return item.model;
+    }
+    std::vector<std::string> ranked = modelRouter->rank(configManager->getAutoModelTiers());
+    return ranked.empty() ? configManager->getSelectedModel() : ranked.front();
+}
+
+std::unique_ptr<ApiClient> BatchRunner::createClient() const {
+    Provider provider = configManager->getSelectedProvider();
+    if (keyPool->size() == 0 && ConfigManager::requiresApiKey(provider)) {
+        return nullptr;
+    }
+
+    std::unique_ptr<ApiClient> client = keyPool->size() == 0 ? createApiClient(provider, std::string())
+                                                             : createApiClient(provider, keyPool);
+    client->setEndpointSelector(endpointSelector);
+    return client;
+}
+
+BatchProgress BatchRunner::progressLocked() const {
+    BatchProgress progress;
+    progress.total = items.size();
+    progress.completed = completedBefore + completed;
+    progress.failed = failed;
+    progress.inFlight = inFlight;
+    progress.outputTokens = outputTokens;
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - startTime;
+    progress.seconds = elapsed.count();
+    if (progress.seconds > 0.0) {
+        progress.requestsPerSecond = completed / progress.seconds;
+        progress.tokensPerSecond = outputTokens / progress.seconds;
+    }
+
+    // Latency percentiles over the successful requests of this run
+    if (!latencies.empty()) {
+        std::vector<double> sorted = latencies;
+        auto percentile = [&sorted](double fraction) {
+            size_t rank = static_cast<size_t>(fraction * (sorted.size() - 1) + 0.5);
+            std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+            return sorted[rank];
+        };
+        progress.p50Seconds = percentile(0.50);
+        progress.p90Seconds = percentile(0.90);
+        progress.p99Seconds = percentile(0.99);
+    }
+
+    for (const auto& [model, state] : jobStates) {
+        progress.status += (progress.status.empty() ? "" : ", ") + state;
+    }
+    return progress;
+}
+
+} // namespace libertymind
@@ -0,0 +1,209 @@
+#include "bulk_exporter.h"
+#include "alloc_tracker.h"
+#include "markdown_exporter.h"
+#include "metrics.h"
+#include "session_store.h"
+#include "trace.h"
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using json = nlohmann::json;
+namespace fs = std::filesystem;
+
+namespace libertymind {
+
+namespace {
+
+// Fixed set of workers, each with its own task deque. Workers take their own
+// tasks from the front (largest first, as they were dealt) and idle workers
+// steal from the back of other deques, so one huge session doesn't leave the
+// rest of a worker's queue stranded behind it.
+class WorkStealingPool {
+public:
+    using Task = std::function<void()>;
+
+    explicit WorkStealingPool(size_t workers) : queues(workers) {}
+
+    // Queue a task on a worker's deque (only valid before run())
+    void submit(size_t worker, Task task) {
+        queues[worker % queues.size()].tasks.push_back(std::move(task));
+    }
+
+    // Run all queued tasks and wait for them to finish
+    void run() {
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < queues.size(); ++i) {
+            threads.emplace_back([this, i]() { work(i); });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<Queue> queues;
+
+    void work(size_t self) {
+        Task task;
+        while (takeOwn(self, task) || steal(self, task)) {
+            task();
+        }
+    }
+
+    bool takeOwn(size_t self, Task& task) {
+        std::lock_guard<std::mutex> lock(queues[self].mutex);
+        if (queues[self].tasks.empty()) {
+            return false;
+        }
+        task = std::move(queues[self].tasks.front());
+        queues[self].tasks.pop_front();
+        return true;
+    }
+
+    bool steal(size_t self, Task& task) {
+        for (size_t offset = 1; offset < queues.size(); ++offset) {
+            Queue& victim = queues[(self + offset) % queues.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.tasks.empty()) {
+                task = std::move(victim.tasks.back());
+                victim.tasks.pop_back();
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+} // namespace
+
+std::string BulkExporter::extensionFor(ExportFormat format) {
+    return format == ExportFormat::JSONL ? ".jsonl" : ".md";
+}
+
+bool BulkExporter::exportSession(
+    const fs::path& sessionPath,
+    const fs::path& outputPath,
+    ExportFormat format,
+    uint64_t& bytesWritten
+) {
+    Trace::Span span("export session", "export");
+    AllocTracker::Scope allocations(AllocTag::EXPORT);
+    try {
+        MarkdownStreamWriter writer;
+        if (!writer.open(outputPath.string())) {
+            return false;
+        }
+
+        std::string sessionId = sessionPath.stem().string();
+        bool ok = true;
+        bool first = true;
+        size_t index = 0;
+
+        // Stream one message at a time so memory stays bounded by the largest message
+        bool read = SessionStore::readSession(sessionPath, [&](const Message& message) {
+            if (format == ExportFormat::JSONL) {
+                json record = {
+                    {"session", sessionId},
+                    {"index", index++},
+                    {"role", message.role},
+                    {"content", message.content}
+                };
+                ok = writer.writeRaw(record.dump() + "\n");
+                return ok;
+            }
+
+            // Sessions start with their system message, which goes in the header
+            if (first) {
+                first = false;
+                ok = writer.writeHeader(message.role == "system" ? &message : nullptr);
+            }
+            ok = ok && writer.writeMessage(message);
+            return ok;
+        });
+
+        if (!read || !ok) {
+            return false;
+        }
+
+        if (format == ExportFormat::MARKDOWN) {
+            if ((first && !writer.writeHeader(nullptr)) || !writer.writeFooter()) {
+                return false;
+            }
+        }
+
+        bytesWritten = writer.bytesWritten();
+        return writer.commit();
+    } catch (const std::exception& e) {
+        std::cerr << "Error exporting " << sessionPath << ": " << e.what() << std::endl;
+        return false;
+    }
+}
+
+BulkExportStats BulkExporter::exportAll(const BulkExportOptions& options) {
+    BulkExportStats stats;
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<SessionInfo> sessions = SessionStore::listSessions(options.sessionDirectory);
+
+    std::error_code ec;
+    fs::create_directories(options.outputDirectory, ec);
+    if (ec) {
+        std::cerr << "Error: Could not create " << options.outputDirectory << ": " << ec.message() << std::endl;
+        stats.failed = sessions.size();
+        return stats;
+    }
+
+    size_t jobs = options.jobs ? options.jobs : std::max(1u, std::thread::hardware_concurrency());
+    jobs = std::max<size_t>(1, std::min(jobs, sessions.size()));
+
+    // Deal the largest sessions out first so they don't all land at the end
+    std::sort(sessions.begin(), sessions.end(), [](const SessionInfo& a, const SessionInfo& b) {
+        return a.sizeBytes > b.sizeBytes;
+    });
+
+    std::atomic<size_t> exported{0};
+    std::atomic<size_t> failed{0};
+    std::atomic<uint64_t> bytesRead{0};
+    std::atomic<uint64_t> bytesWritten{0};
+
+    WorkStealingPool pool(jobs);
+    metrics::exportQueueDepth.add(static_cast<int64_t>(sessions.size()));
+    for (size_t i = 0; i < sessions.size(); ++i) {
+        const SessionInfo& session = sessions[i];
+        pool.submit(i, [&, session]() {
+            metrics::exportQueueDepth.sub();
+            fs::path outputPath = options.outputDirectory / (session.id + extensionFor(options.format));
+            uint64_t written = 0;
+            if (!exportSession(session.path, outputPath, options.format, written)) {
+                failed.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            exported.fetch_add(1, std::memory_order_relaxed);
+            bytesRead.fetch_add(session.sizeBytes, std::memory_order_relaxed);
+            bytesWritten.fetch_add(written, std::memory_order_relaxed);
+        });
+    }
+    pool.run();
+
+    stats.sessions = exported;
+    stats.failed = failed;
+    stats.bytesRead = bytesRead;
+    stats.bytesWritten = bytesWritten;
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return stats;
+}
+
+} // namespace libertymind
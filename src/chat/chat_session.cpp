@@ -1,147 +1,412 @@
 #include "chat_session.h"
+#include "alloc_tracker.h"
+#include "metrics.h"
+#include "network_loop.h"
+#include "trace.h"
+#include <algorithm>
 
 namespace libertymind {
 
 ChatSession::ChatSession(std::shared_ptr<ConfigManager> configManager)
-    : configManager(configManager), systemMessage("You are Synthara, a helpful and intelligent assistant.") {
+    : configManager(configManager),
+      historyRevision(0),
+      systemMessage("You are Synthara, a helpful and intelligent assistant."),
+      contextCache(std::make_shared<ContextCache>()),
+      modelRouter(std::make_shared<ModelRouter>()),
+      keyPool(std::make_shared<ApiKeyPool>()),
+      endpointSelector(std::make_shared<EndpointSelector>(
+          configManager->getEndpoints(configManager->getSelectedProvider()))),
+      sessionSaved(false),
+      calibrationEnabled(true),
+      requestsInFlight(0) {
     // Add system message to history
     history.push_back({"system", systemMessage});
+
+    refreshContextSettings();
+
+    // Keep measuring endpoint latency while the session is open
+    endpointSelector->startProbing();
 }
 
-void ChatSession::sendMessage(const std::string& message, ChatCallback callback) {
-    try {
-        // Create a safe callback wrapper
-        auto safeCallback = [callback](const std::string& response, bool success) {
-            try {
-                callback(response, success);
-            } catch (const std::exception& e) {
-                try {
-                    callback("Critical error in callback: " + std::string(e.what()), false);
-                } catch (...) {
-                    // If even this fails, we can't do much more
-                }
-            } catch (...) {
-                try {
-                    callback("Unknown critical error in callback", false);
-                } catch (...) {
-                    // Last resort
-                }
+void ChatSession::refreshContextSettings(const std::optional<ModelInfo>& modelInfo) {
+    ContextSettings settings;
+    settings.tokenBudget = configManager->getContextTokenBudget();
+
+    // Leave room for the response inside the model's input window
+    if (modelInfo && modelInfo->inputTokenLimit > 0) {
+        size_t limit = modelInfo->inputTokenLimit;
+        size_t reserve = std::min<size_t>(kDefaultMaxOutputTokens, limit / 4);
+        settings.tokenBudget = std::min(settings.tokenBudget, limit - reserve);
+    }
+    settings.recentTurns = configManager->getContextRecentTurns();
+    settings.summaryModel = configManager->getSummaryModel();
+    contextManager.setSettings(settings);
+
+    contextCache->setMinTokens(configManager->getContextCacheMinTokens());
+    contextCache->setTtlSeconds(configManager->getContextCacheTtlSeconds());
+}
+
+// A failed result carrying an error message
+static CompletionResult failure(const std::string& message) {
+    CompletionResult result;
+    result.response = message;
+    return result;
+}
+
+Task<CompletionResult> ChatSession::send(std::string message) {
+    std::unique_ptr<ApiClient> client;
+    std::vector<std::string> models;
+    std::vector<Message> context;
+    {
+        Trace::Span span("sendMessage", "chat");
+        AllocTracker::Scope allocations(AllocTag::SESSION);
+
+        // Add user message to history, keeping a copy to build the request from
+        Message added{"user", message};
+        std::vector<Message> snapshot;
+        {
+            std::lock_guard<std::mutex> lock(historyMutex);
+            history.push_back(added);
+            snapshot = history;
+        }
+        persistMessage(added);
+
+        client = createClient();
+        if (!client) {
+            co_return failure("Error: Failed to create API client. Please check your API key.");
+        }
+
+        // Get selected model; "auto" tries the tier list fastest first
+        std::string model = configManager->getSelectedModel();
+        if (model.empty()) {
+            co_return failure("Error: No model selected");
+        }
+        models = model == kAutoModelId ? modelRouter->rank(configManager->getAutoModelTiers())
+                                       : std::vector<std::string>{model};
+        if (models.empty()) {
+            co_return failure("Error: auto_model_tiers lists no models");
+        }
+
+        // Fit the history into the model's context budget
+        Trace::Span contextSpan("build context", "chat");
+        std::optional<ModelInfo> modelInfo = getModelInfo(models.front());
+        refreshContextSettings(modelInfo);
+        context = contextManager.buildContext(snapshot);
+
+        // The newest message is always sent; reject it up front if it can never fit
+        if (modelInfo && modelInfo->inputTokenLimit > 0) {
+            size_t estimated = 0;
+            for (const auto& msg : context) {
+                estimated += contextManager.estimateTokens(msg);
+            }
+            if (estimated > static_cast<size_t>(modelInfo->inputTokenLimit)) {
+                co_return failure("Error: Message is too long for " + modelInfo->name + " (about " +
+                                  std::to_string(estimated) + " tokens, limit " +
+                                  std::to_string(modelInfo->inputTokenLimit) + ")");
             }
-        };
+        }
 
-        // Add user message to history
-        try {
-            history.push_back({"user", message});
-        } catch (const std::exception& e) {
-            safeCallback("Error adding message to history: " + std::string(e.what()), false);
-            return;
+        if (calibrationEnabled) {
+            contextManager.calibrate(context, models.front(), [this]() { return createClient(); });
         }
+    }
 
-        // Create API client
-        std::unique_ptr<ApiClient> client;
-        try {
+    // Fail over to the next model in the tier list, unless part of a reply was already shown
+    CompletionResult result;
+    for (size_t attempt = 0; attempt < models.size(); ++attempt) {
+        if (attempt > 0) {
             client = createClient();
             if (!client) {
-                safeCallback("Error: Failed to create API client. Please check your API key.", false);
-                return;
+                break;
             }
-        } catch (const std::exception& e) {
-            safeCallback("Error creating API client: " + std::string(e.what()), false);
-            return;
+            metrics::modelRetries.add();
         }
+        configureClient(*client, models[attempt]);
 
-        // Get selected model
-        std::string model;
-        try {
-            model = configManager->getSelectedModel();
-            if (model.empty()) {
-                safeCallback("Error: No model selected", false);
-                return;
-            }
-        } catch (const std::exception& e) {
-            safeCallback("Error getting selected model: " + std::string(e.what()), false);
-            return;
+        ++requestsInFlight;
+        // The stream callback may block on the terminal, so chunks are handed over off the loop, in order
+        AsyncGenerator<std::string> stream = client->streamCompletion({context, models[attempt], nullptr}, result);
+        while (std::optional<std::string> chunk = co_await stream.next()) {
+            co_await NetworkLoop::shared().offload([&]() { appendPendingReply(*chunk); });
         }
+        --requestsInFlight;
 
-        // Send request to API with a safe response handler
-        try {
-            client->sendChatCompletion(history, model, [this, safeCallback](const std::string& response, bool success) {
-                try {
-                    if (success && !response.empty()) {
-                        try {
-                            // Add assistant response to history
-                            history.push_back({"assistant", response});
-                        } catch (const std::exception& e) {
-                            safeCallback("Error adding response to history: " + std::string(e.what()), false);
-                            return;
-                        }
-                    }
-
-                    // Call the callback with the response
-                    safeCallback(response, success);
-                } catch (const std::exception& e) {
-                    // Handle any exceptions in the callback
-                    safeCallback("Error in response handling: " + std::string(e.what()), false);
-                } catch (...) {
-                    safeCallback("Unknown error in response handling", false);
-                }
-            });
-        } catch (const std::exception& e) {
-            // Handle any exceptions in the API call
-            safeCallback("Error sending message: " + std::string(e.what()), false);
-        } catch (...) {
-            safeCallback("Unknown error sending message", false);
+        if (result.hasUsage) {
+            contextManager.recordUsage(context, result.usage.promptTokens);
         }
-    } catch (const std::exception& e) {
-        try {
-            callback("Fatal error in message sending: " + std::string(e.what()), false);
-        } catch (...) {
-            // Last resort, can't do much if even this fails
+        modelRouter->record(result.stats);
+        {
+            std::lock_guard<std::mutex> lock(perfMutex);
+            lastRequest = result.stats;
+        }
+
+        bool streamed;
+        {
+            std::lock_guard<std::mutex> lock(pendingMutex);
+            streamed = !pendingReply.empty();
+            pendingReply.clear();
+        }
+        if (result.success || streamed) {
+            break;
+        }
+    }
+
+    if (result.success && !result.response.empty()) {
+        Message added{"assistant", result.response};
+        {
+            Trace::Span span("complete", "chat");
+            AllocTracker::Scope allocations(AllocTag::SESSION);
+
+            // Add assistant response to history
+            std::vector<Message> snapshot;
+            {
+                std::lock_guard<std::mutex> lock(historyMutex);
+                history.push_back(added);
+                snapshot = history;
+            }
+
+            // Fold older turns into the summary in the background
+            contextManager.maybeCompact(snapshot, [this]() { return createClient(); });
         }
-    } catch (...) {
+
+        // Saving writes to disk, so it happens off the loop
+        co_await NetworkLoop::shared().offload([&]() { persistMessage(added); });
+    }
+    co_return result;
+}
+
+void ChatSession::sendMessage(const std::string& message, ChatCallback callback) {
+    // An exception from the callback is reported back to it once, then dropped
+    auto safeCallback = [callback](const std::string& response, bool success) {
         try {
-            callback("Unknown fatal error in message sending", false);
+            callback(response, success);
+        } catch (const std::exception& e) {
+            try {
+                callback("Critical error in callback: " + std::string(e.what()), false);
+            } catch (...) {
+                // If even this fails, we can't do much more
+            }
         } catch (...) {
-            // Last resort
+            try {
+                callback("Unknown critical error in callback", false);
+            } catch (...) {
+                // Last resort
+            }
         }
-    }
+    };
+
+    // send() finishes on the network loop; the callback runs on a worker instead
+    startTask(send(message),
+        [safeCallback](const CompletionResult& result) {
+            NetworkLoop::shared().execute([safeCallback, result]() {
+                safeCallback(result.response, result.success);
+            });
+        },
+        [safeCallback](const std::string& error) {
+            NetworkLoop::shared().execute([safeCallback, error]() {
+                safeCallback("Error sending message: " + error, false);
+            });
+        });
 }
 
 void ChatSession::clearHistory() {
-    history.clear();
+    {
+        std::lock_guard<std::mutex> lock(historyMutex);
+        history.clear();
+        ++historyRevision;
 
-    // Re-add system message
-    history.push_back({"system", systemMessage});
+        // Re-add system message
+        history.push_back({"system", systemMessage});
+    }
+    contextManager.reset();
+
+    // Continue in a new saved session
+    std::lock_guard<std::mutex> lock(sessionMutex);
+    sessionStore.beginSession();
+    sessionSaved = false;
 }
 
-const std::vector<Message>& ChatSession::getHistory() const {
-    return history;
+size_t ChatSession::getHistorySize() const {
+    std::lock_guard<std::mutex> lock(historyMutex);
+    return history.size();
+}
+
+uint64_t ChatSession::getHistoryRevision() const {
+    std::lock_guard<std::mutex> lock(historyMutex);
+    return historyRevision;
+}
+
+bool ChatSession::copyHistory(size_t begin, size_t count, uint64_t revision, std::vector<Message>& messages) const {
+    std::lock_guard<std::mutex> lock(historyMutex);
+    if (revision != historyRevision) {
+        return false;
+    }
+
+    messages.clear();
+    size_t end = std::min(history.size(), begin + count);
+    for (size_t i = begin; i < end; ++i) {
+        messages.push_back(history[i]);
+    }
+    return true;
 }
 
 void ChatSession::setSystemMessage(const std::string& message) {
     systemMessage = message;
 
+    // The cached prefix no longer matches
+    contextCache->invalidate();
+
     // Update system message in history
-    if (!history.empty() && history[0].role == "system") {
-        history[0].content = message;
-    } else {
-        history.insert(history.begin(), {"system", message});
+    {
+        std::lock_guard<std::mutex> lock(historyMutex);
+        if (!history.empty() && history[0].role == "system") {
+            history[0].content = message;
+        } else {
+            history.insert(history.begin(), {"system", message});
+        }
+        ++historyRevision;
     }
+
+    // Record the change in an already-started saved session
+    persistMessage({"system", message}, true);
 }
 
 std::string ChatSession::getSystemMessage() const {
     return systemMessage;
 }
 
+void ChatSession::persistMessage(const Message& message, bool onlyIfSaved) {
+    if (!configManager->getSaveSessions()) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(sessionMutex);
+    if (onlyIfSaved && !sessionSaved) {
+        return;
+    }
+
+    // Sessions are only written once there is a conversation to keep
+    if (!sessionSaved) {
+        sessionSaved = true;
+        std::optional<Message> system;
+        {
+            std::lock_guard<std::mutex> historyLock(historyMutex);
+            if (message.role != "system" && !history.empty() && history[0].role == "system") {
+                system = history[0];
+            }
+        }
+        if (system) {
+            sessionStore.append(*system);
+        }
+    }
+
+    sessionStore.append(message);
+}
+
+void ChatSession::configureClient(ApiClient& client, const std::string& model) const {
+    std::optional<ModelInfo> modelInfo = getModelInfo(model);
+    if (modelInfo && modelInfo->outputTokenLimit > 0) {
+        client.setMaxOutputTokens(std::min(kDefaultMaxOutputTokens, modelInfo->outputTokenLimit));
+    }
+    client.setContextCache(contextCache);
+}
+
+void ChatSession::appendPendingReply(const std::string& chunk) {
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        if (pendingReply.empty()) {
+            pendingStarted = std::chrono::steady_clock::now();
+        }
+        pendingReply += chunk;
+    }
+    if (streamCallback) {
+        streamCallback(chunk);
+    }
+}
+
+const ContextManager& ChatSession::getContextManager() const {
+    return contextManager;
+}
+
+SessionPerf ChatSession::getPerf() const {
+    SessionPerf perf;
+    perf.requestsInFlight = requestsInFlight;
+    contextCache->getHitStats(perf.cacheHits, perf.cacheLookups);
+
+    {
+        std::lock_guard<std::mutex> lock(historyMutex);
+        perf.historyMessages = history.size();
+        for (const auto& message : history) {
+            perf.historyBytes += message.content.size();
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(perfMutex);
+        perf.lastTtfbSeconds = lastRequest.ttfbSeconds;
+        perf.lastTotalSeconds = lastRequest.totalSeconds;
+
+        // Output tokens over the time they took to arrive
+        double generating = lastRequest.totalSeconds - lastRequest.ttfbSeconds;
+        if (lastRequest.outputTokens > 0 && generating > 0.0) {
+            perf.tokensPerSecond = lastRequest.outputTokens / generating;
+        }
+    }
+
+    // While a reply streams, estimate its rate from the text so far
+    std::lock_guard<std::mutex> lock(pendingMutex);
+    if (!pendingReply.empty()) {
+        perf.streaming = true;
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - pendingStarted).count();
+        perf.tokensPerSecond = elapsed > 0.0 ? contextManager.estimateTokens(pendingReply) / elapsed : 0.0;
+    }
+    return perf;
+}
+
+std::string ChatSession::getPendingReply() const {
+    std::lock_guard<std::mutex> lock(pendingMutex);
+    return pendingReply;
+}
+
+void ChatSession::setStreamCallback(StreamCallback callback) {
+    streamCallback = std::move(callback);
+}
+
+const ModelRouter& ChatSession::getModelRouter() const {
+    return *modelRouter;
+}
+
+void ChatSession::setModelRegistry(std::shared_ptr<ModelRegistry> registry) {
+    modelRegistry = std::move(registry);
+}
+
+void ChatSession::setCalibrationEnabled(bool enabled) {
+    calibrationEnabled = enabled;
+}
+
+std::optional<ModelInfo> ChatSession::getModelInfo(const std::string& model) const {
+    if (!modelRegistry) {
+        return std::nullopt;
+    }
+    return modelRegistry->getModelInfo(configManager->getSelectedProvider(), model);
+}
+
 std::unique_ptr<ApiClient> ChatSession::createClient() const {
     Provider provider = configManager->getSelectedProvider();
-    auto apiKey = configManager->getApiKey(provider);
+    std::vector<std::string> apiKeys = configManager->getApiKeys(provider);
 
-    if (!apiKey) {
+    if (apiKeys.empty() && ConfigManager::requiresApiKey(provider)) {
         return nullptr;
     }
 
-    return createApiClient(provider, *apiKey);
+    // Keys added or removed in the config join the pool without losing its state
+    keyPool->setKeys(apiKeys);
+    endpointSelector->setEndpoints(configManager->getEndpoints(provider));
+
+    std::unique_ptr<ApiClient> client = apiKeys.empty() ? createApiClient(provider, std::string())
+                                                        : createApiClient(provider, keyPool);
+    client->setEndpointSelector(endpointSelector);
+    return client;
 }
 
 } // namespace libertymind
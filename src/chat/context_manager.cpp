@@ -0,0 +1,278 @@
+#include "context_manager.h"
+#include <algorithm>
+#include <iostream>
+#include <thread>
+
+namespace libertymind {
+
+// Fixed per-message overhead for role markers and framing
+static const size_t kMessageOverheadTokens = 4;
+
+// Older turns are folded once at least this many have piled up outside the window
+static const size_t kMinFoldMessages = 4;
+
+// countTokens calls before calibration is left to usage reports alone
+static const int kMaxCalibrationAttempts = 3;
+
+// Wait after a failed countTokens call, doubled for each further failure
+static const std::chrono::seconds kCalibrationBackoff(30);
+
+ContextManager::ContextManager() : state(std::make_shared<State>()) {}
+
+ContextManager::~ContextManager() {
+    // A calibration still running must not touch the session's settings any more
+    std::lock_guard<std::mutex> lock(state->mutex);
+    state->cancelled = true;
+}
+
+void ContextManager::setSettings(const ContextSettings& settings) {
+    std::lock_guard<std::mutex> lock(state->mutex);
+    state->settings = settings;
+}
+
+ContextSettings ContextManager::getSettings() const {
+    std::lock_guard<std::mutex> lock(state->mutex);
+    return state->settings;
+}
+
+size_t ContextManager::estimateTokens(const std::string& text) const {
+    double charsPerToken;
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        charsPerToken = state->charsPerToken;
+    }
+    return static_cast<size_t>(text.size() / charsPerToken) + 1;
+}
+
+size_t ContextManager::estimateTokens(const Message& message) const {
+    return estimateTokens(message.content) + kMessageOverheadTokens;
+}
+
+size_t ContextManager::recentWindowStart(const std::vector<Message>& history, size_t recentTurns) {
+    // A turn is a user message plus its reply
+    size_t keep = recentTurns * 2;
+    size_t start = history.size() > keep ? history.size() - keep : 0;
+    return std::max<size_t>(start, 1);
+}
+
+std::vector<Message> ContextManager::buildContext(const std::vector<Message>& history) const {
+    if (history.empty()) {
+        return {};
+    }
+
+    ContextSettings settings;
+    std::string summary;
+    size_t foldedUpTo;
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        settings = state->settings;
+        summary = state->summary;
+        foldedUpTo = std::min(state->foldedUpTo, history.size());
+    }
+
+    std::vector<Message> context;
+    size_t used = 0;
+
+    // Pin the system message
+    size_t first = 0;
+    if (history[0].role == "system") {
+        context.push_back(history[0]);
+        used += estimateTokens(history[0]);
+        first = 1;
+    }
+
+    // Stand in for folded turns with the rolling summary
+    if (!summary.empty()) {
+        Message summaryMessage{"system", "Summary of the earlier conversation:\n" + summary};
+        used += estimateTokens(summaryMessage);
+        context.push_back(std::move(summaryMessage));
+        first = std::max(first, foldedUpTo);
+    }
+
+    // Take the newest unfolded messages that still fit, always keeping the last one
+    size_t begin = history.size();
+    while (begin > first) {
+        size_t cost = estimateTokens(history[begin - 1]);
+        if (begin != history.size() && used + cost > settings.tokenBudget) {
+            break;
+        }
+        used += cost;
+        --begin;
+    }
+
+    // Never open the conversation with a dangling assistant reply
+    while (begin < history.size() - 1 && history[begin].role == "assistant") {
+        ++begin;
+    }
+
+    context.insert(context.end(), history.begin() + begin, history.end());
+    return context;
+}
+
+void ContextManager::recordUsage(const std::vector<Message>& context, int promptTokens) {
+    applyUsage(*state, context, promptTokens);
+}
+
+void ContextManager::applyUsage(State& state, const std::vector<Message>& context, int promptTokens) {
+    if (promptTokens <= 0) {
+        return;
+    }
+
+    size_t chars = 0;
+    for (const auto& message : context) {
+        chars += message.content.size();
+    }
+
+    // Subtract framing overhead so the ratio only reflects content
+    double overhead = static_cast<double>(context.size() * kMessageOverheadTokens);
+    double contentTokens = std::max(1.0, promptTokens - overhead);
+    double sample = std::clamp(chars / contentTokens, 1.0, 8.0);
+
+    std::lock_guard<std::mutex> lock(state.mutex);
+    if (state.cancelled) {
+        return;
+    }
+    if (state.calibrated) {
+        state.charsPerToken = 0.7 * state.charsPerToken + 0.3 * sample;
+    } else {
+        state.charsPerToken = sample;
+        state.calibrated = true;
+    }
+}
+
+void ContextManager::calibrate(const std::vector<Message>& context, const std::string& model, ClientFactory clientFactory) {
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        if (state->calibrated || state->calibrating || state->calibrationAttempts >= kMaxCalibrationAttempts ||
+            std::chrono::steady_clock::now() < state->nextCalibration) {
+            return;
+        }
+        state->calibrating = true;
+        ++state->calibrationAttempts;
+    }
+
+    // The client is created here so the thread never calls back into the factory's owner
+    std::unique_ptr<ApiClient> client;
+    try {
+        client = clientFactory();
+    } catch (const std::exception& e) {
+        std::cerr << "Error calibrating token estimator: " << e.what() << std::endl;
+    }
+    if (!client) {
+        finishCalibration(*state, false);
+        return;
+    }
+
+    // Counting is a blocking round trip, so keep it off the caller's thread
+    std::thread([sharedState = state, context, model, client = std::move(client)]() {
+        int tokens = -1;
+        try {
+            {
+                std::lock_guard<std::mutex> lock(sharedState->mutex);
+                if (sharedState->cancelled) {
+                    return;
+                }
+            }
+            tokens = client->countTokens(context, model);
+        } catch (const std::exception& e) {
+            std::cerr << "Error calibrating token estimator: " << e.what() << std::endl;
+        }
+
+        if (tokens > 0) {
+            applyUsage(*sharedState, context, tokens);
+        }
+        finishCalibration(*sharedState, tokens > 0);
+    }).detach();
+}
+
+void ContextManager::finishCalibration(State& state, bool success) {
+    std::lock_guard<std::mutex> lock(state.mutex);
+    state.calibrating = false;
+    if (!success) {
+        state.nextCalibration = std::chrono::steady_clock::now() + kCalibrationBackoff * (1 << (state.calibrationAttempts - 1));
+    }
+}
+
+void ContextManager::maybeCompact(const std::vector<Message>& history, ClientFactory clientFactory) {
+    std::string previousSummary;
+    std::string summaryModel;
+    size_t foldFrom;
+    size_t foldTo;
+    size_t generation;
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        if (state->compacting) {
+            return;
+        }
+
+        foldFrom = std::max<size_t>(state->foldedUpTo, 1);
+        foldTo = recentWindowStart(history, state->settings.recentTurns);
+        if (foldTo <= foldFrom || foldTo - foldFrom < kMinFoldMessages) {
+            return;
+        }
+
+        state->compacting = true;
+        previousSummary = state->summary;
+        summaryModel = state->settings.summaryModel;
+        generation = state->generation;
+    }
+
+    // Ask the summary model to merge the older turns into the running summary
+    std::string transcript;
+    for (size_t i = foldFrom; i < foldTo; ++i) {
+        transcript += (history[i].role == "assistant" ? "Assistant: " : "User: ");
+        transcript += history[i].content;
+        transcript += "\n\n";
+    }
+
+    std::vector<Message> request = {
+        {"system", "You maintain a running summary of a conversation. Keep facts, decisions, "
+                   "names and open questions. Reply with the updated summary only."},
+        {"user", "Current summary:\n" + (previousSummary.empty() ? std::string("(none)") : previousSummary) +
+                 "\n\nNew turns:\n" + transcript + "Write the updated summary."}
+    };
+
+    auto finish = [sharedState = state, generation, foldTo](const std::string& response, bool success) {
+        std::lock_guard<std::mutex> lock(sharedState->mutex);
+
+        // Drop results for a history that has since been cleared
+        if (generation != sharedState->generation) {
+            return;
+        }
+
+        sharedState->compacting = false;
+        if (!success || response.empty()) {
+            return;
+        }
+
+        sharedState->summary = response;
+        sharedState->foldedUpTo = foldTo;
+    };
+
+    try {
+        std::unique_ptr<ApiClient> client = clientFactory();
+        if (!client) {
+            finish("", false);
+            return;
+        }
+        client->sendChatCompletion(request, summaryModel, finish);
+    } catch (const std::exception& e) {
+        std::cerr << "Error compacting history: " << e.what() << std::endl;
+        finish("", false);
+    }
+}
+
+void ContextManager::reset() {
+    std::lock_guard<std::mutex> lock(state->mutex);
+    state->summary.clear();
+    state->foldedUpTo = 1;
+    state->compacting = false;
+    ++state->generation;
+}
+
+std::string ContextManager::getSummary() const {
+    std::lock_guard<std::mutex> lock(state->mutex);
+    return state->summary;
+}
+
+} // namespace libertymind
@@ -1,81 +1,497 @@
 #include "markdown_exporter.h"
-#include <fstream>
+#include "alloc_tracker.h"
+#include "trace.h"
+#include <algorithm>
 #include <iostream>
 #include <ctime>
 #include <iomanip>
 #include <sstream>
+#include <cerrno>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 namespace libertymind {
 
+// Messages fetched per read when exporting through a MessageReader
+static const size_t kExportBatchMessages = 64;
+
+MarkdownStreamWriter::MarkdownStreamWriter(size_t bufferSize)
+    : buffer(bufferSize), used(0), written(0), fd(-1) {}
+
+MarkdownStreamWriter::~MarkdownStreamWriter() {
+    discard();
+}
+
+bool MarkdownStreamWriter::open(const std::string& filePath) {
+    discard();
+
+    // Keep the temporary file on the same filesystem so rename() is atomic
+    targetPath = filePath;
+    std::string pattern = filePath + ".tmp.XXXXXX";
+    std::vector<char> nameBuffer(pattern.begin(), pattern.end());
+    nameBuffer.push_back('\0');
+
+    fd = mkstemp(nameBuffer.data());
+    if (fd < 0) {
+        std::cerr << "Error: Could not open file for writing: " << filePath << std::endl;
+        return false;
+    }
+
+    tempPath = nameBuffer.data();
+    used = 0;
+    written = 0;
+    return true;
+}
+
+bool MarkdownStreamWriter::writeHeader(const Message* systemMessage) {
+    return append(MarkdownExporter::formatHeader(systemMessage));
+}
+
+bool MarkdownStreamWriter::writeMessage(const Message& message) {
+    if (message.role == "system") {
+        return true; // Already handled in the header
+    }
+
+    return append(MarkdownExporter::formatMessageHeading(message.role)) &&
+           append(message.content) &&
+           append("\n\n", 2);
+}
+
+bool MarkdownStreamWriter::writeFooter() {
+    return append(MarkdownExporter::formatFooter());
+}
+
+bool MarkdownStreamWriter::writeRaw(const std::string& text) {
+    return append(text);
+}
+
+bool MarkdownStreamWriter::commit() {
+    if (fd < 0 || !flush()) {
+        discard();
+        return false;
+    }
+
+    // Keep the permissions of a file being replaced; new exports stay private (mkstemp's 0600)
+    struct stat existing;
+    if (stat(targetPath.c_str(), &existing) == 0) {
+        fchmod(fd, existing.st_mode & 07777);
+    }
+
+    // Make sure the data is on disk before it replaces the old file
+    if (fsync(fd) != 0 || close(fd) != 0) {
+        fd = -1;
+        discard();
+        return false;
+    }
+    fd = -1;
+
+    if (rename(tempPath.c_str(), targetPath.c_str()) != 0) {
+        std::cerr << "Error: Could not replace " << targetPath << ": " << strerror(errno) << std::endl;
+        discard();
+        return false;
+    }
+
+    tempPath.clear();
+    return true;
+}
+
+size_t MarkdownStreamWriter::bytesWritten() const {
+    return written;
+}
+
+bool MarkdownStreamWriter::append(const char* data, size_t size) {
+    if (fd < 0) {
+        return false;
+    }
+
+    written += size;
+
+    // Large spans bypass the buffer instead of being copied through it
+    if (size >= buffer.size()) {
+        return flush() && writeAll(data, size);
+    }
+
+    if (used + size > buffer.size() && !flush()) {
+        return false;
+    }
+
+    std::memcpy(buffer.data() + used, data, size);
+    used += size;
+    return true;
+}
+
+bool MarkdownStreamWriter::append(const std::string& text) {
+    return append(text.data(), text.size());
+}
+
+bool MarkdownStreamWriter::flush() {
+    if (used == 0) {
+        return true;
+    }
+
+    bool ok = writeAll(buffer.data(), used);
+    used = 0;
+    return ok;
+}
+
+bool MarkdownStreamWriter::writeAll(const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t n = ::write(fd, data, size);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::cerr << "Error writing Markdown export: " << strerror(errno) << std::endl;
+            return false;
+        }
+        data += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+void MarkdownStreamWriter::discard() {
+    if (fd >= 0) {
+        close(fd);
+        fd = -1;
+    }
+    if (!tempPath.empty()) {
+        unlink(tempPath.c_str());
+        tempPath.clear();
+    }
+    used = 0;
+}
+
+MarkdownAutoExporter::MarkdownAutoExporter()
+    : exportedCount(0), exportedRevision(0), footerOffset(0), fileSize(0), fileModified{} {}
+
+void MarkdownAutoExporter::bind(const std::string& filePath) {
+    std::lock_guard<std::mutex> lock(mutex);
+    path = filePath;
+    exportedCount = 0;
+}
+
+void MarkdownAutoExporter::unbind() {
+    std::lock_guard<std::mutex> lock(mutex);
+    path.clear();
+    exportedCount = 0;
+}
+
+bool MarkdownAutoExporter::isBound() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return !path.empty();
+}
+
+std::string MarkdownAutoExporter::getPath() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return path;
+}
+
+bool MarkdownAutoExporter::update(const std::vector<Message>& messages, uint64_t revision) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (path.empty()) {
+        return false;
+    }
+
+    // Find the system message for the header
+    const Message* system = nullptr;
+    for (const auto& message : messages) {
+        if (message.role == "system") {
+            system = &message;
+            break;
+        }
+    }
+
+    // Anything that invalidates the existing file means starting over: changed
+    // messages (even same-length ones), or the file edited or replaced since
+    struct stat st;
+    bool needsRewrite = exportedCount == 0 ||
+                        revision != exportedRevision ||
+                        messages.size() < exportedCount ||
+                        stat(path.c_str(), &st) != 0 ||
+                        st.st_size != fileSize ||
+                        st.st_mtim.tv_sec != fileModified.tv_sec ||
+                        st.st_mtim.tv_nsec != fileModified.tv_nsec;
+    if (needsRewrite) {
+        return rewrite(messages, system, revision);
+    }
+
+    if (messages.size() == exportedCount) {
+        return true;
+    }
+
+    // Format only the new messages, followed by the footer
+    std::string tail;
+    for (size_t i = exportedCount; i < messages.size(); ++i) {
+        if (messages[i].role == "system") {
+            continue;
+        }
+        tail += MarkdownExporter::formatMessageHeading(messages[i].role);
+        tail += messages[i].content;
+        tail += "\n\n";
+    }
+    off_t newFooterOffset = footerOffset + static_cast<off_t>(tail.size());
+    tail += MarkdownExporter::formatFooter();
+
+    int fd = ::open(path.c_str(), O_WRONLY);
+    if (fd < 0) {
+        return rewrite(messages, system, revision);
+    }
+
+    // Overwrite the old footer in place and trim anything left past the new end
+    const char* data = tail.data();
+    size_t remaining = tail.size();
+    off_t offset = footerOffset;
+    bool ok = true;
+    while (remaining > 0) {
+        ssize_t n = pwrite(fd, data, remaining, offset);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            ok = false;
+            break;
+        }
+        data += n;
+        remaining -= static_cast<size_t>(n);
+        offset += n;
+    }
+    ok = ok && ftruncate(fd, offset) == 0 && recordFileState(fd);
+    close(fd);
+
+    if (!ok) {
+        std::cerr << "Error updating Markdown export: " << strerror(errno) << std::endl;
+        exportedCount = 0;
+        return false;
+    }
+
+    exportedCount = messages.size();
+    footerOffset = newFooterOffset;
+    return true;
+}
+
+bool MarkdownAutoExporter::recordFileState(int fd) {
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        return false;
+    }
+    fileSize = st.st_size;
+    fileModified = st.st_mtim;
+    return true;
+}
+
+bool MarkdownAutoExporter::rewrite(const std::vector<Message>& messages, const Message* system, uint64_t revision) {
+    MarkdownStreamWriter writer;
+    if (!writer.open(path) || !writer.writeHeader(system)) {
+        exportedCount = 0;
+        return false;
+    }
+
+    for (const auto& message : messages) {
+        if (!writer.writeMessage(message)) {
+            exportedCount = 0;
+            return false;
+        }
+    }
+
+    off_t offset = static_cast<off_t>(writer.bytesWritten());
+    if (!writer.writeFooter() || !writer.commit()) {
+        exportedCount = 0;
+        return false;
+    }
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    bool recorded = fd >= 0 && recordFileState(fd);
+    if (fd >= 0) {
+        close(fd);
+    }
+    if (!recorded) {
+        exportedCount = 0;
+        return false;
+    }
+
+    exportedCount = messages.size();
+    exportedRevision = revision;
+    footerOffset = offset;
+    return true;
+}
+
 bool MarkdownExporter::exportChatToMarkdown(const std::vector<Message>& messages, const std::string& filePath) {
+    return exportChatToMarkdown(messages, filePath, nullptr);
+}
+
+bool MarkdownExporter::exportChatToMarkdown(
+    const std::vector<Message>& messages,
+    const std::string& filePath,
+    const ExportProgressCallback& progress
+) {
+    Trace::Span span("export", "export");
+    span.setArg("messages", static_cast<int64_t>(messages.size()));
+    AllocTracker::Scope allocations(AllocTag::EXPORT);
     try {
-        // Generate Markdown content
-        std::string markdownContent = generateMarkdown(messages);
-        
-        // Write to file
-        std::ofstream file(filePath);
-        if (!file.is_open()) {
-            std::cerr << "Error: Could not open file for writing: " << filePath << std::endl;
+        MarkdownStreamWriter writer;
+        if (!writer.open(filePath)) {
             return false;
         }
-        
-        file << markdownContent;
-        file.close();
-        
-        return true;
+
+        // Find the system message for the header
+        const Message* systemMessage = nullptr;
+        for (const auto& message : messages) {
+            if (message.role == "system") {
+                systemMessage = &message;
+                break;
+            }
+        }
+
+        if (!writer.writeHeader(systemMessage)) {
+            return false;
+        }
+
+        // Stream the conversation without building the document in memory
+        for (size_t i = 0; i < messages.size(); ++i) {
+            if (!writer.writeMessage(messages[i])) {
+                return false;
+            }
+            if (progress) {
+                progress(i + 1, messages.size());
+            }
+        }
+
+        return writer.writeFooter() && writer.commit();
     } catch (const std::exception& e) {
         std::cerr << "Error exporting chat to Markdown: " << e.what() << std::endl;
         return false;
     }
 }
 
-std::string MarkdownExporter::generateMarkdown(const std::vector<Message>& messages) {
-    std::stringstream markdown;
-    
+bool MarkdownExporter::exportChatToMarkdown(
+    size_t messageCount,
+    const MessageReader& read,
+    const std::string& filePath,
+    const ExportProgressCallback& progress
+) {
+    Trace::Span span("export", "export");
+    span.setArg("messages", static_cast<int64_t>(messageCount));
+    AllocTracker::Scope allocations(AllocTag::EXPORT);
+    try {
+        std::vector<Message> batch;
+        if (!read(0, std::min(messageCount, kExportBatchMessages), batch)) {
+            return false;
+        }
+
+        MarkdownStreamWriter writer;
+        if (!writer.open(filePath)) {
+            return false;
+        }
+
+        const Message* systemMessage = nullptr;
+        for (const auto& message : batch) {
+            if (message.role == "system") {
+                systemMessage = &message;
+                break;
+            }
+        }
+        if (!writer.writeHeader(systemMessage)) {
+            return false;
+        }
+
+        // Only one batch is held at a time; a short read means the history shrank
+        size_t done = 0;
+        while (true) {
+            for (const auto& message : batch) {
+                if (!writer.writeMessage(message)) {
+                    return false;
+                }
+                ++done;
+                if (progress) {
+                    progress(done, messageCount);
+                }
+            }
+            if (done >= messageCount || batch.empty()) {
+                break;
+            }
+            if (!read(done, std::min(messageCount - done, kExportBatchMessages), batch)) {
+                return false;
+            }
+        }
+
+        return done == messageCount && writer.writeFooter() && writer.commit();
+    } catch (const std::exception& e) {
+        std::cerr << "Error exporting chat to Markdown: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+std::string MarkdownExporter::formatHeader(const Message* systemMessage) {
+    std::string header;
+
     // Add title and timestamp
     auto t = std::time(nullptr);
     auto tm = *std::localtime(&t);
     std::ostringstream timeStr;
     timeStr << std::put_time(&tm, "%Y-%m-%d %H:%M:%S");
-    
-    markdown << "# Synthara Chat Session\n\n";
-    markdown << "Date: " << timeStr.str() << "\n\n";
-    
+
+    header += "# Synthara Chat Session\n\n";
+    header += "Date: " + timeStr.str() + "\n\n";
+
     // Add system message if present
-    bool hasSystemMessage = false;
+    if (systemMessage) {
+        header += "## System Instructions\n\n";
+        header += systemMessage->content + "\n\n";
+    }
+
+    // Add conversation
+    header += "## Conversation\n\n";
+    return header;
+}
+
+std::string MarkdownExporter::formatMessageHeading(const std::string& role) {
+    if (role == "user") {
+        return "### User\n\n";
+    } else if (role == "assistant") {
+        return "### Assistant\n\n";
+    }
+    return "### " + role + "\n\n";
+}
+
+std::string MarkdownExporter::formatFooter() {
+    return "---\nGenerated by Synthara - A terminal-based LLM interface\n";
+}
+
+std::string MarkdownExporter::generateMarkdown(const std::vector<Message>& messages) {
+    Trace::Span span("generateMarkdown", "export");
+    AllocTracker::Scope allocations(AllocTag::EXPORT);
+    std::string markdown;
+
+    // Find the system message for the header
+    const Message* systemMessage = nullptr;
     for (const auto& message : messages) {
         if (message.role == "system") {
-            markdown << "## System Instructions\n\n";
-            markdown << message.content << "\n\n";
-            hasSystemMessage = true;
+            systemMessage = &message;
             break;
         }
     }
-    
-    // Add conversation
-    markdown << "## Conversation\n\n";
+
+    markdown += formatHeader(systemMessage);
     
     for (const auto& message : messages) {
         if (message.role == "system") {
             continue; // Already handled above
         }
         
-        if (message.role == "user") {
-            markdown << "### User\n\n";
-        } else if (message.role == "assistant") {
-            markdown << "### Assistant\n\n";
-        } else {
-            markdown << "### " << message.role << "\n\n";
-        }
-        
-        markdown << message.content << "\n\n";
+        markdown += formatMessageHeading(message.role);
+        markdown += message.content;
+        markdown += "\n\n";
     }
     
     // Add footer
-    markdown << "---\n";
-    markdown << "Generated by Synthara - A terminal-based LLM interface\n";
+    markdown += formatFooter();
     
-    return markdown.str();
+    return markdown;
 }
 
 bool MarkdownExporter::generateSampleMarkdown(const std::string& filePath) {
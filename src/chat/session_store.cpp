@@ -0,0 +1,111 @@
+#include "session_store.h"
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <atomic>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <unistd.h>
+
+using json = nlohmann::json;
+namespace fs = std::filesystem;
+
+namespace libertymind {
+
+SessionStore::SessionStore(const fs::path& directory) : directory(directory) {
+    beginSession();
+}
+
+fs::path SessionStore::defaultDirectory() {
+    const char* homeDir = getenv("HOME");
+    if (homeDir) {
+        return fs::path(homeDir) / ".libertymind" / "sessions";
+    }
+    return fs::path(".libertymind") / "sessions";
+}
+
+void SessionStore::beginSession() {
+    static std::atomic<unsigned> counter{0};
+
+    // Name sessions by start time so they sort chronologically
+    auto t = std::time(nullptr);
+    auto tm = *std::localtime(&t);
+    std::ostringstream name;
+    name << std::put_time(&tm, "%Y%m%d-%H%M%S") << "-" << getpid() << "-" << counter++ << ".jsonl";
+
+    currentPath = directory / name.str();
+}
+
+bool SessionStore::append(const Message& message) {
+    try {
+        if (!fs::exists(directory)) {
+            fs::create_directories(directory);
+        }
+
+        std::ofstream file(currentPath, std::ios::app);
+        if (!file.is_open()) {
+            return false;
+        }
+
+        file << json({{"role", message.role}, {"content", message.content}}).dump() << '\n';
+        return file.good();
+    } catch (const std::exception& e) {
+        std::cerr << "Error saving session: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+fs::path SessionStore::getCurrentPath() const {
+    return currentPath;
+}
+
+std::vector<SessionInfo> SessionStore::listSessions(const fs::path& directory) {
+    std::vector<SessionInfo> sessions;
+
+    std::error_code ec;
+    for (const auto& entry : fs::directory_iterator(directory, ec)) {
+        if (!entry.is_regular_file(ec) || entry.path().extension() != ".jsonl") {
+            continue;
+        }
+        sessions.push_back({entry.path().stem().string(), entry.path(), entry.file_size(ec)});
+    }
+
+    std::sort(sessions.begin(), sessions.end(), [](const SessionInfo& a, const SessionInfo& b) {
+        return a.id < b.id;
+    });
+    return sessions;
+}
+
+bool SessionStore::readSession(const fs::path& path, const std::function<bool(const Message&)>& visitor) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    std::string line;
+    Message message;
+    while (std::getline(file, line)) {
+        if (line.empty()) {
+            continue;
+        }
+
+        try {
+            json record = json::parse(line);
+            message.role = record.value("role", "user");
+            message.content = record.value("content", "");
+        } catch (const std::exception& e) {
+            // Skip a torn last line from a crash mid-append
+            continue;
+        }
+
+        if (!visitor(message)) {
+            break;
+        }
+    }
+
+    return true;
+}
+
+} // namespace libertymind
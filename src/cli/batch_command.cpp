@@ -0,0 +1,227 @@
+#include "cli_commands.h"
+#include "batch_runner.h"
+#include "metrics.h"
+#include <cerrno>
+#include <cmath>
+#include <csignal>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+
+namespace libertymind {
+
+// Set by SIGINT/SIGTERM; the progress callback turns it into BatchRunner::interrupt()
+static volatile std::sig_atomic_t stopRequested = 0;
+
+static void handleStopSignal(int) {
+    stopRequested = 1;
+}
+
+static void printBatchUsage() {
+    std::cerr << "Usage: synthara batch [INPUT] [--out FILE] [--concurrency N] [--rps R] [--unordered]" << std::endl;
+    std::cerr << "                      [--resume] [--retries N] [--model ID] [--provider NAME] [--async]" << std::endl;
+    std::cerr << "                      [--metrics ADDR]" << std::endl;
+    std::cerr << "  INPUT            JSONL requests, one object per line (default: requests.jsonl)" << std::endl;
+    std::cerr << "  --out FILE       Results as JSONL (default: INPUT with .results.jsonl)" << std::endl;
+    std::cerr << "  --concurrency N  Requests in flight at once (default: 8)" << std::endl;
+    std::cerr << "  --rps R          Start at most R requests per second (default: no limit)" << std::endl;
+    std::cerr << "  --unordered      Write results as they complete instead of in input order" << std::endl;
+    std::cerr << "  --resume         Continue an interrupted run from its checkpoint" << std::endl;
+    std::cerr << "  --retries N      Retries for 429, 5xx and connection errors (default: 3)" << std::endl;
+    std::cerr << "  --model ID       Model for lines that don't name one (default: configured model)" << std::endl;
+    std::cerr << "  --provider NAME  Provider to use: google or openai" << std::endl;
+    std::cerr << "  --async          Submit a provider-side batch job (Gemini Batch API) and wait for it" << std::endl;
+    std::cerr << "  --metrics ADDR   Serve OpenMetrics at /metrics on unix:PATH, a loopback HOST:PORT or PORT" << std::endl;
+    std::cerr << "Each line: {\"id\": ..., \"prompt\": \"...\"} or {\"messages\": [{\"role\": ..., \"content\": ...}]}," << std::endl;
+    std::cerr << "optionally with \"system\", \"model\" and \"max_output_tokens\"." << std::endl;
+}
+
+// A whole number of at least minimum, with nothing after it
+static bool parseCount(const char* text, unsigned long minimum, unsigned long& value) {
+    errno = 0;
+    char* end = nullptr;
+    value = std::strtoul(text, &end, 10);
+    return errno == 0 && end != text && *end == '\0' && text[0] != '-' && value >= minimum;
+}
+
+// A finite, non-negative rate, with nothing after it
+static bool parseRate(const char* text, double& value) {
+    errno = 0;
+    char* end = nullptr;
+    value = std::strtod(text, &end);
+    return errno == 0 && end != text && *end == '\0' && std::isfinite(value) && value >= 0.0;
+}
+
+static std::string formatProgress(const BatchProgress& progress) {
+    std::ostringstream line;
+    line << progress.completed << "/" << progress.total << " done (" << progress.failed << " failed, "
+         << progress.inFlight << " in flight) | "
+         << std::fixed << std::setprecision(1)
+         << progress.requestsPerSecond << " req/s | "
+         << progress.tokensPerSecond << " tok/s | "
+         << std::setprecision(2)
+         << "p50 " << progress.p50Seconds << "s p90 " << progress.p90Seconds
+         << "s p99 " << progress.p99Seconds << "s";
+    if (!progress.status.empty()) {
+        line << " | " << progress.status;
+    }
+    return line.str();
+}
+
+int runBatchCommand(int argc, char** argv) {
+    BatchOptions options;
+    std::string provider;
+
+    // Parse arguments after the "batch" subcommand
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "--out" && hasValue) {
+            options.outputPath = argv[++i];
+        } else if ((arg == "--concurrency" || arg == "-j") && hasValue) {
+            unsigned long concurrency;
+            if (!parseCount(argv[++i], 1, concurrency)) {
+                std::cerr << "Error: " << arg << " needs a whole number of at least 1, got " << argv[i] << std::endl;
+                return 2;
+            }
+            options.concurrency = concurrency;
+        } else if (arg == "--rps" && hasValue) {
+            if (!parseRate(argv[++i], options.requestsPerSecond)) {
+                std::cerr << "Error: --rps needs a non-negative number, got " << argv[i] << std::endl;
+                return 2;
+            }
+        } else if (arg == "--unordered") {
+            options.ordered = false;
+        } else if (arg == "--resume") {
+            options.resume = true;
+        } else if (arg == "--retries" && hasValue) {
+            unsigned long retries;
+            if (!parseCount(argv[++i], 0, retries) || retries > 100) {
+                std::cerr << "Error: --retries needs a whole number from 0 to 100, got " << argv[i] << std::endl;
+                return 2;
+            }
+            options.maxRetries = static_cast<int>(retries);
+        } else if (arg == "--model" && hasValue) {
+            options.model = argv[++i];
+        } else if (arg == "--async") {
+            options.providerJobs = true;
+        } else if (arg == "--provider" && hasValue) {
+            provider = argv[++i];
+        } else if (arg == "--metrics" && hasValue) {
+            std::string error;
+            if (!MetricsServer::start(argv[++i], error)) {
+                std::cerr << "Error: " << error << std::endl;
+                return 2;
+            }
+        } else if (arg == "--help" || arg == "-h") {
+            printBatchUsage();
+            return 0;
+        } else if (arg[0] != '-' && options.inputPath.empty()) {
+            options.inputPath = arg;
+        } else {
+            std::cerr << "Error: Unknown argument: " << arg << std::endl;
+            printBatchUsage();
+            return 2;
+        }
+    }
+
+    if (options.inputPath.empty()) {
+        options.inputPath = "requests.jsonl";
+    }
+    if (options.outputPath.empty()) {
+        std::filesystem::path output = options.inputPath;
+        options.outputPath = output.replace_extension(".results.jsonl");
+    }
+    options.checkpointPath = options.outputPath.string() + ".checkpoint";
+
+    // Overrides apply to this run only
+    auto configManager = std::make_shared<ConfigManager>();
+    configManager->setReadOnly(true);
+    if (provider == "google" || provider == "openai") {
+        configManager->setSelectedProvider(ConfigManager::stringToProvider(provider));
+    } else if (!provider.empty()) {
+        std::cerr << "Error: Unknown provider: " << provider << std::endl;
+        return 2;
+    }
+
+    Provider selected = configManager->getSelectedProvider();
+    if (ConfigManager::requiresApiKey(selected) && configManager->getApiKeys(selected).empty()) {
+        std::cerr << "Error: No API key configured for " << ConfigManager::providerToString(selected)
+                  << ". Run synthara without arguments to set one." << std::endl;
+        return 3;
+    }
+
+    // Finish in-flight requests and checkpoint on Ctrl-C; a second Ctrl-C exits at once
+    struct sigaction action = {};
+    action.sa_handler = handleStopSignal;
+    action.sa_flags = SA_RESETHAND;
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+
+    BatchRunner runner(configManager, options);
+    bool interactive = isatty(STDERR_FILENO);
+    int reports = 0;
+    bool ok = runner.run([&](const BatchProgress& progress) {
+        if (stopRequested && !runner.wasInterrupted()) {
+            std::cerr << (interactive ? "\n" : "") << "Stopping after requests in flight finish..." << std::endl;
+            runner.interrupt();
+        }
+
+        // Redraw one status line on a terminal; log every ten seconds otherwise
+        if (interactive) {
+            std::cerr << "\r" << formatProgress(progress) << "\033[K" << std::flush;
+        } else if (++reports % 10 == 0) {
+            std::cerr << formatProgress(progress) << std::endl;
+        }
+    });
+    if (interactive) {
+        std::cerr << std::endl;
+    }
+
+    if (!ok) {
+        std::cerr << "Error: " << runner.getError() << std::endl;
+        return 2;
+    }
+    if (!runner.getError().empty()) {
+        std::cerr << "Error: " << runner.getError() << std::endl;
+    }
+
+    BatchProgress progress = runner.getProgress();
+    std::cout << formatProgress(progress) << std::endl;
+    std::cout << "Results: " << options.outputPath.string() << std::endl;
+
+    if (runner.wasInterrupted()) {
+        // Repeat every setting of this run, so the resumed one behaves the same whatever the config says by then
+        BatchOptions defaults;
+        std::ostringstream command;
+        command << "synthara batch " << options.inputPath.string() << " --out " << options.outputPath.string()
+                << " --provider " << ConfigManager::providerToString(selected);
+        if (options.concurrency != defaults.concurrency) {
+            command << " --concurrency " << options.concurrency;
+        }
+        if (options.requestsPerSecond != defaults.requestsPerSecond) {
+            command << " --rps " << options.requestsPerSecond;
+        }
+        if (!options.ordered) {
+            command << " --unordered";
+        }
+        if (options.maxRetries != defaults.maxRetries) {
+            command << " --retries " << options.maxRetries;
+        }
+        if (!options.model.empty()) {
+            command << " --model " << options.model;
+        }
+        if (options.providerJobs) {
+            command << " --async";
+        }
+        std::cout << "Interrupted; continue with: " << command.str() << " --resume" << std::endl;
+        return runner.getError().empty() ? 130 : 1;
+    }
+    return progress.failed == 0 ? 0 : 1;
+}
+
+} // namespace libertymind
@@ -0,0 +1,82 @@
+#include "cli_commands.h"
+#include "bulk_exporter.h"
+#include "session_store.h"
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+namespace fs = std::filesystem;
+
+namespace libertymind {
+
+static void printExportUsage() {
+    std::cerr << "Usage: synthara export --all [--format md|jsonl] [--jobs N] [--out DIR] [--sessions DIR]" << std::endl;
+    std::cerr << "  --all           Export every saved session" << std::endl;
+    std::cerr << "  --format FMT    Output format: md (default) or jsonl" << std::endl;
+    std::cerr << "  --jobs N        Number of parallel workers (default: one per core)" << std::endl;
+    std::cerr << "  --out DIR       Output directory (default: ./synthara-export)" << std::endl;
+    std::cerr << "  --sessions DIR  Session directory (default: ~/.libertymind/sessions)" << std::endl;
+}
+
+int runExportCommand(int argc, char** argv) {
+    BulkExportOptions options;
+    options.sessionDirectory = SessionStore::defaultDirectory();
+    options.outputDirectory = "synthara-export";
+    bool all = false;
+
+    // Parse arguments after the "export" subcommand
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "--all") {
+            all = true;
+        } else if (arg == "--format" && hasValue) {
+            std::string format = argv[++i];
+            if (format == "md" || format == "markdown") {
+                options.format = ExportFormat::MARKDOWN;
+            } else if (format == "jsonl") {
+                options.format = ExportFormat::JSONL;
+            } else {
+                std::cerr << "Error: Unknown format: " << format << std::endl;
+                return 2;
+            }
+        } else if (arg == "--jobs" && hasValue) {
+            options.jobs = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--out" && hasValue) {
+            options.outputDirectory = argv[++i];
+        } else if (arg == "--sessions" && hasValue) {
+            options.sessionDirectory = argv[++i];
+        } else if (arg == "--help" || arg == "-h") {
+            printExportUsage();
+            return 0;
+        } else {
+            std::cerr << "Error: Unknown argument: " << arg << std::endl;
+            printExportUsage();
+            return 2;
+        }
+    }
+
+    if (!all) {
+        printExportUsage();
+        return 2;
+    }
+
+    BulkExportStats stats = BulkExporter::exportAll(options);
+
+    // Report throughput
+    double seconds = std::max(stats.seconds, 1e-9);
+    double megabytes = stats.bytesRead / (1024.0 * 1024.0);
+    std::cout << "Exported " << stats.sessions << " sessions to " << options.outputDirectory.string()
+              << " (" << stats.failed << " failed)" << std::endl;
+    std::cout << std::fixed << std::setprecision(2)
+              << stats.seconds << " s, "
+              << stats.sessions / seconds << " sessions/s, "
+              << megabytes / seconds << " MB/s read, "
+              << (stats.bytesWritten / (1024.0 * 1024.0)) / seconds << " MB/s written" << std::endl;
+
+    return stats.failed == 0 ? 0 : 1;
+}
+
+} // namespace libertymind
@@ -0,0 +1,171 @@
+#include "cli_commands.h"
+#include "alloc_tracker.h"
+#include "chat_session.h"
+#include "config_manager.h"
+#include "model_registry.h"
+#include "trace.h"
+#include <future>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <unistd.h>
+
+namespace libertymind {
+
+static void printPromptUsage() {
+    std::cerr << "Usage: synthara -p PROMPT [--model ID] [--provider NAME] [--system TEXT] [--no-save]" << std::endl;
+    std::cerr << "                [--trace FILE] [--alloc-report FILE]" << std::endl;
+    std::cerr << "       COMMAND | synthara [-p PROMPT] [options]" << std::endl;
+    std::cerr << "  -p, --prompt TEXT  Prompt to send (\"-\" reads it from stdin)" << std::endl;
+    std::cerr << "  -m, --model ID     Model to use instead of the configured one" << std::endl;
+    std::cerr << "  --provider NAME    Provider to use: google or openai" << std::endl;
+    std::cerr << "  -s, --system TEXT  System message" << std::endl;
+    std::cerr << "  --no-save          Don't save this exchange as a session" << std::endl;
+    std::cerr << "  --trace FILE       Write a Chrome trace of the request to FILE" << std::endl;
+    std::cerr << "  --alloc-report FILE  Write allocation counters to FILE (with SYNTHARA_TRACK_ALLOCATIONS=1)" << std::endl;
+    std::cerr << "Piped input is sent after the -p text. The reply streams to stdout." << std::endl;
+    std::cerr << "Exit status: 0 success, 1 request failed, 2 usage error, 3 not configured" << std::endl;
+}
+
+int runPromptCommand(int argc, char** argv) {
+    std::string prompt;
+    bool havePrompt = false;
+    std::string model;
+    std::string provider;
+    std::string systemMessage;
+    bool noSave = false;
+    std::string tracePath;
+    std::string allocReportPath;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if ((arg == "-p" || arg == "--prompt") && hasValue) {
+            prompt = argv[++i];
+            havePrompt = prompt != "-";
+            if (!havePrompt) {
+                prompt.clear();
+            }
+        } else if (arg == "-p" || arg == "--prompt") {
+            // Bare -p: the prompt comes from stdin
+        } else if ((arg == "-m" || arg == "--model") && hasValue) {
+            model = argv[++i];
+        } else if (arg == "--provider" && hasValue) {
+            provider = argv[++i];
+        } else if ((arg == "-s" || arg == "--system") && hasValue) {
+            systemMessage = argv[++i];
+        } else if (arg == "--no-save") {
+            noSave = true;
+        } else if (arg == "--trace" && hasValue) {
+            tracePath = argv[++i];
+        } else if (arg == "--alloc-report" && hasValue) {
+            allocReportPath = argv[++i];
+        } else if (arg == "--trace-startup") {
+            // Only meaningful for the interactive UI
+        } else if (arg == "--help" || arg == "-h") {
+            printPromptUsage();
+            return 0;
+        } else {
+            std::cerr << "Error: Unknown argument: " << arg << std::endl;
+            printPromptUsage();
+            return 2;
+        }
+    }
+
+    // Piped input is the prompt, or material for the -p instruction
+    if (!isatty(STDIN_FILENO)) {
+        std::string input((std::istreambuf_iterator<char>(std::cin)), std::istreambuf_iterator<char>());
+        if (!input.empty()) {
+            prompt = havePrompt ? prompt + "\n\n" + input : input;
+        }
+    }
+
+    if (prompt.find_first_not_of(" \t\r\n") == std::string::npos) {
+        std::cerr << "Error: Empty prompt" << std::endl;
+        printPromptUsage();
+        return 2;
+    }
+
+    // Command-line overrides apply to this run only
+    auto configManager = std::make_shared<ConfigManager>();
+    configManager->setReadOnly(true);
+
+    if (provider == "google" || provider == "openai") {
+        configManager->setSelectedProvider(ConfigManager::stringToProvider(provider));
+    } else if (!provider.empty()) {
+        std::cerr << "Error: Unknown provider: " << provider << std::endl;
+        return 2;
+    }
+    if (!model.empty()) {
+        configManager->setSelectedModel(model);
+    }
+    if (noSave) {
+        configManager->setSaveSessions(false);
+    }
+
+    Provider selected = configManager->getSelectedProvider();
+    if (ConfigManager::requiresApiKey(selected) && configManager->getApiKeys(selected).empty()) {
+        std::cerr << "Error: No API key configured for " << ConfigManager::providerToString(selected)
+                  << ". Run synthara without arguments to set one." << std::endl;
+        return 3;
+    }
+
+    if (!tracePath.empty()) {
+        Trace::enable();
+        Trace::setThreadName("main");
+    }
+
+    ChatSession session(configManager);
+    session.setModelRegistry(std::make_shared<ModelRegistry>());
+    session.setCalibrationEnabled(false);
+    if (!systemMessage.empty()) {
+        session.setSystemMessage(systemMessage);
+    }
+
+    // Print the reply as it streams; the session calls back on the network loop
+    bool streamed = false;
+    bool endsWithNewline = false;
+    session.setStreamCallback([&](const std::string& chunk) {
+        std::cout << chunk << std::flush;
+        streamed = true;
+        endsWithNewline = chunk.back() == '\n';
+    });
+
+    std::promise<std::pair<std::string, bool>> done;
+    std::future<std::pair<std::string, bool>> reply = done.get_future();
+    session.sendMessage(prompt, [&done](const std::string& response, bool success) {
+        done.set_value({response, success});
+    });
+
+    auto [response, success] = reply.get();
+    std::string traceError;
+    if (!tracePath.empty() && !Trace::write(tracePath, traceError)) {
+        std::cerr << "Warning: " << traceError << std::endl;
+    }
+    if (!allocReportPath.empty() && !AllocTracker::writeReport(allocReportPath, traceError)) {
+        std::cerr << "Warning: " << traceError << std::endl;
+    }
+
+    if (!success) {
+        if (streamed) {
+            std::cout << std::endl;
+        }
+        std::cerr << response << std::endl;
+        return 1;
+    }
+
+    // Providers that answered in one piece print it now
+    if (!streamed) {
+        std::cout << response;
+        endsWithNewline = !response.empty() && response.back() == '\n';
+    }
+    if (!endsWithNewline) {
+        std::cout << '\n';
+    }
+    std::cout.flush();
+    return std::cout ? 0 : 1;
+}
+
+} // namespace libertymind
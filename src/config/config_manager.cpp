@@ -1,17 +1,83 @@
 #include "config_manager.h"
 #include <nlohmann/json.hpp>
+#include <algorithm>
 #include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <cerrno>
+#include <climits>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
 
 using json = nlohmann::json;
 namespace fs = std::filesystem;
 
 namespace libertymind {
 
-ConfigManager::ConfigManager() : selectedProvider(Provider::GOOGLE), selectedModel("gemini-2.0-flash-lite") {
+// Coalesce bursts of setter calls into one write
+static const std::chrono::milliseconds kFlushDelay(250);
+
+ConfigManager::Settings::Settings()
+    : selectedProvider(Provider::GOOGLE),
+      selectedModel("gemini-2.0-flash-lite"),
+      contextTokenBudget(32000),
+      contextRecentTurns(6),
+      summaryModel("gemini-2.0-flash-lite"),
+      contextCacheMinTokens(4096),
+      contextCacheTtlSeconds(3600),
+      endpoints({
+          {Provider::GOOGLE, {"https://generativelanguage.googleapis.com"}},
+          {Provider::OPENAI_COMPATIBLE, {"http://127.0.0.1:8080"}}
+      }),
+      autoModelTiers({"gemini-2.0-flash-lite", "gemini-2.0-flash", "gemini-2.5-flash"}),
+      saveSessions(false) {
+}
+
+ConfigManager::ConfigManager()
+    : dirty(false),
+      stopping(false),
+      readOnly(false),
+      inotifyFd(-1),
+      wakePipe{-1, -1},
+      reloadCount(0) {
     initConfigPath();
     loadConfig();
 }
 
+ConfigManager::~ConfigManager() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    flushCondition.notify_all();
+    if (flushThread.joinable()) {
+        flushThread.join();
+    }
+
+    // Wake the watcher so it can exit
+    if (watchThread.joinable()) {
+        char byte = 0;
+        ssize_t ignored = write(wakePipe[1], &byte, 1);
+        (void)ignored;
+        watchThread.join();
+    }
+    if (inotifyFd >= 0) {
+        close(inotifyFd);
+    }
+    if (wakePipe[0] >= 0) {
+        close(wakePipe[0]);
+        close(wakePipe[1]);
+    }
+
+    // Don't lose changes made within the last debounce window
+    flush();
+}
+
 void ConfigManager::initConfigPath() {
     // Create config directory in user's home directory
     const char* homeDir = getenv("HOME");
@@ -25,67 +91,449 @@ void ConfigManager::initConfigPath() {
     }
 }
 
+// Key text without the whitespace a paste tends to bring along
+static std::string trimKey(const std::string& key) {
+    size_t begin = key.find_first_not_of(" \t\r\n");
+    if (begin == std::string::npos) {
+        return "";
+    }
+    size_t end = key.find_last_not_of(" \t\r\n");
+    return key.substr(begin, end - begin + 1);
+}
+
 bool ConfigManager::setApiKey(Provider provider, const std::string& key) {
-    apiKeys[provider] = key;
-    return saveConfig();
+    std::string trimmed = trimKey(key);
+    if (!isValidApiKey(trimmed)) {
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        settings.apiKeys[provider] = {trimmed};
+    }
+    markDirty();
+    return true;
 }
 
 std::optional<std::string> ConfigManager::getApiKey(Provider provider) const {
-    auto it = apiKeys.find(provider);
-    if (it != apiKeys.end()) {
-        return it->second;
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = settings.apiKeys.find(provider);
+    if (it != settings.apiKeys.end() && !it->second.empty()) {
+        return it->second.front();
     }
     return std::nullopt;
 }
 
+bool ConfigManager::addApiKey(Provider provider, const std::string& key) {
+    std::string trimmed = trimKey(key);
+    if (!isValidApiKey(trimmed)) {
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::vector<std::string>& keys = settings.apiKeys[provider];
+        if (std::find(keys.begin(), keys.end(), trimmed) != keys.end()) {
+            return false;
+        }
+        keys.push_back(trimmed);
+    }
+    markDirty();
+    return true;
+}
+
+std::vector<std::string> ConfigManager::getApiKeys(Provider provider) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = settings.apiKeys.find(provider);
+    if (it != settings.apiKeys.end()) {
+        return it->second;
+    }
+    return {};
+}
+
 void ConfigManager::setSelectedProvider(Provider provider) {
-    selectedProvider = provider;
-    saveConfig();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        settings.selectedProvider = provider;
+    }
+    markDirty();
 }
 
 Provider ConfigManager::getSelectedProvider() const {
-    return selectedProvider;
+    std::lock_guard<std::mutex> lock(mutex);
+    return settings.selectedProvider;
 }
 
 void ConfigManager::setSelectedModel(const std::string& model) {
-    selectedModel = model;
-    saveConfig();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        settings.selectedModel = model;
+    }
+    markDirty();
 }
 
 std::string ConfigManager::getSelectedModel() const {
-    return selectedModel;
+    std::lock_guard<std::mutex> lock(mutex);
+    return settings.selectedModel;
 }
 
-bool ConfigManager::saveConfig() const {
-    try {
-        json config;
+void ConfigManager::setContextTokenBudget(size_t tokens) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        settings.contextTokenBudget = tokens;
+    }
+    markDirty();
+}
+
+size_t ConfigManager::getContextTokenBudget() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return settings.contextTokenBudget;
+}
+
+void ConfigManager::setContextRecentTurns(size_t turns) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        settings.contextRecentTurns = turns;
+    }
+    markDirty();
+}
+
+size_t ConfigManager::getContextRecentTurns() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return settings.contextRecentTurns;
+}
+
+void ConfigManager::setSummaryModel(const std::string& model) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        settings.summaryModel = model;
+    }
+    markDirty();
+}
+
+std::string ConfigManager::getSummaryModel() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return settings.summaryModel;
+}
+
+void ConfigManager::setContextCacheMinTokens(size_t tokens) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        settings.contextCacheMinTokens = tokens;
+    }
+    markDirty();
+}
 
-        // Save provider and model selection
-        config["selected_provider"] = providerToString(selectedProvider);
-        config["selected_model"] = selectedModel;
+size_t ConfigManager::getContextCacheMinTokens() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return settings.contextCacheMinTokens;
+}
+
+void ConfigManager::setContextCacheTtlSeconds(int seconds) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        settings.contextCacheTtlSeconds = seconds;
+    }
+    markDirty();
+}
+
+int ConfigManager::getContextCacheTtlSeconds() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return settings.contextCacheTtlSeconds;
+}
+
+void ConfigManager::setEndpoints(Provider provider, const std::vector<std::string>& urls) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        settings.endpoints[provider] = urls;
+    }
+    markDirty();
+}
+
+std::vector<std::string> ConfigManager::getEndpoints(Provider provider) const {
+    // An environment override points every client at a mock or proxy without touching the config
+    const char* baseUrl = getenv(provider == Provider::GOOGLE ? "SYNTHARA_GOOGLE_BASE_URL" : "SYNTHARA_OPENAI_BASE_URL");
+    if (baseUrl && *baseUrl) {
+        return {baseUrl};
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = settings.endpoints.find(provider);
+    if (it != settings.endpoints.end()) {
+        return it->second;
+    }
+    return {};
+}
+
+void ConfigManager::setAutoModelTiers(const std::vector<std::string>& models) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        settings.autoModelTiers = models;
+    }
+    markDirty();
+}
+
+std::vector<std::string> ConfigManager::getAutoModelTiers() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return settings.autoModelTiers;
+}
+
+void ConfigManager::setSaveSessions(bool enabled) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        settings.saveSessions = enabled;
+    }
+    markDirty();
+}
+
+bool ConfigManager::getSaveSessions() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return settings.saveSessions;
+}
+
+void ConfigManager::markDirty() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (readOnly) {
+            return;
+        }
+        dirty = true;
+        lastChange = std::chrono::steady_clock::now();
+
+        // Start the background writer on first use
+        if (!flushThread.joinable() && !stopping) {
+            flushThread = std::thread(&ConfigManager::flushLoop, this);
+        }
+    }
+    flushCondition.notify_all();
+}
+
+void ConfigManager::flushLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        flushCondition.wait(lock, [this]() { return dirty || stopping; });
+        if (stopping) {
+            break;
+        }
+
+        // Wait until changes have settled
+        auto due = lastChange + kFlushDelay;
+        if (std::chrono::steady_clock::now() < due) {
+            flushCondition.wait_until(lock, due);
+            continue;
+        }
+
+        dirty = false;
+        lock.unlock();
+        saveConfig();
+        lock.lock();
+    }
+}
+
+void ConfigManager::setReadOnly(bool enabled) {
+    std::lock_guard<std::mutex> lock(mutex);
+    readOnly = enabled;
+}
+
+bool ConfigManager::flush() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!dirty) {
+            return true;
+        }
+        dirty = false;
+    }
+    return saveConfig();
+}
+
+json ConfigManager::toJson() const {
+    json config;
 
-        // Save API keys (in a real app, these should be encrypted)
-        json keys;
-        for (const auto& [provider, key] : apiKeys) {
+    // Save provider and model selection
+    config["selected_provider"] = providerToString(settings.selectedProvider);
+    config["selected_model"] = settings.selectedModel;
+
+    // Save context window settings
+    config["context_token_budget"] = settings.contextTokenBudget;
+    config["context_recent_turns"] = settings.contextRecentTurns;
+    config["summary_model"] = settings.summaryModel;
+    config["context_cache_min_tokens"] = settings.contextCacheMinTokens;
+    config["context_cache_ttl_seconds"] = settings.contextCacheTtlSeconds;
+    for (const auto& [provider, urls] : settings.endpoints) {
+        config["endpoints"][providerToString(provider)] = urls;
+    }
+    config["auto_model_tiers"] = settings.autoModelTiers;
+    config["save_sessions"] = settings.saveSessions;
+
+    // Save API keys (in a real app, these should be encrypted)
+    // A single key is stored as a string, a pool as an array
+    json keys;
+    for (const auto& [provider, pool] : settings.apiKeys) {
+        json encryptedKeys = json::array();
+        for (const auto& key : pool) {
             std::string encryptedKey = key;
             encryptApiKey(encryptedKey);
-            keys[providerToString(provider)] = encryptedKey;
+            encryptedKeys.push_back(encryptedKey);
         }
-        config["api_keys"] = keys;
+        if (encryptedKeys.size() == 1) {
+            keys[providerToString(provider)] = encryptedKeys[0];
+        } else if (!encryptedKeys.empty()) {
+            keys[providerToString(provider)] = encryptedKeys;
+        }
+    }
+    config["api_keys"] = keys;
 
-        // Write to file
-        std::ofstream file(configPath);
-        if (!file.is_open()) {
-            return false;
+    return config;
+}
+
+// A whole number of at least minimum and at most maximum
+static int64_t readInteger(const json& config, const char* name, int64_t minimum, int64_t maximum) {
+    const json& value = config.at(name);
+    if (!value.is_number_integer()) {
+        throw std::runtime_error(std::string(name) + " must be a whole number");
+    }
+    bool inRange = value.is_number_unsigned()
+        ? value.get<uint64_t>() <= static_cast<uint64_t>(maximum)
+        : value.get<int64_t>() >= minimum && value.get<int64_t>() <= maximum;
+    if (!inRange) {
+        throw std::runtime_error(std::string(name) + " is out of range");
+    }
+    return value.get<int64_t>();
+}
+
+ConfigManager::Settings ConfigManager::parseJson(const json& config) const {
+    // Settings missing from the file keep their defaults, so removing one resets it
+    Settings parsed;
+
+    // Load provider and model selection
+    if (config.contains("selected_provider")) {
+        parsed.selectedProvider = stringToProvider(config["selected_provider"].get<std::string>());
+    }
+
+    if (config.contains("selected_model")) {
+        parsed.selectedModel = config["selected_model"].get<std::string>();
+    }
+
+    // Load context window settings
+    if (config.contains("context_token_budget")) {
+        parsed.contextTokenBudget = readInteger(config, "context_token_budget", 1, INT64_MAX);
+    }
+
+    if (config.contains("context_recent_turns")) {
+        parsed.contextRecentTurns = readInteger(config, "context_recent_turns", 0, INT64_MAX);
+    }
+
+    if (config.contains("summary_model")) {
+        parsed.summaryModel = config["summary_model"].get<std::string>();
+    }
+
+    // Load prefix caching settings
+    if (config.contains("context_cache_min_tokens")) {
+        parsed.contextCacheMinTokens = readInteger(config, "context_cache_min_tokens", 0, INT64_MAX);
+    }
+
+    if (config.contains("context_cache_ttl_seconds")) {
+        parsed.contextCacheTtlSeconds = readInteger(config, "context_cache_ttl_seconds", 1, INT_MAX);
+    }
+
+    // Providers listed replace their default endpoints
+    if (config.contains("endpoints")) {
+        if (!config["endpoints"].is_object()) {
+            throw std::runtime_error("endpoints must map providers to URL lists");
         }
-        file << config.dump(4);
-        return true;
+        for (auto& [providerStr, urls] : config["endpoints"].items()) {
+            std::vector<std::string> list = urls.get<std::vector<std::string>>();
+            if (list.empty()) {
+                throw std::runtime_error("endpoints for " + providerStr + " must not be empty");
+            }
+            parsed.endpoints[stringToProvider(providerStr)] = list;
+        }
+    }
+
+    if (config.contains("auto_model_tiers")) {
+        parsed.autoModelTiers = config["auto_model_tiers"].get<std::vector<std::string>>();
+    }
+
+    if (config.contains("save_sessions")) {
+        parsed.saveSessions = config["save_sessions"].get<bool>();
+    }
+
+    // Load API keys; the file is the whole list, so keys it no longer has are dropped
+    if (config.contains("api_keys") && config["api_keys"].is_object()) {
+        for (auto& [providerStr, keyValue] : config["api_keys"].items()) {
+            Provider provider = stringToProvider(providerStr);
+            std::vector<std::string> pool;
+            for (const auto& value : keyValue.is_array() ? keyValue : json::array({keyValue})) {
+                if (!value.is_string()) {
+                    continue;
+                }
+                std::string key = value;
+                decryptApiKey(key);
+                if (isValidApiKey(key) && std::find(pool.begin(), pool.end(), key) == pool.end()) {
+                    pool.push_back(key);
+                }
+            }
+            if (!pool.empty()) {
+                parsed.apiKeys[provider] = pool;
+            }
+        }
+    }
+    return parsed;
+}
+
+bool ConfigManager::saveConfig() const {
+    try {
+        std::string content;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            content = toJson().dump(4);
+        }
+        return writeConfigFile(content);
     } catch (const std::exception& e) {
         std::cerr << "Error saving config: " << e.what() << std::endl;
         return false;
     }
 }
 
+bool ConfigManager::writeConfigFile(const std::string& content) const {
+    std::lock_guard<std::mutex> writeLock(writeMutex);
+    if (content == lastWrittenContent) {
+        return true;
+    }
+
+    // Write a temporary file and rename it over the old one so a crash never leaves a torn config
+    std::string tempPath = configPath.string() + ".tmp";
+    int fd = open(tempPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        return false;
+    }
+
+    const char* data = content.data();
+    size_t remaining = content.size();
+    bool ok = true;
+    while (remaining > 0) {
+        ssize_t n = write(fd, data, remaining);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            ok = false;
+            break;
+        }
+        data += n;
+        remaining -= static_cast<size_t>(n);
+    }
+    ok = ok && fsync(fd) == 0;
+    ok = close(fd) == 0 && ok;
+
+    if (!ok || rename(tempPath.c_str(), configPath.c_str()) != 0) {
+        std::cerr << "Error saving config: " << strerror(errno) << std::endl;
+        unlink(tempPath.c_str());
+        return false;
+    }
+
+    lastWrittenContent = content;
+    return true;
+}
+
 bool ConfigManager::loadConfig() {
     if (!fs::exists(configPath)) {
         return false;
@@ -97,42 +545,150 @@ bool ConfigManager::loadConfig() {
             return false;
         }
 
-        json config = json::parse(file);
+        std::stringstream buffer;
+        buffer << file.rdbuf();
+        std::string content = buffer.str();
+        Settings parsed = parseJson(json::parse(content));
 
-        // Load provider and model selection
-        if (config.contains("selected_provider")) {
-            selectedProvider = stringToProvider(config["selected_provider"]);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            settings = std::move(parsed);
         }
 
-        if (config.contains("selected_model")) {
-            selectedModel = config["selected_model"];
+        std::lock_guard<std::mutex> writeLock(writeMutex);
+        lastWrittenContent = content;
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << "Error loading config: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+void ConfigManager::enableHotReload() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (watchThread.joinable()) {
+        return;
+    }
+
+    // Watch the directory: atomic replacements show up as renames, not modifications
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFd < 0) {
+        return;
+    }
+    if (inotify_add_watch(inotifyFd, configPath.parent_path().c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0 ||
+        pipe(wakePipe) != 0) {
+        close(inotifyFd);
+        inotifyFd = -1;
+        return;
+    }
+
+    watchThread = std::thread(&ConfigManager::watchLoop, this);
+}
+
+uint64_t ConfigManager::getReloadCount() const {
+    return reloadCount;
+}
+
+void ConfigManager::watchLoop() {
+    std::string fileName = configPath.filename().string();
+    alignas(inotify_event) char buffer[4096];
+
+    while (true) {
+        pollfd fds[2] = {{inotifyFd, POLLIN, 0}, {wakePipe[0], POLLIN, 0}};
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        if (fds[1].revents) {
+            return;
         }
 
-        // Load API keys
-        if (config.contains("api_keys") && config["api_keys"].is_object()) {
-            for (auto& [providerStr, keyValue] : config["api_keys"].items()) {
-                Provider provider = stringToProvider(providerStr);
-                std::string key = keyValue;
-                decryptApiKey(key);
-                apiKeys[provider] = key;
+        // Drain events and check whether any touched config.json
+        bool changed = false;
+        ssize_t length;
+        while ((length = read(inotifyFd, buffer, sizeof(buffer))) > 0) {
+            for (char* ptr = buffer; ptr < buffer + length;) {
+                auto* event = reinterpret_cast<inotify_event*>(ptr);
+                if (event->len > 0 && fileName == event->name) {
+                    changed = true;
+                }
+                ptr += sizeof(inotify_event) + event->len;
             }
         }
 
-        return true;
+        if (changed) {
+            reloadIfChanged();
+        }
+    }
+}
+
+void ConfigManager::reloadIfChanged() {
+    try {
+        std::ifstream file(configPath);
+        if (!file.is_open()) {
+            return;
+        }
+
+        std::stringstream buffer;
+        buffer << file.rdbuf();
+        std::string content = buffer.str();
+
+        // Ignore our own writes
+        {
+            std::lock_guard<std::mutex> writeLock(writeMutex);
+            if (content == lastWrittenContent) {
+                return;
+            }
+        }
+
+        // Nothing is applied unless the whole file is valid
+        Settings parsed = parseJson(json::parse(content));
+
+        // The external edit wins over changes not yet flushed
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            settings = std::move(parsed);
+            dirty = false;
+        }
+
+        std::lock_guard<std::mutex> writeLock(writeMutex);
+        lastWrittenContent = content;
+        ++reloadCount;
     } catch (const std::exception& e) {
-        std::cerr << "Error loading config: " << e.what() << std::endl;
-        return false;
+        // Half-written or invalid edits leave the settings as they were until the next change
     }
 }
 
 std::string ConfigManager::providerToString(Provider provider) {
-    return "google";
+    switch (provider) {
+        case Provider::OPENAI_COMPATIBLE:
+            return "openai";
+        case Provider::GOOGLE:
+        default:
+            return "google";
+    }
 }
 
 Provider ConfigManager::stringToProvider(const std::string& providerStr) {
+    if (providerStr == "openai") {
+        return Provider::OPENAI_COMPATIBLE;
+    }
     return Provider::GOOGLE;
 }
 
+bool ConfigManager::requiresApiKey(Provider provider) {
+    return provider == Provider::GOOGLE;
+}
+
+bool ConfigManager::isValidApiKey(const std::string& key) {
+    if (key.empty() || key.size() > 1024) {
+        return false;
+    }
+    return std::all_of(key.begin(), key.end(), [](unsigned char c) { return c > 0x20 && c < 0x7f; });
+}
+
 // Simple XOR encryption for demonstration purposes
 // In a real application, use a proper encryption library
 void ConfigManager::encryptApiKey(std::string& key) const {
@@ -0,0 +1,295 @@
+#include "alloc_tracker.h"
+#include <nlohmann/json.hpp>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <sstream>
+
+namespace libertymind {
+
+namespace {
+
+// Everything here runs inside operator new, so none of it may allocate
+
+enum Mode : int {
+    UNDECIDED,
+    OFF,
+    ON
+};
+
+std::atomic<int> mode{UNDECIDED};
+
+struct Counters {
+    std::atomic<uint64_t> allocations{0};
+    std::atomic<uint64_t> frees{0};
+    std::atomic<uint64_t> bytesAllocated{0};
+    std::atomic<int64_t> liveBytes{0};
+    std::atomic<int64_t> peakBytes{0};
+};
+
+constexpr size_t kTagCount = static_cast<size_t>(AllocTag::COUNT);
+Counters tagCounters[kTagCount];
+Counters totalCounters;
+
+thread_local AllocTag currentTag = AllocTag::OTHER;
+
+// Prepended to tracked blocks; padded so the caller's pointer stays suitably aligned
+struct alignas(alignof(std::max_align_t)) Header {
+    size_t size;
+    AllocTag tag;
+};
+
+bool trackingEnabled() {
+    int current = mode.load(std::memory_order_relaxed);
+    if (current == UNDECIDED) {
+        const char* value = getenv("SYNTHARA_TRACK_ALLOCATIONS");
+        int decided = value && *value && *value != '0' ? ON : OFF;
+
+        // Another thread may have decided first; its answer is the same
+        mode.compare_exchange_strong(current, decided, std::memory_order_relaxed);
+        current = mode.load(std::memory_order_relaxed);
+    }
+    return current == ON;
+}
+
+void raisePeak(std::atomic<int64_t>& peak, int64_t live) {
+    int64_t seen = peak.load(std::memory_order_relaxed);
+    while (live > seen && !peak.compare_exchange_weak(seen, live, std::memory_order_relaxed)) {
+    }
+}
+
+void countAllocation(Counters& counters, size_t size) {
+    counters.allocations.fetch_add(1, std::memory_order_relaxed);
+    counters.bytesAllocated.fetch_add(size, std::memory_order_relaxed);
+    int64_t live = counters.liveBytes.fetch_add(static_cast<int64_t>(size), std::memory_order_relaxed) +
+                   static_cast<int64_t>(size);
+    raisePeak(counters.peakBytes, live);
+}
+
+void countFree(Counters& counters, size_t size) {
+    counters.frees.fetch_add(1, std::memory_order_relaxed);
+    counters.liveBytes.fetch_sub(static_cast<int64_t>(size), std::memory_order_relaxed);
+}
+
+void* allocateOnce(size_t size) {
+    if (!trackingEnabled()) {
+        return malloc(size ? size : 1);
+    }
+
+    // The header must not wrap a size near SIZE_MAX into a tiny block
+    if (size > SIZE_MAX - sizeof(Header)) {
+        return nullptr;
+    }
+    void* block = malloc(sizeof(Header) + size);
+    if (!block) {
+        return nullptr;
+    }
+    Header* header = static_cast<Header*>(block);
+    header->size = size;
+    header->tag = currentTag;
+    countAllocation(tagCounters[static_cast<size_t>(header->tag)], size);
+    countAllocation(totalCounters, size);
+    return header + 1;
+}
+
+// operator new semantics: retry through the new-handler, then throw
+void* allocate(size_t size) {
+    while (true) {
+        if (void* pointer = allocateOnce(size)) {
+            return pointer;
+        }
+        std::new_handler handler = std::get_new_handler();
+        if (!handler) {
+            throw std::bad_alloc();
+        }
+        handler();
+    }
+}
+
+void* allocateNoThrow(size_t size) noexcept {
+    try {
+        return allocate(size);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void deallocate(void* pointer) noexcept {
+    if (!pointer) {
+        return;
+    }
+    if (!trackingEnabled()) {
+        free(pointer);
+        return;
+    }
+
+    Header* header = static_cast<Header*>(pointer) - 1;
+    countFree(tagCounters[static_cast<size_t>(header->tag)], header->size);
+    countFree(totalCounters, header->size);
+    free(header);
+}
+
+AllocStats snapshot(const Counters& counters) {
+    AllocStats stats;
+    stats.allocations = counters.allocations.load(std::memory_order_relaxed);
+    stats.frees = counters.frees.load(std::memory_order_relaxed);
+    stats.bytesAllocated = counters.bytesAllocated.load(std::memory_order_relaxed);
+    stats.liveBytes = counters.liveBytes.load(std::memory_order_relaxed);
+    stats.peakBytes = counters.peakBytes.load(std::memory_order_relaxed);
+    return stats;
+}
+
+nlohmann::json toJson(const AllocStats& stats) {
+    return {
+        {"allocations", stats.allocations},
+        {"frees", stats.frees},
+        {"bytes_allocated", stats.bytesAllocated},
+        {"live_bytes", stats.liveBytes},
+        {"peak_bytes", stats.peakBytes}
+    };
+}
+
+} // namespace
+
+AllocTracker::Scope::Scope(AllocTag tag) : previous(currentTag) {
+    currentTag = tag;
+}
+
+AllocTracker::Scope::~Scope() {
+    currentTag = previous;
+}
+
+bool AllocTracker::isEnabled() {
+    return trackingEnabled();
+}
+
+AllocStats AllocTracker::stats(AllocTag tag) {
+    return snapshot(tagCounters[static_cast<size_t>(tag)]);
+}
+
+AllocStats AllocTracker::total() {
+    return snapshot(totalCounters);
+}
+
+void AllocTracker::resetPeaks() {
+    for (auto& counters : tagCounters) {
+        counters.peakBytes.store(counters.liveBytes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+    totalCounters.peakBytes.store(totalCounters.liveBytes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+const char* AllocTracker::tagName(AllocTag tag) {
+    switch (tag) {
+        case AllocTag::UI:
+            return "ui";
+        case AllocTag::NETWORK:
+            return "network";
+        case AllocTag::PARSE:
+            return "parse";
+        case AllocTag::SESSION:
+            return "session";
+        case AllocTag::EXPORT:
+            return "export";
+        default:
+            return "other";
+    }
+}
+
+void AllocTracker::residentMemory(uint64_t& currentKb, uint64_t& peakKb) {
+    currentKb = 0;
+    peakKb = 0;
+
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        std::istringstream fields(line);
+        std::string name;
+        uint64_t value = 0;
+        fields >> name >> value;
+        if (name == "VmRSS:") {
+            currentKb = value;
+        } else if (name == "VmHWM:") {
+            peakKb = value;
+        }
+    }
+}
+
+bool AllocTracker::writeReport(const std::filesystem::path& path, std::string& error) {
+    nlohmann::json tags = nlohmann::json::object();
+    for (size_t i = 0; i < kTagCount; ++i) {
+        AllocTag tag = static_cast<AllocTag>(i);
+        tags[tagName(tag)] = toJson(stats(tag));
+    }
+
+    uint64_t rssKb = 0;
+    uint64_t peakRssKb = 0;
+    residentMemory(rssKb, peakRssKb);
+
+    nlohmann::json report = {
+        {"tracking", isEnabled()},
+        {"total", toJson(total())},
+        {"tags", tags},
+        {"rss_kb", rssKb},
+        {"peak_rss_kb", peakRssKb}
+    };
+
+    std::error_code ignored;
+    if (path.has_parent_path()) {
+        std::filesystem::create_directories(path.parent_path(), ignored);
+    }
+    std::ofstream file(path);
+    file << report.dump(2) << std::endl;
+    if (!file) {
+        error = "Cannot write " + path.string();
+        return false;
+    }
+    return true;
+}
+
+} // namespace libertymind
+
+// Replacements for the global allocation functions. The aligned forms keep
+// the library's own implementation and are not counted.
+
+void* operator new(size_t size) {
+    return libertymind::allocate(size);
+}
+
+void* operator new[](size_t size) {
+    return libertymind::allocate(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    return libertymind::allocateNoThrow(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    return libertymind::allocateNoThrow(size);
+}
+
+void operator delete(void* pointer) noexcept {
+    libertymind::deallocate(pointer);
+}
+
+void operator delete[](void* pointer) noexcept {
+    libertymind::deallocate(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+    libertymind::deallocate(pointer);
+}
+
+void operator delete[](void* pointer, size_t) noexcept {
+    libertymind::deallocate(pointer);
+}
+
+void operator delete(void* pointer, const std::nothrow_t&) noexcept {
+    libertymind::deallocate(pointer);
+}
+
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept {
+    libertymind::deallocate(pointer);
+}
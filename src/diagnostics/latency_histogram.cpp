@@ -0,0 +1,138 @@
+#include "latency_histogram.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace libertymind {
+
+LatencyHistogram::LatencyHistogram(int64_t highestTrackableValue, int significantDigits)
+    : highestTrackableValue(std::max<int64_t>(highestTrackableValue, 2)),
+      total(0),
+      minValue(std::numeric_limits<int64_t>::max()),
+      maxValue(0) {
+    significantDigits = std::clamp(significantDigits, 1, 5);
+
+    // Each power-of-two bucket holds enough linear sub-buckets for the precision
+    int64_t largestSingleUnitResolution = 2 * static_cast<int64_t>(std::pow(10, significantDigits));
+    int subBucketCountMagnitude = static_cast<int>(std::ceil(std::log2(static_cast<double>(largestSingleUnitResolution))));
+    subBucketHalfCountMagnitude = std::max(subBucketCountMagnitude, 1) - 1;
+    int64_t subBucketCount = int64_t(1) << (subBucketHalfCountMagnitude + 1);
+    subBucketHalfCount = subBucketCount / 2;
+    subBucketMask = subBucketCount - 1;
+
+    int bucketCount = 1;
+    int64_t smallestUntrackableValue = subBucketCount;
+    while (smallestUntrackableValue <= this->highestTrackableValue) {
+        if (smallestUntrackableValue > std::numeric_limits<int64_t>::max() / 2) {
+            ++bucketCount;
+            break;
+        }
+        smallestUntrackableValue <<= 1;
+        ++bucketCount;
+    }
+    counts.assign(static_cast<size_t>((bucketCount + 1) * subBucketHalfCount), 0);
+}
+
+size_t LatencyHistogram::indexOf(int64_t value) const {
+    int pow2Ceiling = 64 - __builtin_clzll(static_cast<uint64_t>(value | subBucketMask));
+    int bucketIndex = pow2Ceiling - (subBucketHalfCountMagnitude + 1);
+    int64_t subBucketIndex = value >> bucketIndex;
+    return static_cast<size_t>((int64_t(bucketIndex + 1) << subBucketHalfCountMagnitude) + (subBucketIndex - subBucketHalfCount));
+}
+
+int64_t LatencyHistogram::valueAt(size_t index) const {
+    int bucketIndex = static_cast<int>(index >> subBucketHalfCountMagnitude) - 1;
+    int64_t subBucketIndex = static_cast<int64_t>(index & (subBucketHalfCount - 1)) + subBucketHalfCount;
+    if (bucketIndex < 0) {
+        subBucketIndex -= subBucketHalfCount;
+        bucketIndex = 0;
+    }
+    return subBucketIndex << bucketIndex;
+}
+
+int64_t LatencyHistogram::highestEquivalentValue(int64_t value) const {
+    int pow2Ceiling = 64 - __builtin_clzll(static_cast<uint64_t>(value | subBucketMask));
+    int bucketIndex = pow2Ceiling - (subBucketHalfCountMagnitude + 1);
+    int64_t lowest = (value >> bucketIndex) << bucketIndex;
+    return lowest + (int64_t(1) << bucketIndex) - 1;
+}
+
+void LatencyHistogram::record(int64_t value, int64_t count) {
+    value = std::clamp<int64_t>(value, 0, highestTrackableValue);
+    counts[indexOf(value)] += count;
+    total += count;
+    minValue = std::min(minValue, value);
+    maxValue = std::max(maxValue, value);
+}
+
+void LatencyHistogram::add(const LatencyHistogram& other) {
+    if (other.counts.size() == counts.size() && other.subBucketHalfCount == subBucketHalfCount) {
+        for (size_t i = 0; i < counts.size(); ++i) {
+            counts[i] += other.counts[i];
+        }
+        total += other.total;
+        minValue = std::min(minValue, other.minValue);
+        maxValue = std::max(maxValue, other.maxValue);
+        return;
+    }
+
+    // Different layouts: re-record each bucket by value
+    for (size_t i = 0; i < other.counts.size(); ++i) {
+        if (other.counts[i] > 0) {
+            record(other.valueAt(i), other.counts[i]);
+        }
+    }
+}
+
+void LatencyHistogram::reset() {
+    std::fill(counts.begin(), counts.end(), 0);
+    total = 0;
+    minValue = std::numeric_limits<int64_t>::max();
+    maxValue = 0;
+}
+
+int64_t LatencyHistogram::valueAtPercentile(double percentile) const {
+    if (total == 0) {
+        return 0;
+    }
+    percentile = std::clamp(percentile, 0.0, 100.0);
+    int64_t countAtPercentile = std::max<int64_t>(1, static_cast<int64_t>(percentile / 100.0 * total + 0.5));
+
+    int64_t seen = 0;
+    for (size_t i = 0; i < counts.size(); ++i) {
+        seen += counts[i];
+        if (seen >= countAtPercentile) {
+            return std::min(highestEquivalentValue(valueAt(i)), maxValue);
+        }
+    }
+    return maxValue;
+}
+
+int64_t LatencyHistogram::totalCount() const {
+    return total;
+}
+
+int64_t LatencyHistogram::min() const {
+    return total == 0 ? 0 : minValue;
+}
+
+int64_t LatencyHistogram::max() const {
+    return maxValue;
+}
+
+double LatencyHistogram::mean() const {
+    if (total == 0) {
+        return 0.0;
+    }
+    // Each bucket counts as its midpoint
+    double sum = 0.0;
+    for (size_t i = 0; i < counts.size(); ++i) {
+        if (counts[i] > 0) {
+            int64_t value = valueAt(i);
+            sum += static_cast<double>(counts[i]) * ((value + highestEquivalentValue(value)) / 2.0);
+        }
+    }
+    return sum / static_cast<double>(total);
+}
+
+} // namespace libertymind
@@ -0,0 +1,388 @@
+#include "metrics.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace libertymind {
+
+namespace {
+
+// Newest metric first; constant-initialized so metrics in any file can register
+std::atomic<const Metric*> registryHead{nullptr};
+
+// Shortest decimal text that reads back as the same double
+std::string formatNumber(double value) {
+    char text[32];
+    snprintf(text, sizeof(text), "%.17g", value);
+    for (int precision = 1; precision < 17; ++precision) {
+        char shorter[32];
+        snprintf(shorter, sizeof(shorter), "%.*g", precision, value);
+        if (strtod(shorter, nullptr) == value) {
+            return shorter;
+        }
+    }
+    return text;
+}
+
+// name{labels} value, leaving out empty braces
+void writeSample(std::string& out, const std::string& name, const std::string& labels, const std::string& value) {
+    out += name;
+    if (!labels.empty()) {
+        out += "{" + labels + "}";
+    }
+    out += " " + value + "\n";
+}
+
+const char* typeName(Metric::Type type) {
+    switch (type) {
+        case Metric::Type::COUNTER:
+            return "counter";
+        case Metric::Type::GAUGE:
+            return "gauge";
+        default:
+            return "histogram";
+    }
+}
+
+} // namespace
+
+Metric::Metric(Type type, const char* name, const char* help, const char* labels)
+    : type(type), name(name), help(help), labels(labels) {
+    const Metric* head = registryHead.load(std::memory_order_relaxed);
+    do {
+        next = head;
+    } while (!registryHead.compare_exchange_weak(head, this, std::memory_order_release, std::memory_order_relaxed));
+}
+
+const Metric* Metric::first() {
+    return registryHead.load(std::memory_order_acquire);
+}
+
+void Counter::writeSamples(std::string& out) const {
+    writeSample(out, std::string(getName()) + "_total", getLabels(), std::to_string(get()));
+}
+
+void Gauge::writeSamples(std::string& out) const {
+    writeSample(out, getName(), getLabels(), std::to_string(get()));
+}
+
+const double Histogram::kBounds[Histogram::kBucketCount] = {
+    0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1.0, 2.5, 5.0, 10.0, 30.0, 60.0
+};
+
+void Histogram::observe(double seconds) {
+    size_t bucket = 0;
+    while (bucket < kBucketCount && seconds > kBounds[bucket]) {
+        ++bucket;
+    }
+    buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    sumMicroseconds.fetch_add(static_cast<uint64_t>(std::max(0.0, seconds) * 1e6), std::memory_order_relaxed);
+}
+
+void Histogram::writeSamples(std::string& out) const {
+    std::string labels = getLabels();
+    std::string prefix = labels.empty() ? "" : labels + ",";
+
+    // Buckets are exposed cumulatively; the +Inf bucket is the count
+    uint64_t cumulative = 0;
+    for (size_t i = 0; i <= kBucketCount; ++i) {
+        cumulative += buckets[i].load(std::memory_order_relaxed);
+        std::string bound = i < kBucketCount ? formatNumber(kBounds[i]) : "+Inf";
+        writeSample(out, std::string(getName()) + "_bucket", prefix + "le=\"" + bound + "\"", std::to_string(cumulative));
+    }
+    writeSample(out, std::string(getName()) + "_count", labels, std::to_string(cumulative));
+    writeSample(out, std::string(getName()) + "_sum", labels,
+                formatNumber(sumMicroseconds.load(std::memory_order_relaxed) / 1e6));
+}
+
+namespace metrics {
+
+Counter httpRequests("synthara_http_requests", "HTTP requests started");
+Counter httpResponses2xx("synthara_http_responses", "HTTP responses by status class", "code=\"2xx\"");
+Counter httpResponses4xx("synthara_http_responses", "HTTP responses by status class", "code=\"4xx\"");
+Counter httpResponses5xx("synthara_http_responses", "HTTP responses by status class", "code=\"5xx\"");
+Counter httpTransportErrors("synthara_http_transport_errors", "HTTP requests that failed without a response");
+Counter httpThrottled("synthara_http_throttled", "HTTP 429 responses");
+Counter httpRequestBytes("synthara_http_request_bytes", "Request body bytes sent");
+Counter httpResponseBytes("synthara_http_response_bytes", "Response body bytes received");
+Gauge httpInFlight("synthara_http_requests_in_flight", "HTTP requests currently in progress");
+Histogram httpDuration("synthara_http_request_duration_seconds", "Time for the whole HTTP exchange");
+Histogram httpTtfb("synthara_http_ttfb_seconds", "Time until the first response byte");
+
+Counter endpointRetries("synthara_retries", "Requests sent again after a failure", "kind=\"endpoint\"");
+Counter modelRetries("synthara_retries", "Requests sent again after a failure", "kind=\"model\"");
+Counter batchRetries("synthara_retries", "Requests sent again after a failure", "kind=\"batch\"");
+
+Counter contextCacheLookups("synthara_context_cache_lookups", "Context cache lookups for prefixes large enough to cache");
+Counter contextCacheHits("synthara_context_cache_hits", "Context cache lookups that found a live entry");
+
+Gauge batchQueueDepth("synthara_batch_queue_depth", "Batch requests waiting to start, including retries");
+Gauge exportQueueDepth("synthara_export_queue_depth", "Sessions waiting to be exported");
+
+} // namespace metrics
+
+std::string renderMetrics() {
+    // The registry is newest first; expose metrics in the order they were defined
+    std::vector<const Metric*> all;
+    for (const Metric* metric = Metric::first(); metric; metric = metric->getNext()) {
+        all.push_back(metric);
+    }
+
+    // Samples of one family must be adjacent, under a single HELP and TYPE
+    std::string out;
+    std::vector<bool> written(all.size(), false);
+    for (size_t i = all.size(); i-- > 0;) {
+        if (written[i]) {
+            continue;
+        }
+        out += std::string("# HELP ") + all[i]->getName() + " " + all[i]->getHelp() + "\n";
+        out += std::string("# TYPE ") + all[i]->getName() + " " + typeName(all[i]->getType()) + "\n";
+        for (size_t j = i + 1; j-- > 0;) {
+            if (!written[j] && strcmp(all[j]->getName(), all[i]->getName()) == 0) {
+                all[j]->writeSamples(out);
+                written[j] = true;
+            }
+        }
+    }
+    out += "# EOF\n";
+    return out;
+}
+
+namespace {
+
+std::atomic<bool> serverStarted{false};
+
+// Wait after accept() runs out of descriptors or memory before trying again
+constexpr std::chrono::milliseconds kAcceptBackoff(100);
+
+// The running exporter's listening socket, and its path when it is a Unix socket
+std::mutex serverMutex;
+int serverListener = -1;
+std::string serverSocketPath;
+
+bool sendAll(int fd, const std::string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t result = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (result < 0 && errno == EINTR) {
+            continue;
+        }
+        if (result <= 0) {
+            return false;
+        }
+        sent += static_cast<size_t>(result);
+    }
+    return true;
+}
+
+// One request per connection; scrapers reconnect each time
+void serveScrape(int fd) {
+    // Don't let a stalled client hold up the next scrape, whether it stops sending or reading
+    timeval timeout = {2, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    std::string request;
+    char buffer[2048];
+    while (request.find("\r\n\r\n") == std::string::npos && request.size() < 16384) {
+        ssize_t received = recv(fd, buffer, sizeof(buffer), 0);
+        if (received < 0 && errno == EINTR) {
+            continue;
+        }
+        if (received <= 0) {
+            return;
+        }
+        request.append(buffer, static_cast<size_t>(received));
+    }
+
+    std::string line = request.substr(0, request.find("\r\n"));
+    bool isGet = line.rfind("GET ", 0) == 0;
+    bool isHead = line.rfind("HEAD ", 0) == 0;
+    std::string target = line.substr(line.find(' ') + 1);
+    target = target.substr(0, target.find(' '));
+    target = target.substr(0, target.find('?'));
+
+    std::string status = "200 OK";
+    std::string contentType = "application/openmetrics-text; version=1.0.0; charset=utf-8";
+    std::string body;
+    if (!isGet && !isHead) {
+        status = "405 Method Not Allowed";
+        contentType = "text/plain";
+        body = "Only GET is supported\n";
+    } else if (target != "/metrics" && target != "/") {
+        status = "404 Not Found";
+        contentType = "text/plain";
+        body = "Metrics are at /metrics\n";
+    } else {
+        body = renderMetrics();
+    }
+
+    std::string response = "HTTP/1.1 " + status + "\r\nContent-Type: " + contentType +
+                            "\r\nContent-Length: " + std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n";
+    if (!isHead) {
+        response += body;
+    }
+    sendAll(fd, response);
+}
+
+bool listenOn(const std::string& address, int& listener, std::string& socketPath, std::string& error) {
+    if (address.rfind("unix:", 0) == 0) {
+        std::string path = address.substr(5);
+        sockaddr_un local = {};
+        if (path.empty() || path.size() >= sizeof(local.sun_path)) {
+            error = "Invalid socket path: " + path;
+            return false;
+        }
+        local.sun_family = AF_UNIX;
+        memcpy(local.sun_path, path.c_str(), path.size() + 1);
+
+        // Replace a socket left behind by an earlier run, but nothing else
+        struct stat existing;
+        if (stat(path.c_str(), &existing) == 0 && S_ISSOCK(existing.st_mode)) {
+            unlink(path.c_str());
+        }
+
+        listener = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (listener < 0 || bind(listener, reinterpret_cast<sockaddr*>(&local), sizeof(local)) != 0) {
+            error = "Cannot listen on " + path + ": " + strerror(errno);
+            return false;
+        }
+
+        // Owner only; nobody can connect before listen() below, so there is no window
+        if (chmod(path.c_str(), 0600) != 0) {
+            error = "Cannot restrict " + path + ": " + strerror(errno);
+            unlink(path.c_str());
+            return false;
+        }
+        socketPath = path;
+    } else {
+        std::string host = "127.0.0.1";
+        std::string port = address;
+        size_t colon = address.rfind(':');
+        if (colon != std::string::npos) {
+            host = address.substr(0, colon);
+            port = address.substr(colon + 1);
+        }
+
+        sockaddr_in local = {};
+        local.sin_family = AF_INET;
+        char* end = nullptr;
+        long number = strtol(port.c_str(), &end, 10);
+        // Scrapes are unauthenticated, so only loopback addresses (127.0.0.0/8) are served
+        if (port.empty() || *end || number <= 0 || number > 65535 ||
+            inet_pton(AF_INET, host == "localhost" ? "127.0.0.1" : host.c_str(), &local.sin_addr) != 1 ||
+            (ntohl(local.sin_addr.s_addr) >> 24) != 127) {
+            error = "Invalid metrics address: " + address;
+            return false;
+        }
+        local.sin_port = htons(static_cast<uint16_t>(number));
+
+        listener = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        int reuse = 1;
+        if (listener >= 0) {
+            setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        }
+        if (listener < 0 || bind(listener, reinterpret_cast<sockaddr*>(&local), sizeof(local)) != 0) {
+            error = "Cannot listen on " + address + ": " + strerror(errno);
+            return false;
+        }
+    }
+
+    if (listen(listener, 16) != 0) {
+        error = "Cannot listen on " + address + ": " + strerror(errno);
+        if (!socketPath.empty()) {
+            unlink(socketPath.c_str());
+        }
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+bool MetricsServer::start(const std::string& address, std::string& error) {
+    if (serverStarted.exchange(true)) {
+        error = "Metrics server already running";
+        return false;
+    }
+
+    int listener = -1;
+    std::string socketPath;
+    if (!listenOn(address, listener, socketPath, error)) {
+        if (listener >= 0) {
+            close(listener);
+        }
+        serverStarted = false;
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(serverMutex);
+        serverListener = listener;
+        serverSocketPath = socketPath;
+    }
+
+    // Runs until shutdown(), away from the network loop
+    std::thread([listener]() {
+        while (true) {
+            int fd = accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+            if (fd < 0) {
+                if (errno == EINTR || errno == ECONNABORTED) {
+                    continue;
+                }
+
+                // Out of descriptors or memory: keep serving once some are freed
+                if (errno == EMFILE || errno == ENFILE || errno == ENOBUFS || errno == ENOMEM) {
+                    std::this_thread::sleep_for(kAcceptBackoff);
+                    continue;
+                }
+                close(listener);
+                return;
+            }
+            serveScrape(fd);
+            close(fd);
+        }
+    }).detach();
+    return true;
+}
+
+void MetricsServer::shutdown() {
+    std::lock_guard<std::mutex> lock(serverMutex);
+    if (serverListener < 0) {
+        return;
+    }
+
+    // Wakes the exporter thread out of accept(), which then closes the socket
+    ::shutdown(serverListener, SHUT_RDWR);
+    serverListener = -1;
+    if (!serverSocketPath.empty()) {
+        unlink(serverSocketPath.c_str());
+        serverSocketPath.clear();
+    }
+}
+
+void MetricsServer::startFromEnvironment() {
+    const char* address = getenv("SYNTHARA_METRICS_LISTEN");
+    if (!address || !*address) {
+        return;
+    }
+
+    std::string error;
+    if (!start(address, error)) {
+        std::cerr << "Warning: " << error << std::endl;
+    }
+}
+
+} // namespace libertymind
@@ -0,0 +1,81 @@
+#include "startup_trace.h"
+#include <atomic>
+#include <iomanip>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace libertymind {
+
+namespace {
+
+struct TraceEntry {
+    const char* name;
+    std::chrono::steady_clock::time_point start;
+    std::chrono::steady_clock::time_point end;
+    bool background;
+};
+
+// Captured during static initialization, as close to process start as we can get
+const std::chrono::steady_clock::time_point processStart = std::chrono::steady_clock::now();
+const std::thread::id mainThread = std::this_thread::get_id();
+
+std::atomic<bool> enabled{false};
+std::mutex entriesMutex;
+std::vector<TraceEntry> entries;
+
+double millisecondsSinceStart(std::chrono::steady_clock::time_point point) {
+    return std::chrono::duration<double, std::milli>(point - processStart).count();
+}
+
+} // namespace
+
+StartupTrace::Phase::Phase(const char* name)
+    : name(name), start(std::chrono::steady_clock::now()) {}
+
+StartupTrace::Phase::~Phase() {
+    record(name, start, std::chrono::steady_clock::now());
+}
+
+void StartupTrace::enable() {
+    enabled = true;
+}
+
+bool StartupTrace::isEnabled() {
+    return enabled;
+}
+
+void StartupTrace::mark(const char* name) {
+    auto now = std::chrono::steady_clock::now();
+    record(name, now, now);
+}
+
+void StartupTrace::record(const char* name, std::chrono::steady_clock::time_point start,
+                          std::chrono::steady_clock::time_point end) {
+    if (!enabled) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(entriesMutex);
+    entries.push_back({name, start, end, std::this_thread::get_id() != mainThread});
+}
+
+void StartupTrace::report(std::ostream& out) {
+    std::lock_guard<std::mutex> lock(entriesMutex);
+
+    out << "Startup trace (ms since process start):" << std::endl;
+    out << std::fixed << std::setprecision(3);
+    for (const auto& entry : entries) {
+        double start = millisecondsSinceStart(entry.start);
+        double end = millisecondsSinceStart(entry.end);
+
+        out << "  " << std::setw(10) << start << " - " << std::setw(10) << end
+            << "  " << std::setw(9) << (end - start) << "  " << entry.name;
+        if (entry.background) {
+            out << " (background)";
+        }
+        out << std::endl;
+    }
+}
+
+} // namespace libertymind
@@ -0,0 +1,181 @@
+#include "trace.h"
+#include <nlohmann/json.hpp>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace libertymind {
+
+std::atomic<bool> Trace::enabled{false};
+
+namespace {
+
+// Spans kept per thread; older ones are overwritten
+constexpr size_t kEventsPerThread = 8192;
+
+// Buffers of finished threads kept for the next dump (request threads come and go)
+constexpr size_t kMaxRetiredBuffers = 256;
+
+struct Event {
+    const char* name;
+    const char* category;
+    Trace::Clock::time_point start;
+    Trace::Clock::duration duration;
+    const char* argName;
+    int64_t argValue;
+};
+
+struct ThreadBuffer {
+    std::mutex mutex;  // Only contended while a dump reads the buffer
+    std::vector<Event> events;
+    size_t next = 0;
+    uint32_t id = 0;
+    std::string name;
+    bool retired = false;
+};
+
+const Trace::Clock::time_point processStart = Trace::Clock::now();
+
+std::mutex registryMutex;
+std::deque<std::shared_ptr<ThreadBuffer>> buffers;
+uint32_t nextThreadId = 1;
+std::mutex outputPathMutex;
+std::filesystem::path outputPath;
+
+// Marks the thread's buffer as finished when the thread exits
+struct BufferHolder {
+    std::shared_ptr<ThreadBuffer> buffer;
+
+    ~BufferHolder() {
+        if (buffer) {
+            std::lock_guard<std::mutex> lock(registryMutex);
+            buffer->retired = true;
+        }
+    }
+};
+
+thread_local BufferHolder holder;
+
+ThreadBuffer& currentBuffer() {
+    if (!holder.buffer) {
+        // Allocate the whole ring up front so recording never reallocates mid-span
+        auto buffer = std::make_shared<ThreadBuffer>();
+        buffer->events.reserve(kEventsPerThread);
+        std::lock_guard<std::mutex> lock(registryMutex);
+        buffer->id = nextThreadId++;
+        buffer->name = "thread " + std::to_string(buffer->id);
+
+        // Forget the oldest finished threads once there are too many
+        size_t retired = 0;
+        for (const auto& existing : buffers) {
+            retired += existing->retired ? 1 : 0;
+        }
+        for (auto it = buffers.begin(); it != buffers.end() && retired > kMaxRetiredBuffers;) {
+            if ((*it)->retired) {
+                it = buffers.erase(it);
+                --retired;
+            } else {
+                ++it;
+            }
+        }
+
+        buffers.push_back(buffer);
+        holder.buffer = std::move(buffer);
+    }
+    return *holder.buffer;
+}
+
+double microsecondsSinceStart(Trace::Clock::time_point point) {
+    return std::chrono::duration<double, std::micro>(point - processStart).count();
+}
+
+} // namespace
+
+void Trace::enable() {
+    enabled = true;
+}
+
+void Trace::setOutputPath(const std::filesystem::path& path) {
+    std::lock_guard<std::mutex> lock(outputPathMutex);
+    outputPath = path;
+}
+
+std::filesystem::path Trace::getOutputPath() {
+    std::lock_guard<std::mutex> lock(outputPathMutex);
+    return outputPath;
+}
+
+void Trace::setThreadName(const char* name) {
+    if (!isEnabled()) {
+        return;
+    }
+    ThreadBuffer& buffer = currentBuffer();
+    std::lock_guard<std::mutex> lock(buffer.mutex);
+    buffer.name = name;
+}
+
+void Trace::record(const char* name, const char* category, Clock::time_point start, Clock::time_point end,
+                   const char* argName, int64_t argValue) {
+    if (!isEnabled()) {
+        return;
+    }
+
+    ThreadBuffer& buffer = currentBuffer();
+    std::lock_guard<std::mutex> lock(buffer.mutex);
+    Event event = {name, category, start, end - start, argName, argValue};
+    if (buffer.events.size() < kEventsPerThread) {
+        buffer.events.push_back(event);
+    } else {
+        buffer.events[buffer.next] = event;
+    }
+    buffer.next = (buffer.next + 1) % kEventsPerThread;
+}
+
+bool Trace::write(const std::filesystem::path& path, std::string& error) {
+    std::vector<std::shared_ptr<ThreadBuffer>> snapshot;
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        snapshot.assign(buffers.begin(), buffers.end());
+    }
+
+    nlohmann::json events = nlohmann::json::array();
+    events.push_back({{"ph", "M"}, {"name", "process_name"}, {"pid", 1}, {"args", {{"name", "synthara"}}}});
+
+    for (const auto& buffer : snapshot) {
+        std::lock_guard<std::mutex> lock(buffer->mutex);
+        events.push_back({{"ph", "M"}, {"name", "thread_name"}, {"pid", 1}, {"tid", buffer->id},
+                          {"args", {{"name", buffer->name}}}});
+
+        for (const auto& event : buffer->events) {
+            nlohmann::json span = {
+                {"name", event.name},
+                {"cat", event.category},
+                {"ph", "X"},
+                {"ts", microsecondsSinceStart(event.start)},
+                {"dur", std::chrono::duration<double, std::micro>(event.duration).count()},
+                {"pid", 1},
+                {"tid", buffer->id}
+            };
+            if (event.argName) {
+                span["args"] = {{event.argName, event.argValue}};
+            }
+            events.push_back(std::move(span));
+        }
+    }
+
+    std::error_code ignored;
+    if (path.has_parent_path()) {
+        std::filesystem::create_directories(path.parent_path(), ignored);
+    }
+    std::ofstream file(path);
+    file << nlohmann::json({{"traceEvents", events}, {"displayTimeUnit", "ms"}}).dump() << std::endl;
+    if (!file) {
+        error = "Cannot write " + path.string();
+        return false;
+    }
+    return true;
+}
+
+} // namespace libertymind
@@ -1,23 +1,121 @@
 #include "terminal_ui.h"
+#include "cli_commands.h"
+#include "metrics.h"
+#include "network_loop.h"
+#include "alloc_tracker.h"
+#include "startup_trace.h"
+#include "trace.h"
 #include <iostream>
 #include <stdexcept>
+#include <string>
 #include <curl/curl.h>
+#include <unistd.h>
 
-int main() {
+int main(int argc, char** argv) {
+    // Enabled before anything is timed, so the curl phase below is reported too
+    for (int i = 1; i < argc; ++i) {
+        if (std::string(argv[i]) == "--trace-startup") {
+            libertymind::StartupTrace::enable();
+        }
+    }
+
+    // curl_global_init is not thread-safe, so it runs here before any other thread exists
+    libertymind::ensureCurlInitialized();
+
+    // Serve internal counters for scraping when SYNTHARA_METRICS_LISTEN is set
+    libertymind::MetricsServer::startFromEnvironment();
+
+    // Headless subcommands
+    if (argc > 1 && std::string(argv[1]) == "export") {
+        int status;
+        try {
+            status = libertymind::runExportCommand(argc, argv);
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+            status = 1;
+        }
+        libertymind::MetricsServer::shutdown();
+        return status;
+    }
+    if (argc > 1 && std::string(argv[1]) == "batch") {
+        int status;
+        try {
+            status = libertymind::runBatchCommand(argc, argv);
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+            status = 1;
+        }
+        libertymind::MetricsServer::shutdown();
+        libertymind::NetworkLoop::shutdown();
+        curl_global_cleanup();
+        return status;
+    }
+
+    // One-shot prompt from -p or a pipe; never touches ncurses
+    bool headless = !isatty(STDIN_FILENO);
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "-p" || arg == "--prompt") {
+            headless = true;
+        }
+    }
+    if (headless) {
+        int status;
+        try {
+            status = libertymind::runPromptCommand(argc, argv);
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+            status = 1;
+        }
+        libertymind::MetricsServer::shutdown();
+        libertymind::NetworkLoop::shutdown();
+        curl_global_cleanup();
+        return status;
+    }
+
+    std::string allocReportPath;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--alloc-report" && i + 1 < argc) {
+            allocReportPath = argv[++i];
+        } else if (arg == "--trace" && i + 1 < argc) {
+            libertymind::Trace::enable();
+            libertymind::Trace::setOutputPath(argv[++i]);
+            libertymind::Trace::setThreadName("ui");
+        }
+    }
+
+    int status = 0;
     try {
-        // Initialize curl globally
-        curl_global_init(CURL_GLOBAL_ALL);
-        
         // Create and run the terminal UI
         libertymind::TerminalUI ui;
         ui.run();
-        
-        // Clean up curl
-        curl_global_cleanup();
-        
-        return 0;
     } catch (const std::exception& e) {
         std::cerr << "Error: " << e.what() << std::endl;
-        return 1;
+        status = 1;
     }
+
+    // Clean up curl once the network loop has stopped using it
+    libertymind::MetricsServer::shutdown();
+    libertymind::NetworkLoop::shutdown();
+    curl_global_cleanup();
+
+    // Report after ncurses has released the terminal
+    if (libertymind::StartupTrace::isEnabled()) {
+        libertymind::StartupTrace::report(std::cerr);
+    }
+
+    // Spans still buffered at exit go to the --trace file
+    std::string traceError;
+    std::filesystem::path tracePath = libertymind::Trace::getOutputPath();
+    if (!tracePath.empty() && !libertymind::Trace::write(tracePath, traceError)) {
+        std::cerr << "Error: " << traceError << std::endl;
+        status = 1;
+    }
+    if (!allocReportPath.empty() && !libertymind::AllocTracker::writeReport(allocReportPath, traceError)) {
+        std::cerr << "Error: " << traceError << std::endl;
+        status = 1;
+    }
+
+    return status;
 }
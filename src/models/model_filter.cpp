@@ -0,0 +1,111 @@
+#include "model_filter.h"
+#include <algorithm>
+#include <cctype>
+
+namespace libertymind {
+
+static bool isWordStart(const std::string& key, size_t pos) {
+    if (pos == 0) {
+        return true;
+    }
+    char prev = key[pos - 1];
+    return prev == ' ' || prev == '-' || prev == '.' || prev == '/' || prev == '_';
+}
+
+int ModelFilter::score(const std::string& query, const std::string& key) {
+    if (query.empty()) {
+        return 0;
+    }
+
+    // Exact substrings rank above scattered matches, earlier ones higher still
+    size_t found = key.find(query);
+    if (found != std::string::npos) {
+        int result = 1000 + static_cast<int>(query.size()) * 10 - static_cast<int>(std::min<size_t>(found, 100));
+        if (isWordStart(key, found)) {
+            result += 200;
+        }
+        return result;
+    }
+
+    // Otherwise the query must appear as a subsequence
+    int result = 0;
+    size_t pos = 0;
+    size_t last = std::string::npos;
+    for (char c : query) {
+        size_t next = key.find(c, pos);
+        if (next == std::string::npos) {
+            return -1;
+        }
+
+        result += 1;
+        if (last != std::string::npos && next == last + 1) {
+            result += 5;
+        } else if (isWordStart(key, next)) {
+            result += 8;
+        }
+        if (last != std::string::npos) {
+            result -= static_cast<int>(std::min<size_t>(next - last - 1, 10));
+        }
+
+        last = next;
+        pos = next + 1;
+    }
+    return result;
+}
+
+void ModelFilter::reset(std::shared_ptr<const ModelCatalog> newCatalog) {
+    catalog = std::move(newCatalog);
+
+    // Level zero is every model in catalog order
+    std::vector<Match> all;
+    all.reserve(catalog ? catalog->size() : 0);
+    for (size_t i = 0; catalog && i < catalog->size(); ++i) {
+        all.push_back({i, 0});
+    }
+    levels.clear();
+    levels.push_back(std::move(all));
+
+    // Replay the query against the new catalog
+    std::string previous = query;
+    query.clear();
+    for (char c : previous) {
+        push(c);
+    }
+}
+
+void ModelFilter::push(char c) {
+    if (levels.empty()) {
+        reset(catalog);
+    }
+
+    query += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+
+    // Only models that matched the shorter query can match the longer one
+    std::vector<Match> next;
+    for (const Match& match : levels.back()) {
+        int matchScore = score(query, catalog->searchKeys()[match.index]);
+        if (matchScore >= 0) {
+            next.push_back({match.index, matchScore});
+        }
+    }
+
+    std::stable_sort(next.begin(), next.end(), [](const Match& a, const Match& b) {
+        return a.score > b.score;
+    });
+    levels.push_back(std::move(next));
+}
+
+void ModelFilter::pop() {
+    if (query.empty()) {
+        return;
+    }
+    query.pop_back();
+    levels.pop_back();
+}
+
+void ModelFilter::setQuery(const std::string& newQuery) {
+    query = newQuery;
+    reset(catalog);
+}
+
+} // namespace libertymind
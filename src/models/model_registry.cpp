@@ -1,67 +1,284 @@
 #include "model_registry.h"
+#include "api_client.h"
+#include "model_router.h"
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+
+using json = nlohmann::json;
+namespace fs = std::filesystem;
 
 namespace libertymind {
 
-ModelRegistry::ModelRegistry() {
+static int64_t nowSeconds() {
+    return std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+ModelCatalog::ModelCatalog(std::vector<ModelInfo> models) : entries(std::move(models)) {
+    keys.reserve(entries.size());
+    byId.reserve(entries.size());
+    for (size_t i = 0; i < entries.size(); ++i) {
+        std::string key = entries[i].id + " " + entries[i].name;
+        for (char& c : key) {
+            c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        }
+        keys.push_back(std::move(key));
+        byId.emplace(entries[i].id, i);
+    }
+}
+
+const ModelInfo* ModelCatalog::find(const std::string& modelId) const {
+    auto it = byId.find(modelId);
+    return it != byId.end() ? &entries[it->second] : nullptr;
+}
+
+// Catalog of provider models headed by the "auto" routing option
+static std::shared_ptr<const ModelCatalog> makeCatalog(std::vector<ModelInfo> models) {
+    models.insert(models.begin(), {kAutoModelId, "Auto", "Fastest healthy model from auto_model_tiers", 0, 0, {}});
+    return std::make_shared<const ModelCatalog>(std::move(models));
+}
+
+ModelRegistry::ModelRegistry() : refreshing(false) {
+    const char* homeDir = getenv("HOME");
+    cachePath = fs::path(homeDir ? homeDir : ".") / ".libertymind" / "models_cache.json";
+
     initializeModels();
+
+    // Prefer the last discovered list, even if stale, until a refresh lands
+    loadCache();
+}
+
+ModelRegistry::~ModelRegistry() {
+    std::lock_guard<std::mutex> threadLock(refreshThreadMutex);
+    if (refreshThread.joinable()) {
+        refreshThread.join();
+    }
 }
 
 void ModelRegistry::initializeModels() {
-    // Google models
-    models[Provider::GOOGLE] = {
+    // Fallback Google models, used until the models endpoint has been queried
+    const std::vector<std::string> generateMethods = {"generateContent", "countTokens"};
+    catalogs[Provider::GOOGLE] = makeCatalog({
         // Gemini 2.0 models
-        {"gemini-2.0-flash-lite", "Gemini 2.0 Flash-Lite", "Cost-effective model for simple tasks"},
+        {"gemini-2.0-flash-lite", "Gemini 2.0 Flash-Lite", "Cost-effective model for simple tasks", 1048576, 8192, generateMethods},
+        {"gemini-2.0-flash", "Gemini 2.0 Flash", "Fast multimodal model for everyday tasks", 1048576, 8192, generateMethods},
 
-        // Gemini 1.5 models
-        {"gemini-1.5-pro", "Gemini 1.5 Pro", "Google's versatile model with long context"},
-        {"gemini-1.5-flash", "Gemini 1.5 Flash", "Faster, more efficient Google model"}
-    };
+        // Gemini 2.5 models
+        {"gemini-2.5-flash", "Gemini 2.5 Flash", "Fast model with thinking for complex tasks", 1048576, 65536, generateMethods},
+        {"gemini-2.5-pro", "Gemini 2.5 Pro", "Google's most capable model with long context", 1048576, 65536, generateMethods}
+    });
+
+    // OpenAI-compatible servers name their own models; they are listed once discovered
+    catalogs[Provider::OPENAI_COMPATIBLE] = makeCatalog({});
 }
 
-std::vector<ModelInfo> ModelRegistry::getModelsForProvider(Provider provider) const {
-    auto it = models.find(provider);
-    if (it != models.end()) {
+std::shared_ptr<const ModelCatalog> ModelRegistry::getCatalog(Provider provider) const {
+    static const auto empty = std::make_shared<const ModelCatalog>(std::vector<ModelInfo>());
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = catalogs.find(provider);
+    if (it != catalogs.end()) {
         return it->second;
     }
-    return {};
+    return empty;
 }
 
 std::vector<Provider> ModelRegistry::getAvailableProviders() const {
+    std::lock_guard<std::mutex> lock(mutex);
     std::vector<Provider> providers;
-    for (const auto& [provider, _] : models) {
+    for (const auto& [provider, _] : catalogs) {
         providers.push_back(provider);
     }
+    std::sort(providers.begin(), providers.end());
     return providers;
 }
 
 bool ModelRegistry::isValidModel(Provider provider, const std::string& modelId) const {
-    auto it = models.find(provider);
-    if (it == models.end()) {
-        return false;
+    return getCatalog(provider)->find(modelId) != nullptr;
+}
+
+std::optional<ModelInfo> ModelRegistry::getModelInfo(Provider provider, const std::string& modelId) const {
+    std::shared_ptr<const ModelCatalog> catalog = getCatalog(provider);
+    if (const ModelInfo* info = catalog->find(modelId)) {
+        return *info;
+    }
+    return std::nullopt;
+}
+
+void ModelRegistry::setModels(Provider provider, std::vector<ModelInfo> providerModels) {
+    auto catalog = makeCatalog(std::move(providerModels));
+    std::lock_guard<std::mutex> lock(mutex);
+    catalogs[provider] = std::move(catalog);
+}
+
+bool ModelRegistry::isRefreshing() const {
+    return refreshing;
+}
+
+void ModelRegistry::refreshInBackground(
+    Provider provider,
+    const std::string& apiKey,
+    const std::vector<std::string>& endpoints,
+    bool force
+) {
+    if (apiKey.empty() && ConfigManager::requiresApiKey(provider)) {
+        return;
     }
 
-    for (const auto& model : it->second) {
-        if (model.id == modelId) {
-            return true;
+    RefreshRequest request{provider, apiKey, endpoints};
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = fetchedAt.find(provider);
+        if (!force && it != fetchedAt.end() && nowSeconds() - it->second < kCacheTtlSeconds) {
+            return;
         }
+
+        // A forced refresh that arrives mid-fetch runs as soon as that fetch ends
+        bool idle = false;
+        if (!refreshing.compare_exchange_strong(idle, true)) {
+            if (force) {
+                pendingRefresh = std::move(request);
+            }
+            return;
+        }
+    }
+
+    std::lock_guard<std::mutex> threadLock(refreshThreadMutex);
+    if (refreshThread.joinable()) {
+        refreshThread.join();
     }
+    refreshThread = std::thread([this, request]() mutable {
+        while (true) {
+            fetchModels(request);
 
-    return false;
+            // Clear the flag under the lock so a forced request is never left behind
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!pendingRefresh) {
+                refreshing = false;
+                return;
+            }
+            request = std::move(*pendingRefresh);
+            pendingRefresh.reset();
+        }
+    });
 }
 
-std::optional<ModelInfo> ModelRegistry::getModelInfo(Provider provider, const std::string& modelId) const {
-    auto it = models.find(provider);
-    if (it == models.end()) {
-        return std::nullopt;
+void ModelRegistry::fetchModels(const RefreshRequest& request) {
+    try {
+        std::unique_ptr<ApiClient> client = createApiClient(request.provider, request.apiKey);
+        std::vector<ModelInfo> discovered;
+        if (client) {
+            client->setEndpointSelector(std::make_shared<EndpointSelector>(request.endpoints));
+        }
+        if (client && client->listModels(discovered) && !discovered.empty()) {
+            auto catalog = makeCatalog(std::move(discovered));
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                catalogs[request.provider] = std::move(catalog);
+                fetchedAt[request.provider] = nowSeconds();
+            }
+            saveCache();
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error refreshing models: " << e.what() << std::endl;
     }
+}
+
+bool ModelRegistry::loadCache() {
+    try {
+        std::ifstream file(cachePath);
+        if (!file.is_open()) {
+            return false;
+        }
 
-    for (const auto& model : it->second) {
-        if (model.id == modelId) {
-            return model;
+        json cache = json::parse(file);
+        if (!cache.contains("providers") || !cache["providers"].is_object()) {
+            return false;
         }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto& [providerStr, entry] : cache["providers"].items()) {
+            Provider provider = ConfigManager::stringToProvider(providerStr);
+
+            std::vector<ModelInfo> cached;
+            for (const auto& model : entry.value("models", json::array())) {
+                ModelInfo info;
+                info.id = model.value("id", "");
+                info.name = model.value("name", info.id);
+                info.description = model.value("description", "");
+                info.inputTokenLimit = model.value("input_token_limit", 0);
+                info.outputTokenLimit = model.value("output_token_limit", 0);
+                info.supportedMethods = model.value("methods", std::vector<std::string>());
+                if (!info.id.empty()) {
+                    cached.push_back(std::move(info));
+                }
+            }
+
+            if (!cached.empty()) {
+                catalogs[provider] = makeCatalog(std::move(cached));
+                fetchedAt[provider] = entry.value("fetched_at", int64_t(0));
+            }
+        }
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << "Error loading model cache: " << e.what() << std::endl;
+        return false;
     }
+}
 
-    return std::nullopt;
+bool ModelRegistry::saveCache() const {
+    try {
+        json cache;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (const auto& [provider, catalog] : catalogs) {
+                auto it = fetchedAt.find(provider);
+                if (it == fetchedAt.end()) {
+                    continue; // Built-in fallbacks aren't worth caching
+                }
+
+                json list = json::array();
+                for (const auto& model : catalog->models()) {
+                    if (model.id == kAutoModelId) {
+                        continue;
+                    }
+                    list.push_back({
+                        {"id", model.id},
+                        {"name", model.name},
+                        {"description", model.description},
+                        {"input_token_limit", model.inputTokenLimit},
+                        {"output_token_limit", model.outputTokenLimit},
+                        {"methods", model.supportedMethods}
+                    });
+                }
+                cache["providers"][ConfigManager::providerToString(provider)] = {
+                    {"fetched_at", it->second},
+                    {"models", list}
+                };
+            }
+        }
+
+        // Write to a temporary file and rename it into place
+        fs::create_directories(cachePath.parent_path());
+        fs::path tempPath = cachePath;
+        tempPath += ".tmp";
+        {
+            std::ofstream file(tempPath);
+            if (!file.is_open()) {
+                return false;
+            }
+            file << cache.dump(2);
+        }
+        fs::rename(tempPath, cachePath);
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << "Error saving model cache: " << e.what() << std::endl;
+        return false;
+    }
 }
 
 } // namespace libertymind
@@ -0,0 +1,134 @@
+#include "model_router.h"
+#include <algorithm>
+
+namespace libertymind {
+
+// Reply length used to turn throughput into a latency estimate
+static const double kTypicalOutputTokens = 200.0;
+
+// How long a model is skipped after it fails
+static const std::chrono::seconds kThrottleCooldown(30);
+static const std::chrono::seconds kErrorCooldown(10);
+
+// Repeated errors double the cooldown up to this
+static const std::chrono::seconds kMaxErrorCooldown(300);
+
+// How strongly recent failures count against a model's latency estimate
+static const double kErrorPenalty = 2.0;
+
+void ModelRouter::record(const RequestStats& stats) {
+    std::lock_guard<std::mutex> lock(mutex);
+    ModelStats& model = models[stats.model];
+
+    // The first sample seeds the averages instead of being diluted by zeros
+    double alpha = model.samples == 0 ? 1.0 : kSmoothing;
+    ++model.samples;
+
+    bool throttled = stats.status == 429;
+    model.errorRate += alpha * ((stats.success ? 0.0 : 1.0) - model.errorRate);
+    model.throttleRate += alpha * ((throttled ? 1.0 : 0.0) - model.throttleRate);
+
+    if (stats.success) {
+        ++model.successes;
+        model.consecutiveErrors = 0;
+        model.ttfbSeconds += alpha * (stats.ttfbSeconds - model.ttfbSeconds);
+        // Output tokens over the time they took to arrive; TTFB is counted separately
+        double generating = stats.totalSeconds - stats.ttfbSeconds;
+        if (stats.outputTokens > 0 && generating > 0.0) {
+            double tokensPerSecond = stats.outputTokens / generating;
+            model.tokensPerSecond = model.tokensPerSecond == 0.0
+                ? tokensPerSecond
+                : model.tokensPerSecond + kSmoothing * (tokensPerSecond - model.tokensPerSecond);
+        }
+    } else if (throttled) {
+        // Back off longer from models that keep rate limiting us
+        auto cooldown = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            kThrottleCooldown * (1.0 + 3.0 * model.throttleRate));
+        model.cooldownUntil = std::chrono::steady_clock::now() + cooldown;
+    } else {
+        // A model that keeps failing (say with 404 or 400) is retried less and less often
+        ++model.consecutiveErrors;
+        auto cooldown = kErrorCooldown * (1LL << std::min<size_t>(model.consecutiveErrors - 1, 5));
+        model.cooldownUntil = std::chrono::steady_clock::now() + std::min<std::chrono::seconds>(cooldown, kMaxErrorCooldown);
+    }
+}
+
+double ModelRouter::expectedLatency(const ModelStats& stats) {
+    double latency = stats.ttfbSeconds;
+    if (stats.tokensPerSecond > 0.0) {
+        latency += kTypicalOutputTokens / stats.tokensPerSecond;
+    }
+    return latency * (1.0 + kErrorPenalty * stats.errorRate);
+}
+
+bool ModelRouter::isHealthy(const ModelStats& stats, std::chrono::steady_clock::time_point now) {
+    return now >= stats.cooldownUntil;
+}
+
+std::vector<std::string> ModelRouter::rank(const std::vector<std::string>& tiers) const {
+    struct Candidate {
+        std::string model;
+        size_t tier;
+        bool healthy;
+        bool answered;  // Unmeasured, or succeeded at least once
+        double latency;
+        double errorRate;
+    };
+
+    auto now = std::chrono::steady_clock::now();
+    std::vector<Candidate> candidates;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (size_t i = 0; i < tiers.size(); ++i) {
+            auto it = models.find(tiers[i]);
+            if (it == models.end()) {
+                // Unmeasured models go first so every tier gets measured once
+                candidates.push_back({tiers[i], i, true, true, 0.0, 0.0});
+                continue;
+            }
+            const ModelStats& stats = it->second;
+
+            // A model that never succeeded has no latency yet, which must not read as fast
+            candidates.push_back({tiers[i], i, isHealthy(stats, now), stats.successes > 0,
+                                  expectedLatency(stats), stats.errorRate});
+        }
+    }
+
+    // Healthy models by latency, then healthy ones that only failed so far by error rate,
+    // then unhealthy ones as a last resort in tier order
+    std::stable_sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) {
+        if (a.healthy != b.healthy) {
+            return a.healthy;
+        }
+        if (a.healthy && a.answered != b.answered) {
+            return a.answered;
+        }
+        if (a.healthy && a.answered && a.latency != b.latency) {
+            return a.latency < b.latency;
+        }
+        if (a.healthy && !a.answered && a.errorRate != b.errorRate) {
+            return a.errorRate < b.errorRate;
+        }
+        return a.tier < b.tier;
+    });
+
+    std::vector<std::string> ranked;
+    ranked.reserve(candidates.size());
+    for (const auto& candidate : candidates) {
+        ranked.push_back(candidate.model);
+    }
+    return ranked;
+}
+
+ModelStats ModelRouter::getStats(const std::string& model) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = models.find(model);
+    return it != models.end() ? it->second : ModelStats();
+}
+
+void ModelRouter::reset() {
+    std::lock_guard<std::mutex> lock(mutex);
+    models.clear();
+}
+
+} // namespace libertymind
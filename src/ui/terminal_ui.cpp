@@ -1,5 +1,11 @@
 #include "terminal_ui.h"
+#include "alloc_tracker.h"
+#include "startup_trace.h"
+#include "trace.h"
 #include <algorithm>
+#include <cstdint>
+#include <ctime>
+#include <iomanip>
 #include <iostream>
 #include <sstream>
 
@@ -9,18 +15,44 @@ TerminalUI::TerminalUI()
     : currentScreen(Screen::MAIN_MENU),
       selectedOption(0),
       scrollOffset(0),
-      running(true) {
-
-    // Initialize components
-    configManager = std::make_shared<ConfigManager>();
-    modelRegistry = std::make_unique<ModelRegistry>();
-    chatSession = std::make_unique<ChatSession>(configManager);
+      running(true),
+      firstFrameDrawn(false),
+      exportRunning(false),
+      exportSucceeded(false),
+      exportDone(0),
+      exportTotal(0),
+      seenConfigReloads(0),
+      hudVisible(false),
+      lastFrameMilliseconds(0.0),
+      hudRssKb(0),
+      chatHistoryRevision(0),
+      drawnPendingReplySize(0),
+      redrawNeeded(true) {
+
+    // Read the theme while the rest of startup proceeds
+    pendingTheme = std::async(std::launch::async, []() {
+        StartupTrace::Phase phase("theme load");
+        return readThemeFile();
+    });
+
+    // Initialize components needed for the first frame
+    {
+        StartupTrace::Phase phase("config load");
+        configManager = std::make_shared<ConfigManager>();
+        configManager->enableHotReload();
+    }
 
     // Initialize ncurses
+    StartupTrace::Phase phase("ncurses init");
     initNcurses();
 }
 
 TerminalUI::~TerminalUI() {
+    // Let an in-flight export finish writing
+    if (exportThread.joinable()) {
+        exportThread.join();
+    }
+
     cleanupNcurses();
 }
 
@@ -31,12 +63,12 @@ void TerminalUI::initNcurses() {
     noecho();
     keypad(stdscr, TRUE);
     curs_set(0);
-    start_color();
 
-    // Load theme if available, otherwise use default
-    loadTheme();
+    // Wake up periodically to check background work; frames are only drawn when something changed
+    timeout(100);
+    start_color();
 
-    // Initialize color pairs based on theme
+    // Initialize color pairs with the default theme; the saved one is applied once read
     initializeColorPairs();
 
     // Create windows
@@ -72,8 +104,22 @@ void TerminalUI::cleanupNcurses() {
 
 void TerminalUI::run() {
     while (running) {
-        // Draw the current screen
-        drawScreen();
+        // Pick up results from background work
+        pollBackgroundTasks();
+
+        // Draw the current screen, unless nothing on it changed since the last frame
+        if (needsRedraw()) {
+            redrawNeeded = false;
+            drawScreen();
+        }
+
+        if (!firstFrameDrawn) {
+            firstFrameDrawn = true;
+            StartupTrace::mark("first frame");
+
+            // Discover models once the UI is up so startup never waits on the network
+            refreshModels(false);
+        }
 
         // Handle input
         handleInput();
@@ -81,10 +127,14 @@ void TerminalUI::run() {
 }
 
 void TerminalUI::drawScreen() {
-    // Clear windows
-    wclear(mainWindow);
-    wclear(inputWindow);
-    wclear(statusWindow);
+    Trace::Span span("drawScreen", "ui");
+    AllocTracker::Scope allocations(AllocTag::UI);
+    auto frameStart = std::chrono::steady_clock::now();
+
+    // Clear windows (erase rather than clear to avoid repainting the whole terminal)
+    werase(mainWindow);
+    werase(inputWindow);
+    werase(statusWindow);
 
     // Draw box around input window
     box(inputWindow, 0, 0);
@@ -120,6 +170,9 @@ void TerminalUI::drawScreen() {
         case Screen::MARKDOWN_EXPORT:
             drawMarkdownExport();
             break;
+        case Screen::DIAGNOSTICS:
+            drawDiagnostics();
+            break;
         case Screen::COMPANY_INFO:
             drawCompanyInfo();
             break;
@@ -129,16 +182,63 @@ void TerminalUI::drawScreen() {
     wrefresh(mainWindow);
     wrefresh(inputWindow);
     wrefresh(statusWindow);
+
+    lastFrameMilliseconds =
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count();
+}
+
+bool TerminalUI::needsRedraw() {
+    if (redrawNeeded) {
+        return true;
+    }
+
+    switch (currentScreen) {
+        case Screen::CHAT:
+            // The HUD shows live numbers; otherwise only new or streamed text matters
+            if (hudVisible) {
+                return true;
+            }
+            return chatSession && (chatSession->getHistoryRevision() != chatHistoryRevision ||
+                                   chatSession->getHistorySize() != chatHistory.size() ||
+                                   chatSession->getPendingReply().size() != drawnPendingReplySize);
+        case Screen::MODEL_SELECTION:
+            return modelRegistry &&
+                   modelRegistry->getCatalog(configManager->getSelectedProvider()) != modelFilter.getCatalog();
+        case Screen::DIAGNOSTICS:
+            return true;
+        default:
+            return false;
+    }
 }
 
 void TerminalUI::handleInput() {
     int key = getch();
 
+    // Nothing typed before the poll timeout
+    if (key == ERR) {
+        return;
+    }
+
+    // Any key may change what is shown
+    redrawNeeded = true;
+
+    Trace::Span span("handleInput", "ui");
+    span.setArg("key", key);
+    AllocTracker::Scope allocations(AllocTag::UI);
+
     // Handle global keys
     if (key == KEY_F(10)) {
         running = false;
         return;
     }
+    if (key == KEY_F(12)) {
+        toggleTrace();
+        return;
+    }
+    if (key == KEY_F(2)) {
+        hudVisible = !hudVisible;
+        return;
+    }
 
     // Handle screen-specific input
     switch (currentScreen) {
@@ -166,6 +266,9 @@ void TerminalUI::handleInput() {
         case Screen::MARKDOWN_EXPORT:
             handleMarkdownExportInput(key);
             break;
+        case Screen::DIAGNOSTICS:
+            handleDiagnosticsInput(key);
+            break;
         case Screen::COMPANY_INFO:
             handleCompanyInfoInput(key);
             break;
@@ -187,6 +290,7 @@ void TerminalUI::drawMainMenu() {
         "Start Chat",
         "Set System Message",
         "Customize Theme",
+        "Diagnostics",
         "Company Info",
         "Exit"
     };
@@ -209,8 +313,12 @@ void TerminalUI::drawMainMenu() {
     mvwprintw(mainWindow, y++, 4, "Provider: %s", getProviderName(configManager->getSelectedProvider()).c_str());
     mvwprintw(mainWindow, y++, 4, "Model: %s", configManager->getSelectedModel().c_str());
 
-    auto apiKey = configManager->getApiKey(configManager->getSelectedProvider());
-    mvwprintw(mainWindow, y++, 4, "API Key: %s", apiKey ? "Set" : "Not Set");
+    size_t keyCount = configManager->getApiKeys(configManager->getSelectedProvider()).size();
+    if (keyCount > 1) {
+        mvwprintw(mainWindow, y++, 4, "API Key: Set (pool of %zu keys)", keyCount);
+    } else {
+        mvwprintw(mainWindow, y++, 4, "API Key: %s", keyCount ? "Set" : "Not Set");
+    }
 
     // Draw instructions
     y += 2;
@@ -228,7 +336,7 @@ void TerminalUI::drawProviderSelection() {
     wattroff(mainWindow, COLOR_PAIR(1) | A_BOLD);
 
     // Get available providers
-    std::vector<Provider> providers = modelRegistry->getAvailableProviders();
+    std::vector<Provider> providers = registry().getAvailableProviders();
 
     // Draw provider options
     for (size_t i = 0; i < providers.size(); ++i) {
@@ -258,26 +366,49 @@ void TerminalUI::drawModelSelection() {
     whline(mainWindow, ' ', getmaxx(mainWindow));
     wattroff(mainWindow, COLOR_PAIR(1) | A_BOLD);
 
-    // Get available models for the selected provider
-    Provider provider = configManager->getSelectedProvider();
-    std::vector<ModelInfo> models = modelRegistry->getModelsForProvider(provider);
+    // Pick up a model list refreshed in the background
+    std::shared_ptr<const ModelCatalog> catalog = registry().getCatalog(configManager->getSelectedProvider());
+    if (catalog != modelFilter.getCatalog()) {
+        modelFilter.reset(catalog);
+    }
+    const std::vector<ModelFilter::Match>& matches = modelFilter.matches();
+    selectedOption = std::max(0, std::min(selectedOption, static_cast<int>(matches.size()) - 1));
+
+    // Draw filter line
+    mvwprintw(mainWindow, 2, 2, "Filter: %s  (%zu of %zu models)",
+              modelFilter.getQuery().c_str(), matches.size(), catalog->size());
+
+    // Keep the selection inside the visible part of the list
+    int listTop = 4;
+    int visibleRows = std::max(1, getmaxy(mainWindow) - listTop - 6);
+    if (selectedOption < scrollOffset) {
+        scrollOffset = selectedOption;
+    } else if (selectedOption >= scrollOffset + visibleRows) {
+        scrollOffset = selectedOption - visibleRows + 1;
+    }
 
-    // Draw model options
-    for (size_t i = 0; i < models.size(); ++i) {
-        if (static_cast<int>(i) == selectedOption) {
+    // Draw matching models
+    int shown = 0;
+    for (int i = scrollOffset; i < static_cast<int>(matches.size()) && shown < visibleRows; ++i, ++shown) {
+        const ModelInfo& model = catalog->models()[matches[i].index];
+        if (i == selectedOption) {
             wattron(mainWindow, COLOR_PAIR(2) | A_BOLD);
         }
 
-        mvwprintw(mainWindow, i + 2, 2, "%s - %s", models[i].id.c_str(), models[i].name.c_str());
+        mvwprintw(mainWindow, listTop + shown, 2, "%s - %s", model.id.c_str(), model.name.c_str());
 
-        if (static_cast<int>(i) == selectedOption) {
+        if (i == selectedOption) {
             wattroff(mainWindow, COLOR_PAIR(2) | A_BOLD);
         }
     }
+    if (matches.empty()) {
+        mvwprintw(mainWindow, listTop, 2, "No models match");
+    }
 
     // Draw instructions
-    int y = models.size() + 4;
+    int y = listTop + std::max(shown, 1) + 1;
     mvwprintw(mainWindow, y++, 2, "Instructions:");
+    mvwprintw(mainWindow, y++, 4, "Type to filter models");
     mvwprintw(mainWindow, y++, 4, "Use arrow keys to navigate");
     mvwprintw(mainWindow, y++, 4, "Press Enter to select");
     mvwprintw(mainWindow, y++, 4, "Press Escape to go back");
@@ -305,6 +436,7 @@ void TerminalUI::drawApiKeyInput() {
     mvwprintw(mainWindow, y++, 2, "Instructions:");
     mvwprintw(mainWindow, y++, 4, "Enter your API key for %s", getProviderName(configManager->getSelectedProvider()).c_str());
     mvwprintw(mainWindow, y++, 4, "Press Enter to save");
+    mvwprintw(mainWindow, y++, 4, "Press Tab to add it to the key pool instead");
     mvwprintw(mainWindow, y++, 4, "Press Escape to cancel");
 
     // Add provider-specific help
@@ -318,6 +450,13 @@ void TerminalUI::drawApiKeyInput() {
         mvwprintw(mainWindow, y++, 4, "1. Create a free account");
         mvwprintw(mainWindow, y++, 4, "2. Go to API Keys section");
         mvwprintw(mainWindow, y++, 4, "3. Create a new API key");
+    } else if (configManager->getSelectedProvider() == Provider::OPENAI_COMPATIBLE) {
+        y++;
+        wattron(mainWindow, COLOR_PAIR(3) | A_BOLD);
+        mvwprintw(mainWindow, y++, 2, "OpenAI-compatible Server Help:");
+        wattroff(mainWindow, COLOR_PAIR(3) | A_BOLD);
+        mvwprintw(mainWindow, y++, 4, "Only needed if your server checks bearer tokens");
+        mvwprintw(mainWindow, y++, 4, "Set the server address under \"endpoints\" in config.json");
     }
 
     // Show cursor
@@ -325,7 +464,33 @@ void TerminalUI::drawApiKeyInput() {
     wmove(mainWindow, 2, 17 + maskedKey.length());
 }
 
+std::vector<std::string> TerminalUI::wrapText(const std::string& text, size_t width) {
+    std::vector<std::string> lines;
+    std::istringstream iss(text);
+    std::string word;
+    std::string line;
+
+    while (iss >> word) {
+        if (line.length() + word.length() + 1 > width) {
+            lines.push_back(line);
+            line = word;
+        } else {
+            if (!line.empty()) {
+                line += " ";
+            }
+            line += word;
+        }
+    }
+
+    if (!line.empty()) {
+        lines.push_back(line);
+    }
+    return lines;
+}
+
 void TerminalUI::drawChat() {
+    Trace::Span span("drawChat", "ui");
+
     // Draw header
     wattron(mainWindow, COLOR_PAIR(1) | A_BOLD);
     mvwprintw(mainWindow, 0, 0, "Synthara Chat - %s - %s",
@@ -334,51 +499,69 @@ void TerminalUI::drawChat() {
     whline(mainWindow, ' ', getmaxx(mainWindow));
     wattroff(mainWindow, COLOR_PAIR(1) | A_BOLD);
 
-    // Get chat history
-    const std::vector<Message>& history = chatSession->getHistory();
+    // Get chat history; replies are appended on the network loop, so draw from a copy
+    const std::vector<Message>& history = syncChatHistory();
+    std::string pendingReply = session().getPendingReply();
+    drawnPendingReplySize = pendingReply.size();
 
-    // Draw chat history
-    int y = 1;
-    for (size_t i = 1; i < history.size(); ++i) { // Skip system message
-        const auto& message = history[i];
+    int top = 1;
+    if (hudVisible) {
+        drawHud(top++);
+    }
+
+    // Wrap messages from the newest back until the window is full, so a frame
+    // costs the same however long the history is
+    struct Block {
+        std::string role;
+        std::vector<std::string> lines;
+    };
+    int rows = getmaxy(mainWindow) - top;
+    size_t width = getmaxx(mainWindow) - 4;
+    std::vector<Block> blocks;
+    int used = 0;
+    auto addBlock = [&](const std::string& role, const std::string& content) {
+        Block block{role, wrapText(content, width)};
+        bool heading = role == "user" || role == "assistant";
+        used += (heading ? 1 : 0) + static_cast<int>(block.lines.size()) + 1;
+        blocks.push_back(std::move(block));
+    };
+
+    // The reply as it streams in, then the history (without the system message)
+    if (!pendingReply.empty()) {
+        addBlock("assistant", pendingReply);
+    }
+    for (size_t i = history.size(); i-- > 1 && used < rows;) {
+        addBlock(history[i].role, history[i].content);
+    }
 
-        if (message.role == "user") {
+    // Draw oldest first, starting above the window when the oldest block doesn't fit
+    int y = top - std::max(0, used - rows);
+    auto drawLine = [&](int x, const std::string& text) {
+        if (y >= top) {
+            mvwprintw(mainWindow, y, x, "%s", text.c_str());
+        }
+        y++;
+    };
+    for (auto block = blocks.rbegin(); block != blocks.rend(); ++block) {
+        if (block->role == "user") {
             wattron(mainWindow, COLOR_PAIR(3) | A_BOLD);
-            mvwprintw(mainWindow, y++, 1, "You:");
+            drawLine(1, "You:");
             wattroff(mainWindow, COLOR_PAIR(3) | A_BOLD);
-        } else if (message.role == "assistant") {
+        } else if (block->role == "assistant") {
             wattron(mainWindow, COLOR_PAIR(4) | A_BOLD);
-            mvwprintw(mainWindow, y++, 1, "Assistant:");
+            drawLine(1, "Assistant:");
             wattroff(mainWindow, COLOR_PAIR(4) | A_BOLD);
         }
 
-        // Word wrap the message content
-        std::istringstream iss(message.content);
-        std::string word;
-        std::string line;
-        int maxWidth = getmaxx(mainWindow) - 4;
-
-        while (iss >> word) {
-            if (line.length() + word.length() + 1 > static_cast<size_t>(maxWidth)) {
-                mvwprintw(mainWindow, y++, 2, "%s", line.c_str());
-                line = word;
-            } else {
-                if (!line.empty()) {
-                    line += " ";
-                }
-                line += word;
-            }
-        }
-
-        if (!line.empty()) {
-            mvwprintw(mainWindow, y++, 2, "%s", line.c_str());
+        for (const std::string& line : block->lines) {
+            drawLine(2, line);
         }
 
         y++; // Add a blank line between messages
     }
 
     // Draw input prompt
-    mvwprintw(inputWindow, 0, 2, "Enter message (Esc: menu, M: export to Markdown):");
+    mvwprintw(inputWindow, 0, 2, "Enter message (Esc: menu, M: export to Markdown, F2: HUD):");
     mvwprintw(inputWindow, 1, 2, "%s", inputBuffer.c_str());
 
     // Show cursor
@@ -395,7 +578,7 @@ void TerminalUI::drawSystemMessage() {
 
     // Draw current system message
     mvwprintw(mainWindow, 2, 2, "Current system message:");
-    mvwprintw(mainWindow, 3, 4, "%s", chatSession->getSystemMessage().c_str());
+    mvwprintw(mainWindow, 3, 4, "%s", session().getSystemMessage().c_str());
 
     // Draw input field
     mvwprintw(mainWindow, 5, 2, "New system message:");
@@ -419,7 +602,7 @@ void TerminalUI::handleMainMenuInput(int key) {
             selectedOption = std::max(0, selectedOption - 1);
             break;
         case KEY_DOWN:
-            selectedOption = std::min(7, selectedOption + 1);
+            selectedOption = std::min(8, selectedOption + 1);
             break;
         case '\n': // Enter key
             switch (selectedOption) {
@@ -430,6 +613,9 @@ void TerminalUI::handleMainMenuInput(int key) {
                 case 1: // Select Model
                     currentScreen = Screen::MODEL_SELECTION;
                     selectedOption = 0;
+                    scrollOffset = 0;
+                    modelFilter.setQuery("");
+                    modelFilter.reset(registry().getCatalog(configManager->getSelectedProvider()));
                     break;
                 case 2: // Set API Key
                     currentScreen = Screen::API_KEY_INPUT;
@@ -440,7 +626,7 @@ void TerminalUI::handleMainMenuInput(int key) {
                     Provider provider = configManager->getSelectedProvider();
                     auto apiKey = configManager->getApiKey(provider);
 
-                    if (!apiKey) {
+                    if (!apiKey && ConfigManager::requiresApiKey(provider)) {
                         setStatusMessage("Error: API key not set for " + getProviderName(provider));
                     } else {
                         currentScreen = Screen::CHAT;
@@ -451,16 +637,19 @@ void TerminalUI::handleMainMenuInput(int key) {
                 }
                 case 4: // Set System Message
                     currentScreen = Screen::SYSTEM_MESSAGE;
-                    inputBuffer = chatSession->getSystemMessage();
+                    inputBuffer = session().getSystemMessage();
                     break;
                 case 5: // Customize Theme
                     currentScreen = Screen::THEME_CUSTOMIZATION;
                     selectedOption = 0;
                     break;
-                case 6: // Company Info
+                case 6: // Diagnostics
+                    currentScreen = Screen::DIAGNOSTICS;
+                    break;
+                case 7: // Company Info
                     currentScreen = Screen::COMPANY_INFO;
                     break;
-                case 7: // Exit
+                case 8: // Exit
                     running = false;
                     break;
             }
@@ -469,7 +658,7 @@ void TerminalUI::handleMainMenuInput(int key) {
 }
 
 void TerminalUI::handleProviderSelectionInput(int key) {
-    std::vector<Provider> providers = modelRegistry->getAvailableProviders();
+    std::vector<Provider> providers = registry().getAvailableProviders();
 
     switch (key) {
         case KEY_UP:
@@ -481,6 +670,7 @@ void TerminalUI::handleProviderSelectionInput(int key) {
         case '\n': // Enter key
             if (selectedOption >= 0 && selectedOption < static_cast<int>(providers.size())) {
                 configManager->setSelectedProvider(providers[selectedOption]);
+                refreshModels(true);
                 currentScreen = Screen::MAIN_MENU;
                 selectedOption = 0;
             }
@@ -493,19 +683,19 @@ void TerminalUI::handleProviderSelectionInput(int key) {
 }
 
 void TerminalUI::handleModelSelectionInput(int key) {
-    Provider provider = configManager->getSelectedProvider();
-    std::vector<ModelInfo> models = modelRegistry->getModelsForProvider(provider);
+    const std::vector<ModelFilter::Match>& matches = modelFilter.matches();
 
     switch (key) {
         case KEY_UP:
             selectedOption = std::max(0, selectedOption - 1);
             break;
         case KEY_DOWN:
-            selectedOption = std::min(static_cast<int>(models.size()) - 1, selectedOption + 1);
+            selectedOption = std::max(0, std::min(static_cast<int>(matches.size()) - 1, selectedOption + 1));
             break;
         case '\n': // Enter key
-            if (selectedOption >= 0 && selectedOption < static_cast<int>(models.size())) {
-                configManager->setSelectedModel(models[selectedOption].id);
+            if (selectedOption >= 0 && selectedOption < static_cast<int>(matches.size())) {
+                const ModelInfo& model = modelFilter.getCatalog()->models()[matches[selectedOption].index];
+                configManager->setSelectedModel(model.id);
                 currentScreen = Screen::MAIN_MENU;
                 selectedOption = 0;
             }
@@ -514,6 +704,19 @@ void TerminalUI::handleModelSelectionInput(int key) {
             currentScreen = Screen::MAIN_MENU;
             selectedOption = 0;
             break;
+        case KEY_BACKSPACE:
+        case 127: // Delete key
+            modelFilter.pop();
+            selectedOption = 0;
+            scrollOffset = 0;
+            break;
+        default:
+            if (key >= 32 && key <= 126) { // Printable ASCII characters
+                modelFilter.push(static_cast<char>(key));
+                selectedOption = 0;
+                scrollOffset = 0;
+            }
+            break;
     }
 }
 
@@ -522,8 +725,27 @@ void TerminalUI::handleApiKeyInputInput(int key) {
         case '\n': // Enter key
             if (!inputBuffer.empty()) {
                 Provider provider = configManager->getSelectedProvider();
-                configManager->setApiKey(provider, inputBuffer);
+                if (!configManager->setApiKey(provider, inputBuffer)) {
+                    setStatusMessage("Error: That doesn't look like an API key");
+                    break;
+                }
                 setStatusMessage("API key set for " + getProviderName(provider));
+                refreshModels(true);
+                currentScreen = Screen::MAIN_MENU;
+                selectedOption = 0;
+            }
+            break;
+        case '\t': // Tab key
+            if (!inputBuffer.empty()) {
+                Provider provider = configManager->getSelectedProvider();
+                if (configManager->addApiKey(provider, inputBuffer)) {
+                    size_t keyCount = configManager->getApiKeys(provider).size();
+                    setStatusMessage("API key added for " + getProviderName(provider) + " (" +
+                                     std::to_string(keyCount) + " keys in pool)");
+                } else {
+                    setStatusMessage("That API key is invalid or already in the pool");
+                }
+                refreshModels(false);
                 currentScreen = Screen::MAIN_MENU;
                 selectedOption = 0;
             }
@@ -587,7 +809,7 @@ void TerminalUI::handleChatInput(int key) {
 void TerminalUI::handleSystemMessageInput(int key) {
     switch (key) {
         case '\n': // Enter key
-            chatSession->setSystemMessage(inputBuffer);
+            session().setSystemMessage(inputBuffer);
             setStatusMessage("System message updated");
             currentScreen = Screen::MAIN_MENU;
             selectedOption = 0;
@@ -608,16 +830,97 @@ void TerminalUI::handleSystemMessageInput(int key) {
     }
 }
 
+ModelRegistry& TerminalUI::registry() {
+    if (!modelRegistry) {
+        StartupTrace::Phase phase("model registry");
+        modelRegistry = std::make_shared<ModelRegistry>();
+    }
+    return *modelRegistry;
+}
+
+void TerminalUI::refreshModels(bool force) {
+    Provider provider = configManager->getSelectedProvider();
+    auto apiKey = configManager->getApiKey(provider);
+    if (apiKey || !ConfigManager::requiresApiKey(provider)) {
+        registry().refreshInBackground(provider, apiKey.value_or(""), configManager->getEndpoints(provider), force);
+    }
+}
+
+ChatSession& TerminalUI::session() {
+    if (!chatSession) {
+        StartupTrace::Phase phase("chat session");
+        chatSession = std::make_unique<ChatSession>(configManager);
+        registry();
+        chatSession->setModelRegistry(modelRegistry);
+    }
+    return *chatSession;
+}
+
+const std::vector<Message>& TerminalUI::syncChatHistory() {
+    ChatSession& chat = session();
+
+    // Copy only the messages appended since the last sync, or everything once the
+    // history was revised; retry if it is revised in between
+    for (;;) {
+        uint64_t revision = chat.getHistoryRevision();
+        size_t begin = revision == chatHistoryRevision ? chatHistory.size() : 0;
+        std::vector<Message> added;
+        if (chat.copyHistory(begin, SIZE_MAX - begin, revision, added)) {
+            chatHistory.resize(begin);
+            chatHistory.insert(chatHistory.end(), std::make_move_iterator(added.begin()),
+                               std::make_move_iterator(added.end()));
+            chatHistoryRevision = revision;
+            return chatHistory;
+        }
+    }
+}
+
 void TerminalUI::setStatusMessage(const std::string& message) {
-    statusMessage = message;
+    if (message != statusMessage) {
+        statusMessage = message;
+        redrawNeeded = true;
+    }
 }
 
 void TerminalUI::clearStatusMessage() {
-    statusMessage.clear();
+    setStatusMessage("");
+}
+
+void TerminalUI::toggleTrace() {
+    if (!Trace::isEnabled()) {
+        Trace::enable();
+        Trace::setThreadName("ui");
+        setStatusMessage("Tracing on; press F12 again to save the trace");
+        return;
+    }
+
+    // --trace names the file; otherwise keep timestamped traces next to the sessions
+    std::filesystem::path path = Trace::getOutputPath();
+    if (path.empty()) {
+        auto t = std::time(nullptr);
+        auto tm = *std::localtime(&t);
+        std::ostringstream name;
+        name << "trace-" << std::put_time(&tm, "%Y%m%d-%H%M%S") << ".json";
+        const char* homeDir = getenv("HOME");
+        path = std::filesystem::path(homeDir ? homeDir : ".") / ".libertymind" / "traces" / name.str();
+    }
+
+    std::string error;
+    if (Trace::write(path, error)) {
+        setStatusMessage("Trace saved to " + path.string());
+    } else {
+        setStatusMessage("Error: " + error);
+    }
 }
 
 std::string TerminalUI::getProviderName(Provider provider) {
-    return "Google";
+    switch (provider) {
+        case Provider::OPENAI_COMPATIBLE:
+            return "OpenAI-compatible";
+        case Provider::GOOGLE:
+        default:
+            return "Google";
+    }
 }
 
 void TerminalUI::refreshChatDisplay() {
@@ -630,22 +933,15 @@ void TerminalUI::sendChatMessage(const std::string& message) {
         setStatusMessage("Sending message to " + getProviderName(configManager->getSelectedProvider()) + "...");
         refreshChatDisplay();
 
-        // Send the message with a safe callback
-        chatSession->sendMessage(message, [this](const std::string& response, bool success) {
-            try {
-                if (!success) {
-                    setStatusMessage("Error: " + response);
-                } else {
-                    clearStatusMessage();
-                }
-
-                refreshChatDisplay();
-            } catch (const std::exception& e) {
-                // Handle any exceptions in the callback
-                setStatusMessage("Error in UI callback: " + std::string(e.what()));
-                refreshChatDisplay();
-            }
+        // The callback runs on a network worker, so the reply is only queued here;
+        // pollBackgroundTasks shows it on the UI thread
+        session().sendMessage(message, [this](const std::string& response, bool success) {
+            std::lock_guard<std::mutex> lock(chatRepliesMutex);
+            chatReplies.push_back({response, success});
         });
+
+        // Mirror the user's message before the reply arrives
+        updateAutoExport();
     } catch (const std::exception& e) {
         // Handle any exceptions in the method
         setStatusMessage("Error sending message: " + std::string(e.what()));
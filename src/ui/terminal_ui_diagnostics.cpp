@@ -0,0 +1,140 @@
+#include "terminal_ui.h"
+#include "alloc_tracker.h"
+#include <ctime>
+#include <filesystem>
+#include <iomanip>
+#include <sstream>
+#include <string>
+
+namespace libertymind {
+
+// Byte counts with a unit that keeps them short
+static std::string formatBytes(int64_t bytes) {
+    const char* units[] = {"B", "KiB", "MiB", "GiB"};
+    double value = static_cast<double>(bytes);
+    size_t unit = 0;
+    while ((value >= 1024.0 || value <= -1024.0) && unit + 1 < sizeof(units) / sizeof(units[0])) {
+        value /= 1024.0;
+        ++unit;
+    }
+
+    std::ostringstream text;
+    text << std::fixed << std::setprecision(unit == 0 ? 0 : 1) << value << " " << units[unit];
+    return text.str();
+}
+
+void TerminalUI::drawDiagnostics() {
+    // Draw header
+    wattron(mainWindow, COLOR_PAIR(1) | A_BOLD);
+    mvwprintw(mainWindow, 0, 0, "Diagnostics");
+    whline(mainWindow, ' ', getmaxx(mainWindow));
+    wattroff(mainWindow, COLOR_PAIR(1) | A_BOLD);
+
+    int y = 2;
+    uint64_t rssKb = 0;
+    uint64_t peakRssKb = 0;
+    AllocTracker::residentMemory(rssKb, peakRssKb);
+    mvwprintw(mainWindow, y++, 2, "Resident memory: %s (peak %s)",
+              formatBytes(static_cast<int64_t>(rssKb) * 1024).c_str(),
+              formatBytes(static_cast<int64_t>(peakRssKb) * 1024).c_str());
+    y++;
+
+    if (!AllocTracker::isEnabled()) {
+        mvwprintw(mainWindow, y++, 2, "Allocation tracking is off.");
+        mvwprintw(mainWindow, y++, 2, "Start synthara with SYNTHARA_TRACK_ALLOCATIONS=1 to count allocations by subsystem.");
+    } else {
+        // One row per subsystem, then the total
+        wattron(mainWindow, A_BOLD);
+        mvwprintw(mainWindow, y++, 2, "%-10s %14s %14s %12s %12s %12s",
+                  "Subsystem", "Allocations", "Frees", "Allocated", "Live", "Peak");
+        wattroff(mainWindow, A_BOLD);
+
+        auto drawRow = [&](const char* name, const AllocStats& stats) {
+            mvwprintw(mainWindow, y++, 2, "%-10s %14llu %14llu %12s %12s %12s", name,
+                      static_cast<unsigned long long>(stats.allocations),
+                      static_cast<unsigned long long>(stats.frees),
+                      formatBytes(static_cast<int64_t>(stats.bytesAllocated)).c_str(),
+                      formatBytes(stats.liveBytes).c_str(),
+                      formatBytes(stats.peakBytes).c_str());
+        };
+
+        for (size_t i = 0; i < static_cast<size_t>(AllocTag::COUNT); ++i) {
+            AllocTag tag = static_cast<AllocTag>(i);
+            drawRow(AllocTracker::tagName(tag), AllocTracker::stats(tag));
+        }
+        wattron(mainWindow, A_BOLD);
+        drawRow("total", AllocTracker::total());
+        wattroff(mainWindow, A_BOLD);
+    }
+
+    // Draw instructions
+    y += 2;
+    mvwprintw(mainWindow, y++, 2, "Instructions:");
+    mvwprintw(mainWindow, y++, 4, "Press S to save a report to ~/.libertymind/diagnostics");
+    mvwprintw(mainWindow, y++, 4, "Press Escape to return to the main menu");
+}
+
+void TerminalUI::drawHud(int y) {
+    // /proc is read at most once a second; everything else is already in memory
+    auto now = std::chrono::steady_clock::now();
+    if (now - hudRssSampled >= std::chrono::seconds(1)) {
+        uint64_t peakKb = 0;
+        AllocTracker::residentMemory(hudRssKb, peakKb);
+        hudRssSampled = now;
+    }
+
+    SessionPerf perf = session().getPerf();
+
+    std::ostringstream hud;
+    hud << std::fixed << std::setprecision(1);
+    hud << "frame " << lastFrameMilliseconds << " ms";
+    if (perf.lastTotalSeconds > 0.0) {
+        hud << " | ttfb " << perf.lastTtfbSeconds * 1000.0 << " ms, total " << perf.lastTotalSeconds * 1000.0 << " ms";
+    } else {
+        hud << " | ttfb -, total -";
+    }
+    hud << " | " << perf.tokensPerSecond << " tok/s" << (perf.streaming ? " (live)" : "");
+    hud << " | in flight " << perf.requestsInFlight;
+    if (perf.cacheLookups > 0) {
+        hud << " | cache " << perf.cacheHits << "/" << perf.cacheLookups << " hits";
+    } else {
+        hud << " | cache -";
+    }
+    hud << " | history " << perf.historyMessages << " msgs, " << formatBytes(static_cast<int64_t>(perf.historyBytes));
+    hud << " | rss " << formatBytes(static_cast<int64_t>(hudRssKb) * 1024);
+
+    wattron(mainWindow, A_REVERSE);
+    mvwprintw(mainWindow, y, 0, "%.*s", getmaxx(mainWindow), hud.str().c_str());
+    whline(mainWindow, ' ', getmaxx(mainWindow));
+    wattroff(mainWindow, A_REVERSE);
+}
+
+void TerminalUI::handleDiagnosticsInput(int key) {
+    switch (key) {
+        case 's':
+        case 'S': {
+            auto t = std::time(nullptr);
+            auto tm = *std::localtime(&t);
+            std::ostringstream name;
+            name << "alloc-" << std::put_time(&tm, "%Y%m%d-%H%M%S") << ".json";
+            const char* homeDir = getenv("HOME");
+            std::filesystem::path path =
+                std::filesystem::path(homeDir ? homeDir : ".") / ".libertymind" / "diagnostics" / name.str();
+
+            std::string error;
+            if (AllocTracker::writeReport(path, error)) {
+                setStatusMessage("Report saved to " + path.string());
+            } else {
+                setStatusMessage("Error: " + error);
+            }
+            break;
+        }
+        case 27: // Escape key
+        case 'q':
+            currentScreen = Screen::MAIN_MENU;
+            selectedOption = 0;
+            break;
+    }
+}
+
+} // namespace libertymind
@@ -1,5 +1,6 @@
 #include "terminal_ui.h"
 #include "markdown_exporter.h"
+#include <algorithm>
 #include <filesystem>
 #include <iostream>
 
@@ -22,12 +23,19 @@ void TerminalUI::drawMarkdownExport() {
     mvwprintw(mainWindow, y++, 2, "Instructions:");
     mvwprintw(mainWindow, y++, 4, "Enter a file path to save the chat history as a Markdown file");
     mvwprintw(mainWindow, y++, 4, "Press Enter to save");
+    mvwprintw(mainWindow, y++, 4, "Press Tab to keep this file updated after every message (auto-export)");
     mvwprintw(mainWindow, y++, 4, "Press Escape to cancel");
     
     // Draw sample path
     const char* homeDir = getenv("HOME");
     std::string samplePath = homeDir ? std::string(homeDir) + "/chat_export.md" : "./chat_export.md";
     mvwprintw(mainWindow, y++, 4, "Example: %s", samplePath.c_str());
+
+    // Show the current auto-export binding
+    if (autoExporter.isBound()) {
+        y++;
+        mvwprintw(mainWindow, y++, 2, "Auto-export: %s", autoExporter.getPath().c_str());
+    }
     
     // Show cursor
     curs_set(1);
@@ -37,24 +45,40 @@ void TerminalUI::drawMarkdownExport() {
 void TerminalUI::handleMarkdownExportInput(int key) {
     switch (key) {
         case '\n': // Enter key
-            if (!inputBuffer.empty()) {
-                // Get chat history from chat session
-                const auto& history = chatSession->getHistory();
-                
-                // Export to Markdown
-                bool success = MarkdownExporter::exportChatToMarkdown(history, inputBuffer);
-                
-                if (success) {
-                    setStatusMessage("Chat history exported to " + inputBuffer);
-                } else {
-                    setStatusMessage("Error: Failed to export chat history");
-                }
+            if (autoExporter.isBound() && autoExporter.getPath() == inputBuffer) {
+                // The mirror only needs the messages added since its last update
+                updateAutoExport();
+                setStatusMessage("Chat history exported to " + inputBuffer);
+                currentScreen = Screen::CHAT;
+                clearInputBuffer();
+            } else if (exportRunning) {
+                setStatusMessage("An export is already in progress");
+            } else if (!inputBuffer.empty()) {
+                // Export to Markdown in the background
+                startMarkdownExport(inputBuffer);
                 
                 // Return to chat screen
                 currentScreen = Screen::CHAT;
                 clearInputBuffer();
             }
             break;
+        case '\t': // Tab key toggles auto-export for this path
+            if (autoExporter.isBound() && autoExporter.getPath() == inputBuffer) {
+                autoExporter.unbind();
+                setStatusMessage("Auto-export disabled");
+            } else if (!inputBuffer.empty()) {
+                autoExporter.bind(inputBuffer);
+                const std::vector<Message>& history = syncChatHistory();
+                if (autoExporter.update(history, chatHistoryRevision)) {
+                    setStatusMessage("Auto-exporting chat history to " + inputBuffer);
+                } else {
+                    autoExporter.unbind();
+                    setStatusMessage("Error: Failed to export chat history");
+                }
+            }
+            currentScreen = Screen::CHAT;
+            clearInputBuffer();
+            break;
         case 27: // Escape key
             currentScreen = Screen::CHAT;
             clearInputBuffer();
@@ -71,4 +95,96 @@ void TerminalUI::handleMarkdownExportInput(int key) {
     }
 }
 
+void TerminalUI::startMarkdownExport(const std::string& filePath) {
+    if (exportThread.joinable()) {
+        exportThread.join();
+    }
+
+    // Read the live history a batch at a time instead of copying it; the UI keeps
+    // appending meanwhile, and clearing it or editing the system message fails the export
+    ChatSession* chat = &session();
+    uint64_t revision = chat->getHistoryRevision();
+    size_t count = chat->getHistorySize();
+
+    exportPath = filePath;
+    exportDone = 0;
+    exportTotal = count;
+    exportSucceeded = false;
+    exportRunning = true;
+    setStatusMessage("Exporting chat history to " + filePath + "...");
+
+    exportThread = std::thread([this, chat, revision, count, filePath]() {
+        bool success = MarkdownExporter::exportChatToMarkdown(count,
+            [chat, revision](size_t begin, size_t batchSize, std::vector<Message>& messages) {
+                return chat->copyHistory(begin, batchSize, revision, messages);
+            },
+            filePath,
+            [this](size_t done, size_t) {
+                exportDone.store(done, std::memory_order_relaxed);
+            });
+        exportSucceeded = success;
+        exportRunning = false;
+    });
+}
+
+// Called on the UI thread only, with a copy of the history rather than the live one
+void TerminalUI::updateAutoExport() {
+    if (!autoExporter.isBound()) {
+        return;
+    }
+
+    const std::vector<Message>& history = syncChatHistory();
+    if (!autoExporter.update(history, chatHistoryRevision)) {
+        setStatusMessage("Error: Failed to update " + autoExporter.getPath());
+    }
+}
+
+void TerminalUI::pollBackgroundTasks() {
+    // Apply the saved theme once it has been read
+    if (pendingTheme.valid() &&
+        pendingTheme.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+        std::optional<Theme> theme = pendingTheme.get();
+        if (theme) {
+            currentTheme = *theme;
+            initializeColorPairs();
+            redrawNeeded = true;
+        }
+    }
+
+    // Show replies that finished since the last frame
+    std::vector<ChatReply> replies;
+    {
+        std::lock_guard<std::mutex> lock(chatRepliesMutex);
+        replies.swap(chatReplies);
+    }
+    for (const ChatReply& reply : replies) {
+        if (!reply.success) {
+            setStatusMessage("Error: " + reply.response);
+        } else {
+            clearStatusMessage();
+            updateAutoExport();
+        }
+    }
+
+    // Tell the user when another process changed the configuration
+    uint64_t reloads = configManager->getReloadCount();
+    if (reloads != seenConfigReloads) {
+        seenConfigReloads = reloads;
+        setStatusMessage("Configuration reloaded from disk");
+    }
+
+    if (exportRunning) {
+        size_t total = std::max<size_t>(exportTotal, 1);
+        size_t percent = exportDone * 100 / total;
+        setStatusMessage("Exporting chat history to " + exportPath + "... " + std::to_string(percent) + "%");
+    } else if (exportThread.joinable()) {
+        exportThread.join();
+        if (exportSucceeded) {
+            setStatusMessage("Chat history exported to " + exportPath);
+        } else {
+            setStatusMessage("Error: Failed to export chat history");
+        }
+    }
+}
+
 } // namespace libertymind
@@ -52,52 +52,63 @@ bool TerminalUI::saveTheme() const {
 }
 
 bool TerminalUI::loadTheme() {
+    std::optional<Theme> theme = readThemeFile();
+    if (!theme) {
+        return false;
+    }
+    currentTheme = *theme;
+    return true;
+}
+
+std::optional<TerminalUI::Theme> TerminalUI::readThemeFile() {
+    Theme theme;
+
     try {
         // Get theme file path
         const char* homeDir = getenv("HOME");
         if (!homeDir) {
-            return false;
+            return std::nullopt;
         }
         
         fs::path themePath = fs::path(homeDir) / ".libertymind" / "theme.json";
         if (!fs::exists(themePath)) {
-            return false;
+            return std::nullopt;
         }
         
         // Read theme file
         std::ifstream file(themePath);
         if (!file.is_open()) {
-            return false;
+            return std::nullopt;
         }
         
         json themeJson = json::parse(file);
         
         // Load theme settings
         if (themeJson.contains("headerFg")) {
-            currentTheme.headerFg = themeJson["headerFg"];
+            theme.headerFg = themeJson["headerFg"];
         }
         if (themeJson.contains("headerBg")) {
-            currentTheme.headerBg = themeJson["headerBg"];
+            theme.headerBg = themeJson["headerBg"];
         }
         if (themeJson.contains("selectedFg")) {
-            currentTheme.selectedFg = themeJson["selectedFg"];
+            theme.selectedFg = themeJson["selectedFg"];
         }
         if (themeJson.contains("selectedBg")) {
-            currentTheme.selectedBg = themeJson["selectedBg"];
+            theme.selectedBg = themeJson["selectedBg"];
         }
         if (themeJson.contains("userMsgFg")) {
-            currentTheme.userMsgFg = themeJson["userMsgFg"];
+            theme.userMsgFg = themeJson["userMsgFg"];
         }
         if (themeJson.contains("assistantMsgFg")) {
-            currentTheme.assistantMsgFg = themeJson["assistantMsgFg"];
+            theme.assistantMsgFg = themeJson["assistantMsgFg"];
         }
         if (themeJson.contains("errorMsgFg")) {
-            currentTheme.errorMsgFg = themeJson["errorMsgFg"];
+            theme.errorMsgFg = themeJson["errorMsgFg"];
         }
         
-        return true;
+        return theme;
     } catch (const std::exception& e) {
-        return false;
+        return std::nullopt;
     }
 }
 
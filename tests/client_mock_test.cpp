@@ -0,0 +1,550 @@
+// End-to-end checks of GoogleClient and OpenAIClient against synthara-mock:
+// streaming, failover on 5xx, 429 and stalls, a batch job round trip, an ordered
+// BatchRunner interrupted and resumed, and a cassette recording that replays to
+// the same results without the server.
+//
+//   synthara-client-test MOCK_BINARY CASE
+//
+// Each case starts its own mock on a free loopback port and exits non-zero
+// when a check fails. ctest runs every case (see CMakeLists.txt).
+
+#include "api_client.h"
+#include "api_key_pool.h"
+#include "batch_runner.h"
+#include "config_manager.h"
+#include "endpoint_selector.h"
+#include "network_loop.h"
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace libertymind;
+namespace fs = std::filesystem;
+
+namespace {
+
+// Longest any single completion or batch job may take before the test gives up
+const auto kTimeout = std::chrono::seconds(30);
+
+const char* kApiKey = "test-key-0123456789";
+
+bool failed = false;
+
+void check(bool condition, const std::string& what) {
+    if (!condition) {
+        std::cerr << "FAILED: " << what << std::endl;
+        failed = true;
+    }
+}
+
+fs::path tempPath(const std::string& suffix) {
+    static int count = 0;
+    return fs::temp_directory_path() /
+           ("synthara-test-" + std::to_string(getpid()) + "-" + std::to_string(count++) + suffix);
+}
+
+// Connect to 127.0.0.1:port, or with port 0 bind a free one; returns the socket
+int loopbackSocket(int& port) {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    struct sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(static_cast<uint16_t>(port));
+    if (port == 0) {
+        socklen_t length = sizeof(address);
+        bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+        getsockname(fd, reinterpret_cast<sockaddr*>(&address), &length);
+        port = ntohs(address.sin_port);
+        return fd;
+    }
+    if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// A synthara-mock process on a loopback port of its own. (Batch uploads go to
+// the URL the mock hands out, which only works over TCP.)
+class MockServer {
+public:
+    MockServer(const std::string& binary, std::vector<std::string> args) {
+        close(loopbackSocket(port));
+        args.insert(args.begin(), {binary, "--port", std::to_string(port)});
+        pid = fork();
+        if (pid == 0) {
+            int devNull = open("/dev/null", O_WRONLY);
+            dup2(devNull, STDOUT_FILENO);
+            std::vector<char*> argv;
+            for (auto& arg : args) {
+                argv.push_back(arg.data());
+            }
+            argv.push_back(nullptr);
+            execv(binary.c_str(), argv.data());
+            _exit(127);
+        }
+    }
+
+    ~MockServer() { stop(); }
+
+    MockServer(const MockServer&) = delete;
+    MockServer& operator=(const MockServer&) = delete;
+
+    // Wait until the socket accepts connections; false if the mock died or never listened
+    bool waitReady() {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (std::chrono::steady_clock::now() < deadline) {
+            if (pid <= 0 || waitpid(pid, nullptr, WNOHANG) != 0) {
+                return false;
+            }
+            int fd = loopbackSocket(port);
+            if (fd >= 0) {
+                close(fd);
+                return true;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+        return false;
+    }
+
+    void stop() {
+        if (pid > 0) {
+            kill(pid, SIGTERM);
+            waitpid(pid, nullptr, 0);
+            pid = -1;
+        }
+    }
+
+    std::string url() const { return "http://127.0.0.1:" + std::to_string(port); }
+
+private:
+    int port = 0;
+    pid_t pid = -1;
+};
+
+std::unique_ptr<ApiClient> makeClient(Provider provider, const std::vector<std::string>& endpoints,
+                                      std::shared_ptr<ApiKeyPool> pool = nullptr) {
+    std::unique_ptr<ApiClient> client = pool ? createApiClient(provider, pool) : createApiClient(provider, kApiKey);
+    client->setEndpointSelector(std::make_shared<EndpointSelector>(endpoints));
+    return client;
+}
+
+// Run one completion to the end, collecting streamed chunks when asked
+CompletionResult complete(ApiClient& client, const std::string& prompt, std::vector<std::string>* chunks = nullptr) {
+    auto mutex = std::make_shared<std::mutex>();
+    StreamCallback onChunk;
+    if (chunks) {
+        onChunk = [mutex, chunks](const std::string& chunk) {
+            std::lock_guard<std::mutex> lock(*mutex);
+            chunks->push_back(chunk);
+        };
+    }
+
+    auto promise = std::make_shared<std::promise<CompletionResult>>();
+    std::future<CompletionResult> future = promise->get_future();
+    startTask(client.complete({{{"user", prompt}}, "gemini-2.0-flash", onChunk}),
+        [promise](const CompletionResult& result) { promise->set_value(result); },
+        [promise](const std::string& error) {
+            CompletionResult result;
+            result.response = "Error: " + error;
+            promise->set_value(result);
+        });
+    if (future.wait_for(kTimeout) != std::future_status::ready) {
+        check(false, "completion finished in time");
+        std::exit(1);
+    }
+    std::lock_guard<std::mutex> lock(*mutex);
+    return future.get();
+}
+
+std::string join(const std::vector<std::string>& parts) {
+    std::string joined;
+    for (const auto& part : parts) {
+        joined += part;
+    }
+    return joined;
+}
+
+bool startMock(MockServer& mock) {
+    bool ready = mock.waitReady();
+    check(ready, "synthara-mock started");
+    return ready;
+}
+
+// Chunks arrive in order through the client's callbacks, ahead of usage and the reply
+void checkStreaming(const std::string& binary, Provider provider) {
+    MockServer mock(binary, {"--ttfb", "5", "--tps", "0", "--reply-tokens", "24", "--chunk-tokens", "4"});
+    if (!startMock(mock)) {
+        return;
+    }
+    std::unique_ptr<ApiClient> client = makeClient(provider, {mock.url()});
+
+    std::mutex mutex;
+    std::vector<std::string> chunks;
+    TokenUsage usage;
+    RequestStats stats;
+    bool replied = false;
+    bool chunkAfterReply = false;
+    client->setStreamCallback([&](const std::string& chunk) {
+        std::lock_guard<std::mutex> lock(mutex);
+        chunkAfterReply = chunkAfterReply || replied;
+        chunks.push_back(chunk);
+    });
+    client->setUsageCallback([&](const TokenUsage& reported) { usage = reported; });
+    client->setRequestStatsCallback([&](const RequestStats& reported) { stats = reported; });
+
+    std::promise<std::pair<std::string, bool>> promise;
+    std::future<std::pair<std::string, bool>> future = promise.get_future();
+    client->sendChatCompletion({{"user", "hello"}}, "gemini-2.0-flash",
+        [&](const std::string& response, bool success) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                replied = true;
+            }
+            promise.set_value({response, success});
+        });
+    if (future.wait_for(kTimeout) != std::future_status::ready) {
+        check(false, "streamed completion finished in time");
+        return;
+    }
+    auto [response, success] = future.get();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    check(success, "streamed completion succeeded: " + response);
+    check(response.rfind("Mock reply to \"hello\":", 0) == 0, "reply echoes the prompt: " + response);
+    check(chunks.size() == 6, "24 tokens arrive as 6 chunks, got " + std::to_string(chunks.size()));
+    check(join(chunks) == response, "chunks add up to the reply");
+    check(!chunkAfterReply, "no chunk arrives after the reply");
+    check(usage.outputTokens == 24, "usage reports 24 output tokens");
+    check(stats.status == 200 && stats.success, "stats report HTTP 200");
+}
+
+// A failing endpoint hands over to the next one; a throttled key rests while another serves
+void checkFailover(const std::string& binary, Provider provider) {
+    MockServer failing(binary, {"--ttfb", "0", "--tps", "0", "--fail", "503:1"});
+    MockServer healthy(binary, {"--ttfb", "0", "--tps", "0"});
+    if (!startMock(failing) || !startMock(healthy)) {
+        return;
+    }
+
+    std::unique_ptr<ApiClient> client = makeClient(provider, {failing.url(), healthy.url()});
+    CompletionResult result = complete(*client, "fail over");
+    check(result.success, "request fails over past the 503 endpoint: " + result.response);
+    check(result.stats.status == 200, "failed-over request ends with HTTP 200");
+
+    // Only the first request is throttled
+    fs::path profile = tempPath(".json");
+    std::ofstream(profile) << R"({"ttfb_ms": 0, "tokens_per_second": 0, "script": [{"status": 429}]})";
+    MockServer throttling(binary, {"--profile", profile.string()});
+    if (!startMock(throttling)) {
+        fs::remove(profile);
+        return;
+    }
+
+    auto pool = std::make_shared<ApiKeyPool>(std::vector<std::string>{"key-a-0123456789", "key-b-0123456789"});
+    client = makeClient(provider, {throttling.url()}, pool);
+    CompletionResult throttled = complete(*client, "throttle me");
+    check(!throttled.success && throttled.stats.status == 429, "first request is throttled with HTTP 429");
+    CompletionResult retried = complete(*client, "throttle me");
+    check(retried.success, "next request succeeds on the other key: " + retried.response);
+
+    size_t cooling = 0;
+    for (const auto& key : pool->getStatus()) {
+        check(key.requests == 1, "each key served one request");
+        cooling += key.coolingDown && key.throttled == 1 ? 1 : 0;
+    }
+    check(cooling == 1, "the throttled key is cooling down");
+    fs::remove(profile);
+}
+
+// An endpoint that accepts the request and then goes silent is given up on, and the next one answers
+void checkStall(const std::string& binary, Provider provider) {
+    // Read on the first transfer, so set before any request
+    setenv("SYNTHARA_STALL_TIMEOUT_S", "1", 1);
+
+    MockServer stalled(binary, {"--ttfb", "0", "--tps", "0", "--stall", "1", "--stall-ms", "0"});
+    MockServer healthy(binary, {"--ttfb", "0", "--tps", "0"});
+    if (!startMock(stalled) || !startMock(healthy)) {
+        return;
+    }
+
+    std::unique_ptr<ApiClient> client = makeClient(provider, {stalled.url(), healthy.url()});
+    auto started = std::chrono::steady_clock::now();
+    CompletionResult result = complete(*client, "stall");
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - started;
+    check(result.success, "request fails over past the stalled endpoint: " + result.response);
+    // curl averages the transfer rate over a few seconds, so the cut-off comes that much later
+    check(elapsed < std::chrono::seconds(10),
+          "the stall is cut off after the stall timeout, took " + std::to_string(elapsed.count()) + " s");
+}
+
+// Submit a batch job, wait for it, and get every result back under its own key
+std::map<std::string, BatchResult> runBatch(ApiClient& client, size_t count, std::string& error) {
+    std::vector<BatchRequest> requests;
+    for (size_t i = 0; i < count; ++i) {
+        BatchRequest request;
+        request.key = "request-" + std::to_string(i);
+        request.messages = {{"user", "batch prompt " + std::to_string(i)}};
+        requests.push_back(request);
+    }
+
+    BatchJobOptions options;
+    options.pollInterval = std::chrono::milliseconds(50);
+    options.maxPollInterval = std::chrono::milliseconds(200);
+
+    std::map<std::string, BatchResult> results;
+    bool ok = client.runBatchJob(requests, "gemini-2.0-flash", options,
+                                 [&](const BatchResult& result) { results[result.key] = result; }, error);
+    if (!ok && error.empty()) {
+        error = "batch job failed";
+    }
+    return results;
+}
+
+void checkBatch(const std::string& binary) {
+    MockServer mock(binary, {"--ttfb", "0", "--tps", "0", "--batch-ms", "100"});
+    if (!startMock(mock)) {
+        return;
+    }
+    std::unique_ptr<ApiClient> client = makeClient(Provider::GOOGLE, {mock.url()});
+
+    std::string error;
+    std::map<std::string, BatchResult> results = runBatch(*client, 3, error);
+    check(error.empty(), "batch job completed: " + error);
+    check(results.size() == 3, "every batch request has a result");
+    for (size_t i = 0; i < 3; ++i) {
+        const BatchResult& result = results["request-" + std::to_string(i)];
+        check(result.success, "batch result " + std::to_string(i) + " succeeded: " + result.response);
+        check(result.response.find("batch prompt " + std::to_string(i)) != std::string::npos,
+              "batch result " + std::to_string(i) + " answers its own prompt");
+    }
+}
+
+// A config that points the provider at the mock; HOME should be a scratch directory
+std::shared_ptr<ConfigManager> makeConfig(Provider provider, const std::string& url) {
+    auto config = std::make_shared<ConfigManager>();
+    config->setReadOnly(true);
+    config->setSelectedProvider(provider);
+    config->setApiKey(provider, kApiKey);
+    config->setEndpoints(provider, {url});
+    return config;
+}
+
+// Run a batch to the end, or until interruptAfter when that is set
+bool runBatchFile(std::shared_ptr<ConfigManager> config, const BatchOptions& options, std::string& error,
+                  std::chrono::milliseconds interruptAfter = std::chrono::milliseconds(0)) {
+    BatchRunner runner(config, options);
+    std::promise<void> finished;
+    std::thread interrupter;
+    if (interruptAfter.count() > 0) {
+        interrupter = std::thread([&runner, interruptAfter, future = finished.get_future()]() {
+            if (future.wait_for(interruptAfter) == std::future_status::timeout) {
+                runner.interrupt();
+            }
+        });
+    }
+    bool ok = runner.run([](const BatchProgress&) {});
+    finished.set_value();
+    if (interrupter.joinable()) {
+        interrupter.join();
+    }
+    error = runner.getError();
+    return ok;
+}
+
+// An ordered batch stopped part way resumes where it left off: the partial line a crash
+// left behind is cut off, and every item ends up in the output once, in input order
+void checkBatchResume(const std::string& binary) {
+    // Replies finish out of order, so the interruption leaves results in the reorder buffer
+    MockServer mock(binary, {"--ttfb", "20", "--jitter", "150", "--tps", "0"});
+    if (!startMock(mock)) {
+        return;
+    }
+
+    const size_t count = 60;
+    BatchOptions options;
+    options.inputPath = tempPath(".input.jsonl");
+    options.outputPath = tempPath(".output.jsonl");
+    options.checkpointPath = options.outputPath.string() + ".checkpoint";
+    options.concurrency = 6;
+    options.model = "gemini-2.0-flash";
+    {
+        std::ofstream input(options.inputPath);
+        for (size_t i = 0; i < count; ++i) {
+            input << nlohmann::json({{"id", "item-" + std::to_string(i)}, {"prompt", "resume " + std::to_string(i)}})
+                  << "\n";
+        }
+    }
+
+    // Keep the user's own config out of it
+    fs::path home = tempPath(".home");
+    fs::create_directories(home);
+    setenv("HOME", home.c_str(), 1);
+    std::shared_ptr<ConfigManager> config = makeConfig(Provider::GOOGLE, mock.url());
+    std::string error;
+    runBatchFile(config, options, error, std::chrono::milliseconds(400));
+    check(error.empty(), "interrupted run has no error: " + error);
+    check(fs::exists(options.checkpointPath), "interrupted run leaves a checkpoint");
+    size_t firstRun = 0;
+    {
+        std::ifstream output(options.outputPath);
+        std::string line;
+        while (std::getline(output, line)) {
+            ++firstRun;
+        }
+    }
+    check(firstRun > 0 && firstRun < count,
+          "interruption stops part way, after " + std::to_string(firstRun) + " of " + std::to_string(count));
+    std::ofstream(options.outputPath, std::ios::app) << "{\"index\": 0, \"partial";
+
+    options.resume = true;
+    std::shared_ptr<ConfigManager> other = makeConfig(Provider::OPENAI_COMPATIBLE, mock.url());
+    check(!runBatchFile(other, options, error) && error.find("provider google") != std::string::npos,
+          "resuming against another provider is refused: " + error);
+
+    check(runBatchFile(config, options, error), "resumed run completes: " + error);
+    check(!fs::exists(options.checkpointPath), "finished run removes the checkpoint");
+
+    std::ifstream output(options.outputPath);
+    std::string line;
+    size_t expected = 0;
+    while (std::getline(output, line)) {
+        nlohmann::json result = nlohmann::json::parse(line, nullptr, false);
+        bool inOrder = !result.is_discarded() && result.value("index", count) == expected &&
+                       result.value("id", "") == "item-" + std::to_string(expected);
+        check(inOrder, "line " + std::to_string(expected) + " holds item " + std::to_string(expected) + ": " + line);
+        check(result.value("success", false), "item " + std::to_string(expected) + " succeeded: " + line);
+        if (!inOrder) {
+            break;
+        }
+        ++expected;
+    }
+    check(expected == count, "every item is written once, got " + std::to_string(expected) + " lines");
+
+    fs::remove(options.inputPath);
+    fs::remove(options.outputPath);
+    fs::remove_all(home);
+}
+
+// Child side of the cassette case: a streamed completion and a small batch, written to out
+int writeTranscript(const std::string& url, const std::string& out) {
+    std::unique_ptr<ApiClient> client = makeClient(Provider::GOOGLE, {url});
+    std::vector<std::string> chunks;
+    CompletionResult result = complete(*client, "record me", &chunks);
+
+    std::string error;
+    std::map<std::string, BatchResult> batch = runBatch(*client, 2, error);
+
+    std::ofstream file(out);
+    file << result.success << " " << result.stats.status << " " << result.usage.outputTokens << "\n"
+         << result.response << "\n" << chunks.size() << "\n" << error << "\n";
+    for (const auto& [key, item] : batch) {
+        file << key << " " << item.success << " " << item.response << "\n";
+    }
+    NetworkLoop::shutdown();
+    return result.success && error.empty() ? 0 : 1;
+}
+
+// Run this test binary's transcript case with the cassette in the given mode
+bool runTranscript(const std::string& mode, const fs::path& cassette, const std::string& url, const fs::path& out) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        setenv("SYNTHARA_VCR", mode.c_str(), 1);
+        setenv("SYNTHARA_VCR_CASSETTE", cassette.c_str(), 1);
+        setenv("SYNTHARA_VCR_SPEED", "max", 1);
+        execl("/proc/self/exe", "synthara-client-test", "-", "transcript", url.c_str(), out.c_str(),
+              static_cast<char*>(nullptr));
+        _exit(127);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+std::string readFile(const fs::path& path) {
+    std::ifstream file(path);
+    std::stringstream contents;
+    contents << file.rdbuf();
+    return contents.str();
+}
+
+// What was recorded against the mock replays to the same results once it is gone
+void checkCassette(const std::string& binary) {
+    fs::path cassette = tempPath(".cassette.jsonl");
+    fs::path recorded = tempPath(".recorded");
+    fs::path replayed = tempPath(".replayed");
+
+    MockServer mock(binary, {"--ttfb", "5", "--tps", "0", "--reply-tokens", "24", "--chunk-tokens", "4",
+                             "--batch-ms", "100"});
+    if (startMock(mock)) {
+        check(runTranscript("record", cassette, mock.url(), recorded), "recording run succeeded");
+        mock.stop();
+        check(runTranscript("replay", cassette, mock.url(), replayed), "replay run succeeded without the mock");
+
+        std::string expected = readFile(recorded);
+        check(!expected.empty() && expected == readFile(replayed),
+              "replay matches the recording:\n" + expected + "---\n" + readFile(replayed));
+        check(readFile(cassette).find(kApiKey) == std::string::npos, "cassette holds no API key");
+    }
+
+    fs::remove(cassette);
+    fs::remove(recorded);
+    fs::remove(replayed);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc >= 5 && std::string(argv[2]) == "transcript") {
+        return writeTranscript(argv[3], argv[4]);
+    }
+
+    const std::map<std::string, std::function<void(const std::string&)>> cases = {
+        {"google_stream", [](const std::string& binary) { checkStreaming(binary, Provider::GOOGLE); }},
+        {"openai_stream", [](const std::string& binary) { checkStreaming(binary, Provider::OPENAI_COMPATIBLE); }},
+        {"google_failover", [](const std::string& binary) { checkFailover(binary, Provider::GOOGLE); }},
+        {"openai_failover", [](const std::string& binary) { checkFailover(binary, Provider::OPENAI_COMPATIBLE); }},
+        {"google_stall", [](const std::string& binary) { checkStall(binary, Provider::GOOGLE); }},
+        {"openai_stall", [](const std::string& binary) { checkStall(binary, Provider::OPENAI_COMPATIBLE); }},
+        {"google_batch", checkBatch},
+        {"batch_resume", checkBatchResume},
+        {"cassette", checkCassette},
+    };
+
+    auto found = argc == 3 ? cases.find(argv[2]) : cases.end();
+    if (found == cases.end()) {
+        std::cerr << "Usage: synthara-client-test MOCK_BINARY CASE" << std::endl;
+        std::cerr << "Cases:";
+        for (const auto& [name, run] : cases) {
+            std::cerr << " " << name;
+        }
+        std::cerr << std::endl;
+        return 2;
+    }
+
+    found->second(argv[1]);
+    NetworkLoop::shutdown();
+    if (!failed) {
+        std::cout << found->first << ": passed" << std::endl;
+    }
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,576 @@
+// synthara-loadgen: drives the real ChatSession/ApiClient stack with many
+// requests at once and reports how it holds up: latency percentiles, achieved
+// requests/s, resident memory and thread counts over time, and errors.
+//
+// With --rate the load is open-loop: requests are scheduled at fixed
+// intervals and their latency is measured from the scheduled time, so a slow
+// server (or a full --concurrency limit) shows up as queueing delay instead of
+// silently lowering the load (coordinated omission). Without --rate each of
+// --concurrency workers sends its next request as soon as the last one ends;
+// latencies are then service times and the report says so.
+//
+//   synthara-mock --port 8089 --ttfb 200 --tps 100 &
+//   synthara-loadgen --endpoint http://127.0.0.1:8089 --rate 50 --concurrency 64 --duration 30
+
+#include "chat_session.h"
+#include "config_manager.h"
+#include "latency_histogram.h"
+#include "network_loop.h"
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstdlib>
+#include <curl/curl.h>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+using namespace libertymind;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+struct Options {
+    std::string endpoint;
+    std::string provider;
+    std::string model;
+    size_t concurrency = 8;     // Requests in flight at most
+    double rate = 0.0;          // Scheduled requests per second (0 = closed loop)
+    double duration = 30.0;     // Seconds of measured load
+    double warmup = 0.0;        // Seconds of load before measuring
+    size_t promptBytes = 0;     // Pad the prompt to this size
+    std::string prompt = "Reply with one short sentence about load testing.";
+    bool stream = false;        // Measure time to first token as well
+    double interval = 1.0;      // Seconds between progress lines
+    std::string jsonPath;       // Final report as JSON
+};
+
+volatile std::sig_atomic_t stopRequested = 0;
+
+void handleStopSignal(int) {
+    stopRequested = 1;
+}
+
+// Resident set size in bytes and thread count of this process
+void readProcessStats(uint64_t& rssBytes, int& threads) {
+    rssBytes = 0;
+    threads = 0;
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.rfind("VmRSS:", 0) == 0) {
+            rssBytes = std::strtoull(line.c_str() + 6, nullptr, 10) * 1024;
+        } else if (line.rfind("Threads:", 0) == 0) {
+            threads = std::atoi(line.c_str() + 8);
+        }
+    }
+}
+
+double micros(Clock::duration duration) {
+    return static_cast<double>(std::chrono::duration_cast<std::chrono::microseconds>(duration).count());
+}
+
+double seconds(Clock::duration duration) {
+    return std::chrono::duration<double>(duration).count();
+}
+
+// Error messages without request-specific details, so equal failures group together
+std::string errorKind(const std::string& response) {
+    std::string kind = response.substr(0, response.find('\n'));
+    if (kind.size() > 80) {
+        kind = kind.substr(0, 77) + "...";
+    }
+    return kind.empty() ? "Error: (empty)" : kind;
+}
+
+// One point of the time series printed while the load runs
+struct Sample {
+    double elapsed;
+    size_t completed;
+    size_t errors;
+    size_t inFlight;
+    size_t backlog;
+    double requestsPerSecond;
+    int64_t p50Micros;
+    int64_t p99Micros;
+    uint64_t rssBytes;
+    int threads;
+};
+
+class LoadGenerator {
+public:
+    explicit LoadGenerator(Options options) : options(std::move(options)) {}
+
+    int run();
+
+private:
+    // A worker with its own session; requests on one slot never overlap
+    struct Slot {
+        std::unique_ptr<ChatSession> session;
+        Clock::time_point intended;
+        Clock::time_point started;
+        Clock::time_point firstToken;
+        bool busy = false;
+    };
+
+    Options options;
+    std::shared_ptr<ConfigManager> configManager;
+    std::vector<Slot> slots;
+
+    std::mutex mutex;
+    std::condition_variable condition;
+    size_t inFlight = 0;
+    size_t backlog = 0;             // Scheduled but waiting for a free slot
+
+    Clock::time_point startTime;
+    Clock::time_point measureFrom;
+    Clock::time_point measureUntil;
+
+    // Measured requests only (scheduled after warmup)
+    LatencyHistogram latency;       // From the scheduled time in open-loop mode
+    LatencyHistogram serviceTime;   // From the time the request was sent
+    LatencyHistogram firstToken;
+    LatencyHistogram intervalLatency;
+    size_t completed = 0;
+    size_t errors = 0;
+    size_t intervalCompleted = 0;
+    std::map<std::string, size_t> errorKinds;
+    std::vector<Sample> samples;
+
+    bool setUp();
+    void reserve(size_t index, Clock::time_point intended);
+    void send(size_t index);
+    void complete(size_t index, const std::string& response, bool success);
+    void report(Clock::time_point now);
+    void printSummary(double measuredSeconds);
+    bool writeJson(double measuredSeconds) const;
+};
+
+bool LoadGenerator::setUp() {
+    // Route every client to the requested endpoint for this process only
+    if (!options.endpoint.empty()) {
+        setenv("SYNTHARA_GOOGLE_BASE_URL", options.endpoint.c_str(), 1);
+        setenv("SYNTHARA_OPENAI_BASE_URL", options.endpoint.c_str(), 1);
+    }
+
+    configManager = std::make_shared<ConfigManager>();
+    configManager->setReadOnly(true);
+    configManager->setSaveSessions(false);
+    if (options.provider == "google" || options.provider == "openai") {
+        configManager->setSelectedProvider(ConfigManager::stringToProvider(options.provider));
+    } else if (!options.provider.empty()) {
+        std::cerr << "Error: Unknown provider: " << options.provider << std::endl;
+        return false;
+    }
+    if (!options.model.empty()) {
+        configManager->setSelectedModel(options.model);
+    }
+
+    Provider selected = configManager->getSelectedProvider();
+    if (ConfigManager::requiresApiKey(selected) && configManager->getApiKeys(selected).empty()) {
+        // Stand-in servers accept any key, but never send a made-up one to the real service
+        const char* baseUrl = getenv(selected == Provider::GOOGLE ? "SYNTHARA_GOOGLE_BASE_URL" : "SYNTHARA_OPENAI_BASE_URL");
+        if (!baseUrl || !*baseUrl) {
+            std::cerr << "Error: No API key configured for " << ConfigManager::providerToString(selected)
+                      << "; add one or point --endpoint at a stand-in server" << std::endl;
+            return false;
+        }
+        configManager->addApiKey(selected, "loadgen");
+    }
+
+    if (options.prompt.size() < options.promptBytes) {
+        std::string filler = " Context:";
+        while (options.prompt.size() + filler.size() < options.promptBytes) {
+            filler += " lorem ipsum dolor sit amet";
+        }
+        options.prompt += filler.substr(0, options.promptBytes - options.prompt.size());
+    }
+
+    slots.resize(options.concurrency);
+    for (size_t i = 0; i < slots.size(); ++i) {
+        slots[i].session = std::make_unique<ChatSession>(configManager);
+        slots[i].session->setCalibrationEnabled(false);
+        if (options.stream) {
+            slots[i].session->setStreamCallback([this, i](const std::string&) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (slots[i].firstToken == Clock::time_point()) {
+                    slots[i].firstToken = Clock::now();
+                }
+            });
+        }
+    }
+    return true;
+}
+
+// Claim a free slot for a request (called with the mutex held)
+void LoadGenerator::reserve(size_t index, Clock::time_point intended) {
+    Slot& slot = slots[index];
+    slot.busy = true;
+    slot.intended = intended;
+    slot.started = Clock::now();
+    slot.firstToken = Clock::time_point();
+    ++inFlight;
+}
+
+// Send the request of a reserved slot (called without the mutex: setup errors complete at once)
+void LoadGenerator::send(size_t index) {
+    // Every request starts from an empty history so the payload size stays fixed
+    Slot& slot = slots[index];
+    slot.session->clearHistory();
+    slot.session->sendMessage(options.prompt, [this, index](const std::string& response, bool success) {
+        complete(index, response, success);
+    });
+}
+
+void LoadGenerator::complete(size_t index, const std::string& response, bool success) {
+    Clock::time_point now = Clock::now();
+    std::lock_guard<std::mutex> lock(mutex);
+    Slot& slot = slots[index];
+
+    // Only requests scheduled inside the measurement window count
+    if (slot.intended >= measureFrom && slot.intended < measureUntil) {
+        ++completed;
+        ++intervalCompleted;
+        if (success) {
+            latency.record(static_cast<int64_t>(micros(now - slot.intended)));
+            serviceTime.record(static_cast<int64_t>(micros(now - slot.started)));
+            intervalLatency.record(static_cast<int64_t>(micros(now - slot.intended)));
+            if (slot.firstToken != Clock::time_point()) {
+                firstToken.record(static_cast<int64_t>(micros(slot.firstToken - slot.started)));
+            }
+        } else {
+            ++errors;
+            ++errorKinds[errorKind(response)];
+        }
+    }
+
+    slot.busy = false;
+    --inFlight;
+    condition.notify_all();
+}
+
+// Print one progress line (called with the mutex held)
+void LoadGenerator::report(Clock::time_point now) {
+    Sample sample;
+    sample.elapsed = seconds(now - startTime);
+    sample.completed = completed;
+    sample.errors = errors;
+    sample.inFlight = inFlight;
+    sample.backlog = backlog;
+    sample.requestsPerSecond = intervalCompleted / options.interval;
+    sample.p50Micros = intervalLatency.valueAtPercentile(50);
+    sample.p99Micros = intervalLatency.valueAtPercentile(99);
+    readProcessStats(sample.rssBytes, sample.threads);
+    samples.push_back(sample);
+
+    intervalCompleted = 0;
+    intervalLatency.reset();
+
+    std::cerr << std::fixed << std::setprecision(1)
+              << std::setw(6) << sample.elapsed << "s  "
+              << std::setw(7) << sample.requestsPerSecond << " req/s  "
+              << "p50 " << std::setw(8) << sample.p50Micros / 1000.0 << " ms  "
+              << "p99 " << std::setw(8) << sample.p99Micros / 1000.0 << " ms  "
+              << "in flight " << std::setw(4) << sample.inFlight << "  "
+              << "backlog " << std::setw(5) << sample.backlog << "  "
+              << "errors " << std::setw(5) << sample.errors << "  "
+              << "rss " << std::setw(6) << sample.rssBytes / (1024.0 * 1024.0) << " MB  "
+              << "threads " << sample.threads
+              << (now < measureFrom ? "  (warmup)" : "") << std::endl;
+}
+
+int LoadGenerator::run() {
+    if (!setUp()) {
+        return 2;
+    }
+
+    bool openLoop = options.rate > 0.0;
+    auto interval = openLoop
+        ? std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / options.rate))
+        : Clock::duration::zero();
+    auto reportEvery = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(options.interval));
+
+    startTime = Clock::now();
+    measureFrom = startTime + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(options.warmup));
+    measureUntil = measureFrom + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(options.duration));
+
+    if (openLoop) {
+        std::cerr << "Open loop at " << options.rate << " req/s";
+    } else {
+        std::cerr << "Closed loop";
+    }
+    std::cerr << ", at most " << options.concurrency << " in flight, "
+              << options.warmup << "s warmup + " << options.duration << "s" << std::endl;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    Clock::time_point nextIntended = startTime;
+    Clock::time_point nextReport = startTime + reportEvery;
+    size_t scheduled = 0;
+
+    while (!stopRequested) {
+        Clock::time_point now = Clock::now();
+        if (now >= nextReport) {
+            report(now);
+            nextReport += reportEvery;
+        }
+        if (now >= measureUntil) {
+            break;
+        }
+
+        // Requests whose time has come, including any that are waiting for a slot
+        if (openLoop) {
+            while (nextIntended <= now && nextIntended < measureUntil) {
+                ++backlog;
+                nextIntended = startTime + interval * static_cast<int64_t>(++scheduled);
+            }
+        }
+
+        // Start as many as there are free slots; the backlog keeps its scheduled times
+        std::vector<size_t> ready;
+        for (size_t i = 0; i < slots.size(); ++i) {
+            if (slots[i].busy) {
+                continue;
+            }
+            if (openLoop) {
+                if (backlog == 0) {
+                    break;
+                }
+                Clock::time_point intended = startTime + interval * static_cast<int64_t>(scheduled - backlog);
+                --backlog;
+                reserve(i, intended);
+            } else {
+                reserve(i, Clock::now());
+            }
+            ready.push_back(i);
+        }
+        if (!ready.empty()) {
+            lock.unlock();
+            for (size_t index : ready) {
+                send(index);
+            }
+            lock.lock();
+            continue;
+        }
+
+        Clock::time_point wakeAt = std::min(nextReport, measureUntil);
+        if (openLoop && backlog == 0) {
+            wakeAt = std::min(wakeAt, nextIntended);
+        }
+        condition.wait_until(lock, std::min(wakeAt, Clock::now() + std::chrono::milliseconds(200)));
+    }
+    Clock::time_point stoppedAt = Clock::now();
+
+    // Requests still queued were never sent; their latency is at least the time they waited
+    size_t neverSent = backlog;
+    for (size_t i = 0; i < neverSent; ++i) {
+        Clock::time_point intended = startTime + interval * static_cast<int64_t>(scheduled - neverSent + i);
+        if (intended >= measureFrom) {
+            latency.record(static_cast<int64_t>(micros(stoppedAt - intended)));
+        }
+    }
+    backlog = 0;
+
+    // Let requests in flight finish so their latencies count
+    std::cerr << "Waiting for " << inFlight << " requests in flight..." << std::endl;
+    condition.wait(lock, [this] { return inFlight == 0; });
+    report(Clock::now());
+
+    double measuredSeconds = std::max(0.001, seconds(std::min(stoppedAt, measureUntil) - measureFrom));
+    printSummary(measuredSeconds);
+    if (!options.jsonPath.empty() && !writeJson(measuredSeconds)) {
+        return 2;
+    }
+    if (neverSent > 0) {
+        std::cerr << neverSent << " scheduled requests were never sent (all slots busy); "
+                  << "their waits are included in the latencies" << std::endl;
+    }
+    return errors == 0 ? 0 : 1;
+}
+
+void LoadGenerator::printSummary(double measuredSeconds) {
+    bool openLoop = options.rate > 0.0;
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "\nRequests: " << completed << " in " << measuredSeconds << "s, "
+              << completed / measuredSeconds << " req/s achieved";
+    if (openLoop) {
+        std::cout << " (" << options.rate << " scheduled)";
+    }
+    std::cout << ", " << errors << " errors" << std::endl;
+
+    auto printHistogram = [](const std::string& title, const LatencyHistogram& histogram) {
+        if (histogram.totalCount() == 0) {
+            return;
+        }
+        std::cout << title << " (ms): min " << histogram.min() / 1000.0 << "  mean " << histogram.mean() / 1000.0;
+        for (double percentile : {50.0, 90.0, 99.0, 99.9, 99.99}) {
+            std::cout << "  p" << std::defaultfloat << std::setprecision(6) << percentile
+                      << std::fixed << std::setprecision(2) << " " << histogram.valueAtPercentile(percentile) / 1000.0;
+        }
+        std::cout << "  max " << histogram.max() / 1000.0 << std::endl;
+    };
+    printHistogram(openLoop ? "Latency from schedule" : "Latency (closed loop, service time)", latency);
+    if (openLoop) {
+        printHistogram("Service time", serviceTime);
+    }
+    printHistogram("Time to first token", firstToken);
+
+    if (!samples.empty()) {
+        auto peak = std::max_element(samples.begin(), samples.end(), [](const Sample& a, const Sample& b) {
+            return a.rssBytes < b.rssBytes;
+        });
+        std::cout << "RSS: " << samples.front().rssBytes / (1024.0 * 1024.0) << " MB at start, "
+                  << peak->rssBytes / (1024.0 * 1024.0) << " MB peak, "
+                  << samples.back().rssBytes / (1024.0 * 1024.0) << " MB at end; threads peak "
+                  << std::max_element(samples.begin(), samples.end(), [](const Sample& a, const Sample& b) {
+                         return a.threads < b.threads;
+                     })->threads << std::endl;
+    }
+
+    for (const auto& [kind, count] : errorKinds) {
+        std::cout << "  " << std::setw(6) << count << "  " << kind << std::endl;
+    }
+}
+
+bool LoadGenerator::writeJson(double measuredSeconds) const {
+    auto histogramJson = [](const LatencyHistogram& histogram) {
+        nlohmann::json percentiles = nlohmann::json::object();
+        for (double percentile : {50.0, 75.0, 90.0, 95.0, 99.0, 99.9, 99.99, 100.0}) {
+            std::ostringstream key;
+            key << percentile;
+            percentiles[key.str()] = histogram.valueAtPercentile(percentile);
+        }
+        return nlohmann::json{
+            {"count", histogram.totalCount()},
+            {"min_us", histogram.min()},
+            {"mean_us", histogram.mean()},
+            {"max_us", histogram.max()},
+            {"percentiles_us", percentiles}
+        };
+    };
+
+    nlohmann::json timeline = nlohmann::json::array();
+    for (const auto& sample : samples) {
+        timeline.push_back({
+            {"elapsed_s", sample.elapsed},
+            {"completed", sample.completed},
+            {"errors", sample.errors},
+            {"in_flight", sample.inFlight},
+            {"backlog", sample.backlog},
+            {"requests_per_second", sample.requestsPerSecond},
+            {"p50_us", sample.p50Micros},
+            {"p99_us", sample.p99Micros},
+            {"rss_bytes", sample.rssBytes},
+            {"threads", sample.threads}
+        });
+    }
+
+    nlohmann::json report = {
+        {"mode", options.rate > 0.0 ? "open" : "closed"},
+        {"scheduled_rate", options.rate},
+        {"concurrency", options.concurrency},
+        {"duration_s", measuredSeconds},
+        {"completed", completed},
+        {"errors", errors},
+        {"achieved_rate", completed / measuredSeconds},
+        {"latency", histogramJson(latency)},
+        {"service_time", histogramJson(serviceTime)},
+        {"time_to_first_token", histogramJson(firstToken)},
+        {"error_kinds", errorKinds},
+        {"timeline", timeline}
+    };
+
+    std::ofstream file(options.jsonPath);
+    file << report.dump(2) << std::endl;
+    if (!file) {
+        std::cerr << "Error: Cannot write " << options.jsonPath << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void printUsage() {
+    std::cerr << "Usage: synthara-loadgen [--endpoint URL] [--rate R | --concurrency N] [options]" << std::endl;
+    std::cerr << "  --endpoint URL      Server to load (default: the configured endpoints)" << std::endl;
+    std::cerr << "  --provider NAME     google or openai (default: the configured provider)" << std::endl;
+    std::cerr << "  --model ID          Model to request (default: the configured model)" << std::endl;
+    std::cerr << "  --rate R            Open loop: schedule R requests per second" << std::endl;
+    std::cerr << "  --concurrency N     Requests in flight at most (default: 8)" << std::endl;
+    std::cerr << "  --duration S        Seconds to measure (default: 30)" << std::endl;
+    std::cerr << "  --warmup S          Seconds of load before measuring (default: 0)" << std::endl;
+    std::cerr << "  --prompt TEXT       Prompt to send" << std::endl;
+    std::cerr << "  --prompt-bytes N    Pad the prompt to N bytes" << std::endl;
+    std::cerr << "  --stream            Also measure time to first token" << std::endl;
+    std::cerr << "  --interval S        Seconds between progress lines (default: 1)" << std::endl;
+    std::cerr << "  --json FILE         Write the report, including the time series, as JSON" << std::endl;
+    std::cerr << "Exit status: 0 no errors, 1 some requests failed, 2 usage or setup error" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "--endpoint" && hasValue) {
+            options.endpoint = argv[++i];
+        } else if (arg == "--provider" && hasValue) {
+            options.provider = argv[++i];
+        } else if (arg == "--model" && hasValue) {
+            options.model = argv[++i];
+        } else if (arg == "--rate" && hasValue) {
+            options.rate = std::strtod(argv[++i], nullptr);
+        } else if ((arg == "--concurrency" || arg == "-c") && hasValue) {
+            options.concurrency = std::max<size_t>(1, std::strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--duration" && hasValue) {
+            options.duration = std::strtod(argv[++i], nullptr);
+        } else if (arg == "--warmup" && hasValue) {
+            options.warmup = std::strtod(argv[++i], nullptr);
+        } else if (arg == "--prompt" && hasValue) {
+            options.prompt = argv[++i];
+        } else if (arg == "--prompt-bytes" && hasValue) {
+            options.promptBytes = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--stream") {
+            options.stream = true;
+        } else if (arg == "--interval" && hasValue) {
+            options.interval = std::max(0.1, std::strtod(argv[++i], nullptr));
+        } else if (arg == "--json" && hasValue) {
+            options.jsonPath = argv[++i];
+        } else if (arg == "--help" || arg == "-h") {
+            printUsage();
+            return 0;
+        } else {
+            std::cerr << "Error: Unknown argument: " << arg << std::endl;
+            printUsage();
+            return 2;
+        }
+    }
+
+    // The first Ctrl-C stops scheduling and waits for requests in flight; the second exits
+    struct sigaction action = {};
+    action.sa_handler = handleStopSignal;
+    action.sa_flags = SA_RESETHAND;
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+    int status;
+    {
+        LoadGenerator generator(options);
+        status = generator.run();
+    }
+    NetworkLoop::shutdown();
+    curl_global_cleanup();
+    return status;
+}
@@ -0,0 +1,1015 @@
+// synthara-mock: a local stand-in for the Gemini REST API.
+//
+// Speaks enough of the API for GoogleClient to run end to end without
+// credentials or network access: generateContent, streamGenerateContent (SSE),
+// countTokens, models.list/get, the Files upload and Batch API calls used by
+// batch jobs, and Google-style error payloads. POST /v1/chat/completions
+// answers in the OpenAI format for OpenAIClient. Latency, throughput, chunking
+// and faults are set from the command line or a JSON profile, so the client's
+// performance and failure handling can be measured and reproduced.
+//
+//   synthara-mock --port 8089 --ttfb 300 --tps 80 --fail 429:0.05
+//   SYNTHARA_GOOGLE_BASE_URL=http://127.0.0.1:8089 synthara -p "hello"
+
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cctype>
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using json = nlohmann::json;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+// How one generate request behaves
+struct Behavior {
+    int status = 200;               // Anything else returns an error payload
+    int ttfbMs = 50;                // Delay before the first byte of the response
+    int ttfbJitterMs = 0;           // Random extra delay, up to this much
+    double tokensPerSecond = 200.0; // Generation speed (0 = instant)
+    int replyTokens = 64;           // Length of each reply
+    int chunkTokens = 8;            // Tokens per streamed chunk
+    int stallMs = -1;               // Stop responding for this long, then drop the connection (0 = until the client gives up)
+    int stallAfterTokens = 0;       // Tokens sent before stalling
+};
+
+struct Profile {
+    Behavior defaults;
+    std::vector<std::pair<int, double>> errorRates;  // Status and probability
+    double stallRate = 0.0;                          // Fraction of requests that stall
+    int stallMs = 0;                                 // How long those stalls last (0 = until the client gives up)
+    int batchMs = 2000;                              // Time a batch job takes to finish
+    std::vector<json> script;                        // Behavior overrides for the first requests
+    bool loopScript = false;
+    std::vector<std::string> models = {"gemini-2.0-flash-lite", "gemini-2.0-flash", "gemini-2.5-flash", "gemini-2.5-pro"};
+    unsigned seed = 0;
+};
+
+struct Request {
+    std::string method;
+    std::string path;
+    std::map<std::string, std::string> query;
+    std::map<std::string, std::string> headers;  // Names lowercased
+    std::string body;
+};
+
+struct BatchJob {
+    std::string model;
+    std::string inputFile;
+    Clock::time_point finishesAt;
+};
+
+Profile profile;
+bool verbose = false;
+
+std::mutex stateMutex;
+std::mt19937 rng;
+size_t generateCount = 0;
+std::map<int, uint64_t> statusCounts;
+uint64_t requestCount = 0;
+uint64_t stallCount = 0;
+uint64_t bytesSent = 0;
+std::map<std::string, std::string> files;        // "files/N" -> content
+std::map<std::string, std::string> pendingUploads;  // upload id -> display name
+std::map<std::string, BatchJob> batches;        // "batches/N" -> job
+uint64_t nextId = 1;
+
+const char* kWords[] = {
+    "the", "model", "streams", "tokens", "through", "a", "mock", "server", "so", "latency",
+    "and", "throughput", "can", "be", "measured", "without", "touching", "the", "real", "service"
+};
+
+void applyBehavior(Behavior& behavior, const json& overrides) {
+    behavior.status = overrides.value("status", behavior.status);
+    behavior.ttfbMs = overrides.value("ttfb_ms", behavior.ttfbMs);
+    behavior.ttfbJitterMs = overrides.value("ttfb_jitter_ms", behavior.ttfbJitterMs);
+    behavior.tokensPerSecond = overrides.value("tokens_per_second", behavior.tokensPerSecond);
+    behavior.replyTokens = overrides.value("reply_tokens", behavior.replyTokens);
+    behavior.chunkTokens = std::max(1, overrides.value("chunk_tokens", behavior.chunkTokens));
+    behavior.stallMs = overrides.value("stall_ms", behavior.stallMs);
+    behavior.stallAfterTokens = overrides.value("stall_after_tokens", behavior.stallAfterTokens);
+}
+
+bool loadProfile(const std::string& path) {
+    try {
+        std::ifstream file(path);
+        json config = json::parse(file);
+
+        applyBehavior(profile.defaults, config);
+        json errorRates = config.value("error_rates", json::object());
+        for (const auto& [status, rate] : errorRates.items()) {
+            profile.errorRates.push_back({std::stoi(status), rate.get<double>()});
+        }
+        // At the top level stall_ms is the length of random stalls; only script entries force one
+        profile.stallRate = config.value("stall_rate", profile.stallRate);
+        profile.stallMs = config.value("stall_ms", profile.stallMs);
+        profile.defaults.stallMs = -1;
+        profile.batchMs = config.value("batch_ms", profile.batchMs);
+        profile.script = config.value("script", std::vector<json>());
+        profile.loopScript = config.value("loop_script", false);
+        profile.models = config.value("models", profile.models);
+        profile.seed = config.value("seed", profile.seed);
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << "Error loading profile " << path << ": " << e.what() << std::endl;
+        return false;
+    }
+}
+
+// Scripted behavior for the next request, or the defaults with random faults
+Behavior nextBehavior() {
+    std::lock_guard<std::mutex> lock(stateMutex);
+    Behavior behavior = profile.defaults;
+    size_t n = generateCount++;
+
+    if (!profile.script.empty() && (n < profile.script.size() || profile.loopScript)) {
+        applyBehavior(behavior, profile.script[n % profile.script.size()]);
+        return behavior;
+    }
+
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    double roll = uniform(rng);
+    for (const auto& [status, rate] : profile.errorRates) {
+        if (roll < rate) {
+            behavior.status = status;
+            return behavior;
+        }
+        roll -= rate;
+    }
+    if (uniform(rng) < profile.stallRate) {
+        behavior.stallMs = profile.stallMs;
+    }
+    return behavior;
+}
+
+int jitter(int maxMs) {
+    if (maxMs <= 0) {
+        return 0;
+    }
+    std::lock_guard<std::mutex> lock(stateMutex);
+    return std::uniform_int_distribution<int>(0, maxMs)(rng);
+}
+
+std::string statusText(int status) {
+    switch (status) {
+        case 200: return "OK";
+        case 400: return "Bad Request";
+        case 403: return "Forbidden";
+        case 404: return "Not Found";
+        case 429: return "Too Many Requests";
+        case 500: return "Internal Server Error";
+        case 503: return "Service Unavailable";
+        case 504: return "Gateway Timeout";
+        default: return "Error";
+    }
+}
+
+// Google RPC status name for an HTTP status
+std::string rpcStatus(int status) {
+    switch (status) {
+        case 400: return "INVALID_ARGUMENT";
+        case 403: return "PERMISSION_DENIED";
+        case 404: return "NOT_FOUND";
+        case 429: return "RESOURCE_EXHAUSTED";
+        case 503: return "UNAVAILABLE";
+        case 504: return "DEADLINE_EXCEEDED";
+        default: return "INTERNAL";
+    }
+}
+
+json errorPayload(int status, const std::string& message) {
+    return {{"error", {{"code", status}, {"message", message}, {"status", rpcStatus(status)}}}};
+}
+
+bool sendAll(int fd, const std::string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        sent += static_cast<size_t>(n);
+    }
+    std::lock_guard<std::mutex> lock(stateMutex);
+    bytesSent += data.size();
+    return true;
+}
+
+bool sendResponse(int fd, int status, const std::string& body, const std::string& contentType = "application/json",
+                  const std::vector<std::string>& extraHeaders = {}) {
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        ++statusCounts[status];
+    }
+
+    std::ostringstream response;
+    response << "HTTP/1.1 " << status << " " << statusText(status) << "\r\n"
+             << "Content-Type: " << contentType << "\r\n"
+             << "Content-Length: " << body.size() << "\r\n";
+    for (const auto& header : extraHeaders) {
+        response << header << "\r\n";
+    }
+    response << "\r\n" << body;
+    return sendAll(fd, response.str());
+}
+
+bool sendJson(int fd, int status, const json& body, const std::vector<std::string>& extraHeaders = {}) {
+    return sendResponse(fd, status, body.dump(), "application/json", extraHeaders);
+}
+
+bool sendError(int fd, int status, const std::string& message) {
+    return sendJson(fd, status, errorPayload(status, message));
+}
+
+// Parse a decimal count such as a Content-Length; false unless the whole text is one
+bool parseCount(const std::string& text, size_t& value) {
+    if (text.empty() || !std::all_of(text.begin(), text.end(), ::isdigit)) {
+        return false;
+    }
+    errno = 0;
+    unsigned long long parsed = std::strtoull(text.c_str(), nullptr, 10);
+    if (errno == ERANGE || parsed > std::numeric_limits<size_t>::max()) {
+        return false;
+    }
+    value = static_cast<size_t>(parsed);
+    return true;
+}
+
+// Hold the connection open without answering, then let the caller drop it
+void stall(int fd, int stallMs) {
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        ++stallCount;
+    }
+
+    // Wait for the client to hang up (or the stall to end), discarding anything it sends
+    auto until = Clock::now() + std::chrono::milliseconds(stallMs);
+    char discard[4096];
+    while (stallMs == 0 || Clock::now() < until) {
+        struct pollfd pfd = {fd, POLLIN, 0};
+        if (poll(&pfd, 1, 100) > 0) {
+            if (recv(fd, discard, sizeof(discard), 0) <= 0) {
+                return;
+            }
+        }
+    }
+}
+
+size_t estimateTokens(const std::string& text) {
+    return (text.size() + 3) / 4;
+}
+
+// Plain text of everything in a generateContent request
+std::string requestText(const json& request) {
+    std::string text;
+    auto collect = [&text](const json& content) {
+        for (const auto& part : content.value("parts", json::array())) {
+            if (part.contains("text") && part["text"].is_string()) {
+                text += part["text"].get<std::string>() + "\n";
+            }
+        }
+    };
+    if (request.contains("systemInstruction")) {
+        collect(request["systemInstruction"]);
+    }
+    for (const auto& content : request.value("contents", json::array())) {
+        collect(content);
+    }
+    return text;
+}
+
+// Deterministic reply words: an echo of the last prompt followed by filler
+std::vector<std::string> replyWords(std::string prompt, int tokens) {
+    if (prompt.size() > 40) {
+        prompt = prompt.substr(0, 40) + "...";
+    }
+
+    std::vector<std::string> words = {"Mock", "reply", "to", "\"" + prompt + "\":"};
+    for (int i = static_cast<int>(words.size()); i < tokens; ++i) {
+        words.push_back(kWords[i % (sizeof(kWords) / sizeof(kWords[0]))]);
+    }
+    words.resize(std::max(tokens, 1));
+    return words;
+}
+
+std::vector<std::string> replyWords(const json& request, int tokens) {
+    std::string prompt;
+    const auto& contents = request.value("contents", json::array());
+    if (!contents.empty()) {
+        for (const auto& part : contents.back().value("parts", json::array())) {
+            prompt += part.value("text", "");
+        }
+    }
+    return replyWords(prompt, tokens);
+}
+
+std::string joinWords(const std::vector<std::string>& words, size_t first, size_t last) {
+    std::string text;
+    for (size_t i = first; i < last && i < words.size(); ++i) {
+        if (i > 0) {
+            text += ' ';
+        }
+        text += words[i];
+    }
+    return text;
+}
+
+json usageMetadata(const json& request, int replyTokens) {
+    int promptTokens = static_cast<int>(estimateTokens(requestText(request)));
+    return {{"promptTokenCount", promptTokens}, {"candidatesTokenCount", replyTokens},
+            {"totalTokenCount", promptTokens + replyTokens}};
+}
+
+json generateResponse(const std::string& text, const std::string& model, const json& usage, bool finished) {
+    json candidate = {{"content", {{"role", "model"}, {"parts", json::array({{{"text", text}}})}}}, {"index", 0}};
+    json response = {{"candidates", json::array({candidate})}, {"modelVersion", model}};
+    if (finished) {
+        response["candidates"][0]["finishReason"] = "STOP";
+        response["usageMetadata"] = usage;
+    }
+    return response;
+}
+
+json modelResource(const std::string& id) {
+    return {
+        {"name", "models/" + id},
+        {"displayName", "Mock " + id},
+        {"description", "Served by synthara-mock"},
+        {"inputTokenLimit", 1048576},
+        {"outputTokenLimit", 8192},
+        {"supportedGenerationMethods", {"generateContent", "countTokens", "batchGenerateContent"}}
+    };
+}
+
+bool knownModel(const std::string& model) {
+    return profile.models.empty() ||
+           std::find(profile.models.begin(), profile.models.end(), model) != profile.models.end();
+}
+
+void sleepUntil(Clock::time_point when) {
+    std::this_thread::sleep_until(when);
+}
+
+// Time at which the given number of tokens has been generated
+Clock::time_point tokenDeadline(Clock::time_point start, const Behavior& behavior, int tokens) {
+    if (behavior.tokensPerSecond <= 0.0) {
+        return start;
+    }
+    return start + std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(tokens / behavior.tokensPerSecond));
+}
+
+// Stream the reply as server-sent events over a chunked response, one event per chunk
+// of tokens, paced and stalled as the behavior says. event(text, finished) formats one.
+// Returns false when the connection must be closed.
+bool streamReply(int fd, const Behavior& behavior, const std::vector<std::string>& words,
+                 const std::function<std::string(const std::string&, bool)>& event) {
+    bool stalls = behavior.stallMs >= 0;
+    auto generationStart = Clock::now();
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        ++statusCounts[200];
+    }
+    std::string head = "HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\nTransfer-Encoding: chunked\r\n\r\n";
+    if (!sendAll(fd, head)) {
+        return false;
+    }
+
+    auto sendChunk = [fd](const std::string& data) {
+        std::ostringstream chunk;
+        chunk << std::hex << data.size() << "\r\n" << data << "\r\n";
+        return sendAll(fd, chunk.str());
+    };
+
+    size_t sentTokens = 0;
+    while (sentTokens < words.size()) {
+        if (stalls && static_cast<int>(sentTokens) >= behavior.stallAfterTokens) {
+            stall(fd, behavior.stallMs);
+            return false;
+        }
+
+        size_t next = std::min(words.size(), sentTokens + behavior.chunkTokens);
+        sleepUntil(tokenDeadline(generationStart, behavior, static_cast<int>(next)));
+
+        if (!sendChunk(event(joinWords(words, sentTokens, next), next == words.size()))) {
+            return false;
+        }
+        sentTokens = next;
+    }
+    return sendAll(fd, "0\r\n\r\n");
+}
+
+// Returns false when the connection must be closed
+bool handleGenerate(int fd, const json& request, const std::string& model, bool streaming) {
+    Behavior behavior = nextBehavior();
+    auto start = Clock::now();
+    sleepUntil(start + std::chrono::milliseconds(behavior.ttfbMs + jitter(behavior.ttfbJitterMs)));
+
+    if (behavior.status != 200) {
+        std::string message = behavior.status == 429 ? "Resource has been exhausted (e.g. check quota)."
+                                                     : "Injected failure from synthara-mock";
+        return sendError(fd, behavior.status, message);
+    }
+
+    std::vector<std::string> words = replyWords(request, behavior.replyTokens);
+    json usage = usageMetadata(request, static_cast<int>(words.size()));
+
+    if (!streaming) {
+        if (behavior.stallMs >= 0) {
+            stall(fd, behavior.stallMs);
+            return false;
+        }
+        sleepUntil(tokenDeadline(Clock::now(), behavior, static_cast<int>(words.size())));
+        return sendJson(fd, 200, generateResponse(joinWords(words, 0, words.size()), model, usage, true));
+    }
+
+    return streamReply(fd, behavior, words, [&](const std::string& text, bool finished) {
+        return "data: " + generateResponse(text, model, usage, finished).dump() + "\r\n\r\n";
+    });
+}
+
+// OpenAI-style chat completion, streamed when the request asks for it
+bool handleChatCompletion(int fd, const json& request) {
+    Behavior behavior = nextBehavior();
+    sleepUntil(Clock::now() + std::chrono::milliseconds(behavior.ttfbMs + jitter(behavior.ttfbJitterMs)));
+
+    if (behavior.status != 200) {
+        std::string type = behavior.status == 429 ? "rate_limit_error" : "server_error";
+        return sendJson(fd, behavior.status,
+                        {{"error", {{"message", "Injected failure from synthara-mock"}, {"type", type}}}});
+    }
+
+    std::string prompt;
+    std::string text;
+    for (const auto& message : request.at("messages")) {
+        prompt = message.value("content", "");
+        text += prompt + "\n";
+    }
+    std::string model = request.value("model", "mock");
+    std::vector<std::string> words = replyWords(prompt, behavior.replyTokens);
+    int promptTokens = static_cast<int>(estimateTokens(text));
+    int replyTokens = static_cast<int>(words.size());
+    json usage = {{"prompt_tokens", promptTokens}, {"completion_tokens", replyTokens},
+                  {"total_tokens", promptTokens + replyTokens}};
+
+    if (!request.value("stream", false)) {
+        if (behavior.stallMs >= 0) {
+            stall(fd, behavior.stallMs);
+            return false;
+        }
+        sleepUntil(tokenDeadline(Clock::now(), behavior, replyTokens));
+        json choice = {{"index", 0}, {"finish_reason", "stop"},
+                       {"message", {{"role", "assistant"}, {"content", joinWords(words, 0, words.size())}}}};
+        return sendJson(fd, 200, {{"id", "chatcmpl-mock"}, {"object", "chat.completion"}, {"model", model},
+                                  {"choices", json::array({choice})}, {"usage", usage}});
+    }
+
+    // The last event carries the finish reason, then usage and the [DONE] marker
+    return streamReply(fd, behavior, words, [&](const std::string& chunkText, bool finished) {
+        json choice = {{"index", 0}, {"delta", {{"content", chunkText}}},
+                       {"finish_reason", finished ? json("stop") : json(nullptr)}};
+        json chunk = {{"id", "chatcmpl-mock"}, {"object", "chat.completion.chunk"}, {"model", model},
+                      {"choices", json::array({choice})}};
+        std::string events = "data: " + chunk.dump() + "\n\n";
+        if (finished) {
+            chunk["choices"] = json::array();
+            chunk["usage"] = usage;
+            events += "data: " + chunk.dump() + "\n\ndata: [DONE]\n\n";
+        }
+        return events;
+    });
+}
+
+bool handleCountTokens(int fd, const json& request) {
+    // countTokens takes either plain contents or a full generateContentRequest
+    const json& body = request.contains("generateContentRequest") ? request["generateContentRequest"] : request;
+    return sendJson(fd, 200, {{"totalTokens", estimateTokens(requestText(body))}});
+}
+
+bool handleListModels(int fd, const Request& request) {
+    size_t pageSize = 50;
+    size_t offset = 0;
+    if (request.query.count("pageSize") && !parseCount(request.query.at("pageSize"), pageSize)) {
+        return sendError(fd, 400, "Invalid pageSize: " + request.query.at("pageSize"));
+    }
+    if (request.query.count("pageToken") && !parseCount(request.query.at("pageToken"), offset)) {
+        return sendError(fd, 400, "Invalid pageToken: " + request.query.at("pageToken"));
+    }
+    pageSize = std::clamp<size_t>(pageSize, 1, profile.models.size() + 1);
+    offset = std::min(offset, profile.models.size());
+
+    json models = json::array();
+    for (size_t i = offset; i < profile.models.size() && i < offset + pageSize; ++i) {
+        models.push_back(modelResource(profile.models[i]));
+    }
+    json response = {{"models", models}};
+    if (offset + pageSize < profile.models.size()) {
+        response["nextPageToken"] = std::to_string(offset + pageSize);
+    }
+    return sendJson(fd, 200, response);
+}
+
+bool handleUpload(int fd, const Request& request) {
+    std::string command = request.headers.count("x-goog-upload-command") ? request.headers.at("x-goog-upload-command") : "";
+
+    // Start: hand out an upload URL on this server
+    if (command == "start") {
+        std::string id;
+        {
+            std::lock_guard<std::mutex> lock(stateMutex);
+            id = std::to_string(nextId++);
+            pendingUploads[id] = request.body;
+        }
+        std::string host = request.headers.count("host") ? request.headers.at("host") : "localhost";
+        return sendJson(fd, 200, json::object(),
+                        {"X-Goog-Upload-URL: http://" + host + "/upload/v1beta/files?upload_id=" + id,
+                         "X-Goog-Upload-Status: active"});
+    }
+
+    // Upload and finalize in one go
+    std::string id = request.query.count("upload_id") ? request.query.at("upload_id") : "";
+    std::string name;
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        if (!pendingUploads.erase(id)) {
+            name.clear();
+        } else {
+            name = "files/" + std::to_string(nextId++);
+            files[name] = request.body;
+        }
+    }
+    if (name.empty()) {
+        return sendError(fd, 404, "Unknown upload");
+    }
+    return sendJson(fd, 200, {{"file", {{"name", name}, {"sizeBytes", std::to_string(request.body.size())},
+                                        {"mimeType", "application/jsonl"}, {"state", "ACTIVE"}}}});
+}
+
+bool handleCreateBatch(int fd, const json& request, const std::string& model) {
+    json batch = request.value("batch", json::object());
+    std::string inputFile = batch.value("input_config", json::object()).value("file_name", "");
+    if (inputFile.empty()) {
+        inputFile = batch.value("inputConfig", json::object()).value("fileName", "");
+    }
+
+    std::string name;
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        if (!files.count(inputFile)) {
+            name.clear();
+        } else {
+            name = "batches/" + std::to_string(nextId++);
+            batches[name] = {model, inputFile, Clock::now() + std::chrono::milliseconds(profile.batchMs)};
+        }
+    }
+    if (name.empty()) {
+        return sendError(fd, 400, "Unknown input file: " + inputFile);
+    }
+    return sendJson(fd, 200, {{"name", name}, {"metadata", {{"model", "models/" + model}, {"state", "BATCH_STATE_PENDING"}}}});
+}
+
+bool handleGetBatch(int fd, const std::string& name) {
+    json response;
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        auto it = batches.find(name);
+        if (it == batches.end()) {
+            response = nullptr;
+        } else if (Clock::now() < it->second.finishesAt) {
+            response = {{"name", name}, {"metadata", {{"state", "BATCH_STATE_RUNNING"},
+                                                      {"inputConfig", {{"fileName", it->second.inputFile}}}}}};
+        } else {
+            response = {{"name", name}, {"done", true},
+                        {"metadata", {{"state", "BATCH_STATE_SUCCEEDED"},
+                                      {"inputConfig", {{"fileName", it->second.inputFile}}}}},
+                        {"response", {{"responsesFile", name + "/results"}}}};
+        }
+    }
+    if (response.is_null()) {
+        return sendError(fd, 404, "Batch not found: " + name);
+    }
+    return sendJson(fd, 200, response);
+}
+
+// Results of a finished batch, one keyed line per input line
+bool handleDownload(int fd, const std::string& fileName) {
+    std::string batchName = fileName.substr(0, fileName.rfind("/results"));
+    std::string input;
+    std::string model;
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        auto job = batches.find(batchName);
+        if (job != batches.end() && files.count(job->second.inputFile)) {
+            input = files[job->second.inputFile];
+            model = job->second.model;
+        }
+    }
+    if (model.empty()) {
+        return sendError(fd, 404, "File not found: " + fileName);
+    }
+
+    std::string output;
+    std::istringstream lines(input);
+    std::string line;
+    while (std::getline(lines, line)) {
+        if (line.empty()) {
+            continue;
+        }
+        json entry = json::parse(line, nullptr, false);
+        if (entry.is_discarded()) {
+            continue;
+        }
+        json request = entry.value("request", json::object());
+        Behavior behavior = nextBehavior();
+        json result = {{"key", entry.value("key", "")}};
+        if (behavior.status != 200) {
+            result["error"] = errorPayload(behavior.status, "Injected failure from synthara-mock")["error"];
+        } else {
+            std::vector<std::string> words = replyWords(request, behavior.replyTokens);
+            result["response"] = generateResponse(joinWords(words, 0, words.size()), model,
+                                                  usageMetadata(request, static_cast<int>(words.size())), true);
+        }
+        output += result.dump() + "\n";
+    }
+    return sendResponse(fd, 200, output, "application/octet-stream");
+}
+
+bool parseRequest(const std::string& head, Request& request) {
+    std::istringstream stream(head);
+    std::string line;
+    if (!std::getline(stream, line)) {
+        return false;
+    }
+    std::istringstream requestLine(line);
+    std::string target;
+    requestLine >> request.method >> target;
+
+    size_t queryStart = target.find('?');
+    request.path = target.substr(0, queryStart);
+    if (queryStart != std::string::npos) {
+        std::istringstream query(target.substr(queryStart + 1));
+        std::string pair;
+        while (std::getline(query, pair, '&')) {
+            size_t eq = pair.find('=');
+            request.query[pair.substr(0, eq)] = eq == std::string::npos ? "" : pair.substr(eq + 1);
+        }
+    }
+
+    while (std::getline(stream, line)) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        size_t colon = line.find(':');
+        if (colon == std::string::npos) {
+            continue;
+        }
+        std::string name = line.substr(0, colon);
+        std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+        size_t valueStart = line.find_first_not_of(' ', colon + 1);
+        request.headers[name] = valueStart == std::string::npos ? "" : line.substr(valueStart);
+    }
+    return !request.method.empty();
+}
+
+// Read one request from the connection; false when the client is gone
+bool readRequest(int fd, std::string& buffer, Request& request) {
+    char data[16384];
+    size_t headerEnd;
+    while ((headerEnd = buffer.find("\r\n\r\n")) == std::string::npos) {
+        ssize_t n = recv(fd, data, sizeof(data), 0);
+        if (n <= 0) {
+            return false;
+        }
+        buffer.append(data, static_cast<size_t>(n));
+    }
+
+    if (!parseRequest(buffer.substr(0, headerEnd), request)) {
+        return false;
+    }
+    buffer.erase(0, headerEnd + 4);
+
+    // A bad length leaves the rest of the stream unreadable, so the connection ends after the error
+    size_t length = 0;
+    if (request.headers.count("content-length") && !parseCount(request.headers["content-length"], length)) {
+        sendError(fd, 400, "Invalid Content-Length: " + request.headers["content-length"]);
+        return false;
+    }
+    while (buffer.size() < length) {
+        ssize_t n = recv(fd, data, sizeof(data), 0);
+        if (n <= 0) {
+            return false;
+        }
+        buffer.append(data, static_cast<size_t>(n));
+    }
+    request.body = buffer.substr(0, length);
+    buffer.erase(0, length);
+    return true;
+}
+
+// Route one request; false when the connection must be closed
+bool handle(int fd, const Request& request) {
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        ++requestCount;
+    }
+    if (verbose) {
+        std::cerr << request.method << " " << request.path << std::endl;
+    }
+
+    // Endpoint probes only care that something answers
+    if (request.method == "HEAD") {
+        return sendAll(fd, "HTTP/1.1 200 OK\r\nContent-Length: 0\r\n\r\n");
+    }
+
+    if (request.path == "/mock/stats") {
+        json stats;
+        {
+            std::lock_guard<std::mutex> lock(stateMutex);
+            json statuses = json::object();
+            for (const auto& [status, count] : statusCounts) {
+                statuses[std::to_string(status)] = count;
+            }
+            stats = {{"requests", requestCount}, {"generate_requests", generateCount},
+                     {"stalls", stallCount}, {"bytes_sent", bytesSent}, {"statuses", statuses}};
+        }
+        return sendJson(fd, 200, stats);
+    }
+
+    if (request.path == "/upload/v1beta/files" && request.method == "POST") {
+        return handleUpload(fd, request);
+    }
+    if (request.path.rfind("/download/v1beta/", 0) == 0 && request.method == "GET") {
+        std::string name = request.path.substr(std::strlen("/download/v1beta/"));
+        return handleDownload(fd, name.substr(0, name.rfind(":download")));
+    }
+
+    if (request.path == "/v1/chat/completions" && request.method == "POST") {
+        json body = json::parse(request.body, nullptr, false);
+        if (body.is_discarded()) {
+            return sendJson(fd, 400, {{"error", {{"message", "Invalid JSON body"}, {"type", "invalid_request_error"}}}});
+        }
+        try {
+            return handleChatCompletion(fd, body);
+        } catch (const json::exception& e) {
+            return sendJson(fd, 400, {{"error", {{"message", std::string("Invalid request: ") + e.what()},
+                                                 {"type", "invalid_request_error"}}}});
+        }
+    }
+
+    // Everything else lives under an API version
+    std::string path;
+    for (const char* version : {"/v1beta/", "/v1/"}) {
+        if (request.path.rfind(version, 0) == 0) {
+            path = request.path.substr(std::strlen(version));
+            break;
+        }
+    }
+    if (path.empty()) {
+        return sendError(fd, 404, "Unknown path: " + request.path);
+    }
+
+    bool hasKey = (request.query.count("key") && !request.query.at("key").empty()) ||
+                  request.headers.count("x-goog-api-key");
+    if (!hasKey) {
+        return sendError(fd, 400, "API key not valid. Please pass a valid API key.");
+    }
+
+    if (path == "models" && request.method == "GET") {
+        return handleListModels(fd, request);
+    }
+    if (path.rfind("batches/", 0) == 0 && request.method == "GET") {
+        return handleGetBatch(fd, path);
+    }
+    if (path.rfind("files/", 0) == 0 && request.method == "DELETE") {
+        {
+            std::lock_guard<std::mutex> lock(stateMutex);
+            files.erase(path);
+        }
+        return sendResponse(fd, 200, "{}");
+    }
+    if (path.rfind("cachedContents", 0) == 0) {
+        return sendError(fd, 400, "Context caching is not supported by synthara-mock");
+    }
+
+    if (path.rfind("models/", 0) == 0) {
+        std::string name = path.substr(std::strlen("models/"));
+        size_t colon = name.find(':');
+        std::string model = name.substr(0, colon);
+        std::string method = colon == std::string::npos ? "" : name.substr(colon + 1);
+
+        if (!knownModel(model)) {
+            return sendError(fd, 404, "models/" + model + " is not found for API version v1beta.");
+        }
+        if (method.empty() && request.method == "GET") {
+            return sendJson(fd, 200, modelResource(model));
+        }
+
+        json body = json::parse(request.body, nullptr, false);
+        if (request.method != "POST" || body.is_discarded()) {
+            return sendError(fd, 400, "Invalid JSON payload received.");
+        }
+        // Well-formed JSON of the wrong shape is a client error, as it is upstream
+        try {
+            if (method == "generateContent") {
+                return handleGenerate(fd, body, model, false);
+            }
+            if (method == "streamGenerateContent") {
+                return handleGenerate(fd, body, model, true);
+            }
+            if (method == "countTokens") {
+                return handleCountTokens(fd, body);
+            }
+            if (method == "batchGenerateContent") {
+                return handleCreateBatch(fd, body, model);
+            }
+        } catch (const json::exception& e) {
+            return sendError(fd, 400, std::string("Invalid request: ") + e.what());
+        }
+    }
+
+    return sendError(fd, 404, "Unknown method: " + request.path);
+}
+
+void serveConnection(int fd) {
+    std::string buffer;
+    Request request;
+    while (readRequest(fd, buffer, request)) {
+        bool keepAlive = !(request.headers.count("connection") && request.headers["connection"] == "close");
+        if (!handle(fd, request) || !keepAlive) {
+            break;
+        }
+        request = Request();
+    }
+    close(fd);
+}
+
+int listenOn(int port, const std::string& unixPath) {
+    int fd;
+    if (!unixPath.empty()) {
+        fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        struct sockaddr_un address = {};
+        address.sun_family = AF_UNIX;
+        std::strncpy(address.sun_path, unixPath.c_str(), sizeof(address.sun_path) - 1);
+        unlink(unixPath.c_str());
+        if (fd < 0 || bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+            return -1;
+        }
+    } else {
+        fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        int reuse = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        struct sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(static_cast<uint16_t>(port));
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (fd < 0 || bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+            return -1;
+        }
+    }
+    if (listen(fd, 512) != 0) {
+        return -1;
+    }
+    return fd;
+}
+
+void printUsage() {
+    std::cerr << "Usage: synthara-mock [--port N | --unix PATH] [options]" << std::endl;
+    std::cerr << "  --port N            Listen on 127.0.0.1:N (default: 8089)" << std::endl;
+    std::cerr << "  --unix PATH         Listen on a Unix domain socket instead" << std::endl;
+    std::cerr << "  --profile FILE      Load settings from a JSON profile (flags given later override it)" << std::endl;
+    std::cerr << "  --ttfb MS           Delay before the first response byte (default: 50)" << std::endl;
+    std::cerr << "  --jitter MS         Random extra first-byte delay, up to MS" << std::endl;
+    std::cerr << "  --tps N             Tokens generated per second, 0 for instant (default: 200)" << std::endl;
+    std::cerr << "  --reply-tokens N    Tokens per reply (default: 64)" << std::endl;
+    std::cerr << "  --chunk-tokens N    Tokens per streamed chunk (default: 8)" << std::endl;
+    std::cerr << "  --fail STATUS:RATE  Answer STATUS for this fraction of requests (repeatable)" << std::endl;
+    std::cerr << "  --stall RATE        Stall this fraction of requests" << std::endl;
+    std::cerr << "  --stall-ms MS       How long a stall lasts before the connection drops (0: until the client gives up)" << std::endl;
+    std::cerr << "  --stall-after N     Tokens streamed before a stall (default: 0)" << std::endl;
+    std::cerr << "  --batch-ms MS       Time a batch job takes to finish (default: 2000)" << std::endl;
+    std::cerr << "  --seed N            Seed for injected faults and jitter" << std::endl;
+    std::cerr << "  --verbose           Log each request" << std::endl;
+    std::cerr << "Profile keys: ttfb_ms, ttfb_jitter_ms, tokens_per_second, reply_tokens, chunk_tokens," << std::endl;
+    std::cerr << "stall_ms, stall_after_tokens, stall_rate, error_rates {\"429\": 0.1}, batch_ms, models, seed," << std::endl;
+    std::cerr << "and script: [{\"status\": 429}, {\"ttfb_ms\": 2000}, ...] applied to the first requests in order" << std::endl;
+    std::cerr << "(loop_script: true repeats it). GET /mock/stats returns request counters." << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    int port = 8089;
+    std::string unixPath;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "--port" && hasValue) {
+            port = std::atoi(argv[++i]);
+        } else if (arg == "--unix" && hasValue) {
+            unixPath = argv[++i];
+        } else if (arg == "--profile" && hasValue) {
+            if (!loadProfile(argv[++i])) {
+                return 2;
+            }
+        } else if (arg == "--ttfb" && hasValue) {
+            profile.defaults.ttfbMs = std::atoi(argv[++i]);
+        } else if (arg == "--jitter" && hasValue) {
+            profile.defaults.ttfbJitterMs = std::atoi(argv[++i]);
+        } else if (arg == "--tps" && hasValue) {
+            profile.defaults.tokensPerSecond = std::atof(argv[++i]);
+        } else if (arg == "--reply-tokens" && hasValue) {
+            profile.defaults.replyTokens = std::atoi(argv[++i]);
+        } else if (arg == "--chunk-tokens" && hasValue) {
+            profile.defaults.chunkTokens = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--fail" && hasValue) {
+            std::string spec = argv[++i];
+            size_t colon = spec.find(':');
+            if (colon == std::string::npos) {
+                std::cerr << "Error: --fail takes STATUS:RATE" << std::endl;
+                return 2;
+            }
+            profile.errorRates.push_back({std::atoi(spec.substr(0, colon).c_str()), std::atof(spec.substr(colon + 1).c_str())});
+        } else if (arg == "--stall" && hasValue) {
+            profile.stallRate = std::atof(argv[++i]);
+        } else if (arg == "--stall-ms" && hasValue) {
+            profile.stallMs = std::atoi(argv[++i]);
+        } else if (arg == "--stall-after" && hasValue) {
+            profile.defaults.stallAfterTokens = std::atoi(argv[++i]);
+        } else if (arg == "--batch-ms" && hasValue) {
+            profile.batchMs = std::atoi(argv[++i]);
+        } else if (arg == "--seed" && hasValue) {
+            profile.seed = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--verbose") {
+            verbose = true;
+        } else if (arg == "--help" || arg == "-h") {
+            printUsage();
+            return 0;
+        } else {
+            std::cerr << "Error: Unknown argument: " << arg << std::endl;
+            printUsage();
+            return 2;
+        }
+    }
+
+    rng.seed(profile.seed);
+    signal(SIGPIPE, SIG_IGN);
+
+    int listener = listenOn(port, unixPath);
+    if (listener < 0) {
+        std::cerr << "Error: Cannot listen on " << (unixPath.empty() ? "port " + std::to_string(port) : unixPath)
+                  << ": " << strerror(errno) << std::endl;
+        return 1;
+    }
+    std::cerr << "synthara-mock listening on "
+              << (unixPath.empty() ? "http://127.0.0.1:" + std::to_string(port) : unixPath) << std::endl;
+
+    while (true) {
+        int fd = accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+
+            // Out of descriptors: wait for connections to close instead of spinning
+            if (errno == EMFILE || errno == ENFILE || errno == ENOBUFS || errno == ENOMEM) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(50));
+                continue;
+            }
+            break;
+        }
+        int noDelay = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+        std::thread(serveConnection, fd).detach();
+    }
+
+    close(listener);
+    return 0;
+}